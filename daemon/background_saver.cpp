@@ -0,0 +1,182 @@
+// Copyright (c) 2022-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/** \file
+ * \brief Implementation of the background saver thread.
+ *
+ * The main thread prepares a save request which includes a snapshot of
+ * the settings and pushes it in the input FIFO. The saver thread writes
+ * the files from that snapshot and pushes the request in the output
+ * FIFO. Then it wakes up the main thread with the thread_done() signal
+ * so it can update the settings with the result of the save.
+ */
+
+// self
+//
+#include    "background_saver.h"
+
+#include    "server.h"
+
+
+// snaplogger
+//
+#include    <snaplogger/message.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace fluid_settings_daemon
+{
+
+
+
+/** \brief Initialize the saver thread runner.
+ *
+ * \param[in] name  The name of the thread.
+ * \param[in] saver  The saver which owns this runner.
+ */
+background_saver::runner::runner(
+          std::string const & name
+        , background_saver * saver)
+    : cppthread::runner(name)
+    , f_saver(saver)
+{
+}
+
+
+/** \brief Execute save requests until the saver is stopped.
+ *
+ * The function waits for requests on the input FIFO. The FIFO is marked
+ * as done when the saver gets stopped which makes pop_front() return
+ * false once all the requests were executed.
+ */
+void background_saver::runner::run()
+{
+    while(continue_running())
+    {
+        fluid_settings::save_request_t::pointer_t request;
+        if(!f_saver->f_in->pop_front(request, -1))
+        {
+            if(f_saver->f_in->is_done())
+            {
+                break;
+            }
+            continue;
+        }
+
+        fluid_settings::settings::execute_save(*request);
+
+        f_saver->f_out->push_back(request);
+        f_saver->thread_done();
+    }
+}
+
+
+
+/** \class background_saver
+ * \brief Save the settings in a separate thread.
+ *
+ * Writing the settings to disk and calling fsync() can take a while.
+ * The save is executed against a snapshot of the settings by a separate
+ * thread so the daemon keeps answering requests in the meantime.
+ */
+
+
+
+/** \brief Start the saver thread.
+ *
+ * \param[in] s  The server to which the results are sent.
+ */
+background_saver::background_saver(server * s)
+    : f_server(s)
+{
+    set_name("background_saver");
+
+    std::string const name("saver");
+    f_runner = std::make_shared<runner>(name, this);
+    f_thread = std::make_shared<cppthread::thread>(name, f_runner.get());
+    if(!f_thread->start())
+    {
+        SNAP_LOG_ERROR
+            << "could not start saver thread \""
+            << name
+            << "\"."
+            << SNAP_LOG_SEND;
+    }
+}
+
+
+/** \brief Stop the saver thread.
+ */
+background_saver::~background_saver()
+{
+    stop();
+}
+
+
+/** \brief Add a save request to the queue.
+ *
+ * \param[in] request  The save request to execute.
+ */
+void background_saver::push(fluid_settings::save_request_t::pointer_t const & request)
+{
+    f_in->push_back(request);
+}
+
+
+/** \brief Stop the thread.
+ *
+ * Contrary to the reader threads, a save in progress is not dropped.
+ * This function waits until it is done so the files are complete.
+ */
+void background_saver::stop()
+{
+    f_in->done(false);
+    if(f_thread != nullptr)
+    {
+        f_thread->stop();
+        f_thread.reset();
+    }
+    f_runner.reset();
+}
+
+
+/** \brief Report the result of the executed saves.
+ *
+ * This function is called in the main thread whenever the saver thread
+ * signals that it is done with a request.
+ */
+void background_saver::process_read()
+{
+    thread_done_signal::process_read();
+
+    fluid_settings::save_request_t::pointer_t request;
+    while(f_out->pop_front(request, 0))
+    {
+        f_server->save_done(request);
+    }
+}
+
+
+
+} // namespace fluid_settings_daemon
+// vim: ts=4 sw=4 et
@@ -0,0 +1,103 @@
+// Copyright (c) 2022-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+/** \file
+ * \brief Declaration of the background saver thread.
+ *
+ * The settings get saved by a separate thread so the main thread does
+ * not block while the files get written to disk.
+ */
+
+
+// fluid-settings
+//
+#include    <fluid-settings/settings.h>
+
+
+// eventdispatcher
+//
+#include    <eventdispatcher/thread_done_signal.h>
+
+
+// cppthread
+//
+#include    <cppthread/fifo.h>
+#include    <cppthread/thread.h>
+
+
+
+namespace fluid_settings_daemon
+{
+
+
+
+class server;
+
+
+typedef cppthread::fifo<fluid_settings::save_request_t::pointer_t>    save_request_fifo_t;
+
+
+class background_saver
+    : public ed::thread_done_signal
+{
+public:
+    typedef std::shared_ptr<background_saver>    pointer_t;
+
+                        background_saver(server * s);
+                        background_saver(background_saver const &) = delete;
+    virtual             ~background_saver() override;
+    background_saver &  operator = (background_saver const &) = delete;
+
+    void                push(fluid_settings::save_request_t::pointer_t const & request);
+    void                stop();
+
+    // thread_done_signal implementation
+    //
+    virtual void        process_read() override;
+
+private:
+    class runner
+        : public cppthread::runner
+    {
+    public:
+                            runner(
+                                  std::string const & name
+                                , background_saver * saver);
+
+        virtual void        run() override;
+
+    private:
+        background_saver *  f_saver = nullptr;
+    };
+
+    server *            f_server = nullptr;
+    save_request_fifo_t::pointer_t
+                        f_in = std::make_shared<save_request_fifo_t>();
+    save_request_fifo_t::pointer_t
+                        f_out = std::make_shared<save_request_fifo_t>();
+    std::shared_ptr<runner>
+                        f_runner = std::shared_ptr<runner>();
+    cppthread::thread::pointer_t
+                        f_thread = cppthread::thread::pointer_t();
+};
+
+
+
+} // namespace fluid_settings_daemon
+// vim: ts=4 sw=4 et
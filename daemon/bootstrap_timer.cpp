@@ -0,0 +1,67 @@
+// Copyright (c) 2022-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/** \file
+ * \brief The implementation of the bootstrap_timer.
+ *
+ * When a fluid-settings starts without any values, it waits for the
+ * state of another fluid-settings before answering the GET and LIST
+ * requests. If no other fluid-settings is found, or the stream stalls,
+ * this timer times out and the daemon starts answering with what it
+ * has. The server sets the date at which the timer times out.
+ */
+
+// self
+//
+#include    "bootstrap_timer.h"
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace fluid_settings_daemon
+{
+
+
+
+bootstrap_timer::bootstrap_timer(server * s)
+    : timer(-1)
+    , f_server(s)
+{
+    set_enable(false);
+}
+
+
+bootstrap_timer::~bootstrap_timer()
+{
+}
+
+
+void bootstrap_timer::process_timeout()
+{
+    set_enable(false);
+    f_server->bootstrap_timeout();
+}
+
+
+
+} // namespace fluid_settings_daemon
+// vim: ts=4 sw=4 et
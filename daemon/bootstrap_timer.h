@@ -0,0 +1,67 @@
+// Copyright (c) 2022-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+/** \file
+ * \brief The declaration of the bootstrap_timer class.
+ *
+ * This timer limits the time a new fluid-settings waits for the state
+ * of the other fluid-settings before it starts answering requests.
+ */
+
+
+// self
+//
+#include    "server.h"
+
+
+// eventdispatcher
+//
+#include    <eventdispatcher/timer.h>
+
+
+
+namespace fluid_settings_daemon
+{
+
+
+
+class server;
+
+
+class bootstrap_timer
+    : public ed::timer
+{
+public:
+    typedef std::shared_ptr<bootstrap_timer>    pointer_t;
+
+                        bootstrap_timer(server * s);
+                        bootstrap_timer(bootstrap_timer const &) = delete;
+    virtual             ~bootstrap_timer() override;
+    bootstrap_timer &   operator = (bootstrap_timer const &) = delete;
+
+    virtual void        process_timeout() override;
+
+private:
+    server *            f_server = nullptr;
+};
+
+
+
+} // namespace fluid_settings_daemon
+// vim: ts=4 sw=4 et
@@ -0,0 +1,367 @@
+// Copyright (c) 2022-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/** \file
+ * \brief Implementation of the fork saver.
+ *
+ * The main thread prepares a save request which includes a snapshot of
+ * the settings and then forks. The child process executes the request
+ * against its copy-on-write view of the memory, saves the result in a
+ * small shared memory block and wakes up the parent with the
+ * thread_done() signal before exiting. The parent then reaps the child
+ * and updates the settings with the result of the save.
+ */
+
+// self
+//
+#include    "fork_saver.h"
+
+#include    "server.h"
+
+
+// snaplogger
+//
+#include    <snaplogger/message.h>
+
+
+// C++
+//
+#include    <new>
+
+
+// C
+//
+#include    <errno.h>
+#include    <signal.h>
+#include    <string.h>
+#include    <sys/mman.h>
+#include    <sys/wait.h>
+#include    <unistd.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace fluid_settings_daemon
+{
+
+
+namespace
+{
+
+
+
+// a save which takes longer is considered hung
+//
+constexpr std::int64_t const    g_child_timeout = 5LL * 60LL * 1'000'000LL;  // 5 min. in microseconds
+
+
+// how often check() gets called while a child is running
+//
+constexpr std::int64_t const    g_child_poll = 1'000'000;  // 1 sec. in microseconds
+
+
+
+}
+// no name namespace
+
+
+
+/** \class fork_saver
+ * \brief Save the settings in a child process.
+ *
+ * With a very large number of settings, even the save thread competes
+ * with the main thread for the memory and the CPU. The fork saver
+ * instead lets a child process write the files from the pages it
+ * shares with the daemon (copy-on-write). The daemon only pays for the
+ * pages it modifies while the child runs.
+ *
+ * The end of the child is detected through the event loop: the child
+ * uses the pipe of the thread_done_signal connection to wake up the
+ * parent. If the child dies before it can do so, check() detects it.
+ * That function gets called by the connection timeout once per second
+ * while a child is running.
+ *
+ * Only one child runs at a time. start() fails while a child is running.
+ *
+ * A child which is still running after 5 minutes gets killed by
+ * check() so it does not block all the following saves.
+ *
+ * \warning
+ * The child process must not use any lock which another thread may have
+ * held at the time of the fork(). It only writes the files and exits
+ * with _exit() so no destructors and no atexit() functions run. It does
+ * not log either; the errors are returned to the parent which logs them.
+ */
+
+
+
+/** \brief Initialize the fork saver.
+ *
+ * \param[in] s  The server to which the results are sent.
+ */
+fork_saver::fork_saver(server * s)
+    : f_server(s)
+{
+    set_name("fork_saver");
+}
+
+
+/** \brief Wait for the child, if still running.
+ */
+fork_saver::~fork_saver()
+{
+    stop();
+}
+
+
+/** \brief Start a child process to execute a save request.
+ *
+ * \param[in] request  The save request to execute.
+ *
+ * \return true if the child was started, false if a child is already
+ * running or the fork() failed.
+ */
+bool fork_saver::start(fluid_settings::save_request_t::pointer_t const & request)
+{
+    if(is_running())
+    {
+        return false;
+    }
+
+    void * ptr(mmap(
+              nullptr
+            , sizeof(result_t)
+            , PROT_READ | PROT_WRITE
+            , MAP_SHARED | MAP_ANONYMOUS
+            , -1
+            , 0));
+    if(ptr == MAP_FAILED)
+    {
+        int const e(errno);
+        SNAP_LOG_ERROR
+            << "could not allocate shared memory for the fork saver: "
+            << strerror(e)
+            << SNAP_LOG_SEND;
+        return false;
+    }
+    f_result = new (ptr) result_t();
+
+    pid_t const pid(fork());
+    if(pid == 0)
+    {
+        // child, the logger may be locked by another thread
+        //
+        request->f_quiet = true;
+        fluid_settings::settings::execute_save(*request);
+        f_result->f_saved = request->f_saved;
+        f_result->f_file_size = request->f_file_size;
+        f_result->f_base_size = request->f_base_size;
+        f_result->f_errno = request->f_errno;
+        f_result->f_export_errno = request->f_export_errno;
+        f_result->f_done = true;
+        thread_done();
+        _exit(0);
+    }
+
+    if(pid < 0)
+    {
+        int const e(errno);
+        SNAP_LOG_ERROR
+            << "could not fork the saver process: "
+            << strerror(e)
+            << SNAP_LOG_SEND;
+        munmap(f_result, sizeof(result_t));
+        f_result = nullptr;
+        return false;
+    }
+
+    f_child = pid;
+    f_deadline = ed::connection::get_current_date() + g_child_timeout;
+    f_request = request;
+    set_timeout_delay(g_child_poll);
+
+    return true;
+}
+
+
+/** \brief Check whether a child process is running.
+ *
+ * \return true if a save is in progress.
+ */
+bool fork_saver::is_running() const
+{
+    return f_child != -1;
+}
+
+
+/** \brief Check whether the child died without telling us.
+ *
+ * If the child process was killed or crashed, it does not wake up the
+ * parent. This function reaps such a child so a new save can start.
+ * A child which runs for too long is killed and reaped. In both cases,
+ * the save is considered failed.
+ */
+void fork_saver::check()
+{
+    if(!is_running())
+    {
+        return;
+    }
+
+    if(ed::connection::get_current_date() >= f_deadline)
+    {
+        SNAP_LOG_ERROR
+            << "the fork saver process "
+            << f_child
+            << " did not finish in time; killing it."
+            << SNAP_LOG_SEND;
+        kill(f_child, SIGKILL);
+        finish(0);
+        return;
+    }
+
+    finish(WNOHANG);
+}
+
+
+/** \brief Wait for the child to be done.
+ *
+ * The files are complete once this function returns. The result is
+ * dropped since the daemon is quitting.
+ */
+void fork_saver::stop()
+{
+    if(is_running())
+    {
+        int status(0);
+        waitpid(f_child, &status, 0);
+        f_child = -1;
+        set_timeout_delay(-1);
+        munmap(f_result, sizeof(result_t));
+        f_result = nullptr;
+        f_request.reset();
+    }
+}
+
+
+/** \brief Poll the child process.
+ *
+ * The timeout is only enabled while a child is running. It makes sure
+ * a child which dies without waking us up or hangs gets reaped even
+ * if no other save is attempted.
+ */
+void fork_saver::process_timeout()
+{
+    check();
+}
+
+
+/** \brief Report the result of the child process.
+ *
+ * This function is called in the main thread when the child signals
+ * that it is done with the save.
+ */
+void fork_saver::process_read()
+{
+    thread_done_signal::process_read();
+
+    if(is_running())
+    {
+        // the child exits right after the signal, wait for it
+        //
+        finish(0);
+    }
+}
+
+
+/** \brief Reap the child and send the result to the server.
+ *
+ * \param[in] options  The waitpid() options (i.e. WNOHANG).
+ */
+void fork_saver::finish(int options)
+{
+    int status(0);
+    pid_t const pid(waitpid(f_child, &status, options));
+    if(pid == 0)
+    {
+        // still running
+        //
+        return;
+    }
+
+    fluid_settings::save_request_t::pointer_t request(f_request);
+    if(f_result->f_done)
+    {
+        request->f_saved = f_result->f_saved;
+        request->f_file_size = f_result->f_file_size;
+        request->f_base_size = f_result->f_base_size;
+        if(!request->f_saved)
+        {
+            SNAP_LOG_ERROR
+                << "the fork saver could not save \""
+                << request->f_filename
+                << "\" (errno: "
+                << f_result->f_errno
+                << ", "
+                << strerror(f_result->f_errno)
+                << ")."
+                << SNAP_LOG_SEND;
+        }
+        if(f_result->f_export_errno != 0)
+        {
+            SNAP_LOG_ERROR
+                << "the fork saver could not export \""
+                << request->f_export_filename
+                << "\" (errno: "
+                << f_result->f_export_errno
+                << ", "
+                << strerror(f_result->f_export_errno)
+                << ")."
+                << SNAP_LOG_SEND;
+        }
+    }
+    else
+    {
+        SNAP_LOG_ERROR
+            << "the fork saver process died before it was done (status: "
+            << status
+            << ")."
+            << SNAP_LOG_SEND;
+        request->f_saved = false;
+    }
+
+    f_child = -1;
+    set_timeout_delay(-1);
+    munmap(f_result, sizeof(result_t));
+    f_result = nullptr;
+    f_request.reset();
+
+    // on a failure, save_done() marks the settings as unsaved again
+    // and schedules another save
+    //
+    f_server->save_done(request);
+}
+
+
+
+} // namespace fluid_settings_daemon
+// vim: ts=4 sw=4 et
@@ -0,0 +1,98 @@
+// Copyright (c) 2022-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+/** \file
+ * \brief Declaration of the fork saver.
+ *
+ * The settings get saved by a child process which writes its
+ * copy-on-write view of the settings to disk while the daemon keeps
+ * serving requests.
+ */
+
+
+// fluid-settings
+//
+#include    <fluid-settings/settings.h>
+
+
+// eventdispatcher
+//
+#include    <eventdispatcher/thread_done_signal.h>
+
+
+// C
+//
+#include    <sys/types.h>
+
+
+
+namespace fluid_settings_daemon
+{
+
+
+
+class server;
+
+
+class fork_saver
+    : public ed::thread_done_signal
+{
+public:
+    typedef std::shared_ptr<fork_saver>     pointer_t;
+
+                        fork_saver(server * s);
+                        fork_saver(fork_saver const &) = delete;
+    virtual             ~fork_saver() override;
+    fork_saver &        operator = (fork_saver const &) = delete;
+
+    bool                start(fluid_settings::save_request_t::pointer_t const & request);
+    bool                is_running() const;
+    void                check();
+    void                stop();
+
+    // thread_done_signal implementation
+    //
+    virtual void        process_timeout() override;
+    virtual void        process_read() override;
+
+private:
+    struct result_t
+    {
+        bool                f_done = false;
+        bool                f_saved = false;
+        std::size_t         f_file_size = 0;
+        std::size_t         f_base_size = 0;
+        int                 f_errno = 0;
+        int                 f_export_errno = 0;
+    };
+
+    void                finish(int options);
+
+    server *            f_server = nullptr;
+    fluid_settings::save_request_t::pointer_t
+                        f_request = fluid_settings::save_request_t::pointer_t();
+    pid_t               f_child = -1;
+    std::int64_t        f_deadline = 0;
+    result_t *          f_result = nullptr;
+};
+
+
+
+} // namespace fluid_settings_daemon
+// vim: ts=4 sw=4 et
@@ -0,0 +1,78 @@
+// Copyright (c) 2011-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/** \file
+ * \brief The implementation of the journal_timer.
+ *
+ * The timer gets triggered whenever a record is added to the journal.
+ * It times out immediately, which means it runs once all the messages
+ * already received by the event loop were processed. At that point,
+ * the journal gets committed and the replies sent.
+ */
+
+// self
+//
+#include    "journal_timer.h"
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace fluid_settings_daemon
+{
+
+
+
+journal_timer::journal_timer(server * s)
+    : timer(-1)
+    , f_server(s)
+{
+    // by default, there is nothing to commit
+    //
+    set_enable(false);
+}
+
+
+journal_timer::~journal_timer()
+{
+}
+
+
+void journal_timer::trigger()
+{
+    if(!is_enabled())
+    {
+        set_timeout_date(get_current_date());
+        set_enable(true);
+    }
+}
+
+
+void journal_timer::process_timeout()
+{
+    set_enable(false);
+    f_server->commit_journal();
+}
+
+
+
+} // namespace fluid_settings_daemon
+// vim: ts=4 sw=4 et
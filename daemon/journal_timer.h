@@ -0,0 +1,70 @@
+// Copyright (c) 2011-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+/** \file
+ * \brief The declaration of the journal_timer class.
+ *
+ * This timer is used to commit the journal once per run of the event
+ * loop so all the changes received at the same time share one
+ * synchronization to disk.
+ */
+
+
+// self
+//
+#include    "server.h"
+
+
+// eventdispatcher
+//
+#include    <eventdispatcher/timer.h>
+
+
+
+namespace fluid_settings_daemon
+{
+
+
+
+class server;
+
+
+class journal_timer
+    : public ed::timer
+{
+public:
+    typedef std::shared_ptr<journal_timer>      pointer_t;
+
+                        journal_timer(server * s);
+                        journal_timer(journal_timer const &) = delete;
+    virtual             ~journal_timer() override;
+    journal_timer &     operator = (journal_timer const &) = delete;
+
+    void                trigger();
+
+    virtual void        process_timeout() override;
+
+private:
+    server *            f_server = nullptr;
+};
+
+
+
+} // namespace fluid_settings_daemon
+// vim: ts=4 sw=4 et
@@ -32,6 +32,8 @@
 //
 #include    "messenger.h"
 
+#include    "read_job.h"
+
 
 // fluid-settings
 //
@@ -59,6 +61,11 @@
 #include    <libaddr/addr_parser.h>
 
 
+// C++
+//
+#include    <limits>
+
+
 // last include
 //
 #include    <snapdev/poison.h>
@@ -90,6 +97,8 @@ messenger::messenger(server * s, advgetopt::getopt & opts)
         DISPATCHER_MATCH(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_list,      &messenger::msg_list),
         DISPATCHER_MATCH(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_listen,    &messenger::msg_listen),
         DISPATCHER_MATCH(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_put,       &messenger::msg_put),
+        DISPATCHER_MATCH(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_rollback,  &messenger::msg_rollback),
+        DISPATCHER_MATCH(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_stats,     &messenger::msg_stats),
     });
 
     f_dispatcher->add_communicator_commands();
@@ -173,11 +182,11 @@ void messenger::msg_delete(ed::message & msg)
 
     std::string name(msg.get_parameter(fluid_settings::g_name_fluid_settings_param_name));
     std::replace(name.begin(), name.end(), '_', '-');
-    if(f_server->reset_setting(name, priority))
+    if(f_server->reset_setting(f_server->resolve(name), priority))
     {
         reply.set_command(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_deleted);
         reply.add_parameter(fluid_settings::g_name_fluid_settings_param_name, name);
-        send_message(reply);
+        f_server->reply_after_commit(reply);
     }
     else
     {
@@ -187,7 +196,7 @@ void messenger::msg_delete(ed::message & msg)
         reply.set_command(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_deleted);
         reply.add_parameter(fluid_settings::g_name_fluid_settings_param_name, name);
         reply.add_parameter(ed::g_name_ed_param_message, "nothing was deleted");
-        send_message(reply);
+        f_server->reply_after_commit(reply);
     }
 }
 
@@ -248,6 +257,10 @@ void messenger::msg_forget(ed::message & msg)
  * is to use the HIGHEST_PRIORITY; note, however, that you cannot set this
  * parameter to that value (i.e. it is out of bounds)
  * * `all` (optional) -- to retrieve all the currently available values
+ * * `revision` (optional) -- to retrieve the value the setting had at
+ * that revision
+ * * `as_of` (optional) -- to retrieve the value the setting had at that
+ * time; with `revision`, the earliest of both points is used
  *
  * The function may reply with the following messages:
  *
@@ -260,7 +273,9 @@ void messenger::msg_forget(ed::message & msg)
  *
  * \note
  * The `priority` and `all` parameters are mutually exclusive. Specifying
- * both at the same time results in an error.
+ * both at the same time results in an error. The same applies to the
+ * `revision` and `as_of` parameters which only return the effective
+ * value.
  *
  * \param[in] msg  The GET message.
  */
@@ -312,41 +327,99 @@ void messenger::msg_get(ed::message & msg)
         }
     }
 
+    bool history(false);
+    fluid_settings::history::revision_t revision(fluid_settings::history::LATEST_REVISION);
+    if(msg.has_parameter(fluid_settings::g_name_fluid_settings_param_revision))
+    {
+        std::int64_t result(0);
+        if(!advgetopt::validator_integer::convert_string(msg.get_parameter(fluid_settings::g_name_fluid_settings_param_revision), result)
+        || result < 0)
+        {
+            reply.set_command(ed::g_name_ed_cmd_invalid);
+            reply.add_parameter(ed::g_name_ed_param_command, fluid_settings::g_name_fluid_settings_cmd_fluid_settings_get);
+            reply.add_parameter(ed::g_name_ed_param_message, "parameter \"revision\" must be a positive integer when defined");
+            send_message(reply);
+            return;
+        }
+        revision = result;
+        history = true;
+    }
+
+    snapdev::timespec_ex as_of(std::numeric_limits<std::int64_t>::max());
+    if(msg.has_parameter(fluid_settings::g_name_fluid_settings_param_as_of))
+    {
+        double result(0.0);
+        if(!advgetopt::validator_double::convert_string(msg.get_parameter(fluid_settings::g_name_fluid_settings_param_as_of), result))
+        {
+            reply.set_command(ed::g_name_ed_cmd_invalid);
+            reply.add_parameter(ed::g_name_ed_param_command, fluid_settings::g_name_fluid_settings_cmd_fluid_settings_get);
+            reply.add_parameter(ed::g_name_ed_param_message, "parameter \"as_of\" must be a timestamp when defined");
+            send_message(reply);
+            return;
+        }
+        as_of.set(result);
+        history = true;
+    }
+    if(history)
+    {
+        ++cmd;
+    }
+
     if(cmd > 1)
     {
         reply.set_command(ed::g_name_ed_cmd_invalid);
         reply.add_parameter(ed::g_name_ed_param_command, fluid_settings::g_name_fluid_settings_cmd_fluid_settings_get);
-        reply.add_parameter(ed::g_name_ed_param_message, "parameters \"default_value=true\", \"all=true\", and \"priority=...\" (when not HIGHEST_PRIORITY) are mutually exclusive.");
+        reply.add_parameter(ed::g_name_ed_param_message, "parameters \"default_value=true\", \"all=true\", \"priority=...\" (when not HIGHEST_PRIORITY), and \"revision=...\" or \"as_of=...\" are mutually exclusive.");
         send_message(reply);
         return;
     }
 
     std::string name(msg.get_parameter(fluid_settings::g_name_fluid_settings_param_name));
     std::replace(name.begin(), name.end(), '_', '-');
-    reply.add_parameter(fluid_settings::g_name_fluid_settings_param_name, name);
 
-    std::string value;
+    if(history)
+    {
+        // the history is not part of the snapshots so this request is
+        // answered here instead of by a reader thread
+        //
+        get_value_at(reply, name, revision, as_of);
+        return;
+    }
 
-    fluid_settings::get_result_t const r(default_value
-                ? f_server->get_default_value(name, value)
-                : f_server->get_value(name, value, priority, all));
+    // the reply gets generated from a snapshot of the settings, possibly
+    // by one of the reader threads
+    //
+    fluid_settings::setting_id_t const id(f_server->resolve(name));
+    read_job::pointer_t job(std::make_shared<read_job>(
+              read_job::request_t::REQUEST_GET
+            , msg
+            , f_server->get_snapshot()));
+    job->set_setting(name, id, priority, all, default_value);
+    f_server->read(job);
+}
+
+
+/** \brief Reply with the value a setting had at an earlier point.
+ *
+ * \param[in,out] reply  The reply to the GET message.
+ * \param[in] name  The name of the setting.
+ * \param[in] revision  The revision to look at.
+ * \param[in] as_of  The time to look at.
+ */
+void messenger::get_value_at(
+      ed::message & reply
+    , std::string const & name
+    , fluid_settings::history::revision_t revision
+    , snapdev::timespec_ex const & as_of)
+{
+    reply.add_parameter(fluid_settings::g_name_fluid_settings_param_name, name);
 
-    switch(r)
+    std::string value;
+    switch(f_server->get_value_at(f_server->resolve(name), value, revision, as_of))
     {
     case fluid_settings::get_result_t::GET_RESULT_SUCCESS:
-        if(all)
-        {
-            // since commas need special handling in this case, we use
-            // different names for the reply
-            //
-            reply.set_command(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_all_values);
-            reply.add_parameter(fluid_settings::g_name_fluid_settings_param_values, value);
-        }
-        else
-        {
-            reply.set_command(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_value);
-            reply.add_parameter(fluid_settings::g_name_fluid_settings_param_value, value);
-        }
+        reply.set_command(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_value);
+        reply.add_parameter(fluid_settings::g_name_fluid_settings_param_value, value);
         break;
 
     case fluid_settings::get_result_t::GET_RESULT_DEFAULT:
@@ -354,23 +427,13 @@ void messenger::msg_get(ed::message & msg)
         reply.add_parameter(fluid_settings::g_name_fluid_settings_param_value, value);
         break;
 
-    case fluid_settings::get_result_t::GET_RESULT_NOT_SET:
-        reply.set_command(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_not_set);
-        reply.add_parameter(fluid_settings::g_name_fluid_settings_param_error, "this setting is not set");
-        break;
-
-    case fluid_settings::get_result_t::GET_RESULT_PRIORITY_NOT_FOUND:
-        reply.set_command(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_not_set);
-        reply.add_parameter(fluid_settings::g_name_fluid_settings_param_error, "no value at the requested priority");
-        break;
-
     case fluid_settings::get_result_t::GET_RESULT_ERROR:
         reply.set_command(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_not_set);
         reply.add_parameter(
                   fluid_settings::g_name_fluid_settings_param_error
-                , "found a parameter named \""
+                , "the history of \""
                 + name
-                + "\" but no corresponding value (logic error)");
+                + "\" does not go back that far");
         break;
 
     case fluid_settings::get_result_t::GET_RESULT_UNKNOWN:
@@ -382,7 +445,13 @@ void messenger::msg_get(ed::message & msg)
                 + "\"");
         break;
 
+    default:
+        reply.set_command(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_not_set);
+        reply.add_parameter(fluid_settings::g_name_fluid_settings_param_error, "this setting was not set");
+        break;
+
     }
+
     send_message(reply);
 }
 
@@ -433,14 +502,10 @@ void messenger::connect_from_gossip(ed::message & msg, bool send_reply)
 
 void messenger::msg_list(ed::message & msg)
 {
-    ed::message reply;
-    reply.reply_to(msg);
-
-    std::string const options(f_server->list_of_options());
-
-    reply.set_command(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_options);
-    reply.add_parameter(fluid_settings::g_name_fluid_settings_param_options, options);
-    send_message(reply);
+    f_server->read(std::make_shared<read_job>(
+              read_job::request_t::REQUEST_LIST
+            , msg
+            , f_server->get_snapshot()));
 }
 
 
@@ -494,19 +559,18 @@ void messenger::msg_listen(ed::message & msg)
         current_value.set_command(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_value_updated);
         current_value.add_parameter(fluid_settings::g_name_fluid_settings_param_name, n);
 
-        std::string value;
-        fluid_settings::get_result_t const r(f_server->get_value(
-                      n
+        fluid_settings::value::buffer_t value;
+        fluid_settings::get_result_t const r(f_server->get_buffer(
+                      f_server->resolve(n)
                     , value
-                    , fluid_settings::HIGHEST_PRIORITY
-                    , false));
+                    , fluid_settings::HIGHEST_PRIORITY));
         switch(r)
         {
         case fluid_settings::get_result_t::GET_RESULT_DEFAULT:
             current_value.add_parameter(fluid_settings::g_name_fluid_settings_param_default, fluid_settings::g_name_fluid_settings_value_true);
             [[fallthrough]];
         case fluid_settings::get_result_t::GET_RESULT_SUCCESS:
-            current_value.add_parameter(fluid_settings::g_name_fluid_settings_param_value, value);
+            current_value.add_parameter(fluid_settings::g_name_fluid_settings_param_value, *value);
             current_value.add_parameter(ed::g_name_ed_param_message, "current value");
             break;
 
@@ -604,7 +668,7 @@ void messenger::msg_put(ed::message & msg)
         }
     }
 
-    fluid_settings::set_result_t const result(f_server->set_value(name, value, priority, timestamp));
+    fluid_settings::set_result_t const result(f_server->set_value(f_server->resolve(name), value, priority, timestamp));
     switch(result)
     {
     case fluid_settings::set_result_t::SET_RESULT_NEW: // that value was not yet set
@@ -675,6 +739,112 @@ void messenger::msg_put(ed::message & msg)
 
     }
 
+    f_server->reply_after_commit(reply);
+}
+
+
+/** \brief Restore the settings of a namespace.
+ *
+ * The message includes the `revision` to go back to and the `name` of
+ * the namespace to restore. Without a `name`, all the settings are
+ * restored.
+ *
+ * The function replies with FLUID_SETTINGS_ROLLED_BACK once the changes
+ * are committed to the journal. If the history does not go back to that
+ * revision, nothing is changed and the reply is an INVALID message.
+ *
+ * \param[in] msg  The FLUID_SETTINGS_ROLLBACK message.
+ */
+void messenger::msg_rollback(ed::message & msg)
+{
+    ed::message reply;
+    reply.reply_to(msg);
+
+    std::int64_t revision(0);
+    if(!advgetopt::validator_integer::convert_string(msg.get_parameter(fluid_settings::g_name_fluid_settings_param_revision), revision)
+    || revision < 0)
+    {
+        reply.set_command(ed::g_name_ed_cmd_invalid);
+        reply.add_parameter(ed::g_name_ed_param_command, fluid_settings::g_name_fluid_settings_cmd_fluid_settings_rollback);
+        reply.add_parameter(ed::g_name_ed_param_message, "parameter \"revision\" must be a positive integer");
+        send_message(reply);
+        return;
+    }
+
+    std::string name_space;
+    if(msg.has_parameter(fluid_settings::g_name_fluid_settings_param_name))
+    {
+        name_space = msg.get_parameter(fluid_settings::g_name_fluid_settings_param_name);
+        std::replace(name_space.begin(), name_space.end(), '_', '-');
+    }
+
+    if(!f_server->rollback(name_space, revision))
+    {
+        reply.set_command(ed::g_name_ed_cmd_invalid);
+        reply.add_parameter(ed::g_name_ed_param_command, fluid_settings::g_name_fluid_settings_cmd_fluid_settings_rollback);
+        reply.add_parameter(
+                  ed::g_name_ed_param_message
+                , "the history does not go back to revision "
+                + std::to_string(revision)
+                + "; nothing was restored");
+        send_message(reply);
+        return;
+    }
+
+    reply.set_command(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_rolled_back);
+    if(!name_space.empty())
+    {
+        reply.add_parameter(fluid_settings::g_name_fluid_settings_param_name, name_space);
+    }
+    reply.add_parameter(fluid_settings::g_name_fluid_settings_param_revision, f_server->get_revision());
+    f_server->reply_after_commit(reply);
+}
+
+
+/** \brief Reply with the memory statistics.
+ *
+ * This function replies to the FLUID_SETTINGS_STATS message with a
+ * FLUID_SETTINGS_STATISTICS message which includes the statistics of
+ * the memory pool used to hold the values, the statistics of the
+ * saves, and the statistics of the history.
+ *
+ * \param[in] msg  The FLUID_SETTINGS_STATS message.
+ */
+void messenger::msg_stats(ed::message & msg)
+{
+    fluid_settings::memory_pool::stats_t const stats(f_server->get_memory_stats());
+
+    ed::message reply;
+    reply.reply_to(msg);
+    reply.set_command(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_statistics);
+    reply.add_parameter(fluid_settings::g_name_fluid_settings_param_allocations,   static_cast<std::uint64_t>(stats.f_allocations));
+    reply.add_parameter(fluid_settings::g_name_fluid_settings_param_compactions,   static_cast<std::uint64_t>(stats.f_compactions));
+    reply.add_parameter(fluid_settings::g_name_fluid_settings_param_deallocations, static_cast<std::uint64_t>(stats.f_deallocations));
+    reply.add_parameter(fluid_settings::g_name_fluid_settings_param_in_use,        static_cast<std::uint64_t>(stats.f_in_use));
+    reply.add_parameter(fluid_settings::g_name_fluid_settings_param_large,         static_cast<std::uint64_t>(stats.f_large));
+    reply.add_parameter(fluid_settings::g_name_fluid_settings_param_released,      static_cast<std::uint64_t>(stats.f_released));
+    reply.add_parameter(fluid_settings::g_name_fluid_settings_param_reserved,      static_cast<std::uint64_t>(stats.f_reserved));
+    reply.add_parameter(fluid_settings::g_name_fluid_settings_param_slabs,         static_cast<std::uint64_t>(stats.f_slabs));
+
+    save_stats_t const save_stats(f_server->get_save_stats());
+    reply.add_parameter(fluid_settings::g_name_fluid_settings_param_saves,             save_stats.f_saves);
+    reply.add_parameter(fluid_settings::g_name_fluid_settings_param_save_changes,      save_stats.f_changes);
+    reply.add_parameter(fluid_settings::g_name_fluid_settings_param_save_delay,        save_stats.f_delay);
+    reply.add_parameter(fluid_settings::g_name_fluid_settings_param_save_duration,     save_stats.f_duration);
+    reply.add_parameter(fluid_settings::g_name_fluid_settings_param_save_forced,       save_stats.f_forced_saves);
+    reply.add_parameter(fluid_settings::g_name_fluid_settings_param_save_max_changes,  save_stats.f_max_changes);
+    reply.add_parameter(fluid_settings::g_name_fluid_settings_param_save_max_duration, save_stats.f_max_duration);
+
+    fluid_settings::history::stats_t const history_stats(f_server->get_history_stats());
+    reply.add_parameter(fluid_settings::g_name_fluid_settings_param_history_bytes,  static_cast<std::uint64_t>(history_stats.f_log_bytes + history_stats.f_string_bytes));
+    reply.add_parameter(fluid_settings::g_name_fluid_settings_param_history_events, static_cast<std::uint64_t>(history_stats.f_events));
+    reply.add_parameter(fluid_settings::g_name_fluid_settings_param_revision,        history_stats.f_revision);
+
+    replication_stats_t const replication_stats(f_server->get_replication_stats());
+    reply.add_parameter(fluid_settings::g_name_fluid_settings_param_replication_batches,     replication_stats.f_batch_sizes.get_count());
+    reply.add_parameter(fluid_settings::g_name_fluid_settings_param_replication_batch_sizes, replication_stats.f_batch_sizes.to_string());
+    reply.add_parameter(fluid_settings::g_name_fluid_settings_param_replication_delays,      replication_stats.f_delays.to_string());
+    reply.add_parameter(fluid_settings::g_name_fluid_settings_param_replication_delay_p99,   replication_stats.f_delays.percentile(99.0));
     send_message(reply);
 }
 
@@ -95,9 +95,16 @@ public:
     void                msg_list(ed::message & msg);
     void                msg_listen(ed::message & msg);
     void                msg_put(ed::message & msg);
+    void                msg_rollback(ed::message & msg);
+    void                msg_stats(ed::message & msg);
 
 private:
     void                connect_from_gossip(ed::message & msg, bool send_reply);
+    void                get_value_at(
+                              ed::message & reply
+                            , std::string const & name
+                            , fluid_settings::history::revision_t revision
+                            , snapdev::timespec_ex const & as_of);
 
     server *            f_server = nullptr;
     ed::dispatcher::pointer_t
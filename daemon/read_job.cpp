@@ -0,0 +1,217 @@
+// Copyright (c) 2011-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/** \file
+ * \brief Implementation of a read request.
+ *
+ * The read_job class generates the reply of a GET or LIST message from
+ * a snapshot. It does not access the server or the settings so it can
+ * safely be executed by a reader thread.
+ */
+
+// self
+//
+#include    "read_job.h"
+
+
+// fluid-settings
+//
+#include    <fluid-settings/names.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace fluid_settings_daemon
+{
+
+
+
+/** \brief Initialize a read request.
+ *
+ * \param[in] request  The type of request.
+ * \param[in] msg  The message being answered.
+ * \param[in] snapshot  The snapshot used to generate the reply.
+ */
+read_job::read_job(
+          request_t request
+        , ed::message const & msg
+        , fluid_settings::snapshot::pointer_t const & snapshot)
+    : f_request(request)
+    , f_snapshot(snapshot)
+{
+    f_reply.reply_to(msg);
+}
+
+
+/** \brief Define the setting to retrieve.
+ *
+ * This function is used by the GET request to define the setting and
+ * the type of value to return.
+ *
+ * \param[in] name  The canonicalized name of the setting.
+ * \param[in] id  The identifier of the setting, may be invalid.
+ * \param[in] priority  The priority of the value to return.
+ * \param[in] all  Whether to return all the values.
+ * \param[in] default_value  Whether to return the default value.
+ */
+void read_job::set_setting(
+      std::string const & name
+    , fluid_settings::setting_id_t id
+    , fluid_settings::priority_t priority
+    , bool all
+    , bool default_value)
+{
+    f_name = name;
+    f_id = id;
+    f_priority = priority;
+    f_all = all;
+    f_default_value = default_value;
+}
+
+
+/** \brief Replace the snapshot used to generate the reply.
+ *
+ * The requests received while the daemon is not yet ready get deferred.
+ * Their snapshot gets replaced by a newer one before they get executed.
+ *
+ * \param[in] snapshot  The new snapshot.
+ */
+void read_job::set_snapshot(fluid_settings::snapshot::pointer_t const & snapshot)
+{
+    f_snapshot = snapshot;
+}
+
+
+/** \brief Generate the reply.
+ *
+ * This function can be called from any thread.
+ */
+void read_job::execute()
+{
+    switch(f_request)
+    {
+    case request_t::REQUEST_GET:
+        execute_get();
+        break;
+
+    case request_t::REQUEST_LIST:
+        execute_list();
+        break;
+
+    }
+}
+
+
+/** \brief Get the reply.
+ *
+ * Once execute() returned, the reply is ready to be sent.
+ *
+ * \return A reference to the reply message.
+ */
+ed::message & read_job::get_reply()
+{
+    return f_reply;
+}
+
+
+void read_job::execute_get()
+{
+    f_reply.add_parameter(fluid_settings::g_name_fluid_settings_param_name, f_name);
+
+    // the shared buffer avoids a copy of the value in the common case,
+    // all the values still get computed in a string
+    //
+    fluid_settings::value::buffer_t buffer;
+    std::string value;
+
+    fluid_settings::get_result_t const r(f_default_value
+                ? f_snapshot->get_default_value(f_id, buffer)
+                : f_all
+                    ? f_snapshot->get_all_values(f_id, value)
+                    : f_snapshot->get_buffer(f_id, buffer, f_priority));
+    std::string const & result(buffer != nullptr ? *buffer : value);
+
+    switch(r)
+    {
+    case fluid_settings::get_result_t::GET_RESULT_SUCCESS:
+        if(f_all)
+        {
+            // since commas need special handling in this case, we use
+            // different names for the reply
+            //
+            f_reply.set_command(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_all_values);
+            f_reply.add_parameter(fluid_settings::g_name_fluid_settings_param_values, value);
+        }
+        else
+        {
+            f_reply.set_command(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_value);
+            f_reply.add_parameter(fluid_settings::g_name_fluid_settings_param_value, result);
+        }
+        break;
+
+    case fluid_settings::get_result_t::GET_RESULT_DEFAULT:
+        f_reply.set_command(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_default_value);
+        f_reply.add_parameter(fluid_settings::g_name_fluid_settings_param_value, result);
+        break;
+
+    case fluid_settings::get_result_t::GET_RESULT_NOT_SET:
+        f_reply.set_command(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_not_set);
+        f_reply.add_parameter(fluid_settings::g_name_fluid_settings_param_error, "this setting is not set");
+        break;
+
+    case fluid_settings::get_result_t::GET_RESULT_PRIORITY_NOT_FOUND:
+        f_reply.set_command(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_not_set);
+        f_reply.add_parameter(fluid_settings::g_name_fluid_settings_param_error, "no value at the requested priority");
+        break;
+
+    case fluid_settings::get_result_t::GET_RESULT_ERROR:
+        f_reply.set_command(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_not_set);
+        f_reply.add_parameter(
+                  fluid_settings::g_name_fluid_settings_param_error
+                , "found a parameter named \""
+                + f_name
+                + "\" but no corresponding value (logic error)");
+        break;
+
+    case fluid_settings::get_result_t::GET_RESULT_UNKNOWN:
+        f_reply.set_command(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_not_set);
+        f_reply.add_parameter(
+                  fluid_settings::g_name_fluid_settings_param_error
+                , "no parameter named \""
+                + f_name
+                + "\"");
+        break;
+
+    }
+}
+
+
+void read_job::execute_list()
+{
+    f_reply.set_command(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_options);
+    f_reply.add_parameter(fluid_settings::g_name_fluid_settings_param_options, f_snapshot->get_options());
+}
+
+
+
+} // namespace fluid_settings_daemon
+// vim: ts=4 sw=4 et
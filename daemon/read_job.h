@@ -0,0 +1,94 @@
+// Copyright (c) 2022-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+/** \file
+ * \brief Declaration of a read request.
+ *
+ * A read request holds everything necessary to answer a GET or LIST
+ * message: the parameters of the request and the snapshot of the
+ * settings at the time the message was received. It can be executed
+ * by any thread.
+ */
+
+
+// fluid-settings
+//
+#include    <fluid-settings/settings.h>
+
+
+// eventdispatcher
+//
+#include    <eventdispatcher/message.h>
+
+
+
+namespace fluid_settings_daemon
+{
+
+
+
+class read_job
+{
+public:
+    typedef std::shared_ptr<read_job>       pointer_t;
+
+    enum class request_t
+    {
+        REQUEST_GET,
+        REQUEST_LIST,
+    };
+
+                        read_job(
+                              request_t request
+                            , ed::message const & msg
+                            , fluid_settings::snapshot::pointer_t const & snapshot);
+                        read_job(read_job const &) = delete;
+    read_job &          operator = (read_job const &) = delete;
+
+    void                set_setting(
+                              std::string const & name
+                            , fluid_settings::setting_id_t id
+                            , fluid_settings::priority_t priority
+                            , bool all
+                            , bool default_value);
+    void                set_snapshot(fluid_settings::snapshot::pointer_t const & snapshot);
+    void                execute();
+    ed::message &       get_reply();
+
+private:
+    void                execute_get();
+    void                execute_list();
+
+    request_t           f_request = request_t::REQUEST_GET;
+    fluid_settings::snapshot::pointer_t
+                        f_snapshot = fluid_settings::snapshot::pointer_t();
+    ed::message         f_reply = ed::message();
+    std::string         f_name = std::string();
+    fluid_settings::setting_id_t
+                        f_id = fluid_settings::INVALID_SETTING_ID;
+    fluid_settings::priority_t
+                        f_priority = fluid_settings::HIGHEST_PRIORITY;
+    bool                f_all = false;
+    bool                f_default_value = false;
+};
+
+
+
+} // namespace fluid_settings_daemon
+// vim: ts=4 sw=4 et
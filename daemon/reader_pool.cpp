@@ -0,0 +1,183 @@
+// Copyright (c) 2011-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/** \file
+ * \brief Implementation of the pool of reader threads.
+ *
+ * The main thread pushes read jobs in the input FIFO. The reader threads
+ * pop them, generate the reply from the job's snapshot and push the job
+ * in the output FIFO. Then they wake up the main thread with the
+ * thread_done() signal so it can send the replies.
+ */
+
+// self
+//
+#include    "reader_pool.h"
+
+#include    "server.h"
+
+
+// snaplogger
+//
+#include    <snaplogger/message.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace fluid_settings_daemon
+{
+
+
+
+/** \brief Initialize a reader thread runner.
+ *
+ * \param[in] name  The name of the thread.
+ * \param[in] pool  The pool which owns this runner.
+ */
+reader_pool::runner::runner(
+          std::string const & name
+        , reader_pool * pool)
+    : cppthread::runner(name)
+    , f_pool(pool)
+{
+}
+
+
+/** \brief Execute read jobs until the pool is stopped.
+ *
+ * The function waits for jobs on the input FIFO. The FIFO is marked as
+ * done when the pool gets stopped which makes pop_front() return false.
+ */
+void reader_pool::runner::run()
+{
+    while(continue_running())
+    {
+        read_job::pointer_t job;
+        if(!f_pool->f_in->pop_front(job, -1))
+        {
+            if(f_pool->f_in->is_done())
+            {
+                break;
+            }
+            continue;
+        }
+
+        job->execute();
+
+        f_pool->f_out->push_back(job);
+        f_pool->thread_done();
+    }
+}
+
+
+
+/** \class reader_pool
+ * \brief Execute read requests in separate threads.
+ *
+ * The GET and LIST requests do not modify the settings. They get executed
+ * against a snapshot of the settings by a pool of threads. Only the
+ * sending of the reply happens in the main thread.
+ */
+
+
+
+/** \brief Start the reader threads.
+ *
+ * \param[in] s  The server used to send the replies.
+ * \param[in] count  The number of threads to start.
+ */
+reader_pool::reader_pool(server * s, std::size_t count)
+    : f_server(s)
+{
+    set_name("reader_pool");
+
+    for(std::size_t idx(0); idx < count; ++idx)
+    {
+        std::string const name("reader-" + std::to_string(idx + 1));
+        f_runners.push_back(std::make_shared<runner>(name, this));
+        f_threads.push_back(std::make_shared<cppthread::thread>(name, f_runners.back().get()));
+        if(!f_threads.back()->start())
+        {
+            SNAP_LOG_ERROR
+                << "could not start reader thread \""
+                << name
+                << "\"."
+                << SNAP_LOG_SEND;
+        }
+    }
+}
+
+
+/** \brief Stop the reader threads.
+ */
+reader_pool::~reader_pool()
+{
+    stop();
+}
+
+
+/** \brief Add a job to the queue.
+ *
+ * \param[in] job  The read job to execute.
+ */
+void reader_pool::push(read_job::pointer_t const & job)
+{
+    f_in->push_back(job);
+}
+
+
+/** \brief Stop the threads.
+ *
+ * The jobs which were not yet executed are dropped.
+ */
+void reader_pool::stop()
+{
+    f_in->done(true);
+    for(auto & t : f_threads)
+    {
+        t->stop();
+    }
+    f_threads.clear();
+    f_runners.clear();
+}
+
+
+/** \brief Send the replies of the executed jobs.
+ *
+ * This function is called in the main thread whenever a reader thread
+ * signals that it is done with a job.
+ */
+void reader_pool::process_read()
+{
+    thread_done_signal::process_read();
+
+    read_job::pointer_t job;
+    while(f_out->pop_front(job, 0))
+    {
+        f_server->read_done(job);
+    }
+}
+
+
+
+} // namespace fluid_settings_daemon
+// vim: ts=4 sw=4 et
@@ -0,0 +1,104 @@
+// Copyright (c) 2022-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+/** \file
+ * \brief Declaration of the pool of reader threads.
+ *
+ * The reader threads execute the read requests (GET and LIST) against
+ * a snapshot of the settings. The replies are sent back to the main
+ * thread which is the only one allowed to send messages.
+ */
+
+
+// self
+//
+#include    "read_job.h"
+
+
+// eventdispatcher
+//
+#include    <eventdispatcher/thread_done_signal.h>
+
+
+// cppthread
+//
+#include    <cppthread/fifo.h>
+#include    <cppthread/thread.h>
+
+
+
+namespace fluid_settings_daemon
+{
+
+
+
+class server;
+
+
+typedef cppthread::fifo<read_job::pointer_t>    read_job_fifo_t;
+
+
+class reader_pool
+    : public ed::thread_done_signal
+{
+public:
+    typedef std::shared_ptr<reader_pool>    pointer_t;
+
+                        reader_pool(server * s, std::size_t count);
+                        reader_pool(reader_pool const &) = delete;
+    virtual             ~reader_pool() override;
+    reader_pool &       operator = (reader_pool const &) = delete;
+
+    void                push(read_job::pointer_t const & job);
+    void                stop();
+
+    // thread_done_signal implementation
+    //
+    virtual void        process_read() override;
+
+private:
+    class runner
+        : public cppthread::runner
+    {
+    public:
+                            runner(
+                                  std::string const & name
+                                , reader_pool * pool);
+
+        virtual void        run() override;
+
+    private:
+        reader_pool *       f_pool = nullptr;
+    };
+
+    server *            f_server = nullptr;
+    read_job_fifo_t::pointer_t
+                        f_in = std::make_shared<read_job_fifo_t>();
+    read_job_fifo_t::pointer_t
+                        f_out = std::make_shared<read_job_fifo_t>();
+    std::vector<std::shared_ptr<runner>>
+                        f_runners = std::vector<std::shared_ptr<runner>>();
+    cppthread::thread::vector_t
+                        f_threads = cppthread::thread::vector_t();
+};
+
+
+
+} // namespace fluid_settings_daemon
+// vim: ts=4 sw=4 et
@@ -0,0 +1,68 @@
+// Copyright (c) 2022-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/** \file
+ * \brief The implementation of the replication_timer.
+ *
+ * The changes are not sent to the other fluid-settings immediately.
+ * Instead, they get queued and this timer times out at the end of the
+ * replication window. At that point, the queued settings get sent in
+ * one batch. The server sets the date at which the timer times out.
+ */
+
+// self
+//
+#include    "replication_timer.h"
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace fluid_settings_daemon
+{
+
+
+
+replication_timer::replication_timer(server * s)
+    : timer(-1)
+    , f_server(s)
+{
+    // by default, there is nothing to replicate
+    //
+    set_enable(false);
+}
+
+
+replication_timer::~replication_timer()
+{
+}
+
+
+void replication_timer::process_timeout()
+{
+    set_enable(false);
+    f_server->flush_replication();
+}
+
+
+
+} // namespace fluid_settings_daemon
+// vim: ts=4 sw=4 et
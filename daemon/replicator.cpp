@@ -0,0 +1,150 @@
+// Copyright (c) 2022-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/** \file
+ * \brief The implementation of the replicator base class.
+ *
+ * On connection, the replicator_out sends the list of formats it
+ * supports in a FLUID_SETTINGS_REPLICATION_FORMATS message. The
+ * replicator_in replies with the format to use in a
+ * FLUID_SETTINGS_REPLICATION_FORMAT message. A fluid-settings which
+ * does not know about these messages never replies and the text format
+ * remains in use.
+ *
+ * With the binary format, the VALUE_CHANGED message includes the
+ * identifier of the setting on the sender and a binary frame of the
+ * values. The name of the setting is only sent the first time its
+ * values are sent on that connection. The receiver keeps a map of the
+ * identifiers of the sender to its own identifiers.
+ *
+ * A fluid-settings which starts without any values requests the state
+ * of the other side with a FLUID_SETTINGS_STATE_REQUEST message. The
+ * replicator keeps track of the progress of that stream.
+ */
+
+// self
+//
+#include    "replicator.h"
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace fluid_settings_daemon
+{
+
+
+
+replicator::~replicator()
+{
+}
+
+
+/** \brief Check whether the values are sent in binary frames.
+ *
+ * \return true if the other side accepts the binary format.
+ */
+bool replicator::is_binary() const
+{
+    return f_binary;
+}
+
+
+/** \brief Change the format used to send the values.
+ *
+ * This function also forgets about the names already sent since a new
+ * negotiation happens on each new connection.
+ *
+ * \param[in] binary  Whether the values are sent in binary frames.
+ */
+void replicator::set_binary(bool binary)
+{
+    f_binary = binary;
+    f_names_sent.clear();
+    f_remote_ids.clear();
+}
+
+
+/** \brief Mark the name of a setting as sent.
+ *
+ * \param[in] id  The identifier of the setting.
+ *
+ * \return true if the name was not yet sent, in which case the caller
+ * must include it in the message.
+ */
+bool replicator::mark_name_sent(fluid_settings::setting_id_t id)
+{
+    if(id >= f_names_sent.size())
+    {
+        f_names_sent.resize(id + 1);
+    }
+    if(f_names_sent[id])
+    {
+        return false;
+    }
+    f_names_sent[id] = true;
+    return true;
+}
+
+
+/** \brief Save the local identifier of a setting of the other side.
+ *
+ * \param[in] remote_id  The identifier of the setting on the other side.
+ * \param[in] id  The identifier of the same setting here.
+ */
+void replicator::set_remote_id(
+      std::uint64_t remote_id
+    , fluid_settings::setting_id_t id)
+{
+    f_remote_ids[remote_id] = id;
+}
+
+
+/** \brief Get the local identifier of a setting of the other side.
+ *
+ * \param[in] remote_id  The identifier of the setting on the other side.
+ *
+ * \return The local identifier or INVALID_SETTING_ID if not known.
+ */
+fluid_settings::setting_id_t replicator::get_remote_id(std::uint64_t remote_id) const
+{
+    auto const it(f_remote_ids.find(remote_id));
+    if(it == f_remote_ids.end())
+    {
+        return fluid_settings::INVALID_SETTING_ID;
+    }
+    return it->second;
+}
+
+
+/** \brief Get the state of the stream of settings sent to the other side.
+ *
+ * \return A reference to the state of the stream.
+ */
+replicator::state_stream_t & replicator::get_state_stream()
+{
+    return f_state_stream;
+}
+
+
+
+} // namespace fluid_settings_daemon
+// vim: ts=4 sw=4 et
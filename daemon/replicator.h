@@ -0,0 +1,81 @@
+// Copyright (c) 2022-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+/** \file
+ * \brief The declaration of the replicator base class.
+ *
+ * The replicator_in and replicator_out connections share the state of
+ * the replication format negotiated with the other fluid-settings.
+ */
+
+// fluid-settings
+//
+#include    <fluid-settings/settings.h>
+
+
+// C++
+//
+#include    <unordered_map>
+#include    <vector>
+
+
+
+namespace fluid_settings_daemon
+{
+
+
+
+class replicator
+{
+public:
+    // the state of the settings being streamed to the other side
+    //
+    struct state_stream_t
+    {
+        fluid_settings::snapshot::pointer_t
+                                f_snapshot = fluid_settings::snapshot::pointer_t();
+        std::size_t             f_position = 0;         // next record to send
+        std::uint64_t           f_sent = 0;             // number of chunks sent
+        std::uint64_t           f_acknowledged = 0;     // number of chunks acknowledged
+    };
+
+    virtual             ~replicator();
+
+    bool                is_binary() const;
+    void                set_binary(bool binary);
+    bool                mark_name_sent(fluid_settings::setting_id_t id);
+    void                set_remote_id(
+                              std::uint64_t remote_id
+                            , fluid_settings::setting_id_t id);
+    fluid_settings::setting_id_t
+                        get_remote_id(std::uint64_t remote_id) const;
+    state_stream_t &    get_state_stream();
+
+private:
+    bool                f_binary = false;
+    std::vector<bool>   f_names_sent = std::vector<bool>();
+    std::unordered_map<std::uint64_t, fluid_settings::setting_id_t>
+                        f_remote_ids = std::unordered_map<std::uint64_t, fluid_settings::setting_id_t>();
+    state_stream_t      f_state_stream = state_stream_t();
+};
+
+
+
+} // namespace fluid_settings_daemon
+// vim: ts=4 sw=4 et
@@ -35,6 +35,16 @@
 #include    <fluid-settings/names.h>
 
 
+// snapdev
+//
+#include    <snapdev/tokenize_string.h>
+
+
+// C++
+//
+#include    <algorithm>
+
+
 // last include
 //
 #include    <snapdev/poison.h>
@@ -101,6 +111,11 @@ replicator_in::replicator_in(
     , f_dispatcher(std::make_shared<ed::dispatcher>(this))
 {
     f_dispatcher->add_matches({
+        DISPATCHER_MATCH(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_replication_formats, &replicator_in::msg_replication_formats),
+        DISPATCHER_MATCH(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_state_ack, &replicator_in::msg_state_ack),
+        DISPATCHER_MATCH(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_state_request, &replicator_in::msg_state_request),
+        DISPATCHER_MATCH(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_sync, &replicator_in::msg_sync),
+        DISPATCHER_MATCH(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_sync_digests, &replicator_in::msg_sync_digests),
         DISPATCHER_MATCH(fluid_settings::g_name_fluid_settings_cmd_value_changed, &replicator_in::msg_value_changed),
     });
 }
@@ -116,6 +131,72 @@ replicator_in::~replicator_in()
 }
 
 
+/** \brief Select the replication format.
+ *
+ * The other fluid-settings sends the list of formats it supports. If
+ * it includes the binary format, we use it from now on and tell the
+ * other side to do the same.
+ *
+ * \param[in] msg  The FLUID_SETTINGS_REPLICATION_FORMATS message.
+ */
+void replicator_in::msg_replication_formats(ed::message & msg)
+{
+    std::vector<std::string> formats;
+    snapdev::tokenize_string(
+          formats
+        , msg.get_parameter(fluid_settings::g_name_fluid_settings_param_formats)
+        , { "," }
+        , true
+        , " ");
+    bool const binary(std::find(
+                  formats.begin()
+                , formats.end()
+                , fluid_settings::g_name_fluid_settings_value_format_binary) != formats.end());
+    set_binary(binary);
+
+    ed::message reply;
+    reply.set_command(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_replication_format);
+    reply.add_parameter(
+              fluid_settings::g_name_fluid_settings_param_format
+            , binary
+                ? fluid_settings::g_name_fluid_settings_value_format_binary
+                : fluid_settings::g_name_fluid_settings_value_format_text);
+    send_message(reply);
+}
+
+
+void replicator_in::msg_state_ack(ed::message & msg)
+{
+    f_server->state_ack(
+          msg
+        , std::dynamic_pointer_cast<replicator_in>(shared_from_this()));
+}
+
+
+void replicator_in::msg_state_request(ed::message & msg)
+{
+    f_server->state_request(
+          msg
+        , std::dynamic_pointer_cast<replicator_in>(shared_from_this()));
+}
+
+
+void replicator_in::msg_sync(ed::message & msg)
+{
+    f_server->sync_root(
+          msg
+        , std::dynamic_pointer_cast<replicator_in>(shared_from_this()));
+}
+
+
+void replicator_in::msg_sync_digests(ed::message & msg)
+{
+    f_server->sync_digests(
+          msg
+        , std::dynamic_pointer_cast<replicator_in>(shared_from_this()));
+}
+
+
 void replicator_in::msg_value_changed(ed::message & msg)
 {
     f_server->remote_value_changed(
@@ -26,6 +26,7 @@
 
 // self
 //
+#include    "replicator.h"
 #include    "server.h"
 
 
@@ -42,6 +43,7 @@ namespace fluid_settings_daemon
 
 class replicator_in
     : public ed::tcp_server_client_message_connection
+    , public replicator
 {
 public:
     typedef std::shared_ptr<replicator_in>    pointer_t;
@@ -54,6 +56,11 @@ public:
 
     replicator_in &     operator = (replicator_in const &) = delete;
 
+    void                msg_replication_formats(ed::message & msg);
+    void                msg_state_ack(ed::message & msg);
+    void                msg_state_request(ed::message & msg);
+    void                msg_sync(ed::message & msg);
+    void                msg_sync_digests(ed::message & msg);
     void                msg_value_changed(ed::message & msg);
 
 private:
@@ -63,6 +63,11 @@ replicator_out::replicator_out(
     f_dispatcher->set_trace();
 #endif
     f_dispatcher->add_matches({
+        DISPATCHER_MATCH(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_replication_format, &replicator_out::msg_replication_format),
+        DISPATCHER_MATCH(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_state_chunk, &replicator_out::msg_state_chunk),
+        DISPATCHER_MATCH(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_state_end, &replicator_out::msg_state_end),
+        DISPATCHER_MATCH(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_sync_buckets, &replicator_out::msg_sync_buckets),
+        DISPATCHER_MATCH(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_sync_request, &replicator_out::msg_sync_request),
         DISPATCHER_MATCH(fluid_settings::g_name_fluid_settings_cmd_value_changed, &replicator_out::msg_value_changed),
     });
 }
@@ -122,9 +127,79 @@ void replicator_out::process_invalid()
 }
 
 
+/** \brief The connection is up.
+ *
+ * The text format is used until the other side accepts another one.
+ * The list of formats we support is sent right away.
+ *
+ * The synchronization of the settings changed while the two sides were
+ * not connected starts immediately after, unless this fluid-settings
+ * started without any values, in which case it first requests the
+ * state of the other side.
+ */
 void replicator_out::process_connected()
 {
     reset_errors();
+
+    set_binary(false);
+
+    ed::message formats;
+    formats.set_command(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_replication_formats);
+    formats.add_parameter(
+              fluid_settings::g_name_fluid_settings_param_formats
+            , std::string(fluid_settings::g_name_fluid_settings_value_format_binary)
+            + ','
+            + fluid_settings::g_name_fluid_settings_value_format_text);
+    send_message(formats);
+
+    replicator_out::pointer_t me(std::dynamic_pointer_cast<replicator_out>(shared_from_this()));
+    if(!f_server->request_state(me))
+    {
+        f_server->start_sync(me);
+    }
+}
+
+
+/** \brief The other side selected the replication format.
+ *
+ * \param[in] msg  The FLUID_SETTINGS_REPLICATION_FORMAT message.
+ */
+void replicator_out::msg_replication_format(ed::message & msg)
+{
+    set_binary(msg.get_parameter(fluid_settings::g_name_fluid_settings_param_format)
+                    == fluid_settings::g_name_fluid_settings_value_format_binary);
+}
+
+
+void replicator_out::msg_state_chunk(ed::message & msg)
+{
+    f_server->state_chunk(
+          msg
+        , std::dynamic_pointer_cast<replicator_out>(shared_from_this()));
+}
+
+
+void replicator_out::msg_state_end(ed::message & msg)
+{
+    f_server->state_end(
+          msg
+        , std::dynamic_pointer_cast<replicator_out>(shared_from_this()));
+}
+
+
+void replicator_out::msg_sync_buckets(ed::message & msg)
+{
+    f_server->sync_buckets(
+          msg
+        , std::dynamic_pointer_cast<replicator_out>(shared_from_this()));
+}
+
+
+void replicator_out::msg_sync_request(ed::message & msg)
+{
+    f_server->sync_request(
+          msg
+        , std::dynamic_pointer_cast<replicator_out>(shared_from_this()));
 }
 
 
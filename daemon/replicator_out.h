@@ -38,6 +38,7 @@
 
 // self
 //
+#include    "replicator.h"
 #include    "server.h"
 
 
@@ -62,6 +63,7 @@ class server;
 
 class replicator_out
     : public ed::tcp_client_permanent_message_connection
+    , public replicator
 {
 public:
     typedef std::shared_ptr<replicator_out> pointer_t;
@@ -83,6 +85,11 @@ public:
     virtual void        process_invalid() override;
     virtual void        process_connected() override;
 
+    void                msg_replication_format(ed::message & msg);
+    void                msg_state_chunk(ed::message & msg);
+    void                msg_state_end(ed::message & msg);
+    void                msg_sync_buckets(ed::message & msg);
+    void                msg_sync_request(ed::message & msg);
     void                msg_value_changed(ed::message & msg);
 
 private:
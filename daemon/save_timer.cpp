@@ -20,8 +20,9 @@
  * \brief The implementation of the save_timer.
  *
  * This file is the implementation of the save_timer class. It allows us
- * to save the settings after a few seconds, which gives time for the
- * client(s) to set multiple values in a row before a save happens.
+ * to save the settings a little after the last change, which gives time
+ * for the client(s) to set multiple values in a row before a save happens.
+ * The server sets the date at which the timer times out.
  */
 
 // self
@@ -40,8 +41,8 @@ namespace fluid_settings_daemon
 
 
 
-save_timer::save_timer(server * s, std::int64_t timeout_us)
-    : timer(timeout_us)
+save_timer::save_timer(server * s)
+    : timer(-1)
     , f_server(s)
 {
     // by default, there is nothing to save
@@ -57,8 +58,8 @@ save_timer::~save_timer()
 
 void save_timer::process_timeout()
 {
-    f_server->save_settings();
     set_enable(false);
+    f_server->save_settings();
 }
 
 
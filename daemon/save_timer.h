@@ -66,7 +66,7 @@ class save_timer
 public:
     typedef std::shared_ptr<save_timer>      pointer_t;
 
-                        save_timer(server * s, std::int64_t timeout_us);
+                        save_timer(server * s);
                         save_timer(save_timer const &) = delete;
     virtual             ~save_timer() override;
     save_timer &        operator = (save_timer const &) = delete;
@@ -31,25 +31,30 @@
 //
 #include    "server.h"
 
+#include    "background_saver.h"
+#include    "bootstrap_timer.h"
+#include    "fork_saver.h"
 #include    "gossip_timer.h"
+#include    "journal_timer.h"
 #include    "listener.h"
 #include    "messenger.h"
+#include    "reader_pool.h"
+#include    "replication_timer.h"
+#include    "replicator.h"
 #include    "replicator_in.h"
 #include    "replicator_out.h"
 #include    "save_timer.h"
+#include    "verify_timer.h"
 
 
 // fluid-settings
 //
 #include    <fluid-settings/names.h>
+#include    <fluid-settings/replication_frame.h>
+#include    <fluid-settings/snapshot_file.h>
 #include    <fluid-settings/version.h>
 
 
-// eventdispatcher
-//
-#include    <eventdispatcher/broadcast_message.h>
-
-
 // communicatord
 //
 #include    <communicatord/communicator.h>
@@ -59,6 +64,7 @@
 // advgetopt
 //
 #include    <advgetopt/exception.h>
+#include    <advgetopt/utils.h>
 #include    <advgetopt/validator_duration.h>
 #include    <advgetopt/validator_integer.h>
 
@@ -76,7 +82,7 @@
 
 // snapdev
 //
-#include    <snapdev/safe_variable.h>
+#include    <snapdev/not_used.h>
 #include    <snapdev/stringize.h>
 #include    <snapdev/tokenize_string.h>
 
@@ -84,6 +90,13 @@
 // C++
 //
 #include    <functional>
+#include    <future>
+
+
+// C
+//
+#include    <string.h>
+#include    <unistd.h>
 
 
 // last include
@@ -102,6 +115,24 @@ namespace
 
 advgetopt::option const g_options[] =
 {
+    advgetopt::define_option(
+          advgetopt::Name("bootstrap-timeout")
+        , advgetopt::Flags(advgetopt::all_flags<
+              advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+            , advgetopt::GETOPT_FLAG_REQUIRED>())
+        , advgetopt::DefaultValue("10s")
+        , advgetopt::Validator("duration")
+        , advgetopt::Help("when started without any values, number of seconds to wait for the state of another fluid-settings before answering requests; 0 to not request the state.")
+    ),
+    advgetopt::define_option(
+          advgetopt::Name("checkpoint-timeout")
+        , advgetopt::Flags(advgetopt::all_flags<
+              advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+            , advgetopt::GETOPT_FLAG_REQUIRED>())
+        , advgetopt::DefaultValue("5m")
+        , advgetopt::Validator("duration")
+        , advgetopt::Help("number of seconds to wait before rewriting the settings file when the changes are saved in the journal.")
+    ),
     advgetopt::define_option(
           advgetopt::Name("definitions")
         , advgetopt::Flags(advgetopt::all_flags<
@@ -109,6 +140,14 @@ advgetopt::option const g_options[] =
             , advgetopt::GETOPT_FLAG_REQUIRED>())
         , advgetopt::Help("a colon separated list of paths to fluid-settings definitions.")
     ),
+    advgetopt::define_option(
+          advgetopt::Name("export-conf")
+        , advgetopt::Flags(advgetopt::all_flags<
+              advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+            , advgetopt::GETOPT_FLAG_REQUIRED>())
+        , advgetopt::DefaultValue("false")
+        , advgetopt::Help("whether to also save the settings in the --settings file, a human readable export of the binary --snapshot file.")
+    ),
     advgetopt::define_option(
           advgetopt::Name("gossip-timeout")
         , advgetopt::Flags(advgetopt::all_flags<
@@ -118,6 +157,22 @@ advgetopt::option const g_options[] =
         , advgetopt::Validator("duration")
         , advgetopt::Help("number of seconds to wait before sending another FLUID_SETTINGS_GOSSIP message.")
     ),
+    advgetopt::define_option(
+          advgetopt::Name("history-depth")
+        , advgetopt::Flags(advgetopt::all_flags<
+              advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+            , advgetopt::GETOPT_FLAG_REQUIRED>())
+        , advgetopt::DefaultValue("16")
+        , advgetopt::Validator("integer(0...65535)")
+        , advgetopt::Help("number of changes kept in memory for each setting; 0 to disable the history.")
+    ),
+    advgetopt::define_option(
+          advgetopt::Name("journal")
+        , advgetopt::Flags(advgetopt::all_flags<
+              advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+            , advgetopt::GETOPT_FLAG_REQUIRED>())
+        , advgetopt::Help("a full path and filename to the journal; by default, the settings filename with \".journal\" as its extension; \"off\" to not use a journal.")
+    ),
     advgetopt::define_option(
           advgetopt::Name("listen")
         , advgetopt::Flags(advgetopt::all_flags<
@@ -126,13 +181,66 @@ advgetopt::option const g_options[] =
         , advgetopt::DefaultValue("127.0.0.1:4049")
         , advgetopt::Help("set the IP:port to listen on for connections by other fluid-settings daemons.")
     ),
+    advgetopt::define_option(
+          advgetopt::Name("reader-threads")
+        , advgetopt::Flags(advgetopt::all_flags<
+              advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+            , advgetopt::GETOPT_FLAG_REQUIRED>())
+        , advgetopt::DefaultValue("2")
+        , advgetopt::Validator("integer(0...256)")
+        , advgetopt::Help("number of threads used to answer FLUID_SETTINGS_GET and FLUID_SETTINGS_LIST messages; 0 to answer them in the main thread.")
+    ),
+    advgetopt::define_option(
+          advgetopt::Name("replication-batch-size")
+        , advgetopt::Flags(advgetopt::all_flags<
+              advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+            , advgetopt::GETOPT_FLAG_REQUIRED>())
+        , advgetopt::DefaultValue("1000")
+        , advgetopt::Validator("integer(1...1000000)")
+        , advgetopt::Help("maximum number of settings sent to the other fluid-settings in one batch; a full batch is sent before the end of the replication window.")
+    ),
+    advgetopt::define_option(
+          advgetopt::Name("replication-window")
+        , advgetopt::Flags(advgetopt::all_flags<
+              advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+            , advgetopt::GETOPT_FLAG_REQUIRED>())
+        , advgetopt::DefaultValue("0.01s")
+        , advgetopt::Validator("duration")
+        , advgetopt::Help("number of seconds during which the changes get gathered before being sent to the other fluid-settings; 0 to send them right away.")
+    ),
     advgetopt::define_option(
           advgetopt::Name("settings")
         , advgetopt::Flags(advgetopt::all_flags<
               advgetopt::GETOPT_FLAG_GROUP_OPTIONS
             , advgetopt::GETOPT_FLAG_REQUIRED>())
         , advgetopt::DefaultValue(fluid_settings::g_settings_file)
-        , advgetopt::Help("a full path and filename to a file where to save the fluid settings.")
+        , advgetopt::Help("a full path and filename to a file where to export the fluid settings in text; also loaded on startup when the --snapshot file does not exist.")
+    ),
+    advgetopt::define_option(
+          advgetopt::Name("snapshot")
+        , advgetopt::Flags(advgetopt::all_flags<
+              advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+            , advgetopt::GETOPT_FLAG_REQUIRED>())
+        , advgetopt::DefaultValue(fluid_settings::g_snapshot_file)
+        , advgetopt::Help("a full path and filename to the binary file where the fluid settings get saved.")
+    ),
+    advgetopt::define_option(
+          advgetopt::Name("save-delay")
+        , advgetopt::Flags(advgetopt::all_flags<
+              advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+            , advgetopt::GETOPT_FLAG_REQUIRED>())
+        , advgetopt::DefaultValue("1s")
+        , advgetopt::Validator("duration")
+        , advgetopt::Help("number of seconds without changes to wait before saving the latest changes; the delay grows while changes keep coming.")
+    ),
+    advgetopt::define_option(
+          advgetopt::Name("save-mode")
+        , advgetopt::Flags(advgetopt::all_flags<
+              advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+            , advgetopt::GETOPT_FLAG_REQUIRED>())
+        , advgetopt::DefaultValue("thread")
+        , advgetopt::Validator("keywords(thread,fork)")
+        , advgetopt::Help("how the settings get saved: \"thread\" saves them from a background thread, \"fork\" saves them from a child process.")
     ),
     advgetopt::define_option(
           advgetopt::Name("save-timeout")
@@ -141,7 +249,7 @@ advgetopt::option const g_options[] =
             , advgetopt::GETOPT_FLAG_REQUIRED>())
         , advgetopt::DefaultValue("5s")
         , advgetopt::Validator("duration")
-        , advgetopt::Help("number of seconds to wait before saving the latest changes; must be a valid positive number.")
+        , advgetopt::Help("maximum number of seconds a change can remain unsaved; must be a valid positive number.")
     ),
     advgetopt::define_option(
           advgetopt::Name("snapcommunicator")
@@ -151,6 +259,15 @@ advgetopt::option const g_options[] =
         , advgetopt::DefaultValue(communicatord::g_communicatord_default_ip_port.data())
         , advgetopt::Help("set the snapcommunicator IP:port to connect to.")
     ),
+    advgetopt::define_option(
+          advgetopt::Name("startup-threads")
+        , advgetopt::Flags(advgetopt::all_flags<
+              advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+            , advgetopt::GETOPT_FLAG_REQUIRED>())
+        , advgetopt::DefaultValue("0")
+        , advgetopt::Validator("integer(0...256)")
+        , advgetopt::Help("number of threads used to parse the definition files on startup; 0 to use one per processor.")
+    ),
     advgetopt::end_options()
 };
 
@@ -208,6 +325,13 @@ constexpr advgetopt::options_environment const g_options_environment =
 #pragma GCC diagnostic pop
 
 
+// number of settings sent in one FLUID_SETTINGS_STATE_CHUNK and number
+// of chunks sent without being acknowledged
+//
+constexpr std::size_t const     g_state_chunk_size = 256;
+constexpr std::uint64_t const   g_state_window = 4;
+
+
 }
 // no name namespace
 
@@ -235,9 +359,16 @@ int server::run()
 
     prepare_t initializers[] = {
         &server::prepare_settings,
+        &server::prepare_journal,
+        &server::prepare_history,
         &server::prepare_listener,
         &server::prepare_save_timer,
+        &server::prepare_replication_timer,
         &server::prepare_gossip_timer,
+        &server::prepare_reader_pool,
+        &server::prepare_background_saver,
+        &server::prepare_verify_timer,
+        &server::prepare_bootstrap,
     };
 
     for(auto const & f : initializers)
@@ -248,6 +379,14 @@ int server::run()
         }
     }
 
+    // the journal or the backup of the snapshot may have restored
+    // settings which are not yet in the snapshot
+    //
+    if(f_settings.get_unsaved_changes() > 0)
+    {
+        schedule_save();
+    }
+
     f_communicator->run();
 
     return f_exit_code;
@@ -256,20 +395,162 @@ int server::run()
 
 bool server::prepare_settings()
 {
+    // the binary snapshot is much faster to load; the text file is only
+    // used if the snapshot does not exist yet (i.e. first start after an
+    // upgrade) or is not valid and the text file is exported
+    //
+    // the snapshot gets read and decoded while the definitions get parsed;
+    // its values can only be loaded once the definitions are known
+    //
+    std::string const snapshot(f_opts.get_string("snapshot"));
+    std::future<fluid_settings::snapshot_content_t> content;
+    if(access(snapshot.c_str(), F_OK) == 0
+    || access((snapshot + ".bak").c_str(), F_OK) == 0)
+    {
+        content = std::async(
+                  std::launch::async
+                , &fluid_settings::settings::read_snapshot
+                , snapshot);
+    }
+
     std::string paths;
     if(f_opts.is_defined("definitions"))
     {
         paths = f_opts.get_string("definitions");
     }
-    if(!f_settings.load_definitions(paths))
+    if(!f_settings.load_definitions(paths, f_opts.get_long("startup-threads")))
     {
         SNAP_LOG_NOTICE
             << "no definitions found; is fluid-settings expecting definitions from other computers?"
             << SNAP_LOG_SEND;
     }
 
-    f_settings.load(f_opts.get_string("settings"));
+    // the text file is only current when it gets exported on each save
+    //
+    bool const export_conf(advgetopt::is_true(f_opts.get_string("export-conf")));
+    std::string const filename(f_opts.get_string("settings"));
+    if(content.valid())
+    {
+        if(f_settings.load_snapshot(content.get()))
+        {
+            return true;
+        }
+
+        if(!export_conf)
+        {
+            SNAP_LOG_FATAL
+                << "the snapshot \""
+                << snapshot
+                << "\" and its backup could not be loaded and \""
+                << filename
+                << "\" is not current since --export-conf is off; restore the snapshot before restarting fluid-settings."
+                << SNAP_LOG_SEND;
+            return false;
+        }
+
+        SNAP_LOG_SEVERE
+            << "the snapshot \""
+            << snapshot
+            << "\" and its backup could not be loaded; loading the \""
+            << filename
+            << "\" export instead."
+            << SNAP_LOG_SEND;
+        f_settings.load(filename);
+        return true;
+    }
+
+    // no snapshot yet (first start or upgrade from a version which only
+    // saved the text file); when the text file is not exported, it gets
+    // renamed once the first snapshot is saved so a stale version never
+    // gets loaded again
+    //
+    if(access(filename.c_str(), F_OK) == 0)
+    {
+        f_settings.load(filename);
+        if(!export_conf)
+        {
+            f_imported_settings = filename;
+        }
+    }
+
+    return true;
+}
+
+
+/** \brief Open the journal.
+ *
+ * The journal gets replayed over the settings which were just loaded
+ * and then opened so new changes can be appended to it.
+ *
+ * If the journal cannot be used, the daemon still works but saves the
+ * whole settings file after each change (see --save-timeout).
+ *
+ * \return true unless the --checkpoint-timeout is invalid.
+ */
+bool server::prepare_journal()
+{
+    std::string const & timeout(f_opts.get_string("checkpoint-timeout"));
+    double seconds(0.0);
+    if(!advgetopt::validator_duration::convert_string(
+              timeout
+            , advgetopt::validator_duration::VALIDATOR_DURATION_DEFAULT_FLAGS
+            , seconds)
+    || seconds <= 0.0)
+    {
+        SNAP_LOG_FATAL
+            << "the --checkpoint-timeout parameter must be a valid positive duration (\""
+            << timeout
+            << "\" is invalid)."
+            << SNAP_LOG_SEND;
+        return false;
+    }
+    f_checkpoint_timeout = seconds * 1'000'000;
+
+    std::string filename;
+    if(f_opts.is_defined("journal"))
+    {
+        filename = f_opts.get_string("journal");
+        if(filename == "off")
+        {
+            return true;
+        }
+    }
+    if(filename.empty())
+    {
+        filename = fluid_settings::journal::get_default_filename(f_opts.get_string("settings"));
+    }
+
+    f_journal = std::make_shared<fluid_settings::journal>(filename);
+    fluid_settings::change_set_t changes;
+    if(!f_journal->replay(f_settings, changes)
+    || !f_journal->open())
+    {
+        SNAP_LOG_ERROR
+            << "journal \""
+            << filename
+            << "\" cannot be used; changes will only be saved in the settings file."
+            << SNAP_LOG_SEND;
+        f_journal.reset();
+        return true;
+    }
+
+    f_journal_timer = std::make_shared<journal_timer>(this);
+    f_communicator->add_connection(f_journal_timer);
+
+    return true;
+}
+
 
+/** \brief Start recording the changes.
+ *
+ * The history gets enabled once the settings and the journal were loaded
+ * so only the changes made while the daemon runs are recorded.
+ *
+ * \return Always true.
+ */
+bool server::prepare_history()
+{
+    f_settings.set_history_depth(f_opts.get_long("history-depth"));
     return true;
 }
 
@@ -316,13 +597,57 @@ bool server::prepare_save_timer()
     }
     f_save_timeout = seconds * 1'000'000;
 
-    f_save_timer = std::make_shared<save_timer>(this, f_save_timeout);
+    std::string const & delay(f_opts.get_string("save-delay"));
+    if(!advgetopt::validator_duration::convert_string(
+              delay
+            , advgetopt::validator_duration::VALIDATOR_DURATION_DEFAULT_FLAGS
+            , seconds)
+    || seconds < 0.0)
+    {
+        SNAP_LOG_FATAL
+            << "the --save-delay parameter must be a valid duration (\""
+            << delay
+            << "\" is invalid)."
+            << SNAP_LOG_SEND;
+        return false;
+    }
+    f_save_delay = seconds * 1'000'000;
+    f_current_save_delay = f_save_delay;
+
+    f_save_timer = std::make_shared<save_timer>(this);
     f_communicator->add_connection(f_save_timer);
 
     return true;
 }
 
 
+bool server::prepare_replication_timer()
+{
+    std::string const & window(f_opts.get_string("replication-window"));
+    double seconds(0.0);
+    if(!advgetopt::validator_duration::convert_string(
+              window
+            , advgetopt::validator_duration::VALIDATOR_DURATION_DEFAULT_FLAGS
+            , seconds)
+    || seconds < 0.0)
+    {
+        SNAP_LOG_FATAL
+            << "the --replication-window parameter must be a valid duration (\""
+            << window
+            << "\" is invalid)."
+            << SNAP_LOG_SEND;
+        return false;
+    }
+    f_replication_window = seconds * 1'000'000;
+    f_replication_batch_size = f_opts.get_long("replication-batch-size");
+
+    f_replication_timer = std::make_shared<replication_timer>(this);
+    f_communicator->add_connection(f_replication_timer);
+
+    return true;
+}
+
+
 bool server::prepare_gossip_timer()
 {
     f_gossip_timeout = f_opts.get_long("gossip-timeout");
@@ -342,6 +667,101 @@ bool server::prepare_gossip_timer()
 }
 
 
+bool server::prepare_reader_pool()
+{
+    long const count(f_opts.get_long("reader-threads"));
+    if(count == 0)
+    {
+        // read requests are executed by the main thread
+        //
+        return true;
+    }
+
+    f_reader_pool = std::make_shared<reader_pool>(this, count);
+    f_communicator->add_connection(f_reader_pool);
+
+    return true;
+}
+
+
+bool server::prepare_background_saver()
+{
+    if(f_opts.get_string("save-mode") == "fork")
+    {
+        f_fork_saver = std::make_shared<fork_saver>(this);
+        f_communicator->add_connection(f_fork_saver);
+        return true;
+    }
+
+    f_background_saver = std::make_shared<background_saver>(this);
+    f_communicator->add_connection(f_background_saver);
+
+    return true;
+}
+
+
+bool server::prepare_verify_timer()
+{
+    if(!f_settings.has_deferred())
+    {
+        return true;
+    }
+
+    f_verify_timer = std::make_shared<verify_timer>(this, 10'000);
+    f_communicator->add_connection(f_verify_timer);
+
+    return true;
+}
+
+
+/** \brief Check whether the state of another fluid-settings is needed.
+ *
+ * A fluid-settings started without any values (i.e. a new computer
+ * joining the cluster) does not answer the GET and LIST requests until
+ * it received the state of another fluid-settings or the
+ * --bootstrap-timeout elapsed.
+ *
+ * \return true unless an error occurred.
+ */
+bool server::prepare_bootstrap()
+{
+    std::string const & timeout(f_opts.get_string("bootstrap-timeout"));
+    double seconds(0.0);
+    if(!advgetopt::validator_duration::convert_string(
+              timeout
+            , advgetopt::validator_duration::VALIDATOR_DURATION_DEFAULT_FLAGS
+            , seconds)
+    || seconds < 0.0)
+    {
+        SNAP_LOG_FATAL
+            << "the --bootstrap-timeout parameter must be a valid duration (\""
+            << timeout
+            << "\" is invalid)."
+            << SNAP_LOG_SEND;
+        return false;
+    }
+    f_bootstrap_timeout = seconds * 1'000'000;
+
+    if(f_bootstrap_timeout == 0
+    || f_settings.get_hash_tree().size() > 0)
+    {
+        return true;
+    }
+
+    SNAP_LOG_INFO
+        << "no settings found; waiting for the state of another fluid-settings before answering requests."
+        << SNAP_LOG_SEND;
+
+    f_bootstrap_state = bootstrap_state_t::BOOTSTRAP_WAITING;
+    f_bootstrap_timer = std::make_shared<bootstrap_timer>(this);
+    f_bootstrap_timer->set_timeout_date(ed::connection::get_current_date() + f_bootstrap_timeout);
+    f_bootstrap_timer->set_enable(true);
+    f_communicator->add_connection(f_bootstrap_timer);
+
+    return true;
+}
+
+
 void server::restart()
 {
     f_exit_code = 1;
@@ -351,6 +771,12 @@ void server::restart()
 
 void server::stop(bool quitting)
 {
+    // make sure the last changes are on disk, replied to, and sent to
+    // the other fluid-settings
+    //
+    commit_journal();
+    flush_replication();
+
     if(f_messenger != nullptr)
     {
         f_messenger->unregister_communicator(quitting);
@@ -364,8 +790,54 @@ void server::stop(bool quitting)
         f_communicator->remove_connection(f_save_timer);
         f_save_timer.reset();
 
+        if(f_replication_timer != nullptr)
+        {
+            f_communicator->remove_connection(f_replication_timer);
+            f_replication_timer.reset();
+        }
+
+        if(f_bootstrap_timer != nullptr)
+        {
+            f_communicator->remove_connection(f_bootstrap_timer);
+            f_bootstrap_timer.reset();
+        }
+
+        if(f_journal_timer != nullptr)
+        {
+            f_communicator->remove_connection(f_journal_timer);
+            f_journal_timer.reset();
+        }
+
+        if(f_verify_timer != nullptr)
+        {
+            f_communicator->remove_connection(f_verify_timer);
+            f_verify_timer.reset();
+        }
+
         f_communicator->remove_connection(f_listener);
         f_listener.reset();
+
+        if(f_reader_pool != nullptr)
+        {
+            f_communicator->remove_connection(f_reader_pool);
+            f_reader_pool->stop();
+            f_reader_pool.reset();
+        }
+
+        // this waits for the save in progress, if any
+        //
+        if(f_background_saver != nullptr)
+        {
+            f_communicator->remove_connection(f_background_saver);
+            f_background_saver->stop();
+            f_background_saver.reset();
+        }
+        if(f_fork_saver != nullptr)
+        {
+            f_communicator->remove_connection(f_fork_saver);
+            f_fork_saver->stop();
+            f_fork_saver.reset();
+        }
     }
 }
 
@@ -390,15 +862,33 @@ bool server::listen(
     ss.f_service = service_name;
 
     bool result(true);
+    bool known(false);
     for(auto & n : split_names)
     {
-        if(f_listeners[n].insert(ss).second)
+        // the definitions are only loaded on startup so an unknown
+        // setting never gets a value; the reply to the LISTEN message
+        // includes an error for those names
+        //
+        fluid_settings::setting_id_t const id(f_settings.resolve(n));
+        if(id == fluid_settings::INVALID_SETTING_ID)
+        {
+            continue;
+        }
+        known = true;
+
+        if(id >= f_listeners.size())
+        {
+            f_listeners.resize(id + 1);
+        }
+        if(f_listeners[id].insert(ss).second)
         {
             result = false;
         }
     }
 
-    return result;
+    // "already registered" only if all the names were registered before
+    //
+    return result && known;
 }
 
 
@@ -424,16 +914,15 @@ bool server::forget(
     bool result(true);
     for(auto & n : split_names)
     {
-        auto it(f_listeners.find(n));
-        if(it != f_listeners.end())
+        fluid_settings::setting_id_t const id(f_settings.resolve(n));
+        if(id < f_listeners.size())
         {
-            auto e(it->second.find(ss));
-            if(e != it->second.end())
+            auto e(f_listeners[id].find(ss));
+            if(e != f_listeners[id].end())
             {
-                it->second.erase(e);
-                if(it->second.empty())
+                f_listeners[id].erase(e);
+                if(f_listeners[id].empty())
                 {
-                    f_listeners.erase(it);
                     result = false;
                 }
             }
@@ -444,43 +933,84 @@ bool server::forget(
 }
 
 
-std::string server::list_of_options()
+fluid_settings::setting_id_t server::resolve(std::string const & name)
 {
-    return f_settings.list_of_options();
+    return f_settings.resolve(name);
 }
 
 
-fluid_settings::get_result_t server::get_default_value(
-      std::string const & name
-    , std::string & value)
+fluid_settings::snapshot::pointer_t server::get_snapshot()
 {
-    return f_settings.get_default_value(name, value);
+    return f_settings.get_snapshot();
 }
 
 
-fluid_settings::get_result_t server::get_value(
-      std::string const & name
-    , std::string & value
-    , fluid_settings::priority_t priority
-    , bool all)
-{
-    return f_settings.get_value(name, value, priority, all);
-}
+/** \brief Execute a read request.
+ *
+ * If reader threads are available, the request is sent to one of them.
+ * Otherwise it gets executed immediately.
+ *
+ * \param[in] job  The read request to execute.
+ */
+void server::read(read_job::pointer_t const & job)
+{
+    if(f_bootstrap_state != bootstrap_state_t::BOOTSTRAP_DONE)
+    {
+        // the reply would be based on an incomplete set of values
+        //
+        f_deferred_reads.push_back(job);
+        return;
+    }
+
+    if(f_reader_pool != nullptr)
+    {
+        f_reader_pool->push(job);
+        return;
+    }
+
+    job->execute();
+    read_done(job);
+}
+
+
+/** \brief Send the reply of a read request.
+ *
+ * This function is called in the main thread once the read request was
+ * executed.
+ *
+ * \param[in] job  The executed read request.
+ */
+void server::read_done(read_job::pointer_t const & job)
+{
+    if(f_messenger != nullptr)
+    {
+        f_messenger->send_message(job->get_reply());
+    }
+}
+
+
+fluid_settings::get_result_t server::get_buffer(
+      fluid_settings::setting_id_t id
+    , fluid_settings::value::buffer_t & value
+    , fluid_settings::priority_t priority)
+{
+    return f_settings.get_buffer(id, value, priority);
+}
 
 
 fluid_settings::set_result_t server::set_value(
-      std::string const & name
+      fluid_settings::setting_id_t id
     , std::string const & value
     , fluid_settings::priority_t priority
     , fluid_settings::timestamp_t const & timestamp)
 {
-    fluid_settings::set_result_t result(f_settings.set_value(name, value, priority, timestamp));
+    fluid_settings::set_result_t result(f_settings.set_value(id, value, priority, timestamp));
     switch(result)
     {
     case fluid_settings::set_result_t::SET_RESULT_NEW:
     case fluid_settings::set_result_t::SET_RESULT_NEW_PRIORITY:
     case fluid_settings::set_result_t::SET_RESULT_CHANGED:
-        value_changed(name);
+        process_changes({ id }, change_origin_t::CHANGE_ORIGIN_LOCAL);
         break;
 
     default:
@@ -492,13 +1022,81 @@ fluid_settings::set_result_t server::set_value(
 }
 
 
+/** \brief Apply a batch of changes.
+ *
+ * This function applies all the mutations of \p batch and then sends
+ * the notifications once for the whole batch.
+ *
+ * \param[in] batch  The mutations to apply.
+ *
+ * \return One result per mutation.
+ */
+fluid_settings::set_result_vector_t server::apply_batch(
+      fluid_settings::mutation_vector_t const & batch)
+{
+    fluid_settings::change_set_t changes;
+    fluid_settings::set_result_vector_t const results(f_settings.apply_batch(batch, changes));
+    process_changes(changes, change_origin_t::CHANGE_ORIGIN_LOCAL);
+    return results;
+}
+
+
+/** \brief Get the value a setting had at an earlier point.
+ *
+ * \param[in] id  The identifier of the setting.
+ * \param[out] value  The value at that point.
+ * \param[in] revision  The revision to look at.
+ * \param[in] timestamp  The time to look at.
+ *
+ * \return One of the get_result_t::GET_RESULT_... values.
+ */
+fluid_settings::get_result_t server::get_value_at(
+      fluid_settings::setting_id_t id
+    , std::string & value
+    , fluid_settings::history::revision_t revision
+    , snapdev::timespec_ex const & timestamp)
+{
+    return f_settings.get_value_at(id, value, revision, timestamp);
+}
+
+
+/** \brief Restore the settings of a namespace.
+ *
+ * The restored settings are processed as local changes: they get saved
+ * in the journal, sent to the listeners and to the other fluid-settings.
+ *
+ * \param[in] name_space  The namespace of the settings to restore.
+ * \param[in] revision  The revision to go back to.
+ *
+ * \return false if the history does not go back to \p revision.
+ */
+bool server::rollback(
+      std::string const & name_space
+    , fluid_settings::history::revision_t revision)
+{
+    fluid_settings::change_set_t changes;
+    if(!f_settings.rollback(name_space, revision, changes))
+    {
+        return false;
+    }
+    process_changes(changes, change_origin_t::CHANGE_ORIGIN_LOCAL);
+    return true;
+}
+
+
+fluid_settings::history::revision_t server::get_revision() const
+{
+    return f_settings.get_revision();
+}
+
+
 bool server::reset_setting(
-      std::string const & name
+      fluid_settings::setting_id_t id
     , fluid_settings::priority_t priority)
 {
-    if(f_settings.reset_setting(name, priority))
+    if(f_settings.reset_setting(id, priority))
     {
-        value_changed(name);
+        process_changes({ id }, change_origin_t::CHANGE_ORIGIN_LOCAL);
         return true;
     }
 
@@ -506,93 +1104,491 @@ bool server::reset_setting(
 }
 
 
-void server::value_changed(std::string const & name)
+/** \brief Process the settings which changed.
+ *
+ * All the changes, whether they come from a local service (PUT, DELETE)
+ * or from another fluid-settings (VALUE_CHANGED), go through this
+ * function. It arms the save timer, sends the new value of each setting
+ * to its listeners and, for local changes only, sends the values to the
+ * other fluid-settings. Remote changes are not broadcast back to avoid
+ * echoing them around the mesh.
+ *
+ * The listeners are only told about a setting if its effective value
+ * is not the same as the last one they were sent. For example, a new
+ * value at a lower priority or a replicated value which we already
+ * had does not generate a notification.
+ *
+ * \param[in] changes  The sorted list of settings which changed.
+ * \param[in] origin  Where the changes come from.
+ */
+void server::process_changes(
+      fluid_settings::change_set_t const & changes
+    , change_origin_t origin)
+{
+    if(f_messenger == nullptr
+    || changes.empty())
+    {
+        return;
+    }
+
+    schedule_save();
+
+    for(auto const id : changes)
+    {
+        std::string const & name(f_settings.get_name(id));
+
+        if(f_journal != nullptr)
+        {
+            fluid_settings::priority_set const * values(f_settings.get_values(id));
+            if(values != nullptr)
+            {
+                f_journal->append(name, *values);
+                f_journal_timer->trigger();
+            }
+        }
+
+        // the effective value is memoized and shared, no need to copy it
+        //
+        fluid_settings::settings_table::effective_t const * effective(f_settings.get_effective(id));
+        fluid_settings::value::buffer_t current;
+        if(effective != nullptr
+        && effective->f_is_set)
+        {
+            current = effective->f_value;
+        }
+
+        if(id >= f_notified.size())
+        {
+            f_notified.resize(id + 1);
+        }
+        std::optional<fluid_settings::value::buffer_t> & last(f_notified[id]);
+        bool const same(last.has_value()
+                    && (*last == current
+                        || (*last != nullptr && current != nullptr && **last == *current)));
+        last = current;
+
+        // tell the listeners about the new value
+        //
+        if(!same
+        && id < f_listeners.size()
+        && !f_listeners[id].empty())
+        {
+            for(auto const & s : f_listeners[id])
+            {
+                ed::message new_value;
+                new_value.set_command(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_value_updated);
+                new_value.add_parameter(fluid_settings::g_name_fluid_settings_param_name, name);
+                if(current != nullptr)
+                {
+                    new_value.add_parameter(fluid_settings::g_name_fluid_settings_param_value, *current);
+                }
+                else
+                {
+                    new_value.add_parameter(fluid_settings::g_name_fluid_settings_param_reason, "value undefined");
+                }
+                new_value.set_server(s.f_server);
+                new_value.set_service(s.f_service);
+                f_messenger->send_message(new_value);
+            }
+        }
+
+        // if this change happened because another fluid-settings sent us
+        // a message, avoid broadcasting back; a fluid-settings which was
+        // not connected to the sender gets the change on its next
+        // synchronization
+        //
+        // values removed by the verification are also removed by the
+        // other fluid-settings when they verify theirs
+        //
+        if(origin == change_origin_t::CHANGE_ORIGIN_REMOTE
+        || origin == change_origin_t::CHANGE_ORIGIN_VERIFY)
+        {
+            continue;
+        }
+
+        // next we want to tell the other fluid-settings that things changed
+        //
+        queue_replication(id);
+    }
+
+    if(f_replication_window == 0)
+    {
+        flush_replication();
+    }
+}
+
+
+/** \brief Send a reply once the changes are on disk.
+ *
+ * The replies to PUT and DELETE messages must only be sent once the
+ * change is safe in the journal. If the journal has pending records,
+ * the reply is queued until the next commit_journal(). Otherwise it is
+ * sent immediately.
+ *
+ * \param[in] reply  The reply to send.
+ */
+void server::reply_after_commit(ed::message & reply)
 {
-    if(f_messenger == nullptr)
+    if(f_journal != nullptr
+    && f_journal->has_pending())
+    {
+        f_pending_replies.push_back(reply);
+        return;
+    }
+
+    f_messenger->send_message(reply);
+}
+
+
+/** \brief Write the pending journal records and send the replies.
+ *
+ * This function is called by the journal_timer once per run of the
+ * event loop so all the changes received together share a single
+ * fdatasync() (group commit).
+ *
+ * If the journal cannot be written, the error gets logged and the
+ * replies are held since the changes are not yet safe. A save starts
+ * right away and the replies are sent once it succeeds. The journal
+ * keeps the records which could not be written so the replies also get
+ * sent if a later commit succeeds first.
+ */
+void server::commit_journal()
+{
+    if(f_journal != nullptr
+    && !f_journal->commit())
     {
+        f_held_replies.insert(
+                  f_held_replies.end()
+                , f_pending_replies.begin()
+                , f_pending_replies.end());
+        f_pending_replies.clear();
+        save_now();
         return;
     }
 
-    if(!f_save_timer->is_enabled())
+    if(f_messenger != nullptr)
     {
-        f_save_timer->set_enable(true);
-        f_save_timer->set_timeout_delay(f_save_timeout);
+        for(auto & reply : f_held_replies)
+        {
+            f_messenger->send_message(reply);
+        }
+        for(auto & reply : f_pending_replies)
+        {
+            f_messenger->send_message(reply);
+        }
     }
+    f_held_replies.clear();
+    f_saved_replies = 0;
+    f_pending_replies.clear();
+}
 
-    // tell the listeners about the new value
-    //
-    std::string value;
-    fluid_settings::get_result_t const result(f_settings.get_value(name, value));
-    for(auto const & s : f_listeners[name])
-    {
-        ed::message new_value;
-        new_value.set_command(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_value_updated);
-        new_value.add_parameter(fluid_settings::g_name_fluid_settings_param_name, name);
-        switch(result)
-        {
-        case fluid_settings::get_result_t::GET_RESULT_SUCCESS:
-        case fluid_settings::get_result_t::GET_RESULT_DEFAULT:
-            new_value.add_parameter(fluid_settings::g_name_fluid_settings_param_value, value);
-            break;
 
-        default:
-            new_value.add_parameter(fluid_settings::g_name_fluid_settings_param_reason, "value undefined");
-            break;
+/** \brief Set the time of the next save.
+ *
+ * The settings get saved once no changes were received for the current
+ * save delay. Each change pushes the save back so a burst of changes
+ * results in a single save. However, a change never remains unsaved for
+ * more than the save window: the --save-timeout duration or, with a
+ * journal, the --checkpoint-timeout duration.
+ *
+ * The current save delay starts at --save-delay. It gets doubled each
+ * time a save happens shortly after the previous one (i.e. the changes
+ * keep coming) and goes back to --save-delay once things calm down.
+ * This way an isolated change gets saved quickly and a continuous flow
+ * of changes gets saved in larger batches.
+ */
+void server::schedule_save()
+{
+    if(f_save_timer == nullptr)
+    {
+        return;
+    }
+
+    std::int64_t const now(ed::connection::get_current_date());
+    if(f_first_unsaved_change == 0)
+    {
+        f_first_unsaved_change = now;
+    }
+
+    std::int64_t const window_end(f_first_unsaved_change + get_save_window());
+    std::int64_t date(now + f_current_save_delay);
+    f_save_forced = date >= window_end;
+    if(f_save_forced)
+    {
+        date = window_end;
+    }
+
+    f_save_timer->set_timeout_date(date);
+    f_save_timer->set_enable(true);
+}
+
+
+/** \brief Save the settings as soon as possible.
+ *
+ * This function is used when the changes could not be committed to the
+ * journal. Instead of waiting for the save delay, the save timer gets
+ * triggered on the next run of the event loop.
+ */
+void server::save_now()
+{
+    if(f_save_timer == nullptr)
+    {
+        return;
+    }
+
+    if(f_first_unsaved_change == 0)
+    {
+        f_first_unsaved_change = ed::connection::get_current_date();
+    }
+    f_save_timer->set_timeout_date(ed::connection::get_current_date());
+    f_save_timer->set_enable(true);
+}
 
+
+/** \brief Verify some of the values loaded without validation.
+ *
+ * On startup, the values of settings whose definition changed since
+ * they were saved get loaded without validation. This function
+ * validates a few of them at a time. The invalid values get removed
+ * and the listeners told about the change.
+ *
+ * \return true if more values need to be verified.
+ */
+bool server::verify_settings()
+{
+    fluid_settings::change_set_t changes;
+    bool const more(f_settings.verify_deferred(1'000, changes));
+    process_changes(changes, change_origin_t::CHANGE_ORIGIN_VERIFY);
+
+    if(!more)
+    {
+        // the values which are still valid get saved with their new
+        // definition
+        //
+        if(f_settings.get_unsaved_changes() > 0)
+        {
+            schedule_save();
         }
-        new_value.set_server(s.f_server);
-        new_value.set_service(s.f_service);
-        f_messenger->send_message(new_value);
     }
 
-    // if this change happened because another fluid-settings sent us
-    // a message, avoid broadcasting back
+    return more;
+}
+
+
+/** \brief Get the maximum time a change can remain unsaved.
+ *
+ * \return The save window in microseconds.
+ */
+std::int64_t server::get_save_window() const
+{
+    return f_journal != nullptr ? f_checkpoint_timeout : f_save_timeout;
+}
+
+
+void server::save_settings()
+{
+    // a child which died without telling us would otherwise block all
+    // the following saves
     //
-    // TODO: verify that this is really correct... while everyone is
-    //       properly connected, we're certainly just fine, if someone
-    //       was not connected to the sender, maybe it is to this
-    //       instance and it should also be sent a copy of the new value
+    if(f_fork_saver != nullptr)
+    {
+        f_fork_saver->check();
+    }
+
+    // only one save at a time; the changes made while the save runs
+    // remain marked as unsaved and get saved next
     //
-    if(f_remote_change)
+    if(f_save_request != nullptr)
     {
+        f_save_again = true;
         return;
     }
 
-    // next we want to tell the other fluid-settings that things changed
+    // the journal must not include records newer than the checkpoint
+    // once we reset it
+    //
+    commit_journal();
+
+    // this save includes all the changes so far, including the ones
+    // which could not be committed to the journal
+    //
+    f_save_timer->set_enable(false);
+    f_saved_replies = f_held_replies.size();
+
+    // adapt the delay to the rate at which the changes arrive
+    //
+    std::int64_t const now(ed::connection::get_current_date());
+    std::int64_t const window(get_save_window());
+    if(f_last_save != 0
+    && now - f_last_save < window * 2)
+    {
+        f_current_save_delay = std::min(std::max(f_current_save_delay * 2, f_save_delay), window);
+    }
+    else
+    {
+        f_current_save_delay = f_save_delay;
+    }
+    f_last_save = now;
+    f_save_start = now;
+    f_first_unsaved_change = 0;
+    if(f_save_forced)
+    {
+        ++f_save_stats.f_forced_saves;
+        f_save_forced = false;
+    }
+
+    std::string export_filename;
+    if(advgetopt::is_true(f_opts.get_string("export-conf")))
+    {
+        export_filename = f_opts.get_string("settings");
+    }
+    f_save_request = f_settings.prepare_save(
+              f_opts.get_string("snapshot")
+            , export_filename);
+
+    // changes committed to the journal after this point are not part
+    // of the save and must survive the reset of the journal
+    //
+    f_journal_mark = f_journal != nullptr ? f_journal->get_size() : 0;
+
+    if(f_background_saver != nullptr)
+    {
+        f_background_saver->push(f_save_request);
+    }
+    else if(f_fork_saver == nullptr
+         || !f_fork_saver->start(f_save_request))
+    {
+        fluid_settings::settings::execute_save(*f_save_request);
+        save_done(f_save_request);
+    }
+
+    // the daemon is otherwise idle when the save timer fires, which makes
+    // it a good time to give back unused memory
     //
-    ed::message value_changed;
-    value_changed.set_command(fluid_settings::g_name_fluid_settings_cmd_value_changed);
-    value_changed.add_parameter(fluid_settings::g_name_fluid_settings_param_name, name);
-    value_changed.add_parameter(fluid_settings::g_name_fluid_settings_param_values, f_settings.serialize_value(name));
-    ed::broadcast_message(f_replicators, value_changed, false);
-
-    // old way...
-    //for(auto & c : f_communicator->get_connections())
-    //{
-    //    // fluid-settings we connected to
-    //    //
-    //    replicator_out::pointer_t rout(std::dynamic_pointer_cast<replicator_out>(c));
-    //    if(rout != nullptr)
-    //    {
-    //        rout->send_message(value_changed);
-    //        continue;
-    //    }
+    std::size_t const released(f_settings.compact());
+    if(released > 0)
+    {
+        SNAP_LOG_DEBUG
+            << "memory pool compaction released "
+            << released
+            << " bytes."
+            << SNAP_LOG_SEND;
+    }
+}
+
+
+void server::save_done(fluid_settings::save_request_t::pointer_t const & request)
+{
+    f_settings.save_done(*request);
+
+    std::int64_t const duration(ed::connection::get_current_date() - f_save_start);
+    std::uint64_t const count(request->f_ids.size());
+    ++f_save_stats.f_saves;
+    f_save_stats.f_changes += count;
+    f_save_stats.f_max_changes = std::max(f_save_stats.f_max_changes, count);
+    f_save_stats.f_duration += duration;
+    f_save_stats.f_max_duration = std::max(f_save_stats.f_max_duration, duration);
+
+    // the snapshot was synchronized to disk before execute_save()
+    // returned so the journal can safely be reset
     //
-    //    // fluid-settings that connected to us
-    //    //
-    //    replicator_in::pointer_t rin(std::dynamic_pointer_cast<replicator_in>(c));
-    //    if(rin != nullptr)
-    //    {
-    //        rin->send_message(value_changed);
-    //        continue;
-    //    }
-    //}
+    if(request->f_saved)
+    {
+        if(f_journal != nullptr
+        && !f_journal->reset(f_journal_mark))
+        {
+            // the records are still valid, only the journal keeps
+            // growing and replaying it at startup takes longer
+            //
+            SNAP_LOG_ERROR
+                << "could not trim the journal \""
+                << f_journal->get_filename()
+                << "\"."
+                << SNAP_LOG_SEND;
+        }
+
+        if(f_saved_replies > 0)
+        {
+            if(f_messenger != nullptr)
+            {
+                for(std::size_t idx(0); idx < f_saved_replies; ++idx)
+                {
+                    f_messenger->send_message(f_held_replies[idx]);
+                }
+            }
+            f_held_replies.erase(
+                      f_held_replies.begin()
+                    , f_held_replies.begin() + f_saved_replies);
+            f_saved_replies = 0;
+        }
+
+        if(!f_imported_settings.empty())
+        {
+            std::string const imported(f_imported_settings + ".imported");
+            if(rename(f_imported_settings.c_str(), imported.c_str()) != 0)
+            {
+                int const e(errno);
+                SNAP_LOG_WARNING
+                    << "could not rename \""
+                    << f_imported_settings
+                    << "\" to \""
+                    << imported
+                    << "\" (errno: "
+                    << e
+                    << ", "
+                    << strerror(e)
+                    << ")."
+                    << SNAP_LOG_SEND;
+            }
+            f_imported_settings.clear();
+        }
+    }
+    else
+    {
+        SNAP_LOG_ERROR
+            << "could not save the settings to \""
+            << request->f_filename
+            << "\"."
+            << SNAP_LOG_SEND;
+    }
+
+    f_save_request.reset();
+    f_saved_replies = 0;
+
+    if(request->f_saved
+    && !f_held_replies.empty())
+    {
+        // some clients are waiting for changes made during the save
+        //
+        f_save_again = false;
+        save_now();
+    }
+    else if(f_save_again
+         || !request->f_saved)
+    {
+        f_save_again = false;
+        schedule_save();
+    }
 }
 
 
-void server::save_settings()
+fluid_settings::memory_pool::stats_t server::get_memory_stats() const
+{
+    return f_settings.get_memory_stats();
+}
+
+
+fluid_settings::history::stats_t server::get_history_stats() const
+{
+    return f_settings.get_history_stats();
+}
+
+
+save_stats_t server::get_save_stats() const
 {
-    f_settings.save(f_opts.get_string("settings"));
+    save_stats_t stats(f_save_stats);
+    stats.f_delay = f_current_save_delay;
+    return stats;
 }
 
 
@@ -634,24 +1630,947 @@ void server::connect_to_other_fluid_settings(addr::addr const & their_ip)
 }
 
 
-void server::add_replicator(ed::connection_with_send_message::weak_t connection)
+/** \brief Queue a setting to be sent to the other fluid-settings.
+ *
+ * The changes are gathered for --replication-window and then sent in
+ * one batch. A setting which changes several times within the window
+ * is sent only once, with its latest values. When the queue reaches
+ * --replication-batch-size settings, it gets sent right away.
+ *
+ * \param[in] id  The identifier of the setting which changed.
+ */
+void server::queue_replication(fluid_settings::setting_id_t id)
 {
-    f_replicators.push_back(connection);
+    if(f_replicators.empty())
+    {
+        return;
+    }
+
+    std::int64_t const now(ed::connection::get_current_date());
+    f_replication_queue.emplace(id, now);
+    if(f_replication_queue.size() >= f_replication_batch_size
+    || f_replication_timer == nullptr)
+    {
+        flush_replication();
+        return;
+    }
+
+    if(f_replication_window > 0
+    && !f_replication_timer->is_enabled())
+    {
+        f_replication_timer->set_timeout_date(now + f_replication_window);
+        f_replication_timer->set_enable(true);
+    }
 }
 
 
-void server::remote_value_changed(
+/** \brief Send the queued settings to the other fluid-settings.
+ *
+ * Each connection gets the values in the format negotiated with the
+ * other side (see send_values()). The binary frames and the text of
+ * each setting are only generated once.
+ */
+void server::flush_replication()
+{
+    if(f_replication_timer != nullptr)
+    {
+        f_replication_timer->set_enable(false);
+    }
+    if(f_replication_queue.empty())
+    {
+        return;
+    }
+
+    std::int64_t const now(ed::connection::get_current_date());
+    f_replication_stats.f_batch_sizes.add(f_replication_queue.size());
+    std::vector<fluid_settings::setting_id_t> ids;
+    ids.reserve(f_replication_queue.size());
+    for(auto const & q : f_replication_queue)
+    {
+        f_replication_stats.f_delays.add(std::max(now - q.second, static_cast<std::int64_t>(0)));
+        ids.push_back(q.first);
+    }
+
+    std::vector<std::string> frames;
+    std::vector<std::string> texts;
+    for(auto it(f_replicators.begin()); it != f_replicators.end(); )
+    {
+        ed::connection_with_send_message::pointer_t c(it->lock());
+        if(c == nullptr)
+        {
+            it = f_replicators.erase(it);
+            continue;
+        }
+        ++it;
+
+        send_values(c, ids, frames, texts);
+    }
+
+    f_replication_queue.clear();
+}
+
+
+/** \brief Send the values of some settings to one fluid-settings.
+ *
+ * The values are sent in the format negotiated with the other side.
+ * With the binary format, all the settings are sent in a single
+ * VALUE_CHANGED message. With the text format, one message is sent
+ * per setting.
+ *
+ * The \p frames and \p texts are caches of the binary frames and the
+ * text of each setting so they get generated only once when sending
+ * the same settings to several connections. They must be empty on the
+ * first call.
+ *
+ * \param[in] c  The connection to the other fluid-settings.
+ * \param[in] ids  The identifiers of the settings to send.
+ * \param[in,out] frames  The cache of binary frames.
+ * \param[in,out] texts  The cache of text values.
+ */
+void server::send_values(
+      ed::connection_with_send_message::pointer_t const & c
+    , std::vector<fluid_settings::setting_id_t> const & ids
+    , std::vector<std::string> & frames
+    , std::vector<std::string> & texts)
+{
+    if(ids.empty())
+    {
+        return;
+    }
+
+    replicator * r(dynamic_cast<replicator *>(c.get()));
+    if(r != nullptr
+    && r->is_binary())
+    {
+        if(frames.empty())
+        {
+            frames.reserve(ids.size());
+            for(auto const id : ids)
+            {
+                frames.emplace_back();
+                fluid_settings::priority_set const * values(f_settings.get_values(id));
+                if(values != nullptr)
+                {
+                    fluid_settings::encode_frame(frames.back(), *values);
+                }
+            }
+        }
+
+        std::string batch;
+        for(std::size_t idx(0); idx < ids.size(); ++idx)
+        {
+            std::string_view name;
+            if(r->mark_name_sent(ids[idx]))
+            {
+                name = f_settings.get_name(ids[idx]);
+            }
+            fluid_settings::encode_batch_entry(batch, ids[idx], name, frames[idx]);
+        }
+
+        std::string encoded;
+        fluid_settings::encode_base64(encoded, batch);
+
+        ed::message value_changed;
+        value_changed.set_command(fluid_settings::g_name_fluid_settings_cmd_value_changed);
+        value_changed.add_parameter(fluid_settings::g_name_fluid_settings_param_frame, encoded);
+        c->send_message(value_changed);
+        return;
+    }
+
+    if(texts.empty())
+    {
+        texts.reserve(ids.size());
+        for(auto const id : ids)
+        {
+            texts.push_back(f_settings.serialize_value(id));
+        }
+    }
+
+    for(std::size_t idx(0); idx < ids.size(); ++idx)
+    {
+        ed::message value_changed;
+        value_changed.set_command(fluid_settings::g_name_fluid_settings_cmd_value_changed);
+        value_changed.add_parameter(fluid_settings::g_name_fluid_settings_param_name, f_settings.get_name(ids[idx]));
+        value_changed.add_parameter(fluid_settings::g_name_fluid_settings_param_values, texts[idx]);
+        c->send_message(value_changed);
+    }
+}
+
+
+replication_stats_t server::get_replication_stats() const
+{
+    return f_replication_stats;
+}
+
+
+void server::add_replicator(ed::connection_with_send_message::weak_t connection)
+{
+    f_replicators.push_back(connection);
+}
+
+
+void server::remote_value_changed(
       ed::message const & msg
     , ed::connection_with_send_message::pointer_t const & c)
 {
-    snapdev::NOT_USED(c);
+    if(f_bootstrap_state != bootstrap_state_t::BOOTSTRAP_DONE)
+    {
+        // apply those once the state of the other side was received
+        //
+        f_bootstrap_messages.emplace_back(msg, c);
+        return;
+    }
 
-    snapdev::safe_variable<bool> safe(f_remote_change, true, false);
+    if(msg.has_parameter(fluid_settings::g_name_fluid_settings_param_frame))
+    {
+        remote_frame(msg, c);
+        return;
+    }
 
     std::string const name(msg.get_parameter(fluid_settings::g_name_fluid_settings_param_name));
     std::string const values(msg.get_parameter(fluid_settings::g_name_fluid_settings_param_values));
 
-    f_settings.unserialize_values(name, values);
+    fluid_settings::change_set_t changes;
+    f_settings.unserialize_values(name, values, changes);
+    process_changes(changes, change_origin_t::CHANGE_ORIGIN_REMOTE);
+}
+
+
+/** \brief Apply the values received in a binary batch.
+ *
+ * The batch includes the frames of values of one or more settings.
+ * Each setting is identified by the identifier it has on the sender.
+ * The first batch including a setting also includes its name.
+ *
+ * All the values of the batch get applied at once.
+ *
+ * \param[in] msg  The VALUE_CHANGED message.
+ * \param[in] c  The connection which received the message.
+ */
+void server::remote_frame(
+      ed::message const & msg
+    , ed::connection_with_send_message::pointer_t const & c)
+{
+    replicator * r(dynamic_cast<replicator *>(c.get()));
+    if(r == nullptr)
+    {
+        return;
+    }
+
+    // the entries point inside the decoded batch
+    //
+    std::string frame;
+    fluid_settings::batch_entry_vector_t entries;
+    if(!fluid_settings::decode_base64(msg.get_parameter(fluid_settings::g_name_fluid_settings_param_frame), frame)
+    || !fluid_settings::decode_batch(frame, entries))
+    {
+        SNAP_LOG_RECOVERABLE_ERROR
+            << "received an invalid batch of values."
+            << SNAP_LOG_SEND;
+        return;
+    }
+
+    fluid_settings::mutation_vector_t batch;
+    for(auto const & e : entries)
+    {
+        fluid_settings::setting_id_t id(fluid_settings::INVALID_SETTING_ID);
+        if(!e.f_name.empty())
+        {
+            id = f_settings.resolve(std::string(e.f_name));
+            r->set_remote_id(e.f_id, id);
+        }
+        else
+        {
+            id = r->get_remote_id(e.f_id);
+        }
+        if(id == fluid_settings::INVALID_SETTING_ID)
+        {
+            SNAP_LOG_RECOVERABLE_ERROR
+                << "received values for unknown setting identifier "
+                << e.f_id
+                << "."
+                << SNAP_LOG_SEND;
+            continue;
+        }
+
+        std::size_t const start(batch.size());
+        if(!fluid_settings::decode_frame(e.f_frame, batch))
+        {
+            SNAP_LOG_RECOVERABLE_ERROR
+                << "received an invalid frame of values for \""
+                << f_settings.get_name(id)
+                << "\"."
+                << SNAP_LOG_SEND;
+            batch.resize(start);
+            continue;
+        }
+        for(std::size_t idx(start); idx < batch.size(); ++idx)
+        {
+            batch[idx].f_id = id;
+        }
+    }
+
+    fluid_settings::change_set_t changes;
+    f_settings.apply_batch(batch, changes);
+    process_changes(changes, change_origin_t::CHANGE_ORIGIN_REMOTE);
+}
+
+
+
+/** \brief Start the synchronization with another fluid-settings.
+ *
+ * When a connection to another fluid-settings is established, the two
+ * may have missed changes made while they were not connected. This
+ * function sends the root digest of our hash tree. If the other side
+ * has a different root, the two exchange the digests of their buckets
+ * and then of the settings found in the buckets which differ. Only the
+ * settings which differ get sent, in both directions:
+ *
+ * \code
+ *     FLUID_SETTINGS_SYNC          root of the side which connected
+ *     FLUID_SETTINGS_SYNC_BUCKETS  all the bucket digests of the other side
+ *     FLUID_SETTINGS_SYNC_DIGESTS  setting digests in the differing buckets
+ *     VALUE_CHANGED                settings which differ, both ways
+ *     FLUID_SETTINGS_SYNC_REQUEST  names of the settings the other side
+ *                                  wants to receive
+ * \endcode
+ *
+ * The values received this way get merged like any other replicated
+ * values, so the most recent value of each priority wins on both sides.
+ *
+ * \param[in] c  The connection to the other fluid-settings.
+ */
+void server::start_sync(ed::connection_with_send_message::pointer_t const & c)
+{
+    ed::message sync;
+    sync.set_command(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_sync);
+    sync.add_parameter(
+              fluid_settings::g_name_fluid_settings_param_root
+            , fluid_settings::hash_tree::encode_digests({ f_settings.get_hash_tree().get_root() }));
+    c->send_message(sync);
+}
+
+
+/** \brief Compare the root digest of the other fluid-settings.
+ *
+ * If the root digests differ, the digests of all our buckets are sent
+ * back.
+ *
+ * \param[in] msg  The FLUID_SETTINGS_SYNC message.
+ * \param[in] c  The connection which received the message.
+ */
+void server::sync_root(
+      ed::message const & msg
+    , ed::connection_with_send_message::pointer_t const & c)
+{
+    fluid_settings::hash_tree const & tree(f_settings.get_hash_tree());
+    fluid_settings::hash_tree::digest_vector_t root;
+    if(!fluid_settings::hash_tree::decode_digests(msg.get_parameter(fluid_settings::g_name_fluid_settings_param_root), root)
+    || root.size() != 1)
+    {
+        SNAP_LOG_RECOVERABLE_ERROR
+            << "received an invalid root digest."
+            << SNAP_LOG_SEND;
+        return;
+    }
+    if(root[0] == tree.get_root())
+    {
+        return;
+    }
+
+    ed::message buckets;
+    buckets.set_command(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_sync_buckets);
+    buckets.add_parameter(
+              fluid_settings::g_name_fluid_settings_param_buckets
+            , fluid_settings::hash_tree::encode_digests(tree.get_buckets()));
+    c->send_message(buckets);
+}
+
+
+/** \brief Compare the bucket digests of the other fluid-settings.
+ *
+ * The digests of our settings found in the buckets which differ are
+ * sent back.
+ *
+ * \param[in] msg  The FLUID_SETTINGS_SYNC_BUCKETS message.
+ * \param[in] c  The connection which received the message.
+ */
+void server::sync_buckets(
+      ed::message const & msg
+    , ed::connection_with_send_message::pointer_t const & c)
+{
+    fluid_settings::hash_tree const & tree(f_settings.get_hash_tree());
+    fluid_settings::hash_tree::digest_vector_t buckets;
+    if(!fluid_settings::hash_tree::decode_digests(msg.get_parameter(fluid_settings::g_name_fluid_settings_param_buckets), buckets)
+    || buckets.size() != fluid_settings::hash_tree::BUCKET_COUNT)
+    {
+        SNAP_LOG_RECOVERABLE_ERROR
+            << "received an invalid list of bucket digests."
+            << SNAP_LOG_SEND;
+        return;
+    }
+
+    std::string differences;
+    std::string digests;
+    for(std::size_t bucket(0); bucket < fluid_settings::hash_tree::BUCKET_COUNT; ++bucket)
+    {
+        if(buckets[bucket] == tree.get_bucket(bucket))
+        {
+            continue;
+        }
+        if(!differences.empty())
+        {
+            differences += ',';
+        }
+        differences += std::to_string(bucket);
+
+        std::vector<fluid_settings::setting_id_t> members;
+        tree.get_bucket_members(bucket, members);
+        for(auto const id : members)
+        {
+            if(!digests.empty())
+            {
+                digests += ',';
+            }
+            digests += fluid_settings::hash_tree::encode_digests({ tree.get_digest(id) });
+            digests += ':';
+            digests += f_settings.get_name(id);
+        }
+    }
+    if(differences.empty())
+    {
+        return;
+    }
+
+    ed::message reply;
+    reply.set_command(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_sync_digests);
+    reply.add_parameter(fluid_settings::g_name_fluid_settings_param_buckets, differences);
+    reply.add_parameter(fluid_settings::g_name_fluid_settings_param_digests, digests);
+    c->send_message(reply);
+}
+
+
+/** \brief Compare the setting digests of the other fluid-settings.
+ *
+ * Our settings which are missing or different on the other side get
+ * sent to it. The settings which the other side has and which are
+ * missing or different here get requested.
+ *
+ * \param[in] msg  The FLUID_SETTINGS_SYNC_DIGESTS message.
+ * \param[in] c  The connection which received the message.
+ */
+void server::sync_digests(
+      ed::message const & msg
+    , ed::connection_with_send_message::pointer_t const & c)
+{
+    fluid_settings::hash_tree const & tree(f_settings.get_hash_tree());
+
+    std::map<std::string, fluid_settings::hash_tree::digest_t> remote;
+    std::vector<std::string> entries;
+    snapdev::tokenize_string(
+          entries
+        , msg.get_parameter(fluid_settings::g_name_fluid_settings_param_digests)
+        , { "," }
+        , true);
+    for(auto const & e : entries)
+    {
+        std::string::size_type const pos(e.find(':'));
+        fluid_settings::hash_tree::digest_vector_t digest;
+        if(pos == std::string::npos
+        || !fluid_settings::hash_tree::decode_digests(std::string_view(e).substr(0, pos), digest)
+        || digest.size() != 1)
+        {
+            SNAP_LOG_RECOVERABLE_ERROR
+                << "received an invalid setting digest (\""
+                << e
+                << "\")."
+                << SNAP_LOG_SEND;
+            return;
+        }
+        remote[e.substr(pos + 1)] = digest[0];
+    }
+
+    // send what the other side is missing or has different
+    //
+    std::vector<std::string> buckets;
+    snapdev::tokenize_string(
+          buckets
+        , msg.get_parameter(fluid_settings::g_name_fluid_settings_param_buckets)
+        , { "," }
+        , true);
+    std::vector<fluid_settings::setting_id_t> ids;
+    for(auto const & b : buckets)
+    {
+        std::int64_t bucket(0);
+        if(!advgetopt::validator_integer::convert_string(b, bucket)
+        || bucket < 0
+        || static_cast<std::size_t>(bucket) >= fluid_settings::hash_tree::BUCKET_COUNT)
+        {
+            SNAP_LOG_RECOVERABLE_ERROR
+                << "received an invalid bucket number (\""
+                << b
+                << "\")."
+                << SNAP_LOG_SEND;
+            return;
+        }
+
+        std::vector<fluid_settings::setting_id_t> members;
+        tree.get_bucket_members(bucket, members);
+        for(auto const id : members)
+        {
+            auto const it(remote.find(f_settings.get_name(id)));
+            if(it == remote.end()
+            || it->second != tree.get_digest(id))
+            {
+                ids.push_back(id);
+            }
+        }
+    }
+    std::vector<std::string> frames;
+    std::vector<std::string> texts;
+    send_values(c, ids, frames, texts);
+
+    // request what we are missing or have different
+    //
+    std::string names;
+    std::size_t requested(0);
+    for(auto const & r : remote)
+    {
+        fluid_settings::setting_id_t const id(f_settings.resolve(r.first));
+        if(id == fluid_settings::INVALID_SETTING_ID
+        || r.second == tree.get_digest(id))
+        {
+            continue;
+        }
+        if(!names.empty())
+        {
+            names += ',';
+        }
+        names += r.first;
+        ++requested;
+    }
+
+    SNAP_LOG_INFO
+        << "synchronization with another fluid-settings: sent "
+        << ids.size()
+        << " setting(s), requested "
+        << requested
+        << "."
+        << SNAP_LOG_SEND;
+
+    if(!names.empty())
+    {
+        ed::message request;
+        request.set_command(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_sync_request);
+        request.add_parameter(fluid_settings::g_name_fluid_settings_param_names, names);
+        c->send_message(request);
+    }
+}
+
+
+/** \brief Send the settings requested by the other fluid-settings.
+ *
+ * \param[in] msg  The FLUID_SETTINGS_SYNC_REQUEST message.
+ * \param[in] c  The connection which received the message.
+ */
+void server::sync_request(
+      ed::message const & msg
+    , ed::connection_with_send_message::pointer_t const & c)
+{
+    std::vector<std::string> names;
+    snapdev::tokenize_string(
+          names
+        , msg.get_parameter(fluid_settings::g_name_fluid_settings_param_names)
+        , { "," }
+        , true);
+    std::vector<fluid_settings::setting_id_t> ids;
+    for(auto const & name : names)
+    {
+        fluid_settings::setting_id_t const id(f_settings.resolve(name));
+        if(id != fluid_settings::INVALID_SETTING_ID)
+        {
+            ids.push_back(id);
+        }
+    }
+
+    std::vector<std::string> frames;
+    std::vector<std::string> texts;
+    send_values(c, ids, frames, texts);
+}
+
+
+
+/** \brief Request the state of another fluid-settings.
+ *
+ * When this fluid-settings started without any values, the first
+ * connection to another fluid-settings is used to request its state
+ * in full. The other side sends all of its settings in chunks
+ * of values:
+ *
+ * \code
+ *     FLUID_SETTINGS_STATE_REQUEST  sent by the new fluid-settings
+ *     FLUID_SETTINGS_STATE_CHUNK    a batch of settings, numbered
+ *     FLUID_SETTINGS_STATE_ACK      sent back for each chunk received
+ *     FLUID_SETTINGS_STATE_END      all the settings were sent
+ * \endcode
+ *
+ * The other side stops sending chunks when too many were not yet
+ * acknowledged so a slow receiver does not get flooded.
+ *
+ * Until the stream ends or the --bootstrap-timeout elapses, the GET
+ * and LIST requests and the replicated values are kept aside. The
+ * synchronization with the other fluid-settings is also postponed.
+ *
+ * \param[in] c  The new connection to another fluid-settings.
+ *
+ * \return true if the daemon is bootstrapping, in which case the caller
+ * must not start the synchronization.
+ */
+bool server::request_state(ed::connection_with_send_message::pointer_t const & c)
+{
+    switch(f_bootstrap_state)
+    {
+    case bootstrap_state_t::BOOTSTRAP_DONE:
+        return false;
+
+    case bootstrap_state_t::BOOTSTRAP_STREAMING:
+        return true;
+
+    case bootstrap_state_t::BOOTSTRAP_WAITING:
+        break;
+
+    }
+
+    f_bootstrap_state = bootstrap_state_t::BOOTSTRAP_STREAMING;
+    f_bootstrap_source = c;
+    f_bootstrap_chunks = 0;
+    f_bootstrap_timer->set_timeout_date(ed::connection::get_current_date() + f_bootstrap_timeout);
+
+    ed::message request;
+    request.set_command(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_state_request);
+    c->send_message(request);
+
+    return true;
+}
+
+
+/** \brief Start streaming our state to another fluid-settings.
+ *
+ * The state is taken from a snapshot so the settings can still change
+ * while the stream is in progress. Such changes get replicated as usual
+ * and the synchronization run by the other side at the end of the
+ * stream takes care of anything missed.
+ *
+ * \param[in] msg  The FLUID_SETTINGS_STATE_REQUEST message.
+ * \param[in] c  The connection which received the message.
+ */
+void server::state_request(
+      ed::message const & msg
+    , ed::connection_with_send_message::pointer_t const & c)
+{
+    snapdev::NOT_USED(msg);
+
+    replicator * r(dynamic_cast<replicator *>(c.get()));
+    if(r == nullptr)
+    {
+        return;
+    }
+
+    replicator::state_stream_t & stream(r->get_state_stream());
+    stream = replicator::state_stream_t();
+    stream.f_snapshot = f_settings.get_snapshot();
+
+    send_state_chunks(c);
+}
+
+
+/** \brief Send the next chunks of our state.
+ *
+ * Chunks are sent until g_state_window of them are waiting for an
+ * acknowledgement. Once all the settings were sent, the
+ * FLUID_SETTINGS_STATE_END message gets sent.
+ *
+ * \param[in] c  The connection to the fluid-settings receiving our state.
+ */
+void server::send_state_chunks(ed::connection_with_send_message::pointer_t const & c)
+{
+    replicator * r(dynamic_cast<replicator *>(c.get()));
+    if(r == nullptr)
+    {
+        return;
+    }
+
+    replicator::state_stream_t & stream(r->get_state_stream());
+    if(stream.f_snapshot == nullptr)
+    {
+        return;
+    }
+
+    std::size_t const size(stream.f_snapshot->size());
+    while(stream.f_position < size
+       && stream.f_sent - stream.f_acknowledged < g_state_window)
+    {
+        std::string batch;
+        std::size_t count(0);
+        for(; stream.f_position < size && count < g_state_chunk_size; ++stream.f_position)
+        {
+            fluid_settings::snapshot::record_t const * record(stream.f_snapshot->get_record(stream.f_position));
+            if(record == nullptr
+            || record->f_name == nullptr
+            || record->f_values == nullptr
+            || record->f_values->empty())
+            {
+                continue;
+            }
+
+            std::string frame;
+            fluid_settings::encode_frame(frame, *record->f_values);
+            fluid_settings::encode_batch_entry(batch, stream.f_position, *record->f_name, frame);
+            ++count;
+        }
+        if(count == 0)
+        {
+            break;
+        }
+
+        std::string encoded;
+        fluid_settings::encode_base64(encoded, batch);
+
+        ed::message chunk;
+        chunk.set_command(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_state_chunk);
+        chunk.add_parameter(fluid_settings::g_name_fluid_settings_param_sequence, stream.f_sent);
+        chunk.add_parameter(fluid_settings::g_name_fluid_settings_param_frame, encoded);
+        c->send_message(chunk);
+        ++stream.f_sent;
+    }
+
+    if(stream.f_position >= size)
+    {
+        ed::message end;
+        end.set_command(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_state_end);
+        end.add_parameter(fluid_settings::g_name_fluid_settings_param_chunks, stream.f_sent);
+        c->send_message(end);
+
+        stream.f_snapshot.reset();
+    }
+}
+
+
+/** \brief A chunk of our state was received by the other side.
+ *
+ * \param[in] msg  The FLUID_SETTINGS_STATE_ACK message.
+ * \param[in] c  The connection which received the message.
+ */
+void server::state_ack(
+      ed::message const & msg
+    , ed::connection_with_send_message::pointer_t const & c)
+{
+    replicator * r(dynamic_cast<replicator *>(c.get()));
+    if(r == nullptr)
+    {
+        return;
+    }
+
+    std::int64_t const sequence(msg.get_integer_parameter(fluid_settings::g_name_fluid_settings_param_sequence));
+    replicator::state_stream_t & stream(r->get_state_stream());
+    if(sequence >= 0
+    && static_cast<std::uint64_t>(sequence) < stream.f_sent)
+    {
+        stream.f_acknowledged = std::max(stream.f_acknowledged, static_cast<std::uint64_t>(sequence) + 1);
+    }
+
+    send_state_chunks(c);
+}
+
+
+/** \brief Apply a chunk of the state of another fluid-settings.
+ *
+ * The chunk uses the same batch format as the binary VALUE_CHANGED
+ * message except that each entry always includes the name of the
+ * setting.
+ *
+ * \param[in] msg  The FLUID_SETTINGS_STATE_CHUNK message.
+ * \param[in] c  The connection which received the message.
+ */
+void server::state_chunk(
+      ed::message const & msg
+    , ed::connection_with_send_message::pointer_t const & c)
+{
+    if(f_bootstrap_state != bootstrap_state_t::BOOTSTRAP_STREAMING
+    || f_bootstrap_source.lock() != c)
+    {
+        return;
+    }
+
+    // the entries point inside the decoded batch
+    //
+    std::string frame;
+    fluid_settings::batch_entry_vector_t entries;
+    if(!fluid_settings::decode_base64(msg.get_parameter(fluid_settings::g_name_fluid_settings_param_frame), frame)
+    || !fluid_settings::decode_batch(frame, entries))
+    {
+        SNAP_LOG_RECOVERABLE_ERROR
+            << "received an invalid chunk of the state of another fluid-settings."
+            << SNAP_LOG_SEND;
+        return;
+    }
+
+    fluid_settings::mutation_vector_t batch;
+    for(auto const & e : entries)
+    {
+        fluid_settings::setting_id_t const id(f_settings.resolve(std::string(e.f_name)));
+        if(id == fluid_settings::INVALID_SETTING_ID)
+        {
+            continue;
+        }
+
+        std::size_t const start(batch.size());
+        if(!fluid_settings::decode_frame(e.f_frame, batch))
+        {
+            SNAP_LOG_RECOVERABLE_ERROR
+                << "received an invalid frame of values for \""
+                << e.f_name
+                << "\"."
+                << SNAP_LOG_SEND;
+            batch.resize(start);
+            continue;
+        }
+        for(std::size_t idx(start); idx < batch.size(); ++idx)
+        {
+            batch[idx].f_id = id;
+        }
+    }
+
+    fluid_settings::change_set_t changes;
+    f_settings.apply_batch(batch, changes);
+    process_changes(changes, change_origin_t::CHANGE_ORIGIN_REMOTE);
+
+    ++f_bootstrap_chunks;
+    f_bootstrap_timer->set_timeout_date(ed::connection::get_current_date() + f_bootstrap_timeout);
+
+    ed::message ack;
+    ack.set_command(fluid_settings::g_name_fluid_settings_cmd_fluid_settings_state_ack);
+    ack.add_parameter(
+              fluid_settings::g_name_fluid_settings_param_sequence
+            , msg.get_integer_parameter(fluid_settings::g_name_fluid_settings_param_sequence));
+    c->send_message(ack);
+}
+
+
+/** \brief The state of another fluid-settings was fully received.
+ *
+ * \param[in] msg  The FLUID_SETTINGS_STATE_END message.
+ * \param[in] c  The connection which received the message.
+ */
+void server::state_end(
+      ed::message const & msg
+    , ed::connection_with_send_message::pointer_t const & c)
+{
+    if(f_bootstrap_state != bootstrap_state_t::BOOTSTRAP_STREAMING
+    || f_bootstrap_source.lock() != c)
+    {
+        return;
+    }
+
+    std::int64_t const chunks(msg.get_integer_parameter(fluid_settings::g_name_fluid_settings_param_chunks));
+    if(chunks < 0
+    || static_cast<std::uint64_t>(chunks) != f_bootstrap_chunks)
+    {
+        SNAP_LOG_WARNING
+            << "the state of another fluid-settings was sent in "
+            << chunks
+            << " chunks but "
+            << f_bootstrap_chunks
+            << " were received."
+            << SNAP_LOG_SEND;
+    }
+    else
+    {
+        SNAP_LOG_INFO
+            << "received the state of another fluid-settings ("
+            << f_settings.get_hash_tree().size()
+            << " settings)."
+            << SNAP_LOG_SEND;
+    }
+
+    finish_bootstrap();
+}
+
+
+/** \brief The bootstrap took too long.
+ *
+ * Either no other fluid-settings was found or the stream stalled. In
+ * both cases, this fluid-settings starts answering requests with
+ * whatever values it has.
+ */
+void server::bootstrap_timeout()
+{
+    if(f_bootstrap_state == bootstrap_state_t::BOOTSTRAP_WAITING)
+    {
+        SNAP_LOG_WARNING
+            << "no other fluid-settings found before the --bootstrap-timeout elapsed; starting without any values."
+            << SNAP_LOG_SEND;
+    }
+    else
+    {
+        SNAP_LOG_WARNING
+            << "the state of another fluid-settings was not received before the --bootstrap-timeout elapsed ("
+            << f_bootstrap_chunks
+            << " chunks received)."
+            << SNAP_LOG_SEND;
+    }
+
+    finish_bootstrap();
+}
+
+
+/** \brief Start answering requests.
+ *
+ * The replicated values received while bootstrapping get applied, the
+ * synchronization with the other fluid-settings starts, and the
+ * requests kept aside get answered.
+ */
+void server::finish_bootstrap()
+{
+    if(f_bootstrap_state == bootstrap_state_t::BOOTSTRAP_DONE)
+    {
+        return;
+    }
+    f_bootstrap_state = bootstrap_state_t::BOOTSTRAP_DONE;
+    f_bootstrap_source.reset();
+    if(f_bootstrap_timer != nullptr)
+    {
+        f_bootstrap_timer->set_enable(false);
+    }
+
+    std::vector<std::pair<ed::message, ed::connection_with_send_message::weak_t>> messages;
+    messages.swap(f_bootstrap_messages);
+    for(auto const & m : messages)
+    {
+        ed::connection_with_send_message::pointer_t c(m.second.lock());
+        if(c != nullptr)
+        {
+            remote_value_changed(m.first, c);
+        }
+    }
+
+    for(auto const & w : f_replicators)
+    {
+        ed::connection_with_send_message::pointer_t c(w.lock());
+        if(std::dynamic_pointer_cast<replicator_out>(c) != nullptr)
+        {
+            start_sync(c);
+        }
+    }
+
+    std::vector<read_job::pointer_t> reads;
+    reads.swap(f_deferred_reads);
+    fluid_settings::snapshot::pointer_t const snapshot(f_settings.get_snapshot());
+    for(auto const & job : reads)
+    {
+        job->set_snapshot(snapshot);
+        read(job);
+    }
 }
 
 
@@ -24,8 +24,15 @@
  * run loop.
  */
 
+// self
+//
+#include    "read_job.h"
+
+
 // fluid-settings
 //
+#include    <fluid-settings/histogram.h>
+#include    <fluid-settings/journal.h>
 #include    <fluid-settings/settings.h>
 
 
@@ -41,12 +48,62 @@
 #include    <eventdispatcher/tcp_server_connection.h>
 
 
+// C++
+//
+#include    <map>
+#include    <optional>
+
+
 
 namespace fluid_settings_daemon
 {
 
 
+class background_saver;
+class bootstrap_timer;
+class fork_saver;
+class journal_timer;
 class messenger;
+class reader_pool;
+class replication_timer;
+class verify_timer;
+
+
+enum class change_origin_t
+{
+    CHANGE_ORIGIN_LOCAL,        // PUT or DELETE from a local service
+    CHANGE_ORIGIN_REMOTE,       // VALUE_CHANGED from another fluid-settings
+    CHANGE_ORIGIN_VERIFY,       // value found invalid after its definition changed
+};
+
+
+enum class bootstrap_state_t
+{
+    BOOTSTRAP_DONE,             // answering requests
+    BOOTSTRAP_WAITING,          // waiting for a connection to another fluid-settings
+    BOOTSTRAP_STREAMING,        // receiving the state of another fluid-settings
+};
+
+
+struct save_stats_t
+{
+    std::uint64_t           f_saves = 0;
+    std::uint64_t           f_forced_saves = 0;     // saves which reached the save window
+    std::uint64_t           f_changes = 0;          // number of settings saved
+    std::uint64_t           f_max_changes = 0;      // largest number of settings saved at once
+    std::int64_t            f_duration = 0;         // total time spent saving (us)
+    std::int64_t            f_max_duration = 0;     // longest save (us)
+    std::int64_t            f_delay = 0;            // current save delay (us)
+};
+
+
+struct replication_stats_t
+{
+    fluid_settings::histogram
+                            f_batch_sizes = fluid_settings::histogram();    // settings sent per batch
+    fluid_settings::histogram
+                            f_delays = fluid_settings::histogram();         // time in queue (us)
+};
 
 
 class server
@@ -68,28 +125,56 @@ public:
                                   std::string const & server_name
                                 , std::string const & service_name
                                 , std::string const & names);
-    std::string             list_of_options();
-    fluid_settings::get_result_t
-                            get_value(
-                                  std::string const & name
-                                , std::string & value
-                                , fluid_settings::priority_t priority
-                                , bool all);
+    fluid_settings::setting_id_t
+                            resolve(std::string const & name);
+    fluid_settings::snapshot::pointer_t
+                            get_snapshot();
+    void                    read(read_job::pointer_t const & job);
+    void                    read_done(read_job::pointer_t const & job);
     fluid_settings::get_result_t
-                            get_default_value(
-                                  std::string const & name
-                                , std::string & value);
+                            get_buffer(
+                                  fluid_settings::setting_id_t id
+                                , fluid_settings::value::buffer_t & value
+                                , fluid_settings::priority_t priority);
     fluid_settings::set_result_t
                             set_value(
-                                  std::string const & name
+                                  fluid_settings::setting_id_t id
                                 , std::string const & value
                                 , fluid_settings::priority_t priority
                                 , snapdev::timespec_ex const & timestamp);
+    fluid_settings::set_result_vector_t
+                            apply_batch(
+                                  fluid_settings::mutation_vector_t const & batch);
+    fluid_settings::get_result_t
+                            get_value_at(
+                                  fluid_settings::setting_id_t id
+                                , std::string & value
+                                , fluid_settings::history::revision_t revision
+                                , snapdev::timespec_ex const & timestamp);
+    bool                    rollback(
+                                  std::string const & name_space
+                                , fluid_settings::history::revision_t revision);
+    fluid_settings::history::revision_t
+                            get_revision() const;
     bool                    reset_setting(
-                                  std::string const & name
+                                  fluid_settings::setting_id_t id
                                 , int priority);
-    void                    value_changed(std::string const & name);
+    void                    process_changes(
+                                  fluid_settings::change_set_t const & changes
+                                , change_origin_t origin);
+    void                    reply_after_commit(ed::message & reply);
+    void                    commit_journal();
+    void                    schedule_save();
+    void                    save_now();
+    bool                    verify_settings();
     void                    save_settings();
+    void                    save_done(fluid_settings::save_request_t::pointer_t const & request);
+    fluid_settings::memory_pool::stats_t
+                            get_memory_stats() const;
+    fluid_settings::history::stats_t
+                            get_history_stats() const;
+    save_stats_t            get_save_stats() const;
+    replication_stats_t     get_replication_stats() const;
     addr::addr const &      get_listener_address() const;
     void                    send_gossip();
     void                    connect_to_other_fluid_settings(
@@ -98,12 +183,59 @@ public:
                                   ed::message const & msg
                                 , ed::connection_with_send_message::pointer_t const & c);
     void                    add_replicator(ed::connection_with_send_message::weak_t connection);
+    void                    flush_replication();
+    void                    start_sync(ed::connection_with_send_message::pointer_t const & c);
+    void                    sync_root(
+                                  ed::message const & msg
+                                , ed::connection_with_send_message::pointer_t const & c);
+    void                    sync_buckets(
+                                  ed::message const & msg
+                                , ed::connection_with_send_message::pointer_t const & c);
+    void                    sync_digests(
+                                  ed::message const & msg
+                                , ed::connection_with_send_message::pointer_t const & c);
+    void                    sync_request(
+                                  ed::message const & msg
+                                , ed::connection_with_send_message::pointer_t const & c);
+    bool                    request_state(ed::connection_with_send_message::pointer_t const & c);
+    void                    state_request(
+                                  ed::message const & msg
+                                , ed::connection_with_send_message::pointer_t const & c);
+    void                    state_ack(
+                                  ed::message const & msg
+                                , ed::connection_with_send_message::pointer_t const & c);
+    void                    state_chunk(
+                                  ed::message const & msg
+                                , ed::connection_with_send_message::pointer_t const & c);
+    void                    state_end(
+                                  ed::message const & msg
+                                , ed::connection_with_send_message::pointer_t const & c);
+    void                    bootstrap_timeout();
 
 private:
     bool                    prepare_settings();
+    bool                    prepare_journal();
+    bool                    prepare_history();
     bool                    prepare_listener();
     bool                    prepare_save_timer();
+    bool                    prepare_replication_timer();
     bool                    prepare_gossip_timer();
+    bool                    prepare_reader_pool();
+    bool                    prepare_background_saver();
+    bool                    prepare_verify_timer();
+    bool                    prepare_bootstrap();
+    std::int64_t            get_save_window() const;
+    void                    queue_replication(fluid_settings::setting_id_t id);
+    void                    send_values(
+                                  ed::connection_with_send_message::pointer_t const & c
+                                , std::vector<fluid_settings::setting_id_t> const & ids
+                                , std::vector<std::string> & frames
+                                , std::vector<std::string> & texts);
+    void                    send_state_chunks(ed::connection_with_send_message::pointer_t const & c);
+    void                    finish_bootstrap();
+    void                    remote_frame(
+                                  ed::message const & msg
+                                , ed::connection_with_send_message::pointer_t const & c);
 
     advgetopt::getopt       f_opts;
     ed::communicator::pointer_t
@@ -115,16 +247,65 @@ private:
     ed::tcp_server_connection::pointer_t
                             f_listener = ed::tcp_server_connection::pointer_t();
     std::int64_t            f_save_timeout = 5'000'000;
+    std::int64_t            f_save_delay = 1'000'000;
+    std::int64_t            f_current_save_delay = 1'000'000;
+    std::int64_t            f_first_unsaved_change = 0;
+    std::int64_t            f_last_save = 0;
+    std::int64_t            f_save_start = 0;
+    bool                    f_save_forced = false;
+    save_stats_t            f_save_stats = save_stats_t();
     ed::timer::pointer_t    f_save_timer = ed::timer::pointer_t();
+    std::int64_t            f_checkpoint_timeout = 300'000'000;
+    fluid_settings::journal::pointer_t
+                            f_journal = fluid_settings::journal::pointer_t();
+    std::shared_ptr<journal_timer>
+                            f_journal_timer = std::shared_ptr<journal_timer>();
+    std::vector<ed::message>
+                            f_pending_replies = std::vector<ed::message>();
+    std::vector<ed::message>
+                            f_held_replies = std::vector<ed::message>();    // waiting for a save since the commit failed
+    std::size_t             f_saved_replies = 0;                            // held replies covered by the save in progress
     fluid_settings::settings
                             f_settings = fluid_settings::settings();
-    bool                    f_remote_change = false;
+    std::vector<std::optional<fluid_settings::value::buffer_t>>
+                            f_notified = std::vector<std::optional<fluid_settings::value::buffer_t>>();  // no value: never notified
     std::int64_t            f_gossip_timeout = 60;
     ed::connection::pointer_t
                             f_gossip_timer = ed::connection::pointer_t();
     int                     f_exit_code = 0;
     ed::connection_with_send_message::list_weak_t
                             f_replicators = ed::connection_with_send_message::list_weak_t();
+    std::int64_t            f_replication_window = 10'000;
+    std::size_t             f_replication_batch_size = 1'000;
+    std::map<fluid_settings::setting_id_t, std::int64_t>
+                            f_replication_queue = std::map<fluid_settings::setting_id_t, std::int64_t>();
+    std::shared_ptr<replication_timer>
+                            f_replication_timer = std::shared_ptr<replication_timer>();
+    replication_stats_t     f_replication_stats = replication_stats_t();
+    bootstrap_state_t       f_bootstrap_state = bootstrap_state_t::BOOTSTRAP_DONE;
+    std::int64_t            f_bootstrap_timeout = 10'000'000;
+    std::shared_ptr<bootstrap_timer>
+                            f_bootstrap_timer = std::shared_ptr<bootstrap_timer>();
+    ed::connection_with_send_message::weak_t
+                            f_bootstrap_source = ed::connection_with_send_message::weak_t();
+    std::uint64_t           f_bootstrap_chunks = 0;
+    std::vector<std::pair<ed::message, ed::connection_with_send_message::weak_t>>
+                            f_bootstrap_messages = std::vector<std::pair<ed::message, ed::connection_with_send_message::weak_t>>();
+    std::vector<read_job::pointer_t>
+                            f_deferred_reads = std::vector<read_job::pointer_t>();
+    std::shared_ptr<reader_pool>
+                            f_reader_pool = std::shared_ptr<reader_pool>();
+    std::shared_ptr<verify_timer>
+                            f_verify_timer = std::shared_ptr<verify_timer>();
+    std::shared_ptr<background_saver>
+                            f_background_saver = std::shared_ptr<background_saver>();
+    std::shared_ptr<fork_saver>
+                            f_fork_saver = std::shared_ptr<fork_saver>();
+    fluid_settings::save_request_t::pointer_t
+                            f_save_request = fluid_settings::save_request_t::pointer_t();
+    std::size_t             f_journal_mark = 0;
+    std::string             f_imported_settings = std::string();
+    bool                    f_save_again = false;
 
     struct server_service
     {
@@ -147,9 +328,11 @@ private:
             return f_service < rhs.f_service;
         }
     };
-    typedef std::map<std::string, server_service::set_t>    listener_t;
+    typedef std::vector<server_service::set_t>              listener_by_id_t;
 
-    listener_t              f_listeners = listener_t();
+    // listeners are found by setting identifier
+    //
+    listener_by_id_t        f_listeners = listener_by_id_t();
 };
 
 
@@ -0,0 +1,67 @@
+// Copyright (c) 2022-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/** \file
+ * \brief The implementation of the verify_timer.
+ *
+ * The timer times out every few milliseconds until all the values
+ * loaded without validation were verified. Each time, a small number
+ * of settings get verified so the daemon keeps answering messages in
+ * the meantime.
+ */
+
+// self
+//
+#include    "verify_timer.h"
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace fluid_settings_daemon
+{
+
+
+
+verify_timer::verify_timer(server * s, std::int64_t timeout_us)
+    : timer(timeout_us)
+    , f_server(s)
+{
+}
+
+
+verify_timer::~verify_timer()
+{
+}
+
+
+void verify_timer::process_timeout()
+{
+    if(!f_server->verify_settings())
+    {
+        set_enable(false);
+    }
+}
+
+
+
+} // namespace fluid_settings_daemon
+// vim: ts=4 sw=4 et
@@ -0,0 +1,247 @@
+// Copyright (c) 2011-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/** \file
+ * \brief Implementation of the CRC32C checksum function.
+ *
+ * The CRC32C gets computed with the processor instructions when
+ * available: SSE4.2 on x86_64 and the CRC extension on ARMv8. Those
+ * functions are compiled with a target attribute so the library does
+ * not require special compiler flags. Whether the processor supports
+ * them is checked once, at runtime.
+ *
+ * The portable version is table driven. The table gets computed once on
+ * the first call.
+ */
+
+// self
+//
+#include    "crc32c.h"
+
+
+// C
+//
+#include    <string.h>
+
+#if defined(__x86_64__)
+#include    <nmmintrin.h>
+#elif defined(__aarch64__)
+#include    <arm_acle.h>
+#include    <asm/hwcap.h>
+#include    <sys/auxv.h>
+#endif
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace fluid_settings
+{
+
+
+
+namespace
+{
+
+
+
+constexpr std::uint32_t const   g_crc32c_polynomial = 0x82F63B78; // reversed 0x1EDC6F41
+
+
+struct crc32c_table
+{
+    crc32c_table()
+    {
+        for(std::uint32_t n(0); n < 256; ++n)
+        {
+            std::uint32_t c(n);
+            for(int k(0); k < 8; ++k)
+            {
+                c = (c & 1) != 0 ? (c >> 1) ^ g_crc32c_polynomial : c >> 1;
+            }
+            f_table[n] = c;
+        }
+    }
+
+    std::uint32_t           f_table[256] = {};
+};
+
+
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2")))
+std::uint32_t crc32c_hw(
+      void const * data
+    , std::size_t size
+    , std::uint32_t crc)
+{
+    std::uint8_t const * s(reinterpret_cast<std::uint8_t const *>(data));
+    std::uint64_t c(~crc);
+    for(; size > 0 && (reinterpret_cast<std::uintptr_t>(s) & 7) != 0; --size, ++s)
+    {
+        c = _mm_crc32_u8(c, *s);
+    }
+    for(; size >= 8; size -= 8, s += 8)
+    {
+        std::uint64_t v;
+        memcpy(&v, s, sizeof(v));
+        c = _mm_crc32_u64(c, v);
+    }
+    for(; size > 0; --size, ++s)
+    {
+        c = _mm_crc32_u8(c, *s);
+    }
+    return ~static_cast<std::uint32_t>(c);
+}
+
+
+bool has_crc32c_hw()
+{
+    return __builtin_cpu_supports("sse4.2");
+}
+#elif defined(__aarch64__)
+__attribute__((target("+crc")))
+std::uint32_t crc32c_hw(
+      void const * data
+    , std::size_t size
+    , std::uint32_t crc)
+{
+    std::uint8_t const * s(reinterpret_cast<std::uint8_t const *>(data));
+    std::uint32_t c(~crc);
+    for(; size > 0 && (reinterpret_cast<std::uintptr_t>(s) & 7) != 0; --size, ++s)
+    {
+        c = __crc32cb(c, *s);
+    }
+    for(; size >= 8; size -= 8, s += 8)
+    {
+        std::uint64_t v;
+        memcpy(&v, s, sizeof(v));
+        c = __crc32cd(c, v);
+    }
+    for(; size > 0; --size, ++s)
+    {
+        c = __crc32cb(c, *s);
+    }
+    return ~c;
+}
+
+
+bool has_crc32c_hw()
+{
+    return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+}
+#else
+std::uint32_t crc32c_hw(
+      void const * data
+    , std::size_t size
+    , std::uint32_t crc)
+{
+    return crc32c_portable(data, size, crc);
+}
+
+
+bool has_crc32c_hw()
+{
+    return false;
+}
+#endif
+
+
+
+} // no name namespace
+
+
+
+/** \brief Compute the CRC32C of a buffer.
+ *
+ * The \p crc parameter can be used to continue the computation of a
+ * checksum over several buffers:
+ *
+ * \code
+ *     std::uint32_t crc(crc32c(a, a_size));
+ *     crc = crc32c(b, b_size, crc);
+ * \endcode
+ *
+ * This function uses the processor instructions when available and
+ * the portable version otherwise. Both give the same result.
+ *
+ * \param[in] data  The buffer to checksum.
+ * \param[in] size  The number of bytes in \p data.
+ * \param[in] crc  The checksum of the previous buffers or 0.
+ *
+ * \return The CRC32C of the buffer.
+ */
+std::uint32_t crc32c(
+      void const * data
+    , std::size_t size
+    , std::uint32_t crc)
+{
+    static bool const hw(has_crc32c_hw());
+
+    if(hw)
+    {
+        return crc32c_hw(data, size, crc);
+    }
+    return crc32c_portable(data, size, crc);
+}
+
+
+/** \brief Compute the CRC32C of a buffer without special instructions.
+ *
+ * This function is the table driven version of crc32c(). It is used
+ * when the processor does not support the CRC32C instructions.
+ *
+ * \param[in] data  The buffer to checksum.
+ * \param[in] size  The number of bytes in \p data.
+ * \param[in] crc  The checksum of the previous buffers or 0.
+ *
+ * \return The CRC32C of the buffer.
+ */
+std::uint32_t crc32c_portable(
+      void const * data
+    , std::size_t size
+    , std::uint32_t crc)
+{
+    static crc32c_table const table;
+
+    std::uint8_t const * s(reinterpret_cast<std::uint8_t const *>(data));
+    crc = ~crc;
+    for(std::size_t idx(0); idx < size; ++idx)
+    {
+        crc = table.f_table[(crc ^ s[idx]) & 0xFF] ^ (crc >> 8);
+    }
+
+    return ~crc;
+}
+
+
+/** \brief Check whether crc32c() uses the processor instructions.
+ *
+ * \return true if the processor supports the CRC32C instructions.
+ */
+bool crc32c_hardware()
+{
+    return has_crc32c_hw();
+}
+
+
+} // namespace fluid_settings
+// vim: ts=4 sw=4 et
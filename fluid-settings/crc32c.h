@@ -0,0 +1,55 @@
+// Copyright (c) 2011-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+/** \file
+ * \brief Declaration of the CRC32C checksum function.
+ *
+ * The journal and the binary files saved by the daemon protect their
+ * data with a CRC32C (Castagnoli) checksum.
+ *
+ * When the processor has CRC32C instructions (SSE4.2 on x86_64, CRC on
+ * ARMv8), they get used. Otherwise a table driven version is used.
+ */
+
+// C++
+//
+#include    <cstddef>
+#include    <cstdint>
+
+
+
+namespace fluid_settings
+{
+
+
+
+std::uint32_t           crc32c(
+                              void const * data
+                            , std::size_t size
+                            , std::uint32_t crc = 0);
+std::uint32_t           crc32c_portable(
+                              void const * data
+                            , std::size_t size
+                            , std::uint32_t crc = 0);
+bool                    crc32c_hardware();
+
+
+
+} // namespace fluid_settings
+// vim: ts=4 sw=4 et
@@ -0,0 +1,380 @@
+// Copyright (c) 2022-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/** \file
+ * \brief Implementation of the hash tree of the settings.
+ *
+ * The digest of a setting is computed from its name and all of its
+ * values (priority, timestamp, and value). A setting without values has
+ * a digest of 0 so it is the same as a setting which does not exist.
+ *
+ * Each setting goes in one bucket selected from the hash of its name.
+ * The digest of a bucket is the exclusive or of the digests of its
+ * settings, which allows for updating a bucket in constant time when
+ * one setting changes: the old digest is removed and the new one added.
+ * The root digest is computed from the bucket digests.
+ */
+
+// self
+//
+#include    "hash_tree.h"
+
+
+// C++
+//
+#include    <algorithm>
+#include    <charconv>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace fluid_settings
+{
+
+
+
+namespace
+{
+
+
+
+constexpr std::uint64_t const   g_fnv_offset = 0xcbf29ce484222325ULL;
+constexpr std::uint64_t const   g_fnv_prime = 0x100000001b3ULL;
+constexpr std::size_t const     g_digest_length = 16;   // hexadecimal characters
+
+
+void fnv(std::uint64_t & h, void const * data, std::size_t size)
+{
+    std::uint8_t const * s(static_cast<std::uint8_t const *>(data));
+    for(std::size_t idx(0); idx < size; ++idx)
+    {
+        h ^= s[idx];
+        h *= g_fnv_prime;
+    }
+}
+
+
+void fnv(std::uint64_t & h, std::uint64_t n)
+{
+    // always hash in little endian so all the computers agree
+    //
+    std::uint8_t buf[8];
+    for(std::size_t idx(0); idx < sizeof(buf); ++idx)
+    {
+        buf[idx] = static_cast<std::uint8_t>(n >> (idx * 8));
+    }
+    fnv(h, buf, sizeof(buf));
+}
+
+
+// spread the bits so the exclusive or of many digests remains meaningful
+//
+std::uint64_t mix(std::uint64_t h)
+{
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+
+
+} // no name namespace
+
+
+
+/** \class hash_tree
+ * \brief Maintain digests of the settings.
+ *
+ * The settings call update() each time the values of a setting change.
+ * The tree is two levels deep: the root and BUCKET_COUNT buckets. This
+ * is enough to limit the exchange between two fluid-settings to the
+ * settings found in the buckets which differ.
+ */
+
+
+
+/** \brief Update the digest of one setting.
+ *
+ * \param[in] id  The identifier of the setting.
+ * \param[in] name  The name of the setting.
+ * \param[in] values  The current values of the setting.
+ */
+void hash_tree::update(
+      index_t id
+    , std::string const & name
+    , priority_set const & values)
+{
+    if(id >= f_digests.size())
+    {
+        f_digests.resize(id + 1);
+    }
+
+    digest_t const digest(compute_digest(name, values));
+    digest_t & current(f_digests[id]);
+    if(digest == current)
+    {
+        return;
+    }
+
+    std::size_t const bucket(bucket_of(name));
+    std::vector<index_t> & members(f_members[bucket]);
+    if(current == 0)
+    {
+        members.push_back(id);
+        ++f_size;
+    }
+    else if(digest == 0)
+    {
+        auto const it(std::find(members.begin(), members.end(), id));
+        if(it != members.end())
+        {
+            *it = members.back();
+            members.pop_back();
+        }
+        --f_size;
+    }
+
+    f_buckets[bucket] ^= current ^ digest;
+    current = digest;
+    f_root_valid = false;
+}
+
+
+/** \brief Forget all the digests.
+ */
+void hash_tree::clear()
+{
+    *this = hash_tree();
+}
+
+
+/** \brief Get the number of settings with at least one value.
+ *
+ * \return The number of settings with a digest other than 0.
+ */
+std::size_t hash_tree::size() const
+{
+    return f_size;
+}
+
+
+/** \brief Get the root digest.
+ *
+ * When two fluid-settings have the same root digest, they have the same
+ * settings. The root gets recalculated only when a setting changed
+ * since the last call.
+ *
+ * \return The root digest.
+ */
+hash_tree::digest_t hash_tree::get_root() const
+{
+    if(!f_root_valid)
+    {
+        std::uint64_t h(g_fnv_offset);
+        for(auto const b : f_buckets)
+        {
+            fnv(h, b);
+        }
+        f_root = mix(h);
+        f_root_valid = true;
+    }
+    return f_root;
+}
+
+
+/** \brief Get the digest of one bucket.
+ *
+ * \param[in] bucket  The bucket index, less than BUCKET_COUNT.
+ *
+ * \return The digest of the bucket, 0 if the bucket is empty.
+ */
+hash_tree::digest_t hash_tree::get_bucket(std::size_t bucket) const
+{
+    if(bucket >= BUCKET_COUNT)
+    {
+        return 0;
+    }
+    return f_buckets[bucket];
+}
+
+
+/** \brief Get the digests of all the buckets.
+ *
+ * \return A vector of BUCKET_COUNT digests.
+ */
+hash_tree::digest_vector_t const & hash_tree::get_buckets() const
+{
+    return f_buckets;
+}
+
+
+/** \brief Get the digest of one setting.
+ *
+ * \param[in] id  The identifier of the setting.
+ *
+ * \return The digest of the setting, 0 if it has no values.
+ */
+hash_tree::digest_t hash_tree::get_digest(index_t id) const
+{
+    if(id >= f_digests.size())
+    {
+        return 0;
+    }
+    return f_digests[id];
+}
+
+
+/** \brief Get the settings found in one bucket.
+ *
+ * Only the settings with at least one value are added to \p members,
+ * in no specific order. The list of each bucket is maintained by
+ * update() so this does not depend on the total number of settings.
+ *
+ * \param[in] bucket  The bucket index.
+ * \param[in,out] members  The identifiers of the settings in that bucket.
+ */
+void hash_tree::get_bucket_members(
+      std::size_t bucket
+    , std::vector<index_t> & members) const
+{
+    if(bucket >= BUCKET_COUNT)
+    {
+        return;
+    }
+    members.insert(members.end(), f_members[bucket].begin(), f_members[bucket].end());
+}
+
+
+/** \brief Select the bucket of a setting.
+ *
+ * \param[in] name  The name of the setting.
+ *
+ * \return The bucket index, less than BUCKET_COUNT.
+ */
+std::size_t hash_tree::bucket_of(std::string_view name)
+{
+    std::uint64_t h(g_fnv_offset);
+    fnv(h, name.data(), name.length());
+    return mix(h) % BUCKET_COUNT;
+}
+
+
+/** \brief Compute the digest of a setting.
+ *
+ * \param[in] name  The name of the setting.
+ * \param[in] values  The values of the setting.
+ *
+ * \return The digest, 0 if \p values is empty.
+ */
+hash_tree::digest_t hash_tree::compute_digest(
+      std::string_view name
+    , priority_set const & values)
+{
+    if(values.empty())
+    {
+        return 0;
+    }
+
+    std::uint64_t h(g_fnv_offset);
+    fnv(h, name.length());
+    fnv(h, name.data(), name.length());
+    for(auto const & v : values)
+    {
+        std::string const & value(v.get_value());
+        fnv(h, static_cast<std::uint64_t>(v.get_priority()));
+        fnv(h, static_cast<std::uint64_t>(v.get_timestamp().to_nsec()));
+        fnv(h, value.length());
+        fnv(h, value.data(), value.length());
+    }
+
+    // 0 is reserved for settings without values
+    //
+    digest_t const digest(mix(h));
+    return digest == 0 ? 1 : digest;
+}
+
+
+/** \brief Convert digests to a string.
+ *
+ * Each digest is written as 16 hexadecimal characters, without
+ * separators.
+ *
+ * \param[in] digests  The digests to convert.
+ *
+ * \return The string of digests.
+ */
+std::string hash_tree::encode_digests(digest_vector_t const & digests)
+{
+    static char const g_hex[] = "0123456789abcdef";
+
+    std::string result(digests.size() * g_digest_length, '0');
+    char * s(result.data());
+    for(auto const d : digests)
+    {
+        for(std::size_t idx(0); idx < g_digest_length; ++idx)
+        {
+            s[idx] = g_hex[(d >> ((g_digest_length - 1 - idx) * 4)) & 0x0F];
+        }
+        s += g_digest_length;
+    }
+    return result;
+}
+
+
+/** \brief Convert a string back to digests.
+ *
+ * \param[in] str  A string created by encode_digests().
+ * \param[in,out] digests  The digests found in \p str are appended here.
+ *
+ * \return false if \p str is not a valid string of digests.
+ */
+bool hash_tree::decode_digests(
+      std::string_view str
+    , digest_vector_t & digests)
+{
+    if(str.length() % g_digest_length != 0)
+    {
+        return false;
+    }
+    for(std::size_t pos(0); pos < str.length(); pos += g_digest_length)
+    {
+        char const * const start(str.data() + pos);
+        char const * const end(start + g_digest_length);
+        digest_t d(0);
+        std::from_chars_result const r(std::from_chars(start, end, d, 16));
+        if(r.ec != std::errc()
+        || r.ptr != end)
+        {
+            return false;
+        }
+        digests.push_back(d);
+    }
+    return true;
+}
+
+
+
+} // namespace fluid_settings
+// vim: ts=4 sw=4 et
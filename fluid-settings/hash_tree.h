@@ -0,0 +1,94 @@
+// Copyright (c) 2022-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+/** \file
+ * \brief Declaration of the hash tree of the settings.
+ *
+ * The hash tree summarizes all the values of all the settings in a
+ * small number of digests. Two fluid-settings compare their digests to
+ * find out which settings differ without sending all of them.
+ */
+
+// self
+//
+#include    "priority_set.h"
+#include    "settings_table.h"
+
+
+// C++
+//
+#include    <cstdint>
+#include    <string>
+#include    <string_view>
+#include    <vector>
+
+
+
+namespace fluid_settings
+{
+
+
+
+class hash_tree
+{
+public:
+    typedef std::uint64_t               digest_t;
+    typedef std::vector<digest_t>       digest_vector_t;
+    typedef settings_table::index_t     index_t;
+
+    static constexpr std::size_t const  BUCKET_COUNT = 256;
+
+    void                    update(
+                                  index_t id
+                                , std::string const & name
+                                , priority_set const & values);
+    void                    clear();
+
+    std::size_t             size() const;
+    digest_t                get_root() const;
+    digest_t                get_bucket(std::size_t bucket) const;
+    digest_vector_t const & get_buckets() const;
+    digest_t                get_digest(index_t id) const;
+    void                    get_bucket_members(
+                                  std::size_t bucket
+                                , std::vector<index_t> & members) const;
+
+    static std::size_t      bucket_of(std::string_view name);
+    static digest_t         compute_digest(
+                                  std::string_view name
+                                , priority_set const & values);
+    static std::string      encode_digests(digest_vector_t const & digests);
+    static bool             decode_digests(
+                                  std::string_view str
+                                , digest_vector_t & digests);
+
+private:
+    digest_vector_t         f_buckets = digest_vector_t(BUCKET_COUNT);
+    digest_vector_t         f_digests = digest_vector_t();
+    std::vector<std::vector<index_t>>
+                            f_members = std::vector<std::vector<index_t>>(BUCKET_COUNT);  // settings with values, per bucket
+    std::size_t             f_size = 0;
+    mutable digest_t        f_root = 0;
+    mutable bool            f_root_valid = false;
+};
+
+
+
+} // namespace fluid_settings
+// vim: ts=4 sw=4 et
@@ -0,0 +1,224 @@
+// Copyright (c) 2022-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/** \file
+ * \brief Implementation of the histogram.
+ *
+ * The buckets grow as powers of two so a histogram covers the whole
+ * range of a 64 bit number with a fixed and small number of counters.
+ * The percentiles are therefore approximations: the limit of the bucket
+ * in which the percentile falls is returned.
+ */
+
+// self
+//
+#include    "histogram.h"
+
+
+// C++
+//
+#include    <algorithm>
+#include    <cmath>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace fluid_settings
+{
+
+
+
+/** \class histogram
+ * \brief Count samples in buckets of increasing sizes.
+ *
+ * Adding a sample is just a few instructions so the histograms can be
+ * updated on each event without impacting the daemon.
+ */
+
+
+
+/** \brief Add a sample to the histogram.
+ *
+ * \param[in] sample  The sample to add.
+ */
+void histogram::add(std::uint64_t sample)
+{
+    ++f_buckets[bucket_index(sample)];
+    ++f_count;
+    f_sum += sample;
+    f_max = std::max(f_max, sample);
+}
+
+
+/** \brief Reset the histogram.
+ */
+void histogram::clear()
+{
+    *this = histogram();
+}
+
+
+/** \brief Get the number of samples added to this histogram.
+ *
+ * \return The number of samples.
+ */
+std::uint64_t histogram::get_count() const
+{
+    return f_count;
+}
+
+
+/** \brief Get the sum of all the samples.
+ *
+ * \return The sum of the samples.
+ */
+std::uint64_t histogram::get_sum() const
+{
+    return f_sum;
+}
+
+
+/** \brief Get the largest sample.
+ *
+ * \return The largest sample or 0 if the histogram is empty.
+ */
+std::uint64_t histogram::get_max() const
+{
+    return f_max;
+}
+
+
+/** \brief Get the number of samples in one bucket.
+ *
+ * \param[in] idx  The index of the bucket, less than BUCKET_COUNT.
+ *
+ * \return The number of samples in that bucket.
+ */
+std::uint64_t histogram::get_bucket(std::size_t idx) const
+{
+    if(idx >= BUCKET_COUNT)
+    {
+        return 0;
+    }
+    return f_buckets[idx];
+}
+
+
+/** \brief Compute a percentile.
+ *
+ * The function searches the bucket which includes the sample at the
+ * \p p percentile and returns the limit of that bucket, capped to the
+ * largest sample.
+ *
+ * \param[in] p  The percentile, from 0.0 to 100.0.
+ *
+ * \return The approximate value of the percentile, 0 if the histogram
+ * is empty.
+ */
+std::uint64_t histogram::percentile(double p) const
+{
+    if(f_count == 0)
+    {
+        return 0;
+    }
+
+    p = std::clamp(p, 0.0, 100.0);
+    std::uint64_t const rank(std::max(static_cast<std::uint64_t>(1), static_cast<std::uint64_t>(std::ceil(p * f_count / 100.0))));
+    std::uint64_t seen(0);
+    for(std::size_t idx(0); idx < BUCKET_COUNT; ++idx)
+    {
+        seen += f_buckets[idx];
+        if(seen >= rank)
+        {
+            return std::min(bucket_limit(idx), f_max);
+        }
+    }
+
+    return f_max;
+}
+
+
+/** \brief Convert the histogram to a string.
+ *
+ * The string is a comma separated list of the non-empty buckets. Each
+ * bucket is written as its limit and its number of samples separated
+ * by a colon. For example, "1:3,7:12" means 3 samples of 1 and 12
+ * samples from 4 to 7.
+ *
+ * \return The histogram as a string.
+ */
+std::string histogram::to_string() const
+{
+    std::string result;
+    for(std::size_t idx(0); idx < BUCKET_COUNT; ++idx)
+    {
+        if(f_buckets[idx] == 0)
+        {
+            continue;
+        }
+        if(!result.empty())
+        {
+            result += ',';
+        }
+        result += std::to_string(bucket_limit(idx));
+        result += ':';
+        result += std::to_string(f_buckets[idx]);
+    }
+    return result;
+}
+
+
+/** \brief Get the index of the bucket where a sample goes.
+ *
+ * \param[in] sample  The sample.
+ *
+ * \return The index of the bucket.
+ */
+std::size_t histogram::bucket_index(std::uint64_t sample)
+{
+    if(sample == 0)
+    {
+        return 0;
+    }
+    return 64 - __builtin_clzll(sample);
+}
+
+
+/** \brief Get the largest sample which goes in a bucket.
+ *
+ * \param[in] idx  The index of the bucket.
+ *
+ * \return The limit of the bucket, inclusive.
+ */
+std::uint64_t histogram::bucket_limit(std::size_t idx)
+{
+    if(idx >= BUCKET_COUNT - 1)
+    {
+        return UINT64_MAX;
+    }
+    return (static_cast<std::uint64_t>(1) << idx) - 1;
+}
+
+
+
+} // namespace fluid_settings
+// vim: ts=4 sw=4 et
@@ -0,0 +1,69 @@
+// Copyright (c) 2022-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+/** \file
+ * \brief Declaration of a histogram with power of two buckets.
+ *
+ * The daemon uses histograms to report the distribution of measures
+ * such as the number of values sent in one replication batch.
+ */
+
+// C++
+//
+#include    <cstdint>
+#include    <string>
+
+
+
+namespace fluid_settings
+{
+
+
+
+class histogram
+{
+public:
+    // bucket 0 holds 0, bucket N holds [2^(N-1), 2^N - 1]
+    //
+    static constexpr std::size_t const      BUCKET_COUNT = 65;
+
+    void                    add(std::uint64_t sample);
+    void                    clear();
+
+    std::uint64_t           get_count() const;
+    std::uint64_t           get_sum() const;
+    std::uint64_t           get_max() const;
+    std::uint64_t           get_bucket(std::size_t idx) const;
+    std::uint64_t           percentile(double p) const;
+    std::string             to_string() const;
+
+    static std::size_t      bucket_index(std::uint64_t sample);
+    static std::uint64_t    bucket_limit(std::size_t idx);
+
+private:
+    std::uint64_t           f_buckets[BUCKET_COUNT] = {};
+    std::uint64_t           f_count = 0;
+    std::uint64_t           f_sum = 0;
+    std::uint64_t           f_max = 0;
+};
+
+
+
+} // namespace fluid_settings
+// vim: ts=4 sw=4 et
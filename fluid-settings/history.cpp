@@ -0,0 +1,440 @@
+// Copyright (c) 2022-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/** \file
+ * \brief Implementation of the history of the settings.
+ *
+ * Each setting has its own log of events. An event is encoded as a set
+ * of variable length integers: the revision and timestamp as deltas from
+ * the previous event, the priority, and the indexes of the values before
+ * and after the change. The values are kept once in a table of strings
+ * shared by all the logs.
+ */
+
+// self
+//
+#include    "history.h"
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace fluid_settings
+{
+
+
+
+namespace
+{
+
+
+
+void encode(std::vector<std::uint8_t> & data, std::uint64_t n)
+{
+    while(n >= 0x80)
+    {
+        data.push_back(static_cast<std::uint8_t>(n | 0x80));
+        n >>= 7;
+    }
+    data.push_back(static_cast<std::uint8_t>(n));
+}
+
+
+std::uint64_t decode(std::uint8_t const * & p)
+{
+    std::uint64_t n(0);
+    for(int shift(0);; shift += 7)
+    {
+        std::uint8_t const c(*p++);
+        n |= static_cast<std::uint64_t>(c & 0x7F) << shift;
+        if((c & 0x80) == 0)
+        {
+            return n;
+        }
+    }
+}
+
+
+std::uint64_t zigzag(std::int64_t n)
+{
+    return (static_cast<std::uint64_t>(n) << 1) ^ static_cast<std::uint64_t>(n >> 63);
+}
+
+
+std::int64_t unzigzag(std::uint64_t n)
+{
+    return static_cast<std::int64_t>(n >> 1) ^ -static_cast<std::int64_t>(n & 1);
+}
+
+
+
+} // no name namespace
+
+
+
+/** \class history
+ * \brief The last changes made to each setting.
+ *
+ * Each change made to a value gets a new global revision number. The
+ * history keeps the last few changes of each setting (see set_depth())
+ * which is enough to find the value of the setting at any revision or
+ * time since the oldest change kept.
+ *
+ * The history is not saved. It starts empty each time the daemon
+ * starts.
+ */
+
+
+
+/** \brief Set the number of changes kept per setting.
+ *
+ * By default, the depth is 0 meaning that no history is kept. Reducing
+ * the depth drops the oldest events of the settings with too many.
+ *
+ * \param[in] depth  The maximum number of events kept per setting.
+ */
+void history::set_depth(std::size_t depth)
+{
+    f_depth = depth;
+    for(auto & log : f_logs)
+    {
+        while(log.f_count > f_depth)
+        {
+            drop_oldest(log);
+        }
+    }
+}
+
+
+/** \brief Get the number of changes kept per setting.
+ *
+ * \return The maximum number of events kept per setting.
+ */
+std::size_t history::get_depth() const
+{
+    return f_depth;
+}
+
+
+/** \brief Get the last revision.
+ *
+ * \return The revision of the last change recorded, 0 if none.
+ */
+history::revision_t history::get_revision() const
+{
+    return f_revision;
+}
+
+
+/** \brief Record a change.
+ *
+ * This function adds one event to the log of setting \p id. If the log
+ * is full, the oldest event gets dropped.
+ *
+ * \param[in] id  The identifier of the setting which changed.
+ * \param[in] priority  The priority of the value which changed.
+ * \param[in] timestamp  The time of the change.
+ * \param[in] before  The value before the change or nullptr.
+ * \param[in] after  The value after the change or nullptr.
+ *
+ * \return The revision of this change or 0 if the history is disabled.
+ */
+history::revision_t history::record(
+      index_t id
+    , priority_t priority
+    , timestamp_t const & timestamp
+    , value::buffer_t const & before
+    , value::buffer_t const & after)
+{
+    if(f_depth == 0)
+    {
+        return 0;
+    }
+
+    if(id >= f_logs.size())
+    {
+        f_logs.resize(id + 1);
+    }
+    log_t & log(f_logs[id]);
+    if(log.f_count >= f_depth)
+    {
+        drop_oldest(log);
+    }
+
+    ++f_revision;
+    std::int64_t const ns(timestamp.to_nsec());
+    encode(log.f_data, f_revision - log.f_last_revision);
+    encode(log.f_data, zigzag(ns - log.f_last_timestamp));
+    encode(log.f_data, static_cast<std::uint64_t>(priority));
+    encode(log.f_data, add_string(before));
+    encode(log.f_data, add_string(after));
+    ++log.f_count;
+
+    if(log.f_last_revision != 0)
+    {
+        f_latest.erase(log.f_last_revision);
+    }
+    f_latest[f_revision] = id;
+    log.f_last_revision = f_revision;
+    log.f_last_timestamp = ns;
+
+    return f_revision;
+}
+
+
+/** \brief Get the changes made to a setting after a given point.
+ *
+ * This function returns the events of setting \p id with a revision
+ * larger than \p revision or a timestamp after \p timestamp, oldest
+ * first. Undoing those events, from the last to the first, gives the
+ * values the setting had at that point.
+ *
+ * To search by revision only, use a \p timestamp far in the future and
+ * to search by time only, use LATEST_REVISION.
+ *
+ * \param[in] id  The identifier of the setting.
+ * \param[in] revision  The revision to go back to.
+ * \param[in] timestamp  The time to go back to.
+ * \param[out] events  The events after that point.
+ *
+ * \return false if some of the events after that point were dropped.
+ */
+bool history::get_events(
+      index_t id
+    , revision_t revision
+    , timestamp_t const & timestamp
+    , event_vector_t & events) const
+{
+    events.clear();
+    if(id >= f_logs.size())
+    {
+        return true;
+    }
+    log_t const & log(f_logs[id]);
+    std::int64_t const ns(timestamp.to_nsec());
+    if(log.f_base_revision > revision
+    || log.f_base_timestamp > ns)
+    {
+        return false;
+    }
+
+    raw_event_t raw;
+    raw.f_revision = log.f_base_revision;
+    raw.f_timestamp = log.f_base_timestamp;
+    std::uint8_t const * p(log.f_data.data());
+    std::uint8_t const * const end(p + log.f_data.size());
+    while(p < end)
+    {
+        p = decode_event(p, raw);
+        if(raw.f_revision > revision
+        || raw.f_timestamp > ns)
+        {
+            event_t e;
+            e.f_revision = raw.f_revision;
+            e.f_timestamp = timestamp_t(raw.f_timestamp);
+            e.f_priority = static_cast<priority_t>(raw.f_priority);
+            e.f_before = f_strings[raw.f_before].f_buffer;
+            e.f_after = f_strings[raw.f_after].f_buffer;
+            events.push_back(e);
+        }
+    }
+
+    return true;
+}
+
+
+/** \brief Get the settings which changed since a revision.
+ *
+ * The function only visits the settings which changed so its cost
+ * depends on the number of changes, not the number of settings.
+ *
+ * \param[in] revision  The revision to compare against.
+ * \param[out] ids  The settings with a change after \p revision.
+ */
+void history::changed_since(
+      revision_t revision
+    , std::vector<index_t> & ids) const
+{
+    ids.clear();
+    for(auto it(f_latest.upper_bound(revision)); it != f_latest.end(); ++it)
+    {
+        ids.push_back(it->second);
+    }
+}
+
+
+/** \brief Forget all the changes.
+ *
+ * The revision counter is not reset so revisions are never reused.
+ */
+void history::clear()
+{
+    f_logs.clear();
+    f_strings.resize(1);
+    f_free_strings.clear();
+    f_string_index.clear();
+    f_latest.clear();
+}
+
+
+/** \brief Get the statistics of the history.
+ *
+ * \return The statistics.
+ */
+history::stats_t history::get_stats() const
+{
+    stats_t stats;
+    stats.f_revision = f_revision;
+    stats.f_dropped = f_dropped;
+    for(auto const & log : f_logs)
+    {
+        stats.f_events += log.f_count;
+        stats.f_log_bytes += log.f_data.size();
+    }
+    for(auto const & s : f_strings)
+    {
+        if(s.f_buffer != nullptr)
+        {
+            ++stats.f_strings;
+            stats.f_string_bytes += s.f_buffer->length();
+        }
+    }
+    return stats;
+}
+
+
+/** \brief Add a reference to a value.
+ *
+ * Equal values share the same entry in the table of strings.
+ *
+ * \param[in] buffer  The value to add, may be nullptr.
+ *
+ * \return The index of the string, 0 for nullptr.
+ */
+std::uint32_t history::add_string(value::buffer_t const & buffer)
+{
+    if(buffer == nullptr)
+    {
+        return 0;
+    }
+
+    auto const it(f_string_index.find(std::string_view(*buffer)));
+    if(it != f_string_index.end())
+    {
+        ++f_strings[it->second].f_references;
+        return it->second;
+    }
+
+    std::uint32_t idx(0);
+    if(f_free_strings.empty())
+    {
+        idx = static_cast<std::uint32_t>(f_strings.size());
+        f_strings.emplace_back();
+    }
+    else
+    {
+        idx = f_free_strings.back();
+        f_free_strings.pop_back();
+    }
+    f_strings[idx].f_buffer = buffer;
+    f_strings[idx].f_references = 1;
+
+    // the key points to the buffer we keep, so the value is not copied
+    //
+    f_string_index[std::string_view(*f_strings[idx].f_buffer)] = idx;
+
+    return idx;
+}
+
+
+/** \brief Release a reference to a value.
+ *
+ * \param[in] idx  The index of the string, ignored if 0.
+ */
+void history::release_string(std::uint64_t idx)
+{
+    if(idx == 0)
+    {
+        return;
+    }
+
+    string_t & s(f_strings[idx]);
+    --s.f_references;
+    if(s.f_references == 0)
+    {
+        f_string_index.erase(std::string_view(*s.f_buffer));
+        s.f_buffer.reset();
+        f_free_strings.push_back(static_cast<std::uint32_t>(idx));
+    }
+}
+
+
+/** \brief Drop the oldest event of a log.
+ *
+ * The dropped event becomes the base of the next one so the following
+ * events do not need to be encoded again.
+ *
+ * \param[in,out] log  The log to shorten.
+ */
+void history::drop_oldest(log_t & log)
+{
+    raw_event_t raw;
+    raw.f_revision = log.f_base_revision;
+    raw.f_timestamp = log.f_base_timestamp;
+    std::uint8_t const * const start(log.f_data.data());
+    std::uint8_t const * const p(decode_event(start, raw));
+
+    release_string(raw.f_before);
+    release_string(raw.f_after);
+    log.f_data.erase(log.f_data.begin(), log.f_data.begin() + (p - start));
+    log.f_base_revision = raw.f_revision;
+    log.f_base_timestamp = raw.f_timestamp;
+    --log.f_count;
+    ++f_dropped;
+}
+
+
+/** \brief Decode one event.
+ *
+ * On entry, \p event holds the revision and timestamp of the previous
+ * event which are used as the base of the deltas.
+ *
+ * \param[in] p  The start of the encoded event.
+ * \param[in,out] event  The decoded event.
+ *
+ * \return The start of the next event.
+ */
+std::uint8_t const * history::decode_event(
+      std::uint8_t const * p
+    , raw_event_t & event)
+{
+    event.f_revision += decode(p);
+    event.f_timestamp += unzigzag(decode(p));
+    event.f_priority = decode(p);
+    event.f_before = decode(p);
+    event.f_after = decode(p);
+    return p;
+}
+
+
+
+} // namespace fluid_settings
+// vim: ts=4 sw=4 et
@@ -0,0 +1,155 @@
+// Copyright (c) 2022-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+/** \file
+ * \brief Declaration of the history of the settings.
+ *
+ * The history keeps the last few changes of each setting so the value
+ * a setting had at an earlier revision or time can be retrieved and
+ * restored. The changes are kept in memory in a compact form.
+ */
+
+// self
+//
+#include    "settings_table.h"
+#include    "value.h"
+
+
+// C++
+//
+#include    <cstdint>
+#include    <map>
+#include    <string_view>
+#include    <unordered_map>
+#include    <vector>
+
+
+
+namespace fluid_settings
+{
+
+
+
+class history
+{
+public:
+    typedef std::uint64_t               revision_t;
+    typedef settings_table::index_t     index_t;
+
+    static constexpr revision_t const   LATEST_REVISION = static_cast<revision_t>(-1);
+
+    // one change of the value at one priority; a null buffer means that
+    // there was no value at that priority
+    //
+    struct event_t
+    {
+        revision_t              f_revision = 0;
+        timestamp_t             f_timestamp = timestamp_t();
+        priority_t              f_priority = 0;
+        value::buffer_t         f_before = value::buffer_t();
+        value::buffer_t         f_after = value::buffer_t();
+    };
+
+    typedef std::vector<event_t>        event_vector_t;
+
+    struct stats_t
+    {
+        revision_t              f_revision = 0;         // last revision
+        std::size_t             f_events = 0;           // events kept
+        std::size_t             f_dropped = 0;          // events dropped (depth reached)
+        std::size_t             f_log_bytes = 0;        // size of the encoded events
+        std::size_t             f_strings = 0;          // distinct values kept
+        std::size_t             f_string_bytes = 0;     // size of those values
+    };
+
+    void                    set_depth(std::size_t depth);
+    std::size_t             get_depth() const;
+    revision_t              get_revision() const;
+    revision_t              record(
+                                  index_t id
+                                , priority_t priority
+                                , timestamp_t const & timestamp
+                                , value::buffer_t const & before
+                                , value::buffer_t const & after);
+    bool                    get_events(
+                                  index_t id
+                                , revision_t revision
+                                , timestamp_t const & timestamp
+                                , event_vector_t & events) const;
+    void                    changed_since(
+                                  revision_t revision
+                                , std::vector<index_t> & ids) const;
+    void                    clear();
+    stats_t                 get_stats() const;
+
+private:
+    // the events of one setting, each encoded relative to the previous
+    // one; the base is the last event which was dropped
+    //
+    struct log_t
+    {
+        std::vector<std::uint8_t>
+                                f_data = std::vector<std::uint8_t>();
+        std::size_t             f_count = 0;
+        revision_t              f_base_revision = 0;
+        std::int64_t            f_base_timestamp = 0;
+        revision_t              f_last_revision = 0;
+        std::int64_t            f_last_timestamp = 0;
+    };
+
+    struct string_t
+    {
+        value::buffer_t         f_buffer = value::buffer_t();
+        std::size_t             f_references = 0;
+    };
+
+    struct raw_event_t
+    {
+        revision_t              f_revision = 0;
+        std::int64_t            f_timestamp = 0;
+        std::uint64_t           f_priority = 0;
+        std::uint64_t           f_before = 0;
+        std::uint64_t           f_after = 0;
+    };
+
+    std::uint32_t           add_string(value::buffer_t const & buffer);
+    void                    release_string(std::uint64_t idx);
+    void                    drop_oldest(log_t & log);
+    static std::uint8_t const *
+                            decode_event(
+                                  std::uint8_t const * p
+                                , raw_event_t & event);
+
+    std::size_t             f_depth = 0;
+    revision_t              f_revision = 0;
+    std::size_t             f_dropped = 0;
+    std::vector<log_t>      f_logs = std::vector<log_t>();
+    std::vector<string_t>   f_strings = std::vector<string_t>(1);
+    std::vector<std::uint32_t>
+                            f_free_strings = std::vector<std::uint32_t>();
+    std::unordered_map<std::string_view, std::uint32_t>
+                            f_string_index = std::unordered_map<std::string_view, std::uint32_t>();
+    std::map<revision_t, index_t>
+                            f_latest = std::map<revision_t, index_t>();
+};
+
+
+
+} // namespace fluid_settings
+// vim: ts=4 sw=4 et
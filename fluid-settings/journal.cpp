@@ -0,0 +1,558 @@
+// Copyright (c) 2011-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/** \file
+ * \brief Implementation of the write-ahead journal.
+ *
+ * The journal file starts with a small header (magic and version)
+ * followed by records. Each record is:
+ *
+ * \code
+ *     uint32_t     size of the payload
+ *     uint32_t     CRC32C of the payload
+ *     payload      the values of one setting (see record.cpp)
+ * \endcode
+ *
+ * All the numbers are saved in little endian.
+ *
+ * A record holds all the values of one setting after a change. Replaying
+ * the records in order therefore restores the last state of each setting,
+ * whether the change was a PUT, a DELETE or a replicated update.
+ */
+
+// self
+//
+#include    "journal.h"
+
+#include    "crc32c.h"
+
+
+// snaplogger
+//
+#include    <snaplogger/message.h>
+
+
+// snapdev
+//
+#include    <snapdev/not_used.h>
+
+
+// C++
+//
+#include    <fstream>
+#include    <iterator>
+
+
+// C
+//
+#include    <errno.h>
+#include    <fcntl.h>
+#include    <libgen.h>
+#include    <string.h>
+#include    <sys/stat.h>
+#include    <unistd.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace fluid_settings
+{
+
+
+
+/** \class journal
+ * \brief Append-only log of the changes made to the settings.
+ *
+ * Each time a setting changes, append() adds a record with its new
+ * values to a memory buffer. The commit() function writes the buffer
+ * and calls fdatasync() once. This way, all the changes which happened
+ * at about the same time share the cost of a single synchronization
+ * (group commit).
+ *
+ * Once the settings were fully saved, the journal gets reset().
+ *
+ * On startup, the journal is replayed over the settings loaded from
+ * the settings file. A record which was only partially written (i.e.
+ * the daemon or the computer crashed while writing it) is detected
+ * with its checksum and dropped along with anything following it.
+ */
+
+
+
+/** \brief Initialize the journal.
+ *
+ * The file does not get opened until open() is called.
+ *
+ * \param[in] filename  The path to the journal file.
+ */
+journal::journal(std::string const & filename)
+    : f_filename(filename)
+{
+}
+
+
+/** \brief Get the default journal filename.
+ *
+ * The journal is saved next to the settings file. The ".conf" extension
+ * gets replaced by ".journal".
+ *
+ * \param[in] settings_filename  The path to the settings file.
+ *
+ * \return The path to the journal.
+ */
+std::string journal::get_default_filename(std::string const & settings_filename)
+{
+    std::string::size_type const pos(settings_filename.rfind(".conf"));
+    if(pos != std::string::npos
+    && pos + 5 == settings_filename.length())
+    {
+        return settings_filename.substr(0, pos) + ".journal";
+    }
+    return settings_filename + ".journal";
+}
+
+
+std::string const & journal::get_filename() const
+{
+    return f_filename;
+}
+
+
+/** \brief Read all the valid records of the journal.
+ *
+ * This function reads the journal and returns its records. It stops
+ * on the first record which is incomplete or has an invalid checksum.
+ * The following call to open() truncates the file there.
+ *
+ * A missing file is not an error; the function returns true and no
+ * records.
+ *
+ * \param[out] records  The records found in the journal.
+ *
+ * \return false if the file exists but is not a journal.
+ */
+bool journal::read(record_vector_t & records)
+{
+    records.clear();
+    f_valid_size = 0;
+
+    std::ifstream in(f_filename, std::ios::binary);
+    if(!in.is_open())
+    {
+        return true;
+    }
+    std::string const data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if(data.length() < HEADER_SIZE)
+    {
+        // we may have crashed while creating the file
+        //
+        return true;
+    }
+
+    if(decode_uint(data.data(), 4) != MAGIC
+    || decode_uint(data.data() + 4, 4) != VERSION)
+    {
+        SNAP_LOG_ERROR
+            << "file \""
+            << f_filename
+            << "\" is not a fluid-settings journal (or its version is not supported)."
+            << SNAP_LOG_SEND;
+        f_valid_size = -1;
+        return false;
+    }
+    f_valid_size = HEADER_SIZE;
+
+    std::size_t pos(HEADER_SIZE);
+    while(data.length() - pos >= RECORD_HEADER_SIZE)
+    {
+        std::size_t const size(decode_uint(data.data() + pos, 4));
+        std::uint32_t const crc(decode_uint(data.data() + pos + 4, 4));
+        pos += RECORD_HEADER_SIZE;
+        if(data.length() - pos < size
+        || crc32c(data.data() + pos, size) != crc)
+        {
+            break;
+        }
+
+        record_t r;
+        if(!decode_record(data.data() + pos, size, r))
+        {
+            break;
+        }
+        records.push_back(std::move(r));
+        pos += size;
+        f_valid_size = pos;
+    }
+
+    if(static_cast<std::size_t>(f_valid_size) != data.length())
+    {
+        SNAP_LOG_WARNING
+            << "journal \""
+            << f_filename
+            << "\" ends with an incomplete or corrupted record; "
+            << data.length() - static_cast<std::size_t>(f_valid_size)
+            << " bytes ignored."
+            << SNAP_LOG_SEND;
+    }
+
+    return true;
+}
+
+
+/** \brief Apply the journal to the settings.
+ *
+ * This function reads the journal and restores the values of each
+ * setting it finds in it.
+ *
+ * \param[in] s  The settings to update.
+ * \param[in,out] changes  The settings which were restored.
+ *
+ * \return false if the file could not be read.
+ */
+bool journal::replay(settings & s, change_set_t & changes)
+{
+    record_vector_t records;
+    if(!read(records))
+    {
+        return false;
+    }
+
+    for(auto const & r : records)
+    {
+        setting_id_t const id(s.resolve(r.f_name));
+        if(id == INVALID_SETTING_ID)
+        {
+            SNAP_LOG_WARNING
+                << "journal includes values for unknown setting \""
+                << r.f_name
+                << "\"; ignored."
+                << SNAP_LOG_SEND;
+            continue;
+        }
+        s.restore_values(id, r.f_values, changes);
+    }
+
+    if(!records.empty())
+    {
+        SNAP_LOG_INFO
+            << "replayed "
+            << records.size()
+            << " record(s) from journal \""
+            << f_filename
+            << "\"."
+            << SNAP_LOG_SEND;
+    }
+
+    return true;
+}
+
+
+/** \brief Open the journal for writing.
+ *
+ * If read() found an incomplete record, the file gets truncated after
+ * the last valid record. If the file is new, the header gets written.
+ *
+ * \return true if the journal is ready to receive new records.
+ */
+bool journal::open()
+{
+    if(f_valid_size < 0)
+    {
+        // read() found a file which is not a journal, do not overwrite it
+        //
+        return false;
+    }
+
+    f_fd.reset(::open(f_filename.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0640));
+    if(f_fd == nullptr)
+    {
+        int const e(errno);
+        SNAP_LOG_ERROR
+            << "could not open journal \""
+            << f_filename
+            << "\" (errno: "
+            << e
+            << ", "
+            << strerror(e)
+            << ")."
+            << SNAP_LOG_SEND;
+        return false;
+    }
+
+    struct stat st = {};
+    if(fstat(f_fd.get(), &st) != 0)
+    {
+        f_fd.reset();
+        return false;
+    }
+    if(f_valid_size < static_cast<std::int64_t>(HEADER_SIZE)
+    && st.st_size >= static_cast<off_t>(HEADER_SIZE))
+    {
+        // read() was not called
+        //
+        f_valid_size = st.st_size;
+    }
+
+    if(f_valid_size < static_cast<std::int64_t>(HEADER_SIZE))
+    {
+        std::string header;
+        encode_uint(header, MAGIC, 4);
+        encode_uint(header, VERSION, 4);
+        if(ftruncate(f_fd.get(), 0) != 0
+        || pwrite(f_fd.get(), header.data(), header.length(), 0) != static_cast<ssize_t>(header.length())
+        || fdatasync(f_fd.get()) != 0)
+        {
+            f_fd.reset();
+            return false;
+        }
+        f_valid_size = HEADER_SIZE;
+    }
+    else if(st.st_size != f_valid_size)
+    {
+        if(ftruncate(f_fd.get(), f_valid_size) != 0)
+        {
+            f_fd.reset();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+void journal::close()
+{
+    f_fd.reset();
+}
+
+
+bool journal::is_open() const
+{
+    return f_fd != nullptr;
+}
+
+
+/** \brief Add a record to the journal.
+ *
+ * The record is added to a memory buffer. It gets written to disk by
+ * the next call to commit().
+ *
+ * \param[in] name  The name of the setting which changed.
+ * \param[in] values  The new values of that setting.
+ */
+void journal::append(
+      std::string const & name
+    , priority_set const & values)
+{
+    std::string payload;
+    encode_record(payload, name, values);
+
+    encode_uint(f_pending, payload.length(), 4);
+    encode_uint(f_pending, crc32c(payload.data(), payload.length()), 4);
+    f_pending += payload;
+    ++f_pending_records;
+}
+
+
+bool journal::has_pending() const
+{
+    return !f_pending.empty();
+}
+
+
+/** \brief Write the pending records to disk.
+ *
+ * This function writes all the records added since the last commit and
+ * then calls fdatasync() once.
+ *
+ * On failure, the file gets truncated back to its previous size and the
+ * records remain pending.
+ *
+ * \return true if the records are on disk.
+ */
+bool journal::commit()
+{
+    if(f_pending.empty())
+    {
+        return true;
+    }
+    if(f_fd == nullptr)
+    {
+        return false;
+    }
+
+    std::size_t written(0);
+    while(written < f_pending.length())
+    {
+        ssize_t const r(pwrite(
+                  f_fd.get()
+                , f_pending.data() + written
+                , f_pending.length() - written
+                , f_valid_size + written));
+        if(r < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            break;
+        }
+        written += r;
+    }
+
+    if(written != f_pending.length()
+    || fdatasync(f_fd.get()) != 0)
+    {
+        int const e(errno);
+        SNAP_LOG_ERROR
+            << "could not write to journal \""
+            << f_filename
+            << "\" (errno: "
+            << e
+            << ", "
+            << strerror(e)
+            << ")."
+            << SNAP_LOG_SEND;
+
+        // if this fails, read() drops the partial record on the next start
+        //
+        snapdev::NOT_USED(ftruncate(f_fd.get(), f_valid_size));
+        return false;
+    }
+
+    f_valid_size += f_pending.length();
+    f_records += f_pending_records;
+    ++f_commits;
+    f_pending.clear();
+    f_pending_records = 0;
+
+    return true;
+}
+
+
+/** \brief Empty the journal.
+ *
+ * Once all the settings were saved in the settings file, the journal is
+ * not required anymore and this function truncates it back to its header.
+ *
+ * When the settings are saved in the background, more changes may be
+ * committed to the journal while the save is running. In that case,
+ * the \p mark parameter is the size returned by get_size() at the time
+ * the save started. Only the records before that mark get removed.
+ * The records after the mark are copied to a new journal which then
+ * replaces the existing one.
+ *
+ * \param[in] mark  The size of the journal when the save started or 0
+ * to remove all the records.
+ *
+ * \return true if the journal was reset.
+ */
+bool journal::reset(std::size_t mark)
+{
+    if(f_fd == nullptr)
+    {
+        return false;
+    }
+
+    std::size_t const size(static_cast<std::size_t>(f_valid_size));
+    if(mark == 0
+    || mark >= size)
+    {
+        if(ftruncate(f_fd.get(), HEADER_SIZE) != 0
+        || fdatasync(f_fd.get()) != 0)
+        {
+            return false;
+        }
+        f_valid_size = HEADER_SIZE;
+        return true;
+    }
+
+    if(mark <= HEADER_SIZE)
+    {
+        // nothing to remove
+        //
+        return true;
+    }
+
+    std::string data;
+    encode_uint(data, MAGIC, 4);
+    encode_uint(data, VERSION, 4);
+    data.resize(HEADER_SIZE + size - mark);
+    if(pread(f_fd.get(), data.data() + HEADER_SIZE, size - mark, mark) != static_cast<ssize_t>(size - mark))
+    {
+        return false;
+    }
+
+    std::string const tmp(f_filename + ".tmp");
+    snapdev::raii_fd_t fd(::open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0640));
+    if(fd == nullptr)
+    {
+        return false;
+    }
+    if(pwrite(fd.get(), data.data(), data.length(), 0) != static_cast<ssize_t>(data.length())
+    || fdatasync(fd.get()) != 0
+    || rename(tmp.c_str(), f_filename.c_str()) != 0)
+    {
+        unlink(tmp.c_str());
+        return false;
+    }
+
+    // make sure the rename() itself is on disk
+    //
+    std::string dir(f_filename);
+    snapdev::raii_fd_t dfd(::open(dirname(&dir[0]), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+    if(dfd != nullptr)
+    {
+        fsync(dfd.get());
+    }
+
+    f_fd.reset(fd.release());
+    f_valid_size = data.length();
+    return true;
+}
+
+
+/** \brief Get the size of the committed part of the journal.
+ *
+ * \return The size of the journal in bytes.
+ */
+std::size_t journal::get_size() const
+{
+    return f_valid_size < 0 ? 0 : static_cast<std::size_t>(f_valid_size);
+}
+
+
+std::uint64_t journal::get_commits() const
+{
+    return f_commits;
+}
+
+
+std::uint64_t journal::get_records() const
+{
+    return f_records;
+}
+
+
+
+} // namespace fluid_settings
+// vim: ts=4 sw=4 et
@@ -0,0 +1,98 @@
+// Copyright (c) 2011-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+/** \file
+ * \brief Declaration of the write-ahead journal.
+ *
+ * The settings file only gets rewritten once in a while. In between,
+ * each change gets appended to a journal which is replayed on startup.
+ */
+
+// self
+//
+#include    "record.h"
+
+
+// snapdev
+//
+#include    <snapdev/raii_generic_deleter.h>
+
+
+// C++
+//
+#include    <memory>
+#include    <string>
+#include    <vector>
+
+
+
+namespace fluid_settings
+{
+
+
+
+class journal
+{
+public:
+    typedef std::shared_ptr<journal>    pointer_t;
+
+    static constexpr std::uint32_t const    MAGIC = 0x4A534C46;     // "FLSJ"
+    static constexpr std::uint32_t const    VERSION = 1;
+    static constexpr std::size_t const      HEADER_SIZE = 8;        // magic + version
+    static constexpr std::size_t const      RECORD_HEADER_SIZE = 8; // size + crc32c
+
+    typedef fluid_settings::record_t        record_t;
+    typedef fluid_settings::record_vector_t record_vector_t;
+
+                            journal(std::string const & filename);
+                            journal(journal const &) = delete;
+    journal &               operator = (journal const &) = delete;
+
+    static std::string      get_default_filename(std::string const & settings_filename);
+
+    std::string const &     get_filename() const;
+    bool                    read(record_vector_t & records);
+    bool                    replay(settings & s, change_set_t & changes);
+    bool                    open();
+    void                    close();
+    bool                    is_open() const;
+    void                    append(
+                                  std::string const & name
+                                , priority_set const & values);
+    bool                    has_pending() const;
+    bool                    commit();
+    bool                    reset(std::size_t mark = 0);
+    std::size_t             get_size() const;
+    std::uint64_t           get_commits() const;
+    std::uint64_t           get_records() const;
+
+private:
+    std::string             f_filename = std::string();
+    snapdev::raii_fd_t      f_fd = snapdev::raii_fd_t();
+    std::string             f_pending = std::string();
+    std::size_t             f_pending_records = 0;
+    std::int64_t            f_valid_size = 0;
+    std::uint64_t           f_commits = 0;
+    std::uint64_t           f_records = 0;
+};
+
+
+
+} // namespace fluid_settings
+// vim: ts=4 sw=4 et
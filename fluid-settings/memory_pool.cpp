@@ -0,0 +1,296 @@
+// Copyright (c) 2011-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/** \file
+ * \brief Implementation of the slab allocator used by the settings.
+ *
+ * Each size class is a power of two from MINIMUM_BLOCK_SIZE to
+ * MAXIMUM_BLOCK_SIZE. A class allocates slabs of SLAB_SIZE bytes which
+ * get cut in blocks of that class size. Freed blocks go back to the free
+ * list of their class. Larger requests go straight to the heap.
+ */
+
+// self
+//
+#include    "memory_pool.h"
+
+
+// C++
+//
+#include    <algorithm>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace fluid_settings
+{
+
+
+
+/** \class memory_pool
+ * \brief A slab allocator for small objects.
+ *
+ * The pool is used to allocate the value buffers and the arrays of
+ * values of each setting. The value buffers are shared with the
+ * snapshots which can be released by any thread so the pool is
+ * protected by a mutex.
+ *
+ * The compact() function gives back the slabs which are completely
+ * free and reorders the free lists so the next allocations come from
+ * the lowest slabs first. That way, over time, the highest slabs tend
+ * to get emptied and released.
+ */
+
+
+
+/** \brief Release all the slabs.
+ *
+ * All the objects allocated from this pool must have been released
+ * before the pool gets destroyed.
+ */
+memory_pool::~memory_pool()
+{
+    for(auto & c : f_classes)
+    {
+        for(auto const s : c.f_slabs)
+        {
+            ::operator delete(s);
+        }
+    }
+}
+
+
+/** \brief Allocate a block of memory.
+ *
+ * The \p size gets rounded up to the next size class. If larger than
+ * MAXIMUM_BLOCK_SIZE, the block is allocated from the heap.
+ *
+ * \param[in] size  The number of bytes to allocate.
+ *
+ * \return A pointer to the new block.
+ */
+void * memory_pool::allocate(std::size_t size)
+{
+    std::lock_guard<std::mutex> lock(f_mutex);
+
+    ++f_stats.f_allocations;
+
+    if(size > MAXIMUM_BLOCK_SIZE)
+    {
+        f_stats.f_large += size;
+        return ::operator new(size);
+    }
+
+    std::size_t const idx(size_class(size));
+    size_class_t & c(f_classes[idx]);
+    if(c.f_free == nullptr)
+    {
+        add_slab(idx);
+    }
+
+    free_block_t * b(c.f_free);
+    c.f_free = b->f_next;
+    f_stats.f_in_use += block_size(idx);
+    return b;
+}
+
+
+/** \brief Release a block of memory.
+ *
+ * The \p size must be the same as the one used to allocate \p ptr.
+ *
+ * \param[in] ptr  The block to release.
+ * \param[in] size  The size of the block.
+ */
+void memory_pool::deallocate(void * ptr, std::size_t size)
+{
+    if(ptr == nullptr)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(f_mutex);
+
+    ++f_stats.f_deallocations;
+
+    if(size > MAXIMUM_BLOCK_SIZE)
+    {
+        f_stats.f_large -= size;
+        ::operator delete(ptr);
+        return;
+    }
+
+    std::size_t const idx(size_class(size));
+    size_class_t & c(f_classes[idx]);
+    free_block_t * b(static_cast<free_block_t *>(ptr));
+    b->f_next = c.f_free;
+    c.f_free = b;
+    f_stats.f_in_use -= block_size(idx);
+}
+
+
+/** \brief Give back the slabs which are not used anymore.
+ *
+ * This function searches for slabs of which all the blocks are free
+ * and releases them. The remaining free blocks are then linked in
+ * increasing address order.
+ *
+ * The function walks all the free blocks so it is expected to be called
+ * at a time the daemon is otherwise idle (i.e. when the settings get
+ * saved).
+ *
+ * \return The number of bytes given back to the heap.
+ */
+std::size_t memory_pool::compact()
+{
+    std::lock_guard<std::mutex> lock(f_mutex);
+
+    ++f_stats.f_compactions;
+
+    std::size_t released(0);
+    for(std::size_t idx(0); idx < SIZE_CLASS_COUNT; ++idx)
+    {
+        size_class_t & c(f_classes[idx]);
+        if(c.f_free == nullptr)
+        {
+            continue;
+        }
+
+        std::vector<char *> blocks;
+        for(free_block_t * b(c.f_free); b != nullptr; b = b->f_next)
+        {
+            blocks.push_back(reinterpret_cast<char *>(b));
+        }
+        std::sort(blocks.begin(), blocks.end());
+        std::sort(c.f_slabs.begin(), c.f_slabs.end());
+
+        // the free blocks of one slab are contiguous in the sorted list
+        //
+        std::size_t const blocks_per_slab(SLAB_SIZE / block_size(idx));
+        std::vector<char *> kept_blocks;
+        std::vector<char *> kept_slabs;
+        auto b(blocks.begin());
+        for(auto const s : c.f_slabs)
+        {
+            auto const e(std::lower_bound(b, blocks.end(), s + SLAB_SIZE));
+            if(static_cast<std::size_t>(e - b) == blocks_per_slab)
+            {
+                ::operator delete(s);
+                released += SLAB_SIZE;
+            }
+            else
+            {
+                kept_slabs.push_back(s);
+                kept_blocks.insert(kept_blocks.end(), b, e);
+            }
+            b = e;
+        }
+        c.f_slabs.swap(kept_slabs);
+
+        c.f_free = nullptr;
+        for(auto it(kept_blocks.rbegin()); it != kept_blocks.rend(); ++it)
+        {
+            free_block_t * fb(reinterpret_cast<free_block_t *>(*it));
+            fb->f_next = c.f_free;
+            c.f_free = fb;
+        }
+    }
+
+    f_stats.f_slabs -= released / SLAB_SIZE;
+    f_stats.f_reserved -= released;
+    f_stats.f_released += released;
+
+    return released;
+}
+
+
+/** \brief Get the statistics of this pool.
+ *
+ * \return A copy of the statistics.
+ */
+memory_pool::stats_t memory_pool::get_stats() const
+{
+    std::lock_guard<std::mutex> lock(f_mutex);
+    return f_stats;
+}
+
+
+/** \brief Compute the size class of a block.
+ *
+ * \param[in] size  The size of the block, at most MAXIMUM_BLOCK_SIZE.
+ *
+ * \return The index of the size class.
+ */
+std::size_t memory_pool::size_class(std::size_t size)
+{
+    if(size <= MINIMUM_BLOCK_SIZE)
+    {
+        return 0;
+    }
+
+    // 16 is 2^4, so class 0 is 2^4, class 1 is 2^5, etc.
+    //
+    return 64 - __builtin_clzll(size - 1) - 4;
+}
+
+
+/** \brief Get the size of the blocks of a size class.
+ *
+ * \param[in] idx  The index of the size class.
+ *
+ * \return The size of one block in bytes.
+ */
+std::size_t memory_pool::block_size(std::size_t idx)
+{
+    return MINIMUM_BLOCK_SIZE << idx;
+}
+
+
+/** \brief Allocate a new slab for a size class.
+ *
+ * The slab gets cut in blocks which are added to the free list in
+ * increasing address order.
+ *
+ * \param[in] idx  The index of the size class.
+ */
+void memory_pool::add_slab(std::size_t idx)
+{
+    size_class_t & c(f_classes[idx]);
+    char * s(static_cast<char *>(::operator new(SLAB_SIZE)));
+    c.f_slabs.push_back(s);
+
+    std::size_t const size(block_size(idx));
+    for(std::size_t offset(SLAB_SIZE); offset >= size; offset -= size)
+    {
+        free_block_t * b(reinterpret_cast<free_block_t *>(s + offset - size));
+        b->f_next = c.f_free;
+        c.f_free = b;
+    }
+
+    ++f_stats.f_slabs;
+    f_stats.f_reserved += SLAB_SIZE;
+}
+
+
+
+} // namespace fluid_settings
+// vim: ts=4 sw=4 et
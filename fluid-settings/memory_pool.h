@@ -0,0 +1,172 @@
+// Copyright (c) 2011-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+/** \file
+ * \brief Declaration of the slab allocator used by the settings.
+ *
+ * The daemon runs for a very long time and keeps replacing small values
+ * of similar sizes. Allocating those from a few size classes carved out
+ * of large slabs keeps the memory usage predictable and reduces the
+ * number of calls to the heap.
+ */
+
+// C++
+//
+#include    <cstddef>
+#include    <cstdint>
+#include    <memory>
+#include    <mutex>
+#include    <new>
+#include    <type_traits>
+#include    <vector>
+
+
+
+namespace fluid_settings
+{
+
+
+
+class memory_pool
+{
+public:
+    typedef std::shared_ptr<memory_pool>    pointer_t;
+
+    static constexpr std::size_t const      SLAB_SIZE = 64 * 1024;
+    static constexpr std::size_t const      MINIMUM_BLOCK_SIZE = 16;
+    static constexpr std::size_t const      MAXIMUM_BLOCK_SIZE = 1024;
+    static constexpr std::size_t const      SIZE_CLASS_COUNT = 7;  // 16 to 1024
+
+    struct stats_t
+    {
+        std::size_t             f_slabs = 0;            // number of slabs
+        std::size_t             f_reserved = 0;         // bytes in slabs
+        std::size_t             f_in_use = 0;           // bytes in use in slabs
+        std::size_t             f_large = 0;            // bytes allocated outside of slabs
+        std::uint64_t           f_allocations = 0;
+        std::uint64_t           f_deallocations = 0;
+        std::uint64_t           f_compactions = 0;
+        std::size_t             f_released = 0;         // bytes given back by compact()
+    };
+
+                            memory_pool() = default;
+                            memory_pool(memory_pool const &) = delete;
+                            ~memory_pool();
+    memory_pool &           operator = (memory_pool const &) = delete;
+
+    void *                  allocate(std::size_t size);
+    void                    deallocate(void * ptr, std::size_t size);
+    std::size_t             compact();
+    stats_t                 get_stats() const;
+
+private:
+    struct free_block_t
+    {
+        free_block_t *          f_next = nullptr;
+    };
+
+    struct size_class_t
+    {
+        free_block_t *          f_free = nullptr;
+        std::vector<char *>     f_slabs = std::vector<char *>();
+    };
+
+    static std::size_t      size_class(std::size_t size);
+    static std::size_t      block_size(std::size_t idx);
+    void                    add_slab(std::size_t idx);
+
+    mutable std::mutex      f_mutex = std::mutex();
+    size_class_t            f_classes[SIZE_CLASS_COUNT] = {};
+    stats_t                 f_stats = stats_t();
+};
+
+
+
+// STL allocator over a memory_pool; without a pool, it uses the heap
+//
+template<typename T>
+class pool_allocator
+{
+public:
+    typedef T                   value_type;
+    typedef std::true_type      propagate_on_container_copy_assignment;
+    typedef std::true_type      propagate_on_container_move_assignment;
+    typedef std::true_type      propagate_on_container_swap;
+
+    static_assert(alignof(T) <= memory_pool::MINIMUM_BLOCK_SIZE
+                , "pool_allocator cannot satisfy the alignment of this type.");
+
+                            pool_allocator() = default;
+
+                            pool_allocator(memory_pool::pointer_t const & pool)
+                                : f_pool(pool)
+                            {
+                            }
+
+                            template<typename U>
+                            pool_allocator(pool_allocator<U> const & rhs)
+                                : f_pool(rhs.get_pool())
+                            {
+                            }
+
+    T *                     allocate(std::size_t n)
+                            {
+                                if(f_pool == nullptr)
+                                {
+                                    return static_cast<T *>(::operator new(n * sizeof(T)));
+                                }
+                                return static_cast<T *>(f_pool->allocate(n * sizeof(T)));
+                            }
+
+    void                    deallocate(T * ptr, std::size_t n)
+                            {
+                                if(f_pool == nullptr)
+                                {
+                                    ::operator delete(ptr);
+                                    return;
+                                }
+                                f_pool->deallocate(ptr, n * sizeof(T));
+                            }
+
+    memory_pool::pointer_t const &
+                            get_pool() const
+                            {
+                                return f_pool;
+                            }
+
+    template<typename U>
+    bool                    operator == (pool_allocator<U> const & rhs) const
+                            {
+                                return f_pool == rhs.get_pool();
+                            }
+
+    template<typename U>
+    bool                    operator != (pool_allocator<U> const & rhs) const
+                            {
+                                return f_pool != rhs.get_pool();
+                            }
+
+private:
+    memory_pool::pointer_t  f_pool = memory_pool::pointer_t();
+};
+
+
+
+} // namespace fluid_settings
+// vim: ts=4 sw=4 et
@@ -0,0 +1,298 @@
+// Copyright (c) 2011-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/** \file
+ * \brief Implementation of the set of values of one setting.
+ *
+ * The bit at position `priority` in the bitmap is set when a value exists
+ * at that priority. The position of that value in the array of slots is
+ * the number of bits set below that priority (its rank). This means all
+ * the searches are a couple of bit operations and none of them require
+ * a temporary value.
+ */
+
+// self
+//
+#include    "priority_set.h"
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace fluid_settings
+{
+
+
+
+/** \class priority_set
+ * \brief Hold the values of one setting, one per priority.
+ *
+ * The set is ordered by priority. Iterating from begin() to end() returns
+ * the values from the lowest to the highest priority.
+ */
+
+
+/** \brief Initialize an empty set.
+ *
+ * The \p allocator is used to allocate the array of values. The
+ * settings_table passes an allocator using its memory pool.
+ *
+ * \param[in] allocator  The allocator used for the array of values.
+ */
+priority_set::priority_set(allocator_t const & allocator)
+    : f_slots(allocator)
+{
+}
+
+
+/** \brief Check whether the set is empty.
+ *
+ * \return true if no value is defined at any priority.
+ */
+bool priority_set::empty() const
+{
+    return f_slots.empty();
+}
+
+
+/** \brief Get the number of values in this set.
+ *
+ * \return The number of priorities with a value.
+ */
+std::size_t priority_set::size() const
+{
+    return f_slots.size();
+}
+
+
+/** \brief Check whether a value exists at \p priority.
+ *
+ * \param[in] priority  The priority to check.
+ *
+ * \return true if a value is defined at that priority.
+ */
+bool priority_set::has(priority_t priority) const
+{
+    if(!valid(priority))
+    {
+        return false;
+    }
+    return (f_bitmap[priority >> 6] & (1ULL << (priority & 63))) != 0;
+}
+
+
+/** \brief Search for the value at \p priority.
+ *
+ * \param[in] priority  The priority of the value to retrieve.
+ *
+ * \return A pointer to the value or nullptr if there is no value at that
+ * priority.
+ */
+value const * priority_set::find(priority_t priority) const
+{
+    if(!has(priority))
+    {
+        return nullptr;
+    }
+    return &f_slots[rank(priority)];
+}
+
+
+/** \brief Search for the value at \p priority.
+ *
+ * This is the non-constant version of the find() function.
+ *
+ * \param[in] priority  The priority of the value to retrieve.
+ *
+ * \return A pointer to the value or nullptr if there is no value at that
+ * priority.
+ */
+value * priority_set::find(priority_t priority)
+{
+    if(!has(priority))
+    {
+        return nullptr;
+    }
+    return &f_slots[rank(priority)];
+}
+
+
+/** \brief Get the highest priority with a value.
+ *
+ * \return The highest priority or HIGHEST_PRIORITY (-1) if the set is empty.
+ */
+priority_t priority_set::get_highest_priority() const
+{
+    if(f_bitmap[1] != 0)
+    {
+        return 127 - __builtin_clzll(f_bitmap[1]);
+    }
+    if(f_bitmap[0] != 0)
+    {
+        return 63 - __builtin_clzll(f_bitmap[0]);
+    }
+    return HIGHEST_PRIORITY;
+}
+
+
+/** \brief Get the value with the highest priority.
+ *
+ * This is the current value of the setting.
+ *
+ * \return A pointer to the value or nullptr if the set is empty.
+ */
+value const * priority_set::highest() const
+{
+    if(f_slots.empty())
+    {
+        return nullptr;
+    }
+    return &f_slots.back();
+}
+
+
+/** \brief Insert or replace a value.
+ *
+ * The value gets saved at its priority. If a value already exists at
+ * that priority, it gets replaced.
+ *
+ * \param[in] v  The value to save in this set.
+ *
+ * \return true if the value was new at that priority.
+ */
+bool priority_set::insert(value const & v)
+{
+    priority_t const priority(v.get_priority());
+    if(!valid(priority))
+    {
+        return false;
+    }
+
+    std::size_t const pos(rank(priority));
+    if(has(priority))
+    {
+        f_slots[pos] = v;
+        return false;
+    }
+
+    f_bitmap[priority >> 6] |= 1ULL << (priority & 63);
+    f_slots.insert(f_slots.begin() + pos, v);
+    return true;
+}
+
+
+/** \brief Remove the value at \p priority.
+ *
+ * \param[in] priority  The priority of the value to remove.
+ *
+ * \return true if a value was removed.
+ */
+bool priority_set::erase(priority_t priority)
+{
+    if(!has(priority))
+    {
+        return false;
+    }
+
+    f_slots.erase(f_slots.begin() + rank(priority));
+    f_bitmap[priority >> 6] &= ~(1ULL << (priority & 63));
+    return true;
+}
+
+
+/** \brief Remove all the values.
+ */
+void priority_set::clear()
+{
+    f_bitmap[0] = 0;
+    f_bitmap[1] = 0;
+    f_slots.clear();
+}
+
+
+/** \brief Release the unused capacity of the array of values.
+ *
+ * The array of values is reallocated to the exact size necessary. This
+ * is called when the memory gets compacted.
+ */
+void priority_set::shrink_to_fit()
+{
+    f_slots.shrink_to_fit();
+}
+
+
+/** \brief Get an iterator to the value with the lowest priority.
+ *
+ * \return The iterator to the first value.
+ */
+priority_set::const_iterator priority_set::begin() const
+{
+    return f_slots.begin();
+}
+
+
+/** \brief Get an iterator to the end of the set.
+ *
+ * \return The iterator one past the value with the highest priority.
+ */
+priority_set::const_iterator priority_set::end() const
+{
+    return f_slots.end();
+}
+
+
+/** \brief Check whether \p priority is within bounds.
+ *
+ * \param[in] priority  The priority to check.
+ *
+ * \return true if the priority is between MINIMUM_PRIORITY and
+ * MAXIMUM_PRIORITY inclusive.
+ */
+bool priority_set::valid(priority_t priority)
+{
+    return priority >= MINIMUM_PRIORITY
+        && priority <= MAXIMUM_PRIORITY;
+}
+
+
+/** \brief Compute the position of \p priority in the array of slots.
+ *
+ * The rank is the number of values with a priority smaller than
+ * \p priority.
+ *
+ * \param[in] priority  A valid priority.
+ *
+ * \return The position of the value in the slots.
+ */
+std::size_t priority_set::rank(priority_t priority) const
+{
+    if(priority < 64)
+    {
+        return __builtin_popcountll(f_bitmap[0] & ((1ULL << priority) - 1));
+    }
+    return __builtin_popcountll(f_bitmap[0])
+         + __builtin_popcountll(f_bitmap[1] & ((1ULL << (priority - 64)) - 1));
+}
+
+
+
+} // namespace fluid_settings
+// vim: ts=4 sw=4 et
@@ -0,0 +1,80 @@
+// Copyright (c) 2011-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+/** \file
+ * \brief Declaration of the set of values of one setting.
+ *
+ * A setting can have one value per priority. Since priorities are limited
+ * to 0 to 99, the set uses a 128 bit occupancy bitmap and a compact array
+ * of values sorted by priority.
+ */
+
+// self
+//
+#include    "memory_pool.h"
+#include    "value.h"
+
+
+// C++
+//
+#include    <cstdint>
+
+
+
+namespace fluid_settings
+{
+
+
+
+class priority_set
+{
+public:
+    typedef pool_allocator<value>               allocator_t;
+    typedef std::vector<value, allocator_t>     slot_vector_t;
+    typedef slot_vector_t::const_iterator       const_iterator;
+
+                            priority_set(allocator_t const & allocator = allocator_t());
+
+    bool                    empty() const;
+    std::size_t             size() const;
+    bool                    has(priority_t priority) const;
+    value const *           find(priority_t priority) const;
+    value *                 find(priority_t priority);
+    priority_t              get_highest_priority() const;
+    value const *           highest() const;
+    bool                    insert(value const & v);
+    bool                    erase(priority_t priority);
+    void                    clear();
+    void                    shrink_to_fit();
+
+    const_iterator          begin() const;
+    const_iterator          end() const;
+
+private:
+    static bool             valid(priority_t priority);
+    std::size_t             rank(priority_t priority) const;
+
+    std::uint64_t           f_bitmap[2] = { 0, 0 };
+    slot_vector_t           f_slots = slot_vector_t();
+};
+
+
+
+} // namespace fluid_settings
+// vim: ts=4 sw=4 et
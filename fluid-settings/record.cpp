@@ -0,0 +1,214 @@
+// Copyright (c) 2011-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/** \file
+ * \brief Implementation of the binary encoding of the values of a setting.
+ *
+ * A record is:
+ *
+ * \code
+ *     uint16_t     length of the name
+ *     char[]       name
+ *     uint16_t     number of values
+ *     values:
+ *         uint8_t      priority
+ *         int64_t      timestamp in nanoseconds
+ *         uint32_t     length of the value
+ *         char[]       value
+ * \endcode
+ *
+ * All the numbers are saved in little endian.
+ */
+
+// self
+//
+#include    "record.h"
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace fluid_settings
+{
+
+
+
+/** \brief Append a number in little endian.
+ *
+ * \param[in,out] out  The buffer where the number gets appended.
+ * \param[in] value  The number to append.
+ * \param[in] size  The number of bytes to use (1 to 8).
+ */
+void encode_uint(
+      std::string & out
+    , std::uint64_t value
+    , int size)
+{
+    for(int idx(0); idx < size; ++idx)
+    {
+        out += static_cast<char>(value & 0xFF);
+        value >>= 8;
+    }
+}
+
+
+/** \brief Read a number saved in little endian.
+ *
+ * The caller is responsible for making sure that \p size bytes are
+ * available in \p data.
+ *
+ * \param[in] data  The bytes to read.
+ * \param[in] size  The number of bytes to read (1 to 8).
+ *
+ * \return The number.
+ */
+std::uint64_t decode_uint(
+      char const * data
+    , int size)
+{
+    std::uint64_t value(0);
+    for(int idx(size - 1); idx >= 0; --idx)
+    {
+        value = (value << 8) | static_cast<std::uint8_t>(data[idx]);
+    }
+    return value;
+}
+
+
+/** \brief Append the values of a setting to a buffer.
+ *
+ * \param[in,out] out  The buffer where the record gets appended.
+ * \param[in] name  The name of the setting.
+ * \param[in] values  The values of the setting.
+ */
+void encode_record(
+      std::string & out
+    , std::string const & name
+    , priority_set const & values)
+{
+    encode_uint(out, name.length(), 2);
+    out += name;
+    encode_uint(out, values.size(), 2);
+    for(auto const & v : values)
+    {
+        encode_uint(out, v.get_priority(), 1);
+        encode_uint(out, v.get_timestamp().to_nsec(), 8);
+        std::string const & value(v.get_value());
+        encode_uint(out, value.length(), 4);
+        out += value;
+    }
+}
+
+
+/** \brief Append the values of a setting found in a snapshot.
+ *
+ * This function generates the same record as the one using a
+ * priority_set. It is used to save a snapshot from a thread other than
+ * the one modifying the settings.
+ *
+ * \param[in,out] out  The buffer where the record gets appended.
+ * \param[in] name  The name of the setting.
+ * \param[in] values  The values of the setting; may be nullptr.
+ */
+void encode_record(
+      std::string & out
+    , std::string const & name
+    , snapshot::value_list_t const * values)
+{
+    encode_uint(out, name.length(), 2);
+    out += name;
+    if(values == nullptr)
+    {
+        encode_uint(out, 0, 2);
+        return;
+    }
+    encode_uint(out, values->size(), 2);
+    for(auto const & v : *values)
+    {
+        encode_uint(out, v.f_priority, 1);
+        encode_uint(out, v.f_timestamp.to_nsec(), 8);
+        encode_uint(out, v.f_value->length(), 4);
+        out += *v.f_value;
+    }
+}
+
+
+/** \brief Read the values of a setting.
+ *
+ * The record must use exactly \p size bytes.
+ *
+ * \param[in] data  The encoded record.
+ * \param[in] size  The size of the record in bytes.
+ * \param[out] record  The name and values found in the record.
+ *
+ * \return false if the record is not valid.
+ */
+bool decode_record(
+      char const * data
+    , std::size_t size
+    , record_t & record)
+{
+    char const * end(data + size);
+
+    if(end - data < 2)
+    {
+        return false;
+    }
+    std::size_t length(decode_uint(data, 2));
+    data += 2;
+    if(static_cast<std::size_t>(end - data) < length + 2)
+    {
+        return false;
+    }
+    record.f_name.assign(data, length);
+    data += length;
+
+    std::size_t const count(decode_uint(data, 2));
+    data += 2;
+    record.f_values.clear();
+    record.f_values.reserve(count);
+    for(std::size_t idx(0); idx < count; ++idx)
+    {
+        if(end - data < 1 + 8 + 4)
+        {
+            return false;
+        }
+        mutation_t m;
+        m.f_priority = static_cast<priority_t>(decode_uint(data, 1));
+        m.f_timestamp = timestamp_t(static_cast<std::int64_t>(decode_uint(data + 1, 8)));
+        length = decode_uint(data + 9, 4);
+        data += 13;
+        if(static_cast<std::size_t>(end - data) < length)
+        {
+            return false;
+        }
+        m.f_value.assign(data, length);
+        data += length;
+        record.f_values.push_back(std::move(m));
+    }
+
+    return data == end;
+}
+
+
+
+} // namespace fluid_settings
+// vim: ts=4 sw=4 et
@@ -0,0 +1,78 @@
+// Copyright (c) 2011-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+/** \file
+ * \brief Declaration of the binary encoding of the values of a setting.
+ *
+ * The journal and the binary snapshot save the values of a setting in
+ * the same compact binary format.
+ */
+
+// self
+//
+#include    "priority_set.h"
+#include    "settings.h"
+
+
+// C++
+//
+#include    <string>
+#include    <vector>
+
+
+
+namespace fluid_settings
+{
+
+
+
+struct record_t
+{
+    std::string             f_name = std::string();
+    mutation_vector_t       f_values = mutation_vector_t();
+    std::uint32_t           f_definition = 0;       // fingerprint of the definition (snapshot_file only)
+};
+
+typedef std::vector<record_t>       record_vector_t;
+
+
+void                        encode_uint(
+                                  std::string & out
+                                , std::uint64_t value
+                                , int size);
+std::uint64_t               decode_uint(
+                                  char const * data
+                                , int size);
+void                        encode_record(
+                                  std::string & out
+                                , std::string const & name
+                                , priority_set const & values);
+void                        encode_record(
+                                  std::string & out
+                                , std::string const & name
+                                , snapshot::value_list_t const * values);
+bool                        decode_record(
+                                  char const * data
+                                , std::size_t size
+                                , record_t & record);
+
+
+
+} // namespace fluid_settings
+// vim: ts=4 sw=4 et
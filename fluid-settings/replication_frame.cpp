@@ -0,0 +1,429 @@
+// Copyright (c) 2022-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/** \file
+ * \brief Implementation of the binary frame used to replicate the values.
+ *
+ * A frame is a list of values, each encoded as:
+ *
+ * \code
+ *     varint     priority
+ *     int64      timestamp in nanoseconds (little endian)
+ *     varint     size of the value
+ *     char[size] the value as is
+ * \endcode
+ *
+ * The values do not need to be escaped and the numbers do not need to
+ * be converted to and from text.
+ *
+ * A batch is a list of settings, each encoded as:
+ *
+ * \code
+ *     varint     identifier of the setting on the sender
+ *     varint     size of the name, 0 if the name was already sent
+ *     char[size] the name
+ *     varint     size of the frame
+ *     char[size] the frame of the values of that setting
+ * \endcode
+ *
+ * The batch is binary so it gets encoded in base64 before it is added
+ * as a parameter of a message.
+ */
+
+// self
+//
+#include    "replication_frame.h"
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace fluid_settings
+{
+
+
+
+namespace
+{
+
+
+
+void encode_varint(std::string & frame, std::uint64_t n)
+{
+    while(n >= 0x80)
+    {
+        frame += static_cast<char>(n | 0x80);
+        n >>= 7;
+    }
+    frame += static_cast<char>(n);
+}
+
+
+void encode_value(
+      std::string & frame
+    , priority_t priority
+    , timestamp_t const & timestamp
+    , std::string const & value)
+{
+    encode_varint(frame, static_cast<std::uint64_t>(priority));
+
+    std::uint64_t const ns(static_cast<std::uint64_t>(timestamp.to_nsec()));
+    char buf[8];
+    for(std::size_t idx(0); idx < sizeof(buf); ++idx)
+    {
+        buf[idx] = static_cast<char>(ns >> (idx * 8));
+    }
+    frame.append(buf, sizeof(buf));
+
+    encode_varint(frame, value.length());
+    frame += value;
+}
+
+
+bool decode_varint(std::string_view & frame, std::uint64_t & n)
+{
+    n = 0;
+    for(int shift(0); shift < 64; shift += 7)
+    {
+        if(frame.empty())
+        {
+            return false;
+        }
+        std::uint8_t const c(static_cast<std::uint8_t>(frame[0]));
+        frame.remove_prefix(1);
+        n |= static_cast<std::uint64_t>(c & 0x7F) << shift;
+        if((c & 0x80) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+bool decode_string(std::string_view & batch, std::string_view & str)
+{
+    std::uint64_t size(0);
+    if(!decode_varint(batch, size)
+    || size > batch.length())
+    {
+        return false;
+    }
+    str = batch.substr(0, size);
+    batch.remove_prefix(size);
+    return true;
+}
+
+
+
+char const g_base64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+
+int base64_digit(char c)
+{
+    if(c >= 'A' && c <= 'Z')
+    {
+        return c - 'A';
+    }
+    if(c >= 'a' && c <= 'z')
+    {
+        return c - 'a' + 26;
+    }
+    if(c >= '0' && c <= '9')
+    {
+        return c - '0' + 52;
+    }
+    if(c == '+')
+    {
+        return 62;
+    }
+    if(c == '/')
+    {
+        return 63;
+    }
+    return -1;
+}
+
+
+
+} // no name namespace
+
+
+
+/** \brief Encode the values of a setting in a frame.
+ *
+ * The values are appended to \p frame.
+ *
+ * \param[in,out] frame  The buffer receiving the frame.
+ * \param[in] values  The values to encode.
+ */
+void encode_frame(
+      std::string & frame
+    , priority_set const & values)
+{
+    for(auto const & v : values)
+    {
+        encode_value(frame, v.get_priority(), v.get_timestamp(), v.get_value());
+    }
+}
+
+
+/** \brief Encode the values of a setting found in a snapshot.
+ *
+ * This function creates the same frame as the other encode_frame()
+ * function, from the values of a snapshot record instead.
+ *
+ * \param[in,out] frame  The buffer receiving the frame.
+ * \param[in] values  The values to encode.
+ */
+void encode_frame(
+      std::string & frame
+    , snapshot::value_list_t const & values)
+{
+    for(auto const & v : values)
+    {
+        if(v.f_value != nullptr)
+        {
+            encode_value(frame, v.f_priority, v.f_timestamp, *v.f_value);
+        }
+    }
+}
+
+
+/** \brief Decode a frame.
+ *
+ * The values found in \p frame are added to \p values. Only the
+ * priority, timestamp, and value fields of the mutations are set.
+ *
+ * \param[in] frame  The frame to decode.
+ * \param[in,out] values  The decoded values.
+ *
+ * \return false if the frame is not valid.
+ */
+bool decode_frame(
+      std::string_view frame
+    , mutation_vector_t & values)
+{
+    while(!frame.empty())
+    {
+        std::uint64_t priority(0);
+        if(!decode_varint(frame, priority)
+        || priority > static_cast<std::uint64_t>(MAXIMUM_PRIORITY)
+        || frame.length() < 8)
+        {
+            return false;
+        }
+
+        std::uint64_t ns(0);
+        for(std::size_t idx(0); idx < 8; ++idx)
+        {
+            ns |= static_cast<std::uint64_t>(static_cast<std::uint8_t>(frame[idx])) << (idx * 8);
+        }
+        frame.remove_prefix(8);
+
+        // a timestamp set_value() would not accept could only come from
+        // a broken or hostile peer
+        //
+        if(ns > static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max()))
+        {
+            return false;
+        }
+        timestamp_t const timestamp(static_cast<std::int64_t>(ns));
+        if(!value::is_valid(static_cast<priority_t>(priority), timestamp))
+        {
+            return false;
+        }
+
+        std::uint64_t size(0);
+        if(!decode_varint(frame, size)
+        || size > frame.length())
+        {
+            return false;
+        }
+
+        mutation_t m;
+        m.f_priority = static_cast<priority_t>(priority);
+        m.f_timestamp = timestamp;
+        m.f_value.assign(frame.data(), size);
+        values.push_back(std::move(m));
+        frame.remove_prefix(size);
+    }
+
+    return true;
+}
+
+
+/** \brief Append the frame of one setting to a batch.
+ *
+ * \param[in,out] batch  The buffer receiving the batch.
+ * \param[in] id  The identifier of the setting on this side.
+ * \param[in] name  The name of the setting, empty if the other side
+ * already knows about this identifier.
+ * \param[in] frame  The frame of values as created by encode_frame().
+ */
+void encode_batch_entry(
+      std::string & batch
+    , std::uint64_t id
+    , std::string_view name
+    , std::string_view frame)
+{
+    encode_varint(batch, id);
+    encode_varint(batch, name.length());
+    batch += name;
+    encode_varint(batch, frame.length());
+    batch += frame;
+}
+
+
+/** \brief Decode a batch.
+ *
+ * The settings found in \p batch are added to \p entries. The entries
+ * point inside \p batch which must remain valid while they are used.
+ * The frames themselves are not decoded; use decode_frame() for that
+ * purpose.
+ *
+ * \param[in] batch  The batch to decode.
+ * \param[in,out] entries  The decoded entries.
+ *
+ * \return false if the batch is not valid.
+ */
+bool decode_batch(
+      std::string_view batch
+    , batch_entry_vector_t & entries)
+{
+    while(!batch.empty())
+    {
+        batch_entry_t e;
+        if(!decode_varint(batch, e.f_id)
+        || !decode_string(batch, e.f_name)
+        || !decode_string(batch, e.f_frame))
+        {
+            return false;
+        }
+        entries.push_back(e);
+    }
+
+    return true;
+}
+
+
+
+/** \brief Encode a batch so it can be sent in a message.
+ *
+ * The message parameters are text. The batch gets encoded in base64
+ * (RFC 4648, with padding) and appended to \p text.
+ *
+ * \param[in,out] text  The buffer receiving the encoded batch.
+ * \param[in] batch  The batch to encode.
+ */
+void encode_base64(
+      std::string & text
+    , std::string_view batch)
+{
+    text.reserve(text.size() + (batch.length() + 2) / 3 * 4);
+
+    unsigned char const * s(reinterpret_cast<unsigned char const *>(batch.data()));
+    std::size_t size(batch.length());
+    for(; size >= 3; size -= 3, s += 3)
+    {
+        std::uint32_t const n((s[0] << 16) | (s[1] << 8) | s[2]);
+        text += g_base64[(n >> 18) & 0x3F];
+        text += g_base64[(n >> 12) & 0x3F];
+        text += g_base64[(n >> 6) & 0x3F];
+        text += g_base64[n & 0x3F];
+    }
+    if(size > 0)
+    {
+        std::uint32_t const n((s[0] << 16) | (size == 2 ? s[1] << 8 : 0));
+        text += g_base64[(n >> 18) & 0x3F];
+        text += g_base64[(n >> 12) & 0x3F];
+        text += size == 2 ? g_base64[(n >> 6) & 0x3F] : '=';
+        text += '=';
+    }
+}
+
+
+/** \brief Decode a batch received in a message.
+ *
+ * This function reverses encode_base64(). The decoded batch gets
+ * appended to \p batch.
+ *
+ * \param[in] text  The encoded batch.
+ * \param[in,out] batch  The buffer receiving the decoded batch.
+ *
+ * \return false if \p text is not valid base64.
+ */
+bool decode_base64(
+      std::string_view text
+    , std::string & batch)
+{
+    if(text.length() % 4 != 0)
+    {
+        return false;
+    }
+
+    batch.reserve(batch.size() + text.length() / 4 * 3);
+    for(std::size_t pos(0); pos < text.length(); pos += 4)
+    {
+        // the padding is only valid at the very end
+        //
+        std::size_t padding(0);
+        if(pos + 4 == text.length())
+        {
+            if(text[pos + 3] == '=')
+            {
+                ++padding;
+                if(text[pos + 2] == '=')
+                {
+                    ++padding;
+                }
+            }
+        }
+
+        std::uint32_t n(0);
+        for(std::size_t idx(0); idx < 4 - padding; ++idx)
+        {
+            int const d(base64_digit(text[pos + idx]));
+            if(d < 0)
+            {
+                return false;
+            }
+            n |= d << (18 - idx * 6);
+        }
+
+        batch += static_cast<char>(n >> 16);
+        if(padding < 2)
+        {
+            batch += static_cast<char>(n >> 8);
+        }
+        if(padding < 1)
+        {
+            batch += static_cast<char>(n);
+        }
+    }
+
+    return true;
+}
+
+
+
+} // namespace fluid_settings
+// vim: ts=4 sw=4 et
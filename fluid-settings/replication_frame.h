@@ -0,0 +1,91 @@
+// Copyright (c) 2022-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+/** \file
+ * \brief Declaration of the binary frame used to replicate the values.
+ *
+ * Once two fluid-settings agreed to use the binary format, the values
+ * of a setting are sent to the other fluid-settings in a frame instead
+ * of the escaped text returned by settings::serialize_value().
+ *
+ * The frames of several settings get grouped in one batch so the
+ * changes made within a short time window travel in a single message.
+ * The batch gets encoded in base64 since message parameters are text.
+ */
+
+// self
+//
+#include    "priority_set.h"
+#include    "settings.h"
+#include    "snapshot.h"
+
+
+// C++
+//
+#include    <string>
+#include    <string_view>
+#include    <vector>
+
+
+
+namespace fluid_settings
+{
+
+
+
+// one setting found in a batch; the views point inside the batch
+//
+struct batch_entry_t
+{
+    std::uint64_t           f_id = 0;
+    std::string_view        f_name = std::string_view();    // empty if already sent
+    std::string_view        f_frame = std::string_view();
+};
+
+typedef std::vector<batch_entry_t>  batch_entry_vector_t;
+
+
+void                    encode_frame(
+                              std::string & frame
+                            , priority_set const & values);
+void                    encode_frame(
+                              std::string & frame
+                            , snapshot::value_list_t const & values);
+bool                    decode_frame(
+                              std::string_view frame
+                            , mutation_vector_t & values);
+void                    encode_batch_entry(
+                              std::string & batch
+                            , std::uint64_t id
+                            , std::string_view name
+                            , std::string_view frame);
+bool                    decode_batch(
+                              std::string_view batch
+                            , batch_entry_vector_t & entries);
+void                    encode_base64(
+                              std::string & text
+                            , std::string_view batch);
+bool                    decode_base64(
+                              std::string_view text
+                            , std::string & batch);
+
+
+
+} // namespace fluid_settings
+// vim: ts=4 sw=4 et
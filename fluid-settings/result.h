@@ -0,0 +1,56 @@
+// Copyright (c) 2011-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+/** \file
+ * \brief Results of the functions reading and writing settings.
+ *
+ * These enumerations are shared by the settings and the snapshots.
+ */
+
+
+
+namespace fluid_settings
+{
+
+
+enum class get_result_t
+{
+    GET_RESULT_ERROR,               // some error happened (other than value undefined)
+    GET_RESULT_UNKNOWN,             // unknown value (name not found in lists)
+    GET_RESULT_NOT_SET,             // the get "failed" because the value is not set
+    GET_RESULT_PRIORITY_NOT_FOUND,  // some values are set, but not at the requested priority
+    GET_RESULT_DEFAULT,             // default value is being returned
+    GET_RESULT_SUCCESS,             // the value(s) is(are) being returned
+};
+
+enum class set_result_t
+{
+    SET_RESULT_ERROR,               // some error happened
+    SET_RESULT_UNKNOWN,             // the named was not found in the existing values
+    SET_RESULT_NEW,                 // that value was not set yet
+    SET_RESULT_NEW_PRIORITY,        // the value existed, but not at that priority
+    SET_RESULT_CHANGED,             // the value was changed
+    SET_RESULT_NEWER,               // the timestamp changed, the value is the same
+    SET_RESULT_UNCHANGED,           // the timestamp is older or the same
+};
+
+
+
+} // namespace fluid_settings
+// vim: ts=4 sw=4 et
@@ -38,6 +38,10 @@
 //
 #include    "fluid-settings/settings.h"
 
+#include    "fluid-settings/crc32c.h"
+#include    "fluid-settings/snapshot_file.h"
+#include    "fluid-settings/value_codec.h"
+
 #include    "fluid-settings/version.h"
 
 
@@ -58,10 +62,27 @@
 #include    <snapdev/glob_to_list.h>
 #include    <snapdev/join_strings.h>
 #include    <snapdev/map_keyset.h>
-#include    <snapdev/string_replace_many.h>
+#include    <snapdev/raii_generic_deleter.h>
 #include    <snapdev/tokenize_string.h>
 
 
+// C++
+//
+#include    <algorithm>
+#include    <atomic>
+#include    <charconv>
+#include    <thread>
+
+
+// C
+//
+#include    <errno.h>
+#include    <fcntl.h>
+#include    <libgen.h>
+#include    <string.h>
+#include    <unistd.h>
+
+
 // last include
 //
 #include    <snapdev/poison.h>
@@ -105,6 +126,42 @@ constexpr advgetopt::options_environment const g_options_environment =
 #pragma GCC diagnostic pop
 
 
+/** \brief Compute the fingerprint of a definition file.
+ *
+ * The fingerprint is a CRC32C of the parameters found in the file.
+ * The advgetopt parser keeps the configuration files it parsed in a
+ * cache, so calling this function after parse_options_from_file()
+ * with the same setup returns the parameters it already read instead
+ * of reading the file again. Comments and blank lines do not change
+ * the fingerprint.
+ *
+ * \param[in] filename  The name of the definition file.
+ *
+ * \return The fingerprint, never 0.
+ */
+std::uint32_t definition_fingerprint(std::string const & filename)
+{
+    // this is the setup used by parse_options_from_file()
+    //
+    advgetopt::conf_file_setup setup(
+                  filename
+                , advgetopt::line_continuation_t::line_continuation_unix
+                , advgetopt::ASSIGNMENT_OPERATOR_EQUAL
+                , advgetopt::COMMENT_INI | advgetopt::COMMENT_SHELL
+                , advgetopt::SECTION_OPERATOR_INI_FILE);
+    advgetopt::conf_file::pointer_t conf(advgetopt::conf_file::get_conf_file(setup));
+
+    std::uint32_t crc(0);
+    for(auto const & p : conf->get_parameters())
+    {
+        std::string const & value(p.second.get_value());
+        crc = crc32c(p.first.data(), p.first.length() + 1, crc);   // include the '\0'
+        crc = crc32c(value.data(), value.length() + 1, crc);
+    }
+    return crc | 1;
+}
+
+
 }
 // no name namespace
 
@@ -133,20 +190,29 @@ constexpr advgetopt::options_environment const g_options_environment =
  * "default definitions path". You can obtain the default path using the
  * get_default_path() function.
  *
+ * The files are parsed in parallel by up to \p threads threads, each
+ * file in its own option table. The tables then get merged in the order
+ * the files were found (paths in order, files sorted by name within a
+ * path) so the result does not depend on which thread finished first.
+ * When more than one file defines the same option, the first one wins.
+ *
  * \note
  * You can load files in one specific location using this function and
  * only one path as the input string.
  *
  * \param[in] paths  A list of colon separated paths used to read all the
  * available definitions.
+ * \param[in] threads  The maximum number of threads used to parse the
+ * files; 0 means one per processor.
  *
  * \return true if some configuration files were found, false otherwise.
  */
-bool settings::load_definitions(std::string paths)
+bool settings::load_definitions(std::string paths, std::size_t threads)
 {
     // completely reset the whole table of options
     //
     f_opts = std::make_shared<advgetopt::getopt>(g_options_environment);
+    f_definitions.clear();
 
     if(!paths.empty())
     {
@@ -157,9 +223,10 @@ bool settings::load_definitions(std::string paths)
     advgetopt::string_list_t list;
     advgetopt::split_string(paths, list, { ":" });
     bool found(false);
+    advgetopt::string_list_t files;
     for(auto const & p : list)
     {
-        if(load_definition_file(p))
+        if(find_definition_files(p, files))
         {
             found = true;
         }
@@ -170,54 +237,266 @@ bool settings::load_definitions(std::string paths)
             << "no fluid-settings definition files found anywhere; fluid-settings will be dormant."
             << SNAP_LOG_SEND;
     }
-    return !f_opts->get_options().empty();
-}
 
+    // parse each file in its own table
+    //
+    std::vector<advgetopt::getopt::pointer_t> parsed(files.size());
+    std::vector<std::string> errors(files.size());
+    std::vector<std::uint32_t> fingerprints(files.size());
+    std::atomic<std::size_t> next(0);
+    auto parse = [&]()
+    {
+        for(;;)
+        {
+            std::size_t const idx(next++);
+            if(idx >= files.size())
+            {
+                break;
+            }
+            parsed[idx] = std::make_shared<advgetopt::getopt>(g_options_environment);
+            try
+            {
+                parsed[idx]->parse_options_from_file(
+                          files[idx]
+                        , 2
+                        , std::numeric_limits<int>::max()
+                        , true);
+
+                // the fingerprint tells us whether the values saved with
+                // this definition need to be validated again on load
+                //
+                fingerprints[idx] = definition_fingerprint(files[idx]);
+            }
+            catch(advgetopt::getopt_logic_error const & e)
+            {
+                errors[idx] = e.what();
+            }
+        }
+    };
 
-bool settings::load_definition_file(std::string const & path)
-{
-    snapdev::glob_to_list<std::list<std::string>> files;
-    if(!files.read_path<>(path + '/' + g_definitions_pattern))
+    if(threads == 0)
     {
-        SNAP_LOG_WARNING
-            << "no fluid-settings definition files found in \""
-            << path
-            << "\" (with pattern \""
-            << g_definitions_pattern
-            << "\")."
-            << SNAP_LOG_SEND;
-        return false;
+        threads = std::max(1U, std::thread::hardware_concurrency());
+    }
+    threads = std::min(threads, files.size());
+    std::vector<std::thread> workers;
+    for(std::size_t idx(1); idx < threads; ++idx)
+    {
+        workers.emplace_back(parse);
+    }
+    parse();
+    for(auto & w : workers)
+    {
+        w.join();
     }
 
-    for(auto const & f : files)
+    // merge the tables in order
+    //
+    for(std::size_t idx(0); idx < files.size(); ++idx)
     {
         SNAP_LOG_CONFIGURATION
             << "loading fluid-settings definitions from \""
-            << f
+            << files[idx]
             << "\"."
             << SNAP_LOG_SEND;
 
-        try
-        {
-            f_opts->parse_options_from_file(
-                      f
-                    , 2
-                    , std::numeric_limits<int>::max()
-                    , true);
-        }
-        catch(advgetopt::getopt_logic_error const & e)
+        if(!errors[idx].empty())
         {
             SNAP_LOG_SEVERE
                 << "the fluid-settings option parser found an invalid parameter: "
-                << e.what()
+                << errors[idx]
                 << SNAP_LOG_SEND;
         }
+
+        for(auto const & o : parsed[idx]->get_options())
+        {
+            // the first file defining an option wins, as if all the
+            // files had been parsed in order in the same table
+            //
+            if(f_opts->get_option(o.first) != nullptr)
+            {
+                SNAP_LOG_WARNING
+                    << "option \""
+                    << o.first
+                    << "\" found in \""
+                    << files[idx]
+                    << "\" is already defined; this definition is ignored."
+                    << SNAP_LOG_SEND;
+                continue;
+            }
+
+            try
+            {
+                f_opts->add_option(o.second);
+                f_definitions.emplace(o.first, fingerprints[idx]);
+            }
+            catch(advgetopt::getopt_logic_error const & e)
+            {
+                SNAP_LOG_SEVERE
+                    << "the fluid-settings option parser found an invalid parameter: "
+                    << e.what()
+                    << SNAP_LOG_SEND;
+            }
+        }
     }
 
+    // the setting identifiers remain valid, but the options they point
+    // to need to be updated (an option may also have been removed)
+    //
+    for(setting_id_t id(0); id < f_values.size(); ++id)
+    {
+        settings_table::entry & e(f_values.get_entry(id));
+        e.set_option(f_opts->get_option(e.get_name()));
+        e.set_definition(get_definition(e.get_name()));
+        refresh(id);
+    }
+
+    f_options = std::make_shared<std::string const>(list_of_options());
+    f_snapshot_dirty = true;
+
+    return !f_opts->get_options().empty();
+}
+
+
+/** \brief Recalculate a setting after a change.
+ *
+ * This function refreshes the effective value and the digest of the
+ * setting and marks its record as changed for the next snapshot and
+ * the next save.
+ *
+ * \param[in] id  The identifier of the setting which changed.
+ */
+void settings::refresh(setting_id_t id)
+{
+    settings_table::entry & e(f_values.get_entry(id));
+    e.refresh_effective();
+    f_hash_tree.update(id, e.get_name(), e.get_values());
+
+    if(id >= f_dirty_flags.size())
+    {
+        f_dirty_flags.resize(f_values.size());
+    }
+    if(!f_dirty_flags[id])
+    {
+        f_dirty_flags[id] = true;
+        f_dirty.push_back(id);
+    }
+    f_snapshot_dirty = true;
+
+    mark_unsaved(id);
+}
+
+
+/** \brief Mark a setting as having to be saved.
+ *
+ * \param[in] id  The identifier of the setting to save.
+ */
+void settings::mark_unsaved(setting_id_t id)
+{
+    if(id >= f_unsaved_flags.size())
+    {
+        f_unsaved_flags.resize(f_values.size());
+    }
+    if(!f_unsaved_flags[id])
+    {
+        f_unsaved_flags[id] = true;
+        f_unsaved.push_back(id);
+    }
+}
+
+
+/** \brief Create a new snapshot.
+ *
+ * The chunks with at least one modified record get copied and their
+ * modified records recreated. The other chunks are shared with the
+ * previous snapshot.
+ *
+ * The new snapshot gets published atomically so current_snapshot() can
+ * be called from other threads at any time.
+ */
+void settings::publish()
+{
+    std::size_t const size(f_values.size());
+    std::size_t const count((size + snapshot::CHUNK_SIZE - 1) / snapshot::CHUNK_SIZE);
+    while(f_chunks.size() < count)
+    {
+        f_chunks.push_back(std::make_shared<snapshot::chunk_t const>());
+    }
+
+    std::sort(f_dirty.begin(), f_dirty.end());
+    for(auto it(f_dirty.begin()); it != f_dirty.end(); )
+    {
+        std::size_t const chunk(*it / snapshot::CHUNK_SIZE);
+        std::shared_ptr<snapshot::chunk_t> copy(std::make_shared<snapshot::chunk_t>(*f_chunks[chunk]));
+        for(; it != f_dirty.end() && *it / snapshot::CHUNK_SIZE == chunk; ++it)
+        {
+            (*copy)[*it % snapshot::CHUNK_SIZE] = snapshot::make_record(f_values.get_entry(*it));
+            f_dirty_flags[*it] = false;
+        }
+        f_chunks[chunk] = copy;
+    }
+    f_dirty.clear();
+
+    ++f_snapshot_version;
+    std::atomic_store(
+          &f_snapshot
+        , std::make_shared<snapshot const>(
+                  f_snapshot_version
+                , size
+                , f_chunks
+                , f_options));
+    f_snapshot_dirty = false;
+}
+
+
+/** \brief Search the definition files found in one directory.
+ *
+ * \param[in] path  The directory to search.
+ * \param[in,out] files  The list where the files found get appended.
+ *
+ * \return true if at least one file was found.
+ */
+bool settings::find_definition_files(
+      std::string const & path
+    , advgetopt::string_list_t & files)
+{
+    snapdev::glob_to_list<std::list<std::string>> found;
+    if(!found.read_path<>(path + '/' + g_definitions_pattern))
+    {
+        SNAP_LOG_WARNING
+            << "no fluid-settings definition files found in \""
+            << path
+            << "\" (with pattern \""
+            << g_definitions_pattern
+            << "\")."
+            << SNAP_LOG_SEND;
+        return false;
+    }
+
+    files.insert(files.end(), found.begin(), found.end());
+
     return true;
 }
 
 
+/** \brief Get the fingerprint of the definition of a setting.
+ *
+ * \param[in] name  The canonicalized name of the setting.
+ *
+ * \return The fingerprint of the parameters of the file defining that
+ * setting or 0.
+ */
+std::uint32_t settings::get_definition(std::string const & name) const
+{
+    auto const it(f_definitions.find(name));
+    if(it == f_definitions.end())
+    {
+        return 0;
+    }
+    return it->second;
+}
+
+
 /** \brief Retrieve the list of options.
  *
  * This function reads all the option names and return a comma separated
@@ -241,7 +520,181 @@ std::string settings::list_of_options()
 }
 
 
+/** \brief Resolve a setting name to its identifier.
+ *
+ * This function canonicalizes the \p name (i.e. replaces underscores with
+ * dashes) and searches for the corresponding definition. If the setting
+ * is defined, the function returns its identifier which can then be used
+ * with all the other functions accepting a setting_id_t.
+ *
+ * The identifier remains valid for the lifetime of the settings object,
+ * even if the definitions get reloaded. This allows callers to resolve a
+ * name once and avoid the string manipulations and searches on each
+ * subsequent access.
+ *
+ * \param[in] name  The name of the setting to resolve.
+ *
+ * \return The setting identifier or INVALID_SETTING_ID if the name is not
+ * defined.
+ */
+setting_id_t settings::resolve(std::string name)
+{
+    if(f_opts == nullptr)
+    {
+        return INVALID_SETTING_ID;
+    }
+
+    std::replace(name.begin(), name.end(), '_', '-');
+    setting_id_t const id(f_values.find(name));
+    if(id != INVALID_SETTING_ID)
+    {
+        return id;
+    }
+
+    advgetopt::option_info::pointer_t o(f_opts->get_option(name));
+    if(o == nullptr)
+    {
+        return INVALID_SETTING_ID;
+    }
+
+    setting_id_t const new_id(f_values.intern(name));
+    settings_table::entry & e(f_values.get_entry(new_id));
+    e.set_option(o);
+    e.set_definition(get_definition(name));
+    refresh(new_id);
+    return new_id;
+}
+
+
+/** \brief Get the name of a setting from its identifier.
+ *
+ * This function returns the canonicalized name of the setting with
+ * identifier \p id.
+ *
+ * \param[in] id  A valid setting identifier as returned by resolve().
+ *
+ * \return A reference to the name of the setting.
+ */
+std::string const & settings::get_name(setting_id_t id) const
+{
+    return f_values.get_entry(id).get_name();
+}
+
+
+/** \brief Get the memoized effective value of a setting.
+ *
+ * This function gives direct access to the effective value record of a
+ * setting: the value with the highest priority or the default value.
+ * The record also includes the priority of that value and a version
+ * which gets incremented each time the record is recalculated.
+ *
+ * \warning
+ * The returned pointer is only valid until the next call to a function
+ * modifying the settings (set_value(), reset_setting(), resolve(), etc.)
+ *
+ * \param[in] id  The identifier of the setting.
+ *
+ * \return A pointer to the effective value or nullptr if \p id is not
+ * a valid setting identifier or the setting is not defined anymore.
+ */
+settings_table::effective_t const * settings::get_effective(setting_id_t id) const
+{
+    if(id >= f_values.size())
+    {
+        return nullptr;
+    }
+    settings_table::entry const & e(f_values.get_entry(id));
+    if(e.get_option() == nullptr)
+    {
+        return nullptr;
+    }
+    return &e.get_effective();
+}
+
+
+/** \brief Get all the values of a setting.
+ *
+ * This function gives direct access to the values of a setting, one
+ * per priority.
+ *
+ * \warning
+ * The returned pointer is only valid until the next call to a function
+ * modifying the settings.
+ *
+ * \param[in] id  The identifier of the setting.
+ *
+ * \return A pointer to the values or nullptr if \p id is not a valid
+ * setting identifier.
+ */
+priority_set const * settings::get_values(setting_id_t id) const
+{
+    if(id >= f_values.size())
+    {
+        return nullptr;
+    }
+    return &f_values.get_entry(id).get_values();
+}
+
+
+/** \brief Get the current snapshot of the settings.
+ *
+ * This function returns a read-only copy of the settings. If the settings
+ * changed since the last call, a new snapshot gets created first. Only
+ * the chunks of records which changed are copied.
+ *
+ * The snapshot can then be passed to other threads. It remains valid for
+ * as long as someone holds a pointer to it.
+ *
+ * \warning
+ * This function must be called by the thread modifying the settings.
+ * Other threads can use current_snapshot() instead.
+ *
+ * \return A pointer to the latest snapshot.
+ */
+snapshot::pointer_t settings::get_snapshot()
+{
+    if(f_snapshot_dirty
+    || f_snapshot == nullptr)
+    {
+        publish();
+    }
+    return f_snapshot;
+}
+
+
+/** \brief Get the last published snapshot.
+ *
+ * This function can be called from any thread. It returns the snapshot
+ * which was last published by get_snapshot(). Changes made since then
+ * are not visible in that snapshot.
+ *
+ * \return A pointer to the last published snapshot, may be nullptr.
+ */
+snapshot::pointer_t settings::current_snapshot() const
+{
+    return std::atomic_load(&f_snapshot);
+}
+
+
 /** \brief Retrieved the default setting of the named value.
+ *
+ * This function resolves the name and then calls the get_default_value()
+ * accepting a setting identifier.
+ *
+ * \param[in] name  The name of the value to retrieve.
+ * \param[out] result  The variable where the default value gets saved.
+ *
+ * \return One of the get_result_t::GET_RESULT_... values.
+ */
+get_result_t settings::get_default_value(
+      std::string name
+    , std::string & result)
+{
+    return get_default_value(resolve(name), result);
+}
+
+
+/** \brief Retrieved the default setting of a value.
  *
  * This function searches for a value in the existing settings and return
  * its default setting.
@@ -249,23 +702,26 @@ std::string settings::list_of_options()
  * On success, the function returns get_result_t::GET_RESULT_DEFAULT and
  * sets the \p result variable to the default value.
  *
- * If the named setting does not have a default value, then the function
+ * If the setting does not have a default value, then the function
  * returns get_result_t::GET_RESULT_NOT_SET.
  *
- * If the named value does not exist, then get_result_t::GET_RESULT_UNKNOWN
+ * If the setting is not defined, then get_result_t::GET_RESULT_UNKNOWN
  * is returned.
  *
- * \param[in] name  The name of the value to retrieve.
+ * \param[in] id  The identifier of the value to retrieve.
  * \param[out] result  The variable where the default value gets saved.
  *
  * \return One of the get_result_t::GET_RESULT_... values.
  */
 get_result_t settings::get_default_value(
-      std::string name
+      setting_id_t id
     , std::string & result)
 {
-    std::replace(name.begin(), name.end(), '_', '-');
-    advgetopt::option_info::pointer_t o(f_opts->get_option(name));
+    if(id >= f_values.size())
+    {
+        return get_result_t::GET_RESULT_UNKNOWN;
+    }
+    advgetopt::option_info::pointer_t const & o(f_values.get_entry(id).get_option());
     if(o == nullptr)
     {
         return get_result_t::GET_RESULT_UNKNOWN;
@@ -281,6 +737,28 @@ get_result_t settings::get_default_value(
 }
 
 
+/** \brief Retrieved the named value.
+ *
+ * This function resolves the name and then calls the get_value()
+ * accepting a setting identifier.
+ *
+ * \param[in] name  The name of the value to retrieve.
+ * \param[out] result  The variable where the value gets saved.
+ * \param[in] priority  The value at that specific priority.
+ * \param[in] all  All the values are returned if true.
+ *
+ * \return One of the get_result_t::GET_RESULT_... values.
+ */
+get_result_t settings::get_value(
+      std::string name
+    , std::string & result
+    , priority_t priority
+    , bool all)
+{
+    return get_value(resolve(name), result, priority, all);
+}
+
+
 /** \brief Retrieved the named value.
  *
  * This function searches for a value in the existing settings.
@@ -320,333 +798,1519 @@ get_result_t settings::get_default_value(
  * \note
  * If \p all is set to true, then the \p priority parameter is ignored.
  *
- * \param[in] name  The name of the value to retrieve.
+ * \param[in] id  The identifier of the setting to retrieve.
  * \param[out] result  The variable where the value gets saved.
  * \param[in] priority  The value at that specific priority.
  * \param[in] all  All the values are returned if true.
  *
- * \return true if a value was found, false otherwise.
+ * \return One of the get_result_t::GET_RESULT_... values.
  */
 get_result_t settings::get_value(
-      std::string name
+      setting_id_t id
     , std::string & result
     , priority_t priority
     , bool all)
 {
-    std::replace(name.begin(), name.end(), '_', '-');
-    advgetopt::option_info::pointer_t o(f_opts->get_option(name));
+    if(id >= f_values.size())
+    {
+        return get_result_t::GET_RESULT_UNKNOWN;
+    }
+    settings_table::entry const & e(f_values.get_entry(id));
+    advgetopt::option_info::pointer_t const & o(e.get_option());
     if(o == nullptr)
     {
         return get_result_t::GET_RESULT_UNKNOWN;
     }
 
-    if(!o->is_defined())
+    // the effective value (highest priority or default) is memoized
+    // in the entry so the most common GET is a single access
+    //
+    settings_table::effective_t const & effective(e.get_effective());
+    if(!effective.f_is_set)
     {
-        if(o->has_default())
+        return get_result_t::GET_RESULT_NOT_SET;
+    }
+
+    priority_set const & values(e.get_values());
+    if(values.empty()
+    || (!all && priority == HIGHEST_PRIORITY))
+    {
+        result = *effective.f_value;
+        return effective.f_is_default
+                    ? get_result_t::GET_RESULT_DEFAULT
+                    : get_result_t::GET_RESULT_SUCCESS;
+    }
+
+    if(all)
+    {
+        result.clear();
+        for(auto const & v : values)
+        {
+            if(!result.empty())
+            {
+                result += ',';
+            }
+            escape_commas(result, v.get_value());
+        }
+    }
+    else
+    {
+        // a specific priority was give, search for that item
+        //
+        value const * vp(values.find(priority));
+        if(vp == nullptr)
+        {
+            return get_result_t::GET_RESULT_PRIORITY_NOT_FOUND;
+        }
+        result = vp->get_value();
+    }
+
+    return get_result_t::GET_RESULT_SUCCESS;
+}
+
+
+/** \brief Retrieve a value without copying it.
+ *
+ * This function works like get_value() except that it returns the shared
+ * immutable buffer holding the value instead of a copy. The buffer remains
+ * valid for as long as the caller holds on to it, even if the setting gets
+ * modified or reset in the meantime.
+ *
+ * This is the function to use to build replies and notifications since
+ * values can be large (certificates, long lists of hosts, etc.)
+ *
+ * The function does not support the `all` mode since that one has to
+ * build a new string anyway.
+ *
+ * \param[in] id  The identifier of the setting to retrieve.
+ * \param[out] result  The shared buffer with the value.
+ * \param[in] priority  The value at that specific priority.
+ *
+ * \return One of the get_result_t::GET_RESULT_... values.
+ */
+get_result_t settings::get_buffer(
+      setting_id_t id
+    , value::buffer_t & result
+    , priority_t priority) const
+{
+    if(id >= f_values.size())
+    {
+        return get_result_t::GET_RESULT_UNKNOWN;
+    }
+    settings_table::entry const & e(f_values.get_entry(id));
+    if(e.get_option() == nullptr)
+    {
+        return get_result_t::GET_RESULT_UNKNOWN;
+    }
+
+    settings_table::effective_t const & effective(e.get_effective());
+    if(!effective.f_is_set)
+    {
+        return get_result_t::GET_RESULT_NOT_SET;
+    }
+
+    if(priority == HIGHEST_PRIORITY
+    || e.get_values().empty())
+    {
+        result = effective.f_value;
+        return effective.f_is_default
+                    ? get_result_t::GET_RESULT_DEFAULT
+                    : get_result_t::GET_RESULT_SUCCESS;
+    }
+
+    value const * vp(e.get_values().find(priority));
+    if(vp == nullptr)
+    {
+        return get_result_t::GET_RESULT_PRIORITY_NOT_FOUND;
+    }
+    result = vp->get_buffer();
+
+    return get_result_t::GET_RESULT_SUCCESS;
+}
+
+
+/** \brief Set the named value.
+ *
+ * This function resolves the name and then calls the set_value()
+ * accepting a setting identifier.
+ *
+ * \param[in] name  The name of the value to change.
+ * \param[in] new_value  The new value.
+ * \param[in] priority  The priority of the new value.
+ * \param[in] timestamp  The time when the value was set.
+ *
+ * \return One of the set_result_t::SET_RESULT_... values.
+ */
+set_result_t settings::set_value(
+      std::string name
+    , std::string const & new_value
+    , int priority
+    , timestamp_t const & timestamp)
+{
+    return set_value(resolve(name), new_value, priority, timestamp);
+}
+
+
+/** \brief Set a value.
+ *
+ * This function verifies the new value against the setting definition
+ * and, if valid, saves it at the specified \p priority unless a value
+ * with a more recent \p timestamp is already defined at that priority.
+ *
+ * \param[in] id  The identifier of the value to change.
+ * \param[in] new_value  The new value.
+ * \param[in] priority  The priority of the new value.
+ * \param[in] timestamp  The time when the value was set.
+ *
+ * \return One of the set_result_t::SET_RESULT_... values.
+ */
+set_result_t settings::set_value(
+      setting_id_t id
+    , std::string const & new_value
+    , int priority
+    , timestamp_t const & timestamp)
+{
+    set_result_t const result(store_value(id, new_value, priority, timestamp));
+    switch(result)
+    {
+    case set_result_t::SET_RESULT_NEW:
+    case set_result_t::SET_RESULT_NEW_PRIORITY:
+    case set_result_t::SET_RESULT_CHANGED:
+        refresh(id);
+        break;
+
+    default:
+        break;
+
+    }
+
+    return result;
+}
+
+
+/** \brief Apply a set of changes at once.
+ *
+ * This function applies each mutation found in \p batch as set_value()
+ * would. The names are resolved once per run of mutations to the same
+ * setting and the effective value of each setting is recalculated once
+ * at the end instead of once per mutation.
+ *
+ * The identifiers of the settings whose effective value may have changed
+ * are added to \p changes which gets sorted and made unique. This allows
+ * the caller to send one notification per setting for the entire batch.
+ *
+ * \param[in] batch  The list of mutations to apply, in order.
+ * \param[in,out] changes  The set of settings which changed.
+ *
+ * \return One result per mutation, in the same order as \p batch.
+ */
+set_result_vector_t settings::apply_batch(
+      mutation_vector_t const & batch
+    , change_set_t & changes)
+{
+    set_result_vector_t results;
+    results.reserve(batch.size());
+
+    std::string const * last_name(nullptr);
+    setting_id_t last_id(INVALID_SETTING_ID);
+    for(auto const & m : batch)
+    {
+        setting_id_t id(m.f_id);
+        if(id == INVALID_SETTING_ID)
+        {
+            if(last_name == nullptr
+            || *last_name != m.f_name)
+            {
+                last_name = &m.f_name;
+                last_id = resolve(m.f_name);
+            }
+            id = last_id;
+        }
+
+        set_result_t const result(store_value(id, m.f_value, m.f_priority, m.f_timestamp));
+        switch(result)
+        {
+        case set_result_t::SET_RESULT_NEW:
+        case set_result_t::SET_RESULT_NEW_PRIORITY:
+        case set_result_t::SET_RESULT_CHANGED:
+            changes.push_back(id);
+            break;
+
+        default:
+            break;
+
+        }
+        results.push_back(result);
+    }
+
+    std::sort(changes.begin(), changes.end());
+    changes.erase(std::unique(changes.begin(), changes.end()), changes.end());
+
+    for(auto const id : changes)
+    {
+        refresh(id);
+    }
+
+    return results;
+}
+
+
+/** \brief Replace all the values of a setting.
+ *
+ * This function removes all the values of the setting and then saves
+ * the ones found in \p values. It is used to restore the state of a
+ * setting as it was saved in the journal. The f_id and f_name fields of
+ * the mutations are ignored.
+ *
+ * Values which do not validate anymore (the definition changed) are
+ * dropped.
+ *
+ * \param[in] id  The identifier of the setting to restore.
+ * \param[in] values  The values of the setting, one per priority.
+ * \param[in,out] changes  The set of settings which changed.
+ */
+void settings::restore_values(
+      setting_id_t id
+    , mutation_vector_t const & values
+    , change_set_t & changes)
+{
+    if(id >= f_values.size()
+    || f_values.get_entry(id).get_option() == nullptr)
+    {
+        return;
+    }
+
+    priority_set & current(f_values.get_entry(id).get_values());
+    priority_set const before(current);
+    current.clear();
+    for(auto const & m : values)
+    {
+        store_value(id, m.f_value, m.f_priority, m.f_timestamp, false);
+    }
+    if(f_history.get_depth() > 0)
+    {
+        // store_value() saw an empty set so it cannot tell what changed;
+        // compare with the values we had before instead
+        //
+        for(auto const & v : before)
+        {
+            value const * vp(current.find(v.get_priority()));
+            if(vp == nullptr)
+            {
+                record_history(id, v.get_priority(), timestamp_t::gettime(), v.get_buffer(), value::buffer_t());
+            }
+            else if(vp->get_value() != v.get_value())
+            {
+                record_history(id, v.get_priority(), vp->get_timestamp(), v.get_buffer(), vp->get_buffer());
+            }
+        }
+        for(auto const & v : current)
+        {
+            if(!before.has(v.get_priority()))
+            {
+                record_history(id, v.get_priority(), v.get_timestamp(), value::buffer_t(), v.get_buffer());
+            }
+        }
+    }
+    refresh(id);
+
+    auto const it(std::lower_bound(changes.begin(), changes.end(), id));
+    if(it == changes.end()
+    || *it != id)
+    {
+        changes.insert(it, id);
+    }
+}
+
+
+/** \brief Save a value without refreshing the effective value.
+ *
+ * This function does the work of set_value() except for the call to
+ * refresh() which is left to the caller. This way apply_batch() can
+ * refresh each setting once.
+ *
+ * \param[in] id  The identifier of the value to change.
+ * \param[in] new_value  The new value.
+ * \param[in] priority  The priority of the new value.
+ * \param[in] timestamp  The time when the value was set.
+ * \param[in] history  Whether the change gets recorded in the history.
+ *
+ * \return One of the set_result_t::SET_RESULT_... values.
+ */
+set_result_t settings::store_value(
+      setting_id_t id
+    , std::string const & new_value
+    , int priority
+    , timestamp_t const & timestamp
+    , bool history)
+{
+    if(id >= f_values.size())
+    {
+        // value not defined at all
+        //
+        return set_result_t::SET_RESULT_UNKNOWN;
+    }
+    settings_table::entry & e(f_values.get_entry(id));
+    advgetopt::option_info::pointer_t const & o(e.get_option());
+    if(o == nullptr)
+    {
+        // value not defined anymore
+        //
+        return set_result_t::SET_RESULT_UNKNOWN;
+    }
+
+    // set_value() throws on those, which would stop a batch half way
+    //
+    if(!value::is_valid(priority, timestamp))
+    {
+        return set_result_t::SET_RESULT_ERROR;
+    }
+
+    // the validator is cached in the entry; this does not modify the
+    // option so f_opts remains untouched
+    //
+    if(!e.validate(new_value))
+    {
+        // value not accepted by the validator
+        //
+        return set_result_t::SET_RESULT_ERROR;
+    }
+
+    value v;
+    v.set_value(f_values.make_buffer(new_value), priority, timestamp);
+
+    priority_set & values(e.get_values());
+    if(values.empty())
+    {
+        // no such value yet, just save that value_priority as is
+        //
+        values.insert(v);
+        if(history)
+        {
+            record_history(id, priority, timestamp, value::buffer_t(), v.get_buffer());
+        }
+        return set_result_t::SET_RESULT_NEW;
+    }
+
+    value * vp(values.find(priority));
+    if(vp == nullptr)
+    {
+        // not there yet, just insert
+        //
+        values.insert(v);
+        if(history)
+        {
+            record_history(id, priority, timestamp, value::buffer_t(), v.get_buffer());
+        }
+        return set_result_t::SET_RESULT_NEW_PRIORITY;
+    }
+
+    if(timestamp > vp->get_timestamp())
+    {
+        // it was already there, but message value is more recent
+        // than stored value so keep the newer one
+        //
+        set_result_t const result(v.get_value() == vp->get_value()
+                                ? set_result_t::SET_RESULT_NEWER
+                                : set_result_t::SET_RESULT_CHANGED);
+        if(history
+        && result == set_result_t::SET_RESULT_CHANGED)
+        {
+            record_history(id, priority, timestamp, vp->get_buffer(), v.get_buffer());
+        }
+        *vp = v;
+        return result;
+    }
+
+    return set_result_t::SET_RESULT_UNCHANGED;
+}
+
+
+/** \brief Reset the named value.
+ *
+ * This function resolves the name and then calls the reset_setting()
+ * accepting a setting identifier.
+ *
+ * \param[in] name  The name of the value to reset.
+ * \param[in] priority  The priority of the value to remove.
+ *
+ * \return true if a value was removed.
+ */
+bool settings::reset_setting(
+      std::string name
+    , priority_t priority)
+{
+    return reset_setting(resolve(name), priority);
+}
+
+
+/** \brief Reset a value.
+ *
+ * This function removes the value defined at \p priority.
+ *
+ * \param[in] id  The identifier of the value to reset.
+ * \param[in] priority  The priority of the value to remove.
+ *
+ * \return true if a value was removed.
+ */
+bool settings::reset_setting(
+      setting_id_t id
+    , priority_t priority)
+{
+    if(id >= f_values.size())
+    {
+        return false;
+    }
+    settings_table::entry & e(f_values.get_entry(id));
+    if(e.get_option() == nullptr)
+    {
+        return false;
+    }
+
+    value const * vp(e.get_values().find(priority));
+    if(vp == nullptr)
+    {
+        return false;
+    }
+    record_history(id, priority, timestamp_t::gettime(), vp->get_buffer(), value::buffer_t());
+
+    // note: the entry remains in the table even once empty, that way
+    //       its identifier does not change
+    //
+    e.get_values().erase(priority);
+    refresh(id);
+
+    return true;
+}
+
+
+/** \brief Set the number of changes kept per setting.
+ *
+ * The history is disabled by default (a depth of 0). The daemon enables
+ * it once the settings were loaded so the initial values do not fill
+ * the history.
+ *
+ * \param[in] depth  The maximum number of changes kept per setting.
+ */
+void settings::set_history_depth(std::size_t depth)
+{
+    f_history.set_depth(depth);
+}
+
+
+/** \brief Get the current revision of the settings.
+ *
+ * Each change to a value, while the history is enabled, gets a new
+ * revision.
+ *
+ * \return The revision of the last change.
+ */
+history::revision_t settings::get_revision() const
+{
+    return f_history.get_revision();
+}
+
+
+/** \brief Get the statistics of the history.
+ *
+ * \return The statistics of the history.
+ */
+history::stats_t settings::get_history_stats() const
+{
+    return f_history.get_stats();
+}
+
+
+/** \brief Get the hash tree of the settings.
+ *
+ * The hash tree is kept up to date each time a value changes. It is
+ * used to compare the settings with another fluid-settings.
+ *
+ * \return A reference to the hash tree.
+ */
+hash_tree const & settings::get_hash_tree() const
+{
+    return f_hash_tree;
+}
+
+
+/** \brief Get the value a setting had at an earlier point.
+ *
+ * This function returns the effective value setting \p id had at
+ * \p revision or at \p timestamp, whichever comes first. When no value
+ * was set at the time, the current default value is returned.
+ *
+ * \param[in] id  The identifier of the setting.
+ * \param[out] result  The value at that point.
+ * \param[in] revision  The revision to look at.
+ * \param[in] timestamp  The time to look at.
+ *
+ * \return One of the get_result_t::GET_RESULT_... values;
+ * GET_RESULT_ERROR if the history does not go back that far.
+ */
+get_result_t settings::get_value_at(
+      setting_id_t id
+    , std::string & result
+    , history::revision_t revision
+    , timestamp_t const & timestamp)
+{
+    if(id >= f_values.size()
+    || f_values.get_entry(id).get_option() == nullptr)
+    {
+        return get_result_t::GET_RESULT_UNKNOWN;
+    }
+
+    std::map<priority_t, value::buffer_t> values;
+    if(!values_at(id, revision, timestamp, values))
+    {
+        return get_result_t::GET_RESULT_ERROR;
+    }
+    if(values.empty())
+    {
+        return get_default_value(id, result);
+    }
+
+    result = *values.rbegin()->second;
+    return get_result_t::GET_RESULT_SUCCESS;
+}
+
+
+/** \brief Restore the settings of a namespace as they were at a revision.
+ *
+ * The settings named \p name_space or starting with \p name_space
+ * followed by "::" get their values restored as they were at
+ * \p revision. An empty \p name_space means all the settings. Only the
+ * settings which changed since that revision are visited.
+ *
+ * The restored values get the current time as their timestamp since
+ * the rollback is a new change. Values which are not valid with the
+ * current definition are not restored.
+ *
+ * Nothing is changed if the history of one of the settings does not go
+ * back to \p revision.
+ *
+ * \param[in] name_space  The namespace of the settings to restore.
+ * \param[in] revision  The revision to go back to.
+ * \param[in,out] changes  The set of settings which changed.
+ *
+ * \return true if the settings were restored.
+ */
+bool settings::rollback(
+      std::string const & name_space
+    , history::revision_t revision
+    , change_set_t & changes)
+{
+    std::string const prefix(name_space + "::");
+    std::vector<setting_id_t> ids;
+    f_history.changed_since(revision, ids);
+
+    std::vector<std::pair<setting_id_t, std::map<priority_t, value::buffer_t>>> targets;
+    for(auto const id : ids)
+    {
+        std::string const & name(f_values.get_entry(id).get_name());
+        if(!name_space.empty()
+        && name != name_space
+        && name.compare(0, prefix.length(), prefix) != 0)
+        {
+            continue;
+        }
+
+        std::map<priority_t, value::buffer_t> values;
+        if(!values_at(id, revision, timestamp_t(std::numeric_limits<std::int64_t>::max()), values))
+        {
+            SNAP_LOG_ERROR
+                << "the history of \""
+                << name
+                << "\" does not go back to revision "
+                << revision
+                << "; rollback canceled."
+                << SNAP_LOG_SEND;
+            return false;
+        }
+        targets.emplace_back(id, std::move(values));
+    }
+
+    timestamp_t const now(timestamp_t::gettime());
+    for(auto const & t : targets)
+    {
+        setting_id_t const id(t.first);
+        settings_table::entry & e(f_values.get_entry(id));
+        if(e.get_option() == nullptr)
+        {
+            continue;
+        }
+        priority_set & current(e.get_values());
+
+        std::vector<priority_t> removed;
+        for(auto const & v : current)
+        {
+            if(t.second.find(v.get_priority()) == t.second.end())
+            {
+                removed.push_back(v.get_priority());
+            }
+        }
+        bool changed(!removed.empty());
+        for(auto const p : removed)
+        {
+            record_history(id, p, now, current.find(p)->get_buffer(), value::buffer_t());
+            current.erase(p);
+        }
+
+        for(auto const & v : t.second)
+        {
+            value * vp(current.find(v.first));
+            if(vp != nullptr
+            && vp->get_value() == *v.second)
+            {
+                continue;
+            }
+            if(!e.validate(*v.second))
+            {
+                SNAP_LOG_WARNING
+                    << "value \""
+                    << *v.second
+                    << "\" of \""
+                    << e.get_name()
+                    << "\" at priority "
+                    << v.first
+                    << " is not valid with the current definition; it was not restored."
+                    << SNAP_LOG_SEND;
+                continue;
+            }
+            value n;
+            n.set_trusted_value(v.second, v.first, now);
+            record_history(id, v.first, now, vp == nullptr ? value::buffer_t() : vp->get_buffer(), v.second);
+            if(vp == nullptr)
+            {
+                current.insert(n);
+            }
+            else
+            {
+                *vp = n;
+            }
+            changed = true;
+        }
+        if(!changed)
+        {
+            continue;
+        }
+        refresh(id);
+
+        auto const it(std::lower_bound(changes.begin(), changes.end(), id));
+        if(it == changes.end()
+        || *it != id)
+        {
+            changes.insert(it, id);
+        }
+    }
+
+    return true;
+}
+
+
+/** \brief Record a change in the history.
+ *
+ * The \p timestamp is the one of the new value so the history agrees
+ * with the timestamps replicated between fluid-settings. A value which
+ * gets removed has no timestamp of its own so the current time is
+ * used instead.
+ *
+ * \param[in] id  The identifier of the setting which changed.
+ * \param[in] priority  The priority of the value which changed.
+ * \param[in] timestamp  The time of the change.
+ * \param[in] before  The previous value or nullptr.
+ * \param[in] after  The new value or nullptr.
+ */
+void settings::record_history(
+      setting_id_t id
+    , priority_t priority
+    , timestamp_t const & timestamp
+    , value::buffer_t const & before
+    , value::buffer_t const & after)
+{
+    if(f_history.get_depth() == 0)
+    {
+        return;
+    }
+
+    f_history.record(id, priority, timestamp, before, after);
+}
+
+
+/** \brief Compute the values a setting had at an earlier point.
+ *
+ * The changes made after that point are undone, newest first, over a
+ * copy of the current values.
+ *
+ * \param[in] id  The identifier of the setting.
+ * \param[in] revision  The revision to go back to.
+ * \param[in] timestamp  The time to go back to.
+ * \param[out] values  The values at that point, by priority.
+ *
+ * \return false if the history does not go back that far.
+ */
+bool settings::values_at(
+      setting_id_t id
+    , history::revision_t revision
+    , timestamp_t const & timestamp
+    , std::map<priority_t, value::buffer_t> & values) const
+{
+    history::event_vector_t events;
+    if(!f_history.get_events(id, revision, timestamp, events))
+    {
+        return false;
+    }
+
+    values.clear();
+    for(auto const & v : f_values.get_entry(id).get_values())
+    {
+        values[v.get_priority()] = v.get_buffer();
+    }
+    for(auto it(events.rbegin()); it != events.rend(); ++it)
+    {
+        if(it->f_before == nullptr)
+        {
+            values.erase(it->f_priority);
+        }
+        else
+        {
+            values[it->f_priority] = it->f_before;
+        }
+    }
+
+    return true;
+}
+
+
+void settings::load(std::string const & filename)
+{
+    advgetopt::conf_file_setup setup(
+                  filename
+                , advgetopt::line_continuation_t::line_continuation_unix
+                , advgetopt::ASSIGNMENT_OPERATOR_EQUAL
+                , advgetopt::COMMENT_INI | advgetopt::COMMENT_SHELL
+                , advgetopt::SECTION_OPERATOR_CPP);
+    advgetopt::conf_file::pointer_t data(advgetopt::conf_file::get_conf_file(setup));
+
+    mutation_vector_t batch;
+    batch.reserve(data->get_parameters().size());
+    for(auto const & p : data->get_parameters())
+    {
+        std::vector<std::string> sections;
+        snapdev::tokenize_string(sections, p.first, { "::" }, true);
+        std::int64_t priority(0);
+        advgetopt::validator_integer::convert_string(sections.back(), priority);
+        sections.pop_back();
+        std::string const & value(p.second.get_value());
+        std::string::size_type const pos(value.find('|'));
+        if(pos == std::string::npos)
+        {
+            SNAP_LOG_ERROR
+                << "found value \""
+                << value
+                << "\" in parameter \""
+                << p.first
+                << "\" without a | to separate the timestamp from the value."
+                << SNAP_LOG_SEND;
+            continue;
+        }
+        std::int64_t timestamp_nsec(0);
+        advgetopt::validator_integer::convert_string(value.substr(0, pos), timestamp_nsec);
+
+        mutation_t m;
+        m.f_name = snapdev::join_strings(sections, "::");
+        m.f_priority = static_cast<priority_t>(priority);
+        m.f_timestamp = timestamp_t(timestamp_nsec);
+        unescape_value(m.f_value, std::string_view(value).substr(pos + 1));
+        batch.push_back(std::move(m));
+    }
+
+    // the parameters are sorted by name so all the priorities of one
+    // setting follow each other and get resolved once
+    //
+    change_set_t changes;
+    apply_batch(batch, changes);
+}
+
+
+/** \brief Export the settings to a text file.
+ *
+ * This function exports the current settings. See export_conf() for
+ * details.
+ *
+ * \param[in] filename  The name of the text file.
+ */
+void settings::save(std::string const & filename)
+{
+    export_conf(*get_snapshot(), filename);
+}
+
+
+/** \brief Export a snapshot of the settings to a text file.
+ *
+ * The settings are written in the format expected by load():
+ *
+ * \code
+ *     <name>::<priority>=<timestamp>|<value>
+ * \endcode
+ *
+ * The value is escaped with escape_value() so it always fits on one line.
+ *
+ * The file is written, sorted by name, to a temporary file which gets
+ * synchronized to disk and then replaces \p filename. The previous
+ * version is kept with the ".bak" extension.
+ *
+ * This function only uses the snapshot so it can be called from any
+ * thread.
+ *
+ * \param[in] snap  The snapshot to export.
+ * \param[in] filename  The name of the text file.
+ * \param[out] error  If not nullptr, the errno of a failure is saved
+ * there instead of being logged (i.e. in a forked child).
+ *
+ * \return true if the file was saved.
+ */
+bool settings::export_conf(
+      snapshot const & snap
+    , std::string const & filename
+    , int * error)
+{
+    std::vector<setting_id_t> ids;
+    for(setting_id_t id(0); id < snap.size(); ++id)
+    {
+        snapshot::record_t const * r(snap.get_record(id));
+        if(r != nullptr
+        && r->f_values != nullptr)
+        {
+            ids.push_back(id);
+        }
+    }
+    std::sort(
+          ids.begin()
+        , ids.end()
+        , [&snap](setting_id_t a, setting_id_t b)
+          {
+              return *snap.get_record(a)->f_name < *snap.get_record(b)->f_name;
+          });
+
+    // the default warning of advgetopt is not going to cut it for
+    // fluid-settings since it mentions that you can safely edit the file
+    //
+    std::string out(
+        "# WARNING: AUTO-GENERATED FILE, DO NOT EDIT\n"
+        "#          see `man fluid-settings` for details\n");
+
+    // the values are escaped like in serialize_value() so a new line
+    // or a backslash does not break the format
+    //
+    char number[32];
+    for(auto const id : ids)
+    {
+        snapshot::record_t const * r(snap.get_record(id));
+        for(auto const & v : *r->f_values)
+        {
+            out += *r->f_name;
+            out += "::";
+            out.append(number, std::to_chars(number, number + sizeof(number), v.f_priority).ptr);
+            out += '=';
+            out.append(number, std::to_chars(number, number + sizeof(number), v.f_timestamp.to_nsec()).ptr);
+            out += FIELD_SEPARATOR;
+            escape_value(out, *v.f_value);
+            out += '\n';
+        }
+    }
+
+    // same steps as snapshot_file::save() so a crash leaves either the
+    // old or the new file, never a partial one
+    //
+    std::string const tmp(filename + ".tmp");
+    snapdev::raii_fd_t fd(::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0640));
+    if(fd == nullptr)
+    {
+        int const e(errno);
+        if(error != nullptr)
+        {
+            *error = e;
+        }
+        else
+        {
+            SNAP_LOG_ERROR
+                << "could not create \""
+                << tmp
+                << "\" (errno: "
+                << e
+                << ", "
+                << strerror(e)
+                << ")."
+                << SNAP_LOG_SEND;
+        }
+        return false;
+    }
+
+    if(!write_all(fd.get(), out)
+    || fsync(fd.get()) != 0)
+    {
+        int const e(errno);
+        if(error != nullptr)
+        {
+            *error = e;
+        }
+        else
+        {
+            SNAP_LOG_ERROR
+                << "could not write to \""
+                << tmp
+                << "\" (errno: "
+                << e
+                << ", "
+                << strerror(e)
+                << ")."
+                << SNAP_LOG_SEND;
+        }
+        fd.reset();
+        unlink(tmp.c_str());
+        return false;
+    }
+    fd.reset();
+
+    std::string const bak(filename + ".bak");
+    unlink(bak.c_str());
+    if(link(filename.c_str(), bak.c_str()) != 0
+    && errno != ENOENT
+    && error == nullptr)
+    {
+        SNAP_LOG_WARNING
+            << "could not create backup \""
+            << bak
+            << "\"."
+            << SNAP_LOG_SEND;
+    }
+    if(rename(tmp.c_str(), filename.c_str()) != 0)
+    {
+        int const e(errno);
+        if(error != nullptr)
+        {
+            *error = e;
+        }
+        else
+        {
+            SNAP_LOG_ERROR
+                << "could not rename \""
+                << tmp
+                << "\" to \""
+                << filename
+                << "\" (errno: "
+                << e
+                << ", "
+                << strerror(e)
+                << ")."
+                << SNAP_LOG_SEND;
+        }
+        unlink(tmp.c_str());
+        return false;
+    }
+
+    // make sure the rename() itself is on disk
+    //
+    std::string dir(filename);
+    snapdev::raii_fd_t dfd(::open(dirname(&dir[0]), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+    if(dfd != nullptr)
+    {
+        fsync(dfd.get());
+    }
+
+    return true;
+}
+
+
+/** \brief Load the settings from a binary file.
+ *
+ * This function reads the file with read_snapshot() and loads its
+ * content with load_snapshot(snapshot_content_t const &).
+ *
+ * \param[in] filename  The name of the binary file.
+ *
+ * \return true if the file or its backup was loaded.
+ */
+bool settings::load_snapshot(std::string const & filename)
+{
+    return load_snapshot(read_snapshot(filename));
+}
+
+
+/** \brief Read and decode a binary file.
+ *
+ * The binary file is memory mapped and its checksums verified before
+ * its records get decoded. If the file is not valid, the previous
+ * version of the file, saved with the ".bak" extension, gets read
+ * instead.
+ *
+ * This function does not access the settings so it can run in another
+ * thread, for example while the definitions get loaded.
+ *
+ * \param[in] filename  The name of the binary file.
+ *
+ * \return The content of the file; f_loaded is false if neither the file
+ * nor its backup could be read.
+ */
+snapshot_content_t settings::read_snapshot(std::string const & filename)
+{
+    snapshot_content_t content;
+    content.f_filename = filename;
+
+    std::unique_ptr<snapshot_file> file(std::make_unique<snapshot_file>(filename));
+    if(!file->load())
+    {
+        std::string const bak(filename + ".bak");
+        if(access(bak.c_str(), F_OK) != 0)
+        {
+            return content;
+        }
+        file = std::make_unique<snapshot_file>(bak);
+        if(!file->load())
+        {
+            return content;
+        }
+        content.f_backup = true;
+    }
+
+    content.f_records.reserve(file->size());
+    record_t r;
+    while(file->next(r))
+    {
+        content.f_records.push_back(std::move(r));
+    }
+    content.f_file_size = file->get_file_size();
+    content.f_base_size = file->get_base_size();
+    content.f_loaded = true;
+
+    return content;
+}
+
+
+/** \brief Load the settings read from a binary file.
+ *
+ * Values of settings which are not defined are ignored, as with load().
+ * The definitions must therefore be loaded first.
+ *
+ * If the content comes from the backup file, all the settings get marked
+ * as unsaved so the next save rewrites the whole file.
+ *
+ * \param[in] content  The content returned by read_snapshot().
+ *
+ * \return true if the content was loaded.
+ */
+bool settings::load_snapshot(snapshot_content_t const & content)
+{
+    if(!content.f_loaded)
+    {
+        return false;
+    }
+
+    // the values were validated before they were saved; if the definition
+    // of a setting did not change since, they are still valid and get
+    // loaded as is; otherwise they get validated later by
+    // verify_deferred()
+    //
+    change_set_t changes;
+    for(auto const & r : content.f_records)
+    {
+        setting_id_t const id(resolve(r.f_name));
+        if(id == INVALID_SETTING_ID)
         {
-            result = o->get_default();
-            return get_result_t::GET_RESULT_DEFAULT;
+            continue;
+        }
+        settings_table::entry & e(f_values.get_entry(id));
+        if(e.get_option() == nullptr)
+        {
+            continue;
+        }
+
+        priority_set & values(e.get_values());
+        values.clear();
+        for(auto const & m : r.f_values)
+        {
+            value v;
+            v.set_trusted_value(f_values.make_buffer(m.f_value), m.f_priority, m.f_timestamp);
+            values.insert(v);
+        }
+        refresh(id);
+        changes.push_back(id);
+
+        if(r.f_definition == 0
+        || r.f_definition != e.get_definition())
+        {
+            f_unverified.push_back(id);
         }
-        return get_result_t::GET_RESULT_NOT_SET;
     }
+    std::sort(changes.begin(), changes.end());
+    changes.erase(std::unique(changes.begin(), changes.end()), changes.end());
 
-    // the value is defined so we can retrieve it, "unfortunately" the
-    // advgetopt option_info object does not track priorities; there we
-    // instead save the latest which happens to be the values from the
-    // configuration file with the highest priority...
+    // what we just loaded is what is saved
     //
-    // in fluid-settings we have to have our own table because we want
-    // to save all the values with all of their priorities so here we
-    // do the necessary to retrieve the value with the highest priority
-    //
-    auto it(f_values.find(name));
-    if(it == f_values.end())
+    for(auto const id : f_unsaved)
     {
-        // weird, if o->is_defined() is true then we should have found this!?
-        //
-        return get_result_t::GET_RESULT_ERROR;
+        f_unsaved_flags[id] = false;
     }
-    if(it->second.empty())
+    f_unsaved.clear();
+
+    if(content.f_backup)
     {
-        // array of value is empty
+        SNAP_LOG_WARNING
+            << "settings file \""
+            << content.f_filename
+            << "\" is not valid; loaded its backup instead."
+            << SNAP_LOG_SEND;
+
+        // the file on disk is not valid, it cannot be appended to
         //
-        if(o->has_default())
+        f_snapshot_file_loaded = false;
+        for(auto const id : changes)
         {
-            result = o->get_default();
-            return get_result_t::GET_RESULT_DEFAULT;
+            mark_unsaved(id);
         }
-        return get_result_t::GET_RESULT_NOT_SET;
+        return true;
     }
 
-    if(all)
+    f_snapshot_file_loaded = true;
+    f_snapshot_file_size = content.f_file_size;
+    f_snapshot_base_size = content.f_base_size;
+
+    return true;
+}
+
+
+/** \brief Validate the values loaded without validation.
+ *
+ * The values loaded by load_snapshot() are not validated when the
+ * definition of their setting did not change since they were saved.
+ * The others get validated by this function, a few at a time, so the
+ * daemon can start serving requests right away.
+ *
+ * Values which are not valid anymore get removed. The settings which
+ * lost a value are added to \p changes.
+ *
+ * \param[in] count  The maximum number of settings to validate.
+ * \param[in,out] changes  The settings which changed.
+ *
+ * \return true if more settings remain to be validated.
+ */
+bool settings::verify_deferred(std::size_t count, change_set_t & changes)
+{
+    for(; count > 0 && !f_unverified.empty(); --count)
     {
-        result.clear();
-        for(auto const & v : it->second)
+        setting_id_t const id(f_unverified.back());
+        f_unverified.pop_back();
+
+        settings_table::entry & e(f_values.get_entry(id));
+        priority_set & values(e.get_values());
+        std::vector<priority_t> invalid;
+        for(auto const & v : values)
         {
-            if(!result.empty())
+            if(!e.validate(v.get_value()))
             {
-                result += ',';
+                SNAP_LOG_WARNING
+                    << "value \""
+                    << v.get_value()
+                    << "\" of \""
+                    << e.get_name()
+                    << "\" at priority "
+                    << v.get_priority()
+                    << " is not valid with its new definition; removing it."
+                    << SNAP_LOG_SEND;
+                invalid.push_back(v.get_priority());
             }
-            result += snapdev::string_replace_many(
-                              v.get_value()
-                            , { { ",", "\\," } });
         }
-    }
-    else if(priority == HIGHEST_PRIORITY)
-    {
-        // the default is to return the HIGHEST_PRIORITY
-        //
-        result = it->second.rbegin()->get_value();
-    }
-    else
-    {
-        // a specific priority was give, search for that item
-        //
-        value v;
-        timestamp_t const now(timestamp_t::gettime());
-        v.set_value(std::string(), priority, now);
-        auto vp(it->second.find(v));
-        if(vp == it->second.end())
+        if(!invalid.empty())
         {
-            return get_result_t::GET_RESULT_PRIORITY_NOT_FOUND;
+            for(auto const p : invalid)
+            {
+                record_history(id, p, timestamp_t::gettime(), values.find(p)->get_buffer(), value::buffer_t());
+                values.erase(p);
+            }
+            refresh(id);
+
+            auto const it(std::lower_bound(changes.begin(), changes.end(), id));
+            if(it == changes.end()
+            || *it != id)
+            {
+                changes.insert(it, id);
+            }
+        }
+        else
+        {
+            // the values were saved with the old definition; save them
+            // again so they do not get verified again on the next start
+            //
+            mark_unsaved(id);
         }
-        result = vp->get_value();
     }
 
-    return get_result_t::GET_RESULT_SUCCESS;
+    return !f_unverified.empty();
 }
 
 
-set_result_t settings::set_value(
-      std::string name
-    , std::string const & new_value
-    , int priority
-    , timestamp_t const & timestamp)
+/** \brief Check whether some values still need to be validated.
+ *
+ * \return true if verify_deferred() has work to do.
+ */
+bool settings::has_deferred() const
 {
-    std::replace(name.begin(), name.end(), '_', '-');
-    advgetopt::option_info::pointer_t o(f_opts->get_option(name));
-    if(o == nullptr)
-    {
-        // value not defined at all
-        //
-        return set_result_t::SET_RESULT_UNKNOWN;
-    }
-
-    o->set_value(
-              0
-            , new_value
-            , advgetopt::string_list_t()
-            , advgetopt::option_source_t::SOURCE_DYNAMIC);
-    if(!o->is_defined())
-    {
-        // value not accepted by advgetopt
-        //
-        return set_result_t::SET_RESULT_ERROR;
-    }
+    return !f_unverified.empty();
+}
 
-    value v;
-    v.set_value(new_value, priority, timestamp);
 
-    auto it(f_values.find(name));
-    if(it == f_values.end())
-    {
-        // no such value yet, just save that value_priority as is
-        //
-        f_values[name].insert(v);
-        return set_result_t::SET_RESULT_NEW;
-    }
+/** \brief Save the settings to a binary file.
+ *
+ * This function saves the settings immediately. It is the same as
+ * calling prepare_save(), execute_save() and save_done() in a row.
+ *
+ * \param[in] filename  The name of the binary file.
+ *
+ * \return true if the file was saved.
+ */
+bool settings::save_snapshot(std::string const & filename)
+{
+    save_request_t::pointer_t request(prepare_save(filename));
+    execute_save(*request);
+    save_done(*request);
+    return request->f_saved;
+}
 
-    auto vp(it->second.find(v));
-    if(vp == it->second.end())
-    {
-        // not there yet, just insert
-        //
-        it->second.insert(v);
-        return set_result_t::SET_RESULT_NEW_PRIORITY;
-    }
 
-    if(timestamp > vp->get_timestamp())
+/** \brief Prepare a save of the settings.
+ *
+ * This function creates a request including a snapshot of the settings
+ * and the list of settings which changed since the last save. The
+ * request can then be executed by another thread with execute_save()
+ * since it does not access the settings object. Once done, the result
+ * must be given back to save_done().
+ *
+ * If the file was loaded or saved before, only the settings which
+ * changed since then get appended to it as a delta segment. The cost
+ * of such a save is proportional to the number of changes. Once the
+ * delta segments are larger than the first segment of the file, all
+ * the settings get saved in a new file instead.
+ *
+ * \warning
+ * Only one request can be in progress at a time.
+ *
+ * \param[in] filename  The name of the binary file.
+ * \param[in] export_filename  The name of the text export or an empty
+ * string to not export the settings.
+ *
+ * \return The request to execute.
+ */
+save_request_t::pointer_t settings::prepare_save(
+      std::string const & filename
+    , std::string const & export_filename)
+{
+    save_request_t::pointer_t request(std::make_shared<save_request_t>());
+    request->f_snapshot = get_snapshot();
+    request->f_filename = filename;
+    request->f_export_filename = export_filename;
+    request->f_full = !f_snapshot_file_loaded
+                   || f_snapshot_file_size - f_snapshot_base_size >= f_snapshot_base_size;
+    request->f_file_size = f_snapshot_file_size;
+    request->f_base_size = f_snapshot_base_size;
+
+    // the settings changed while the request is executed get marked
+    // again by refresh()
+    //
+    for(auto const id : f_unsaved)
     {
-        // it was already there, but message value is more recent
-        // than stored value so keep the newer one
-        //
-        set_result_t const result(v.get_value() == vp->get_value()
-                                ? set_result_t::SET_RESULT_NEWER
-                                : set_result_t::SET_RESULT_CHANGED);
-        it->second.erase(vp);   // in sets we need to remove the old one first
-        it->second.insert(v);   // otherwise the insert does nothing
-        return result;
+        f_unsaved_flags[id] = false;
     }
+    request->f_ids.swap(f_unsaved);
 
-    return set_result_t::SET_RESULT_UNCHANGED;
+    return request;
 }
 
 
-bool settings::reset_setting(
-      std::string name
-    , priority_t priority)
+/** \brief Execute a save request.
+ *
+ * This function only uses the snapshot found in the request so it can
+ * safely be called from any thread.
+ *
+ * On return, the f_saved field of the request is true if the save
+ * succeeded and the file sizes are updated.
+ *
+ * \param[in,out] request  The request to execute.
+ */
+void settings::execute_save(save_request_t & request)
 {
-    std::replace(name.begin(), name.end(), '_', '-');
-    advgetopt::option_info::pointer_t o(f_opts->get_option(name));
-    if(o == nullptr)
+    snapshot const & snap(*request.f_snapshot);
+
+    std::vector<setting_id_t> ids;
+    if(request.f_full)
     {
-        return false;
+        for(setting_id_t id(0); id < snap.size(); ++id)
+        {
+            snapshot::record_t const * r(snap.get_record(id));
+            if(r != nullptr
+            && r->f_values != nullptr
+            && !r->f_values->empty())
+            {
+                ids.push_back(id);
+            }
+        }
+    }
+    else
+    {
+        for(auto const id : request.f_ids)
+        {
+            if(snap.get_record(id) != nullptr)
+            {
+                ids.push_back(id);
+            }
+        }
     }
 
-    o->reset();
+    std::sort(
+          ids.begin()
+        , ids.end()
+        , [&snap](setting_id_t a, setting_id_t b)
+          {
+              return *snap.get_record(a)->f_name < *snap.get_record(b)->f_name;
+          });
 
-    auto it(f_values.find(name));
-    if(it == f_values.end())
+    if(request.f_full
+    || !ids.empty())
     {
-        return false;
-    }
+        // a setting without values gets saved in a delta, that way the
+        // reset is also applied on the next load
+        //
+        snapshot_file file(request.f_filename);
+        file.set_quiet(request.f_quiet);
+        for(auto const id : ids)
+        {
+            snapshot::record_t const * r(snap.get_record(id));
+            file.add(*r->f_name, r->f_values.get(), r->f_definition);
+        }
 
-    timestamp_t const now(timestamp_t::gettime());
-    value v;
-    v.set_value(std::string(), priority, now);
-    auto vp(it->second.find(v));
-    if(vp == it->second.end())
+        if(request.f_full)
+        {
+            request.f_saved = file.save();
+            request.f_base_size = file.get_base_size();
+        }
+        else
+        {
+            request.f_saved = file.append(request.f_file_size);
+        }
+        if(request.f_saved)
+        {
+            request.f_file_size = file.get_file_size();
+        }
+        else
+        {
+            request.f_errno = file.get_errno();
+        }
+    }
+    else
     {
-        return false;
+        request.f_saved = true;
     }
 
-    it->second.erase(vp);
-
-    if(it->second.empty())
+    if(!request.f_export_filename.empty())
     {
-        f_values.erase(it);
+        export_conf(
+                  snap
+                , request.f_export_filename
+                , request.f_quiet ? &request.f_export_errno : nullptr);
     }
-
-    return true;
 }
 
 
-void settings::load(std::string const & filename)
+/** \brief Handle the result of a save request.
+ *
+ * If the save failed, the settings of the request are marked as unsaved
+ * again and the next save rewrites the whole file.
+ *
+ * \param[in] request  The executed request.
+ */
+void settings::save_done(save_request_t const & request)
 {
-    advgetopt::conf_file_setup setup(
-                  filename
-                , advgetopt::line_continuation_t::line_continuation_unix
-                , advgetopt::ASSIGNMENT_OPERATOR_EQUAL
-                , advgetopt::COMMENT_INI | advgetopt::COMMENT_SHELL
-                , advgetopt::SECTION_OPERATOR_CPP);
-    advgetopt::conf_file::pointer_t data(advgetopt::conf_file::get_conf_file(setup));
-
-    for(auto const & p : data->get_parameters())
+    if(request.f_saved)
     {
-        std::vector<std::string> sections;
-        snapdev::tokenize_string(sections, p.first, { "::" }, true);
-        std::int64_t priority(0);
-        advgetopt::validator_integer::convert_string(sections.back(), priority);
-        sections.pop_back();
-        std::string const & value(p.second.get_value());
-        std::string::size_type const pos(value.find('|'));
-        if(pos == std::string::npos)
-        {
-            SNAP_LOG_ERROR
-                << "found value \""
-                << value
-                << "\" in parameter \""
-                << p.first
-                << "\" without a | to separate the timestamp from the value."
-                << SNAP_LOG_SEND;
-            continue;
-        }
-        std::int64_t timestamp_nsec(0);
-        advgetopt::validator_integer::convert_string(value.substr(0, pos), timestamp_nsec);
+        f_snapshot_file_loaded = true;
+        f_snapshot_file_size = request.f_file_size;
+        f_snapshot_base_size = request.f_base_size;
+        return;
+    }
 
-        set_value(
-              snapdev::join_strings(sections, "::")
-            , value.substr(pos + 1)
-            , static_cast<priority_t>(priority)
-            , timestamp_nsec);
+    for(auto const id : request.f_ids)
+    {
+        mark_unsaved(id);
     }
+    f_snapshot_file_loaded = false;
 }
 
 
-void settings::save(std::string const & filename)
+/** \brief Get the number of settings changed since the last save.
+ *
+ * \return The number of settings which save_snapshot() has to save.
+ */
+std::size_t settings::get_unsaved_changes() const
 {
-    advgetopt::conf_file_setup setup(
-                  filename
-                , advgetopt::line_continuation_t::line_continuation_unix
-                , advgetopt::ASSIGNMENT_OPERATOR_EQUAL
-                , advgetopt::COMMENT_INI | advgetopt::COMMENT_SHELL
-                , advgetopt::SECTION_OPERATOR_CPP);
-    advgetopt::conf_file::pointer_t data(advgetopt::conf_file::get_conf_file(setup));
-
-    // TODO: look into a way to not have to do that erase since it is really
-    //       slow (it deletes one parameter at a time and saves all the info)
-    //
-    //       this happens in part because the configuration files are
-    //       cached in memory (for speed) -- deleting the file has no
-    //       effect since the cache is always returned at the moment
-    //
-    data->erase_all_parameters();
+    return f_unsaved.size();
+}
 
-    // the default warning is not going to cut it for fluid-settings since
-    // it mentions advgetopt instead and that you can safely edit the file
-    //
-    std::string startup_comment(
-        "# WARNING: AUTO-GENERATED FILE, DO NOT EDIT\n"
-        "#          see `man fluid-settings` for details\n");
 
-    for(auto const & m : f_values)
-    {
-        for(auto const & s : m.second)
-        {
-            std::string const np(std::to_string(s.get_priority()));
+/** \brief Release the memory which is not used anymore.
+ *
+ * The values are allocated from a memory pool. Once in a while, the
+ * pool gets compacted to give back the slabs which are not used anymore.
+ * The daemon calls this function after it saved the settings.
+ *
+ * \return The number of bytes given back to the heap.
+ */
+std::size_t settings::compact()
+{
+    return f_values.compact();
+}
 
-            fluid_settings::timestamp_t const t(s.get_timestamp());
 
-            std::string tv(std::to_string(t.to_nsec()));
-            tv += FIELD_SEPARATOR;
-            tv += s.get_value();
+/** \brief Get the statistics of the memory pool.
+ *
+ * This function returns the number of slabs, the number of bytes in use,
+ * etc. of the memory pool used to allocate the values.
+ *
+ * \return A copy of the memory statistics.
+ */
+memory_pool::stats_t settings::get_memory_stats() const
+{
+    return f_values.get_memory_stats();
+}
 
-            data->set_parameter(
-                  m.first
-                , np
-                , tv
-                , advgetopt::assignment_t::ASSIGNMENT_NONE
-                , startup_comment);
-            startup_comment.clear();
-        }
-    }
 
-    data->save_configuration(".bak", true, false);
+std::string settings::serialize_value(std::string name)
+{
+    return serialize_value(resolve(name));
 }
 
 
-std::string settings::serialize_value(std::string name)
+std::string settings::serialize_value(setting_id_t id)
 {
     std::string result;
 
-    std::replace(name.begin(), name.end(), '_', '-');
-
-    auto m(f_values.find(name));
-    if(m == f_values.end())
+    if(id >= f_values.size())
     {
         return result;
     }
 
-    std::string const separator(1, FIELD_SEPARATOR);
-    for(auto const & s : m->second)
+    for(auto const & s : f_values.get_entry(id).get_values())
     {
-        result += std::to_string(s.get_priority());
+        char number[32];
+        result.append(number, std::to_chars(number, number + sizeof(number), s.get_priority()).ptr);
         result += FIELD_SEPARATOR;
 
         fluid_settings::timestamp_t const t(s.get_timestamp());
-        result += std::to_string(t.to_nsec());
+        result.append(number, std::to_chars(number, number + sizeof(number), t.to_nsec()).ptr);
         result += FIELD_SEPARATOR;
 
-        // the value may include
+        // the value may include the separators
         //
-        result += snapdev::string_replace_many(
-                    s.get_value(),
-                    {
-                        { separator, "\\P" },
-                        { "\\", "\\S" },
-                        { "\n", "\\n" },
-                        { "\r", "\\r" },
-                    });
+        escape_value(result, s.get_value());
 
         result += VALUE_SEPARATOR;
     }
@@ -655,11 +2319,33 @@ std::string settings::serialize_value(std::string name)
 }
 
 
+/** \brief Apply the values received from another fluid-settings.
+ *
+ * The \p values string is the output of serialize_value(). Each value
+ * is applied as with set_value() and the setting is added to \p changes
+ * if its effective value may have changed.
+ *
+ * \param[in] name  The name of the setting.
+ * \param[in] values  The serialized values.
+ * \param[in,out] changes  The set of settings which changed.
+ */
 void settings::unserialize_values(
           std::string const & name
-        , std::string const & values)
+        , std::string const & values
+        , change_set_t & changes)
 {
-    // no need to fix 'name' here because it will be done in set_value()
+    // resolve the name once for all the values
+    //
+    setting_id_t const id(resolve(name));
+    if(id == INVALID_SETTING_ID)
+    {
+        SNAP_LOG_RECOVERABLE_ERROR
+            << "received values for unknown setting \""
+            << name
+            << "\"."
+            << SNAP_LOG_SEND;
+        return;
+    }
 
     // one value per line
     // lines are separated by fluid_settings::VALUE_SEPARATOR ('\n')
@@ -667,63 +2353,34 @@ void settings::unserialize_values(
     // one value has three parameters: priority, timestamp, actual value
     // parameters are separated by fluid_settings::FIELD_SEPARATOR ('|')
     //
-    std::string const separator(std::string(1, fluid_settings::settings::FIELD_SEPARATOR));
-    std::list<std::string> lines;
-    snapdev::tokenize_string(lines, values, { std::string(1, fluid_settings::settings::VALUE_SEPARATOR) });
-    for(auto const & l : lines)
+    serialized_parser parser(values);
+    mutation_vector_t batch;
+    std::string_view line;
+    while(parser.next_line(line))
     {
-        std::vector<std::string> params;
-        snapdev::tokenize_string(params, l, { separator });
-        if(params.size() != 3)
+        serialized_parser::entry_t entry;
+        if(!serialized_parser::parse_line(line, entry))
         {
             // skip invalid entries
             SNAP_LOG_RECOVERABLE_ERROR
                 << "\""
-                << l
+                << line
                 << "\" is invalid as it does not include exactly 3 parts (priority, timestamp, value) separated by '"
-                << separator
+                << FIELD_SEPARATOR
                 << "'."
                 << SNAP_LOG_SEND;
             continue;
         }
 
-        std::int64_t priority(0);
-        if(!advgetopt::validator_integer::convert_string(params[0], priority))
-        {
-            SNAP_LOG_RECOVERABLE_ERROR
-                << "invalid priority \""
-                << params[0]
-                << "\" found in serialized values."
-                << SNAP_LOG_SEND;
-            continue;
-        }
-
-        std::int64_t timestamp_nsec(0);
-        if(!advgetopt::validator_integer::convert_string(params[1], timestamp_nsec))
-        {
-            SNAP_LOG_RECOVERABLE_ERROR
-                << "invalid timestamp \""
-                << params[1]
-                << "\" found in serialized values."
-                << SNAP_LOG_SEND;
-            continue;
-        }
-
-        std::string const value(snapdev::string_replace_many(
-                    params[2],
-                    {
-                        { "\\P", separator },
-                        { "\\S", "\\" },
-                        { "\\n", "\n" },
-                        { "\\r", "\r" },
-                    }));
-
-        set_value(
-              name
-            , value
-            , static_cast<fluid_settings::priority_t>(priority)
-            , timestamp_nsec);
+        mutation_t m;
+        m.f_id = id;
+        m.f_priority = static_cast<fluid_settings::priority_t>(entry.f_priority);
+        m.f_timestamp = timestamp_t(entry.f_timestamp);
+        unescape_value(m.f_value, entry.f_value);
+        batch.push_back(std::move(m));
     }
+
+    apply_batch(batch, changes);
 }
 
 
@@ -733,6 +2390,12 @@ char const * settings::get_default_settings_filename()
 }
 
 
+char const * settings::get_default_snapshot_filename()
+{
+    return g_snapshot_file;
+}
+
+
 /** \brief Retrieve a copy of the path to the settings definitions.
  *
  * By default, all the settings definitions are expected to be saved under
@@ -30,6 +30,11 @@
 
 // self
 //
+#include    "hash_tree.h"
+#include    "history.h"
+#include    "result.h"
+#include    "settings_table.h"
+#include    "snapshot.h"
 #include    "value.h"
 
 
@@ -38,35 +43,69 @@
 #include    <advgetopt/advgetopt.h>
 
 
+// C++
+//
+#include    <limits>
+#include    <map>
+
+
 
 namespace fluid_settings
 {
 
 
 constexpr char const * const g_settings_file = "/var/lib/fluid-settings/settings/settings.conf";
+constexpr char const * const g_snapshot_file = "/var/lib/fluid-settings/settings/settings.snapshot";
 constexpr char const * const g_definitions_path = "/usr/share/fluid-settings/definitions:/var/lib/fluid-settings/definitions";
 constexpr char const * const g_definitions_pattern = "*.ini";
 
 
-enum class get_result_t
+typedef settings_table::index_t     setting_id_t;
+
+
+struct snapshot_content_t;
+
+constexpr setting_id_t const        INVALID_SETTING_ID = settings_table::NO_INDEX;
+
+
+// one change to apply with settings::apply_batch(); when f_id is not
+// INVALID_SETTING_ID, f_name is ignored
+//
+struct mutation_t
 {
-    GET_RESULT_ERROR,               // some error happened (other than value undefined)
-    GET_RESULT_UNKNOWN,             // unknown value (name not found in lists)
-    GET_RESULT_NOT_SET,             // the get "failed" because the value is not set
-    GET_RESULT_PRIORITY_NOT_FOUND,  // some values are set, but not at the requested priority
-    GET_RESULT_DEFAULT,             // default value is being returned
-    GET_RESULT_SUCCESS,             // the value(s) is(are) being returned
+    std::string             f_name = std::string();
+    setting_id_t            f_id = INVALID_SETTING_ID;
+    priority_t              f_priority = ADMINISTRATOR_PRIORITY;
+    timestamp_t             f_timestamp = timestamp_t();
+    std::string             f_value = std::string();
 };
 
-enum class set_result_t
+typedef std::vector<mutation_t>     mutation_vector_t;
+typedef std::vector<set_result_t>   set_result_vector_t;
+
+// sorted list of the settings whose effective value changed
+//
+typedef std::vector<setting_id_t>   change_set_t;
+
+
+// a save of the settings which can be executed by another thread
+//
+struct save_request_t
 {
-    SET_RESULT_ERROR,               // some error happened
-    SET_RESULT_UNKNOWN,             // the named was not found in the existing values
-    SET_RESULT_NEW,                 // that value was not set yet
-    SET_RESULT_NEW_PRIORITY,        // the value existed, but not at that priority
-    SET_RESULT_CHANGED,             // the value was changed
-    SET_RESULT_NEWER,               // the timestamp changed, the value is the same
-    SET_RESULT_UNCHANGED,           // the timestamp is older or the same
+    typedef std::shared_ptr<save_request_t>     pointer_t;
+
+    snapshot::pointer_t     f_snapshot = snapshot::pointer_t();
+    std::string             f_filename = std::string();
+    std::string             f_export_filename = std::string();
+    std::vector<setting_id_t>
+                            f_ids = std::vector<setting_id_t>();
+    bool                    f_full = false;
+    std::size_t             f_file_size = 0;
+    std::size_t             f_base_size = 0;
+    bool                    f_saved = false;
+    bool                    f_quiet = false;        // do not log, report the errors below
+    int                     f_errno = 0;            // errno of the failed save
+    int                     f_export_errno = 0;     // errno of the failed export
 };
 
 
@@ -77,40 +116,157 @@ public:
     static constexpr char const     VALUE_SEPARATOR = '\n';
 
     bool                    load_definitions(
-                                  std::string paths = std::string());
+                                  std::string paths = std::string()
+                                , std::size_t threads = 0);
     std::string             list_of_options();
+    setting_id_t            resolve(std::string name);
+    std::string const &     get_name(setting_id_t id) const;
+    settings_table::effective_t const *
+                            get_effective(setting_id_t id) const;
+    priority_set const *    get_values(setting_id_t id) const;
+    snapshot::pointer_t     get_snapshot();
+    snapshot::pointer_t     current_snapshot() const;
     get_result_t            get_default_value(
                                   std::string name
                                 , std::string & result);
+    get_result_t            get_default_value(
+                                  setting_id_t id
+                                , std::string & result);
     get_result_t            get_value(
                                   std::string name
                                 , std::string & value
                                 , priority_t priority = HIGHEST_PRIORITY
                                 , bool all = false);
+    get_result_t            get_value(
+                                  setting_id_t id
+                                , std::string & value
+                                , priority_t priority = HIGHEST_PRIORITY
+                                , bool all = false);
+    get_result_t            get_buffer(
+                                  setting_id_t id
+                                , value::buffer_t & result
+                                , priority_t priority = HIGHEST_PRIORITY) const;
     set_result_t            set_value(
                                   std::string name
                                 , std::string const & value
                                 , int priority
                                 , snapdev::timespec_ex const & timestamp);
+    set_result_t            set_value(
+                                  setting_id_t id
+                                , std::string const & value
+                                , int priority
+                                , snapdev::timespec_ex const & timestamp);
+    set_result_vector_t     apply_batch(
+                                  mutation_vector_t const & batch
+                                , change_set_t & changes);
+    void                    restore_values(
+                                  setting_id_t id
+                                , mutation_vector_t const & values
+                                , change_set_t & changes);
     bool                    reset_setting(
                                   std::string name
                                 , int priority);
+    bool                    reset_setting(
+                                  setting_id_t id
+                                , int priority);
+    void                    set_history_depth(std::size_t depth);
+    history::revision_t     get_revision() const;
+    history::stats_t        get_history_stats() const;
+    hash_tree const &       get_hash_tree() const;
+    get_result_t            get_value_at(
+                                  setting_id_t id
+                                , std::string & result
+                                , history::revision_t revision
+                                , timestamp_t const & timestamp = timestamp_t(std::numeric_limits<std::int64_t>::max()));
+    bool                    rollback(
+                                  std::string const & name_space
+                                , history::revision_t revision
+                                , change_set_t & changes);
     void                    load(std::string const & filename);
     void                    save(std::string const & filename);
+    bool                    load_snapshot(std::string const & filename);
+    bool                    load_snapshot(snapshot_content_t const & content);
+    static snapshot_content_t
+                            read_snapshot(std::string const & filename);
+    bool                    verify_deferred(
+                                  std::size_t count
+                                , change_set_t & changes);
+    bool                    has_deferred() const;
+    bool                    save_snapshot(std::string const & filename);
+    save_request_t::pointer_t
+                            prepare_save(
+                                  std::string const & filename
+                                , std::string const & export_filename = std::string());
+    static void             execute_save(save_request_t & request);
+    void                    save_done(save_request_t const & request);
+    static bool             export_conf(
+                                  snapshot const & snap
+                                , std::string const & filename
+                                , int * error = nullptr);
+    std::size_t             get_unsaved_changes() const;
+    std::size_t             compact();
+    memory_pool::stats_t    get_memory_stats() const;
     std::string             serialize_value(std::string name);
+    std::string             serialize_value(setting_id_t id);
     void                    unserialize_values(
                                   std::string const & name
-                                , std::string const & value);
+                                , std::string const & value
+                                , change_set_t & changes);
 
     static char const *     get_default_settings_filename();
+    static char const *     get_default_snapshot_filename();
     static char const *     get_default_path();
 
 private:
-    bool                    load_definition_file(std::string const & path);
+    bool                    find_definition_files(
+                                  std::string const & path
+                                , advgetopt::string_list_t & files);
+    std::uint32_t           get_definition(std::string const & name) const;
+    set_result_t            store_value(
+                                  setting_id_t id
+                                , std::string const & value
+                                , int priority
+                                , snapdev::timespec_ex const & timestamp
+                                , bool history = true);
+    void                    record_history(
+                                  setting_id_t id
+                                , priority_t priority
+                                , timestamp_t const & timestamp
+                                , value::buffer_t const & before
+                                , value::buffer_t const & after);
+    bool                    values_at(
+                                  setting_id_t id
+                                , history::revision_t revision
+                                , timestamp_t const & timestamp
+                                , std::map<priority_t, value::buffer_t> & values) const;
+    void                    refresh(setting_id_t id);
+    void                    mark_unsaved(setting_id_t id);
+    void                    publish();
 
     advgetopt::getopt::pointer_t
                             f_opts = advgetopt::getopt::pointer_t();
-    value::map_t            f_values = value::map_t();
+    std::map<std::string, std::uint32_t>
+                            f_definitions = std::map<std::string, std::uint32_t>();
+    std::vector<setting_id_t>
+                            f_unverified = std::vector<setting_id_t>();
+    settings_table          f_values = settings_table();
+    history                 f_history = history();
+    hash_tree               f_hash_tree = hash_tree();
+    value::buffer_t         f_options = std::make_shared<std::string const>();
+    snapshot::chunk_vector_t
+                            f_chunks = snapshot::chunk_vector_t();
+    std::vector<setting_id_t>
+                            f_dirty = std::vector<setting_id_t>();
+    std::vector<bool>       f_dirty_flags = std::vector<bool>();
+    bool                    f_snapshot_dirty = true;
+    std::vector<setting_id_t>
+                            f_unsaved = std::vector<setting_id_t>();
+    std::vector<bool>       f_unsaved_flags = std::vector<bool>();
+    bool                    f_snapshot_file_loaded = false;
+    std::size_t             f_snapshot_file_size = 0;
+    std::size_t             f_snapshot_base_size = 0;
+    std::uint64_t           f_snapshot_version = 0;
+    snapshot::pointer_t     f_snapshot = snapshot::pointer_t();
 };
 
 
@@ -0,0 +1,564 @@
+// Copyright (c) 2011-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/** \file
+ * \brief Implementation of the table holding all the fluid settings values.
+ *
+ * The table is an open-addressing hash table (linear probing) of interned
+ * setting names. The slots only hold a fragment of the hash and the index
+ * of the entry so the probing remains within a few cache lines. The entries
+ * themselves are kept in a vector in the order they were interned.
+ *
+ * Names are never removed from the table. When all the values of a setting
+ * get reset, the entry remains with an empty list of values. This is what
+ * allows the entry indexes to remain stable.
+ */
+
+// self
+//
+#include    "settings_table.h"
+
+
+// C++
+//
+#include    <algorithm>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace fluid_settings
+{
+
+
+namespace
+{
+
+
+
+/** \brief The minimum number of slots in the hash table.
+ *
+ * The number of slots must always be a power of two.
+ */
+constexpr std::size_t const     g_minimum_slots = 64;
+
+
+
+}
+// no name namespace
+
+
+
+/** \class settings_table
+ * \brief Hold all the values of all the settings.
+ *
+ * This class is the storage engine of the settings class. It interns the
+ * names of the settings and keeps all of their values, one per priority.
+ *
+ * The find() and intern() functions are O(1). The table also offers a
+ * deterministic iteration order (sorted by name) through the
+ * sorted_indexes() function which is what is used to save the settings.
+ */
+
+
+
+/** \brief Get the name of this entry.
+ *
+ * The name is the canonicalized name of the setting as passed to the
+ * settings_table::intern() function.
+ *
+ * \return A reference to the name of this entry.
+ */
+std::string const & settings_table::entry::get_name() const
+{
+    return f_name;
+}
+
+
+/** \brief Get the definition of this entry.
+ *
+ * The settings class attaches the advgetopt option defining this setting
+ * to the entry. This way it does not have to search for it each time a
+ * value gets accessed.
+ *
+ * The option may be a nullptr if the definitions were reloaded and this
+ * setting is not defined anymore.
+ *
+ * \return A reference to the option definition of this entry.
+ */
+advgetopt::option_info::pointer_t const & settings_table::entry::get_option() const
+{
+    return f_option;
+}
+
+
+/** \brief Attach the definition of this entry.
+ *
+ * This function saves the advgetopt option defining this setting.
+ *
+ * The validator of the option is also cached along with the list of
+ * separators when the option accepts multiple values. The validator
+ * was compiled by advgetopt when the definition was loaded (ranges
+ * parsed, regex compiled, etc.) so the validate() function can use it
+ * as is.
+ *
+ * The default value, if any, is copied in a shared buffer once here.
+ *
+ * \param[in] o  The option defining this setting.
+ */
+void settings_table::entry::set_option(advgetopt::option_info::pointer_t const & o)
+{
+    f_option = o;
+    f_validator.reset();
+    f_separators.clear();
+    f_default.reset();
+    if(o != nullptr)
+    {
+        f_validator = o->get_validator();
+        if(o->has_default())
+        {
+            f_default = std::make_shared<std::string const>(o->get_default());
+        }
+        if(o->has_flag(advgetopt::GETOPT_FLAG_MULTIPLE))
+        {
+            f_separators = o->get_multiple_separators();
+        }
+    }
+}
+
+
+/** \brief Get the fingerprint of the definition of this entry.
+ *
+ * The fingerprint changes whenever the file defining this setting
+ * changes. It is saved along the values so on the next start we know
+ * whether the values need to be validated again.
+ *
+ * \return The fingerprint or 0 if unknown.
+ */
+std::uint32_t settings_table::entry::get_definition() const
+{
+    return f_definition;
+}
+
+
+/** \brief Set the fingerprint of the definition of this entry.
+ *
+ * \param[in] definition  The new fingerprint.
+ */
+void settings_table::entry::set_definition(std::uint32_t definition)
+{
+    f_definition = definition;
+}
+
+
+/** \brief Check whether a value is valid for this setting.
+ *
+ * This function runs the cached validator against \p v. Contrary to
+ * calling advgetopt::option_info::set_value(), it has no side effect on
+ * the option so it can be called as often as necessary.
+ *
+ * If the option accepts multiple values, each one of them gets validated
+ * separately.
+ *
+ * \param[in] v  The value to validate.
+ *
+ * \return true if the value is acceptable for this setting.
+ */
+bool settings_table::entry::validate(std::string const & v) const
+{
+    if(f_option == nullptr)
+    {
+        return false;
+    }
+    if(f_validator == nullptr)
+    {
+        return true;
+    }
+    if(f_separators.empty())
+    {
+        return f_validator->validate(v);
+    }
+
+    advgetopt::string_list_t list;
+    advgetopt::split_string(v, list, f_separators);
+    for(auto const & l : list)
+    {
+        if(!f_validator->validate(l))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/** \brief Get the default value of this entry.
+ *
+ * \return The buffer with the default value or nullptr if the setting
+ * does not have a default value.
+ */
+value::buffer_t const & settings_table::entry::get_default() const
+{
+    return f_default;
+}
+
+
+/** \brief Get the values of this entry.
+ *
+ * The values are sorted by priority. There is at most one value per
+ * priority.
+ *
+ * \return A reference to the set of values.
+ */
+priority_set & settings_table::entry::get_values()
+{
+    return f_values;
+}
+
+
+/** \brief Get the values of this entry.
+ *
+ * This is the constant version of the get_values() function.
+ *
+ * \return A constant reference to the set of values.
+ */
+priority_set const & settings_table::entry::get_values() const
+{
+    return f_values;
+}
+
+
+/** \brief Get the effective value of this entry.
+ *
+ * The effective value is the value with the highest priority or, if no
+ * value is defined, the default value of the setting definition.
+ *
+ * The record is memoized. It gets recalculated by refresh_effective()
+ * which must be called each time the values or the option change.
+ *
+ * \return A reference to the effective value record.
+ */
+settings_table::effective_t const & settings_table::entry::get_effective() const
+{
+    return f_effective;
+}
+
+
+/** \brief Recalculate the effective value of this entry.
+ *
+ * This function must be called whenever the set of values or the option
+ * of this entry changes. It recalculates the effective value record and
+ * increments its version.
+ */
+void settings_table::entry::refresh_effective()
+{
+    value const * v(f_values.highest());
+    if(v != nullptr)
+    {
+        f_effective.f_is_set = true;
+        f_effective.f_is_default = false;
+        f_effective.f_priority = v->get_priority();
+        f_effective.f_value = v->get_buffer();
+    }
+    else if(f_default != nullptr)
+    {
+        f_effective.f_is_set = true;
+        f_effective.f_is_default = true;
+        f_effective.f_priority = HIGHEST_PRIORITY;
+        f_effective.f_value = f_default;
+    }
+    else
+    {
+        f_effective.f_is_set = false;
+        f_effective.f_is_default = false;
+        f_effective.f_priority = HIGHEST_PRIORITY;
+        f_effective.f_value.reset();
+    }
+    ++f_effective.f_version;
+}
+
+
+/** \brief Search for a name in the table.
+ *
+ * This function searches the table for the specified \p name. The name
+ * is expected to already be canonicalized.
+ *
+ * \param[in] name  The name of the setting to search.
+ *
+ * \return The index of the entry or NO_INDEX if not found.
+ */
+settings_table::index_t settings_table::find(std::string const & name) const
+{
+    if(f_slots.empty())
+    {
+        return NO_INDEX;
+    }
+
+    std::uint64_t const h(hash(name));
+    std::uint32_t const fragment(static_cast<std::uint32_t>(h));
+    std::size_t const mask(f_slots.size() - 1);
+    for(std::size_t pos(h & mask);; pos = (pos + 1) & mask)
+    {
+        slot_t const & s(f_slots[pos]);
+        if(s.f_index == NO_INDEX)
+        {
+            return NO_INDEX;
+        }
+        if(s.f_hash == fragment
+        && f_entries[s.f_index].f_name == name)
+        {
+            return s.f_index;
+        }
+    }
+}
+
+
+/** \brief Search for a name and add it if not yet present.
+ *
+ * This function returns the index of the entry named \p name. If that
+ * entry does not exist yet, it gets created with an empty list of values.
+ *
+ * The returned index remains valid for the lifetime of the table (or until
+ * clear() gets called).
+ *
+ * \param[in] name  The name of the setting to intern.
+ *
+ * \return The index of the entry.
+ */
+settings_table::index_t settings_table::intern(std::string const & name)
+{
+    // keep the load factor at or under 50%
+    //
+    if((f_entries.size() + 1) * 2 > f_slots.size())
+    {
+        grow();
+    }
+
+    std::uint64_t const h(hash(name));
+    std::uint32_t const fragment(static_cast<std::uint32_t>(h));
+    std::size_t const mask(f_slots.size() - 1);
+    for(std::size_t pos(h & mask);; pos = (pos + 1) & mask)
+    {
+        slot_t & s(f_slots[pos]);
+        if(s.f_index == NO_INDEX)
+        {
+            s.f_hash = fragment;
+            s.f_index = static_cast<index_t>(f_entries.size());
+            f_entries.emplace_back();
+            f_entries.back().f_name = name;
+            f_entries.back().f_values = priority_set(priority_set::allocator_t(f_pool));
+            f_sorted_valid = false;
+            return s.f_index;
+        }
+        if(s.f_hash == fragment
+        && f_entries[s.f_index].f_name == name)
+        {
+            return s.f_index;
+        }
+    }
+}
+
+
+/** \brief Get the number of entries in the table.
+ *
+ * This function returns the number of names that were interned. Some of
+ * those entries may not have any values.
+ *
+ * \return The number of entries.
+ */
+std::size_t settings_table::size() const
+{
+    return f_entries.size();
+}
+
+
+/** \brief Retrieve an entry.
+ *
+ * The \p idx parameter must be a valid index as returned by find() or
+ * intern().
+ *
+ * \param[in] idx  The index of the entry to retrieve.
+ *
+ * \return A reference to the entry.
+ */
+settings_table::entry & settings_table::get_entry(index_t idx)
+{
+    return f_entries[idx];
+}
+
+
+/** \brief Retrieve an entry.
+ *
+ * This is the constant version of the get_entry() function.
+ *
+ * \param[in] idx  The index of the entry to retrieve.
+ *
+ * \return A constant reference to the entry.
+ */
+settings_table::entry const & settings_table::get_entry(index_t idx) const
+{
+    return f_entries[idx];
+}
+
+
+/** \brief Get the list of indexes sorted by name.
+ *
+ * The table does not keep its entries in any specific order. This function
+ * returns a vector of indexes sorted by entry name which allows for a
+ * deterministic iteration of the table.
+ *
+ * The list is cached and only recalculated when new names get interned.
+ *
+ * \return A reference to the vector of sorted indexes.
+ */
+std::vector<settings_table::index_t> const & settings_table::sorted_indexes() const
+{
+    if(!f_sorted_valid)
+    {
+        f_sorted.resize(f_entries.size());
+        for(index_t idx(0); idx < f_entries.size(); ++idx)
+        {
+            f_sorted[idx] = idx;
+        }
+        std::sort(
+              f_sorted.begin()
+            , f_sorted.end()
+            , [this](index_t a, index_t b)
+            {
+                return f_entries[a].f_name < f_entries[b].f_name;
+            });
+        f_sorted_valid = true;
+    }
+
+    return f_sorted;
+}
+
+
+/** \brief Remove all the entries.
+ *
+ * This function empties the table. All the indexes previously returned
+ * become invalid.
+ */
+void settings_table::clear()
+{
+    f_entries.clear();
+    f_slots.clear();
+    f_sorted.clear();
+    f_sorted_valid = true;
+}
+
+
+/** \brief Allocate a value buffer from the memory pool.
+ *
+ * The string object and the shared pointer control block get allocated
+ * in one block of the memory pool. Values which do not fit in the small
+ * string buffer still allocate their characters on the heap.
+ *
+ * \param[in] v  The value to copy in the new buffer.
+ *
+ * \return The new immutable buffer.
+ */
+value::buffer_t settings_table::make_buffer(std::string const & v) const
+{
+    return std::allocate_shared<std::string const>(
+                  pool_allocator<std::string>(f_pool)
+                , v);
+}
+
+
+/** \brief Release the memory which is not used anymore.
+ *
+ * This function shrinks the array of values of each entry and then
+ * gives back the free slabs of the memory pool.
+ *
+ * \return The number of bytes released.
+ */
+std::size_t settings_table::compact()
+{
+    for(auto & e : f_entries)
+    {
+        e.f_values.shrink_to_fit();
+    }
+    return f_pool->compact();
+}
+
+
+/** \brief Get the statistics of the memory pool.
+ *
+ * \return A copy of the memory pool statistics.
+ */
+memory_pool::stats_t settings_table::get_memory_stats() const
+{
+    return f_pool->get_stats();
+}
+
+
+/** \brief Compute the hash of a name.
+ *
+ * This function uses the FNV-1a algorithm which is fast on short strings
+ * such as setting names and gives the same result on all platforms.
+ *
+ * \param[in] name  The name to hash.
+ *
+ * \return The 64 bit hash of \p name.
+ */
+std::uint64_t settings_table::hash(std::string const & name)
+{
+    std::uint64_t h(0xcbf29ce484222325ULL);
+    for(char const c : name)
+    {
+        h ^= static_cast<unsigned char>(c);
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+
+/** \brief Double the number of slots.
+ *
+ * The function allocates a new array of slots twice the size of the
+ * current one and re-inserts all the existing entries in it.
+ *
+ * The hash is recalculated for each entry. This happens rarely enough
+ * that keeping the full hash in the slots would be a waste of memory.
+ */
+void settings_table::grow()
+{
+    slot_vector_t slots(std::max(g_minimum_slots, f_slots.size() * 2));
+    std::size_t const mask(slots.size() - 1);
+    for(index_t idx(0); idx < f_entries.size(); ++idx)
+    {
+        std::uint64_t const h(hash(f_entries[idx].f_name));
+        std::size_t pos(h & mask);
+        while(slots[pos].f_index != NO_INDEX)
+        {
+            pos = (pos + 1) & mask;
+        }
+        slots[pos].f_hash = static_cast<std::uint32_t>(h);
+        slots[pos].f_index = idx;
+    }
+    f_slots.swap(slots);
+}
+
+
+
+} // namespace fluid_settings
+// vim: ts=4 sw=4 et
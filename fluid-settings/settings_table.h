@@ -0,0 +1,140 @@
+// Copyright (c) 2011-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+/** \file
+ * \brief Declaration of the table holding all the fluid settings values.
+ *
+ * The settings_table is the storage engine used by the settings class.
+ * Each setting name is interned once in the table and gets assigned an
+ * index which never changes for the lifetime of the table. The names are
+ * found using an open-addressing hash table and each entry holds all of
+ * its priorities inline.
+ */
+
+// self
+//
+#include    "priority_set.h"
+
+
+// advgetopt
+//
+#include    <advgetopt/advgetopt.h>
+
+
+// C++
+//
+#include    <cstdint>
+#include    <string>
+#include    <vector>
+
+
+
+namespace fluid_settings
+{
+
+
+
+class settings_table
+{
+public:
+    typedef std::uint32_t               index_t;
+
+    static constexpr index_t const      NO_INDEX = static_cast<index_t>(-1);
+
+    // the value returned by a GET at the highest priority, recalculated
+    // only when the values or the definition of the setting change; the
+    // buffer is shared with the value it comes from
+    //
+    struct effective_t
+    {
+        bool                    f_is_set = false;
+        bool                    f_is_default = false;
+        priority_t              f_priority = HIGHEST_PRIORITY;
+        value::buffer_t         f_value = value::buffer_t();
+        std::uint64_t           f_version = 0;
+    };
+
+    class entry
+    {
+    public:
+        std::string const &     get_name() const;
+        advgetopt::option_info::pointer_t const &
+                                get_option() const;
+        void                    set_option(advgetopt::option_info::pointer_t const & o);
+        std::uint32_t           get_definition() const;
+        void                    set_definition(std::uint32_t definition);
+        bool                    validate(std::string const & v) const;
+        value::buffer_t const & get_default() const;
+        priority_set &          get_values();
+        priority_set const &    get_values() const;
+        effective_t const &     get_effective() const;
+        void                    refresh_effective();
+
+    private:
+        friend class settings_table;
+
+        std::string             f_name = std::string();
+        advgetopt::option_info::pointer_t
+                                f_option = advgetopt::option_info::pointer_t();
+        advgetopt::validator::pointer_t
+                                f_validator = advgetopt::validator::pointer_t();
+        advgetopt::string_list_t
+                                f_separators = advgetopt::string_list_t();
+        value::buffer_t         f_default = value::buffer_t();
+        std::uint32_t           f_definition = 0;
+        priority_set            f_values = priority_set();
+        effective_t             f_effective = effective_t();
+    };
+
+    index_t                 find(std::string const & name) const;
+    index_t                 intern(std::string const & name);
+    std::size_t             size() const;
+    entry &                 get_entry(index_t idx);
+    entry const &           get_entry(index_t idx) const;
+    std::vector<index_t> const &
+                            sorted_indexes() const;
+    void                    clear();
+
+    value::buffer_t         make_buffer(std::string const & v) const;
+    std::size_t             compact();
+    memory_pool::stats_t    get_memory_stats() const;
+
+private:
+    struct slot_t
+    {
+        std::uint32_t       f_hash = 0;
+        index_t             f_index = NO_INDEX;
+    };
+    typedef std::vector<slot_t>     slot_vector_t;
+
+    static std::uint64_t    hash(std::string const & name);
+    void                    grow();
+
+    memory_pool::pointer_t  f_pool = std::make_shared<memory_pool>();
+    std::vector<entry>      f_entries = std::vector<entry>();
+    slot_vector_t           f_slots = slot_vector_t();
+    mutable std::vector<index_t>
+                            f_sorted = std::vector<index_t>();
+    mutable bool            f_sorted_valid = true;
+};
+
+
+
+} // namespace fluid_settings
+// vim: ts=4 sw=4 et
@@ -0,0 +1,292 @@
+// Copyright (c) 2011-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/** \file
+ * \brief Implementation of the immutable snapshots of the settings.
+ *
+ * The functions reading a snapshot follow the same rules as the
+ * corresponding functions of the settings class. The difference is that
+ * a snapshot is never modified so it can be read from any thread.
+ */
+
+// self
+//
+#include    "snapshot.h"
+
+#include    "value_codec.h"
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace fluid_settings
+{
+
+
+
+/** \class snapshot
+ * \brief A read-only version of the settings.
+ *
+ * The settings class creates a new snapshot when it gets modified and
+ * someone asks for the current snapshot. The records which did not
+ * change are shared between the old and new snapshots (see CHUNK_SIZE).
+ *
+ * All the values are shared buffers, so creating a record never copies
+ * any value.
+ */
+
+
+
+/** \brief Initialize the snapshot.
+ *
+ * \param[in] version  The version of this snapshot.
+ * \param[in] size  The number of records in this snapshot.
+ * \param[in] chunks  The chunks holding the records.
+ * \param[in] options  The comma separated list of options.
+ */
+snapshot::snapshot(
+          std::uint64_t version
+        , std::size_t size
+        , chunk_vector_t const & chunks
+        , value::buffer_t const & options)
+    : f_version(version)
+    , f_size(size)
+    , f_chunks(chunks)
+    , f_options(options)
+{
+}
+
+
+/** \brief Create the record of one setting.
+ *
+ * This function is used by the settings class to create a record from
+ * an entry of its table.
+ *
+ * \param[in] e  The entry to copy.
+ *
+ * \return The new record.
+ */
+snapshot::record_t snapshot::make_record(settings_table::entry const & e)
+{
+    record_t r;
+    r.f_name = std::make_shared<std::string const>(e.get_name());
+    r.f_defined = e.get_option() != nullptr;
+    r.f_effective = e.get_effective();
+    r.f_default = e.get_default();
+    r.f_definition = e.get_definition();
+
+    priority_set const & values(e.get_values());
+    if(!values.empty())
+    {
+        std::shared_ptr<value_list_t> list(std::make_shared<value_list_t>());
+        list->reserve(values.size());
+        for(auto const & v : values)
+        {
+            list->push_back({ v.get_priority(), v.get_buffer(), v.get_timestamp() });
+        }
+        r.f_values = list;
+    }
+
+    return r;
+}
+
+
+/** \brief Get the version of this snapshot.
+ *
+ * Each new snapshot gets a larger version.
+ *
+ * \return The version of this snapshot.
+ */
+std::uint64_t snapshot::get_version() const
+{
+    return f_version;
+}
+
+
+/** \brief Get the number of records.
+ *
+ * \return The number of records in this snapshot.
+ */
+std::size_t snapshot::size() const
+{
+    return f_size;
+}
+
+
+/** \brief Get the record of a setting.
+ *
+ * \param[in] id  The identifier of the setting.
+ *
+ * \return A pointer to the record or nullptr if \p id is out of bounds.
+ */
+snapshot::record_t const * snapshot::get_record(index_t id) const
+{
+    if(id >= f_size)
+    {
+        return nullptr;
+    }
+    return &(*f_chunks[id / CHUNK_SIZE])[id % CHUNK_SIZE];
+}
+
+
+/** \brief Get the list of options.
+ *
+ * This is the same list as returned by settings::list_of_options() at
+ * the time the snapshot was created.
+ *
+ * \return The comma separated list of option names.
+ */
+std::string const & snapshot::get_options() const
+{
+    return *f_options;
+}
+
+
+/** \brief Get the default value of a setting.
+ *
+ * \param[in] id  The identifier of the setting.
+ * \param[out] result  The buffer with the default value.
+ *
+ * \return One of the get_result_t::GET_RESULT_... values.
+ *
+ * \sa settings::get_default_value()
+ */
+get_result_t snapshot::get_default_value(
+      index_t id
+    , value::buffer_t & result) const
+{
+    record_t const * r(get_record(id));
+    if(r == nullptr
+    || !r->f_defined)
+    {
+        return get_result_t::GET_RESULT_UNKNOWN;
+    }
+
+    if(r->f_default == nullptr)
+    {
+        return get_result_t::GET_RESULT_NOT_SET;
+    }
+
+    result = r->f_default;
+    return get_result_t::GET_RESULT_DEFAULT;
+}
+
+
+/** \brief Get the value of a setting.
+ *
+ * \param[in] id  The identifier of the setting.
+ * \param[out] result  The buffer with the value.
+ * \param[in] priority  The value at that specific priority.
+ *
+ * \return One of the get_result_t::GET_RESULT_... values.
+ *
+ * \sa settings::get_buffer()
+ */
+get_result_t snapshot::get_buffer(
+      index_t id
+    , value::buffer_t & result
+    , priority_t priority) const
+{
+    record_t const * r(get_record(id));
+    if(r == nullptr
+    || !r->f_defined)
+    {
+        return get_result_t::GET_RESULT_UNKNOWN;
+    }
+
+    if(!r->f_effective.f_is_set)
+    {
+        return get_result_t::GET_RESULT_NOT_SET;
+    }
+
+    if(priority == HIGHEST_PRIORITY
+    || r->f_values == nullptr)
+    {
+        result = r->f_effective.f_value;
+        return r->f_effective.f_is_default
+                    ? get_result_t::GET_RESULT_DEFAULT
+                    : get_result_t::GET_RESULT_SUCCESS;
+    }
+
+    for(auto const & v : *r->f_values)
+    {
+        if(v.f_priority == priority)
+        {
+            result = v.f_value;
+            return get_result_t::GET_RESULT_SUCCESS;
+        }
+    }
+
+    return get_result_t::GET_RESULT_PRIORITY_NOT_FOUND;
+}
+
+
+/** \brief Get all the values of a setting.
+ *
+ * The values are returned as a comma separated list. Commas within the
+ * values are backslash escaped.
+ *
+ * \param[in] id  The identifier of the setting.
+ * \param[out] result  The list of values.
+ *
+ * \return One of the get_result_t::GET_RESULT_... values.
+ *
+ * \sa settings::get_value()
+ */
+get_result_t snapshot::get_all_values(
+      index_t id
+    , std::string & result) const
+{
+    record_t const * r(get_record(id));
+    if(r == nullptr
+    || !r->f_defined)
+    {
+        return get_result_t::GET_RESULT_UNKNOWN;
+    }
+
+    if(!r->f_effective.f_is_set)
+    {
+        return get_result_t::GET_RESULT_NOT_SET;
+    }
+
+    if(r->f_values == nullptr)
+    {
+        result = *r->f_effective.f_value;
+        return get_result_t::GET_RESULT_DEFAULT;
+    }
+
+    result.clear();
+    for(auto const & v : *r->f_values)
+    {
+        if(!result.empty())
+        {
+            result += ',';
+        }
+        escape_commas(result, *v.f_value);
+    }
+
+    return get_result_t::GET_RESULT_SUCCESS;
+}
+
+
+
+} // namespace fluid_settings
+// vim: ts=4 sw=4 et
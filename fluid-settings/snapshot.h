@@ -0,0 +1,115 @@
+// Copyright (c) 2011-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+/** \file
+ * \brief Declaration of the immutable snapshots of the settings.
+ *
+ * A snapshot is a read-only copy of the settings at a given version.
+ * It can be shared with other threads which can then answer requests
+ * without having to lock the settings.
+ *
+ * The records are saved in chunks. A new snapshot shares all the chunks
+ * which did not change with the previous snapshot.
+ */
+
+// self
+//
+#include    "result.h"
+#include    "settings_table.h"
+
+
+// C++
+//
+#include    <array>
+#include    <memory>
+#include    <vector>
+
+
+
+namespace fluid_settings
+{
+
+
+
+class snapshot
+{
+public:
+    typedef std::shared_ptr<snapshot const>     pointer_t;
+    typedef settings_table::index_t             index_t;
+
+    static constexpr std::size_t const          CHUNK_SIZE = 64;
+
+    struct priority_value_t
+    {
+        priority_t              f_priority = HIGHEST_PRIORITY;
+        value::buffer_t         f_value = value::buffer_t();
+        timestamp_t             f_timestamp = timestamp_t();
+    };
+    typedef std::vector<priority_value_t>       value_list_t;
+
+    struct record_t
+    {
+        value::buffer_t         f_name = value::buffer_t();
+        bool                    f_defined = false;
+        settings_table::effective_t
+                                f_effective = settings_table::effective_t();
+        value::buffer_t         f_default = value::buffer_t();
+        std::uint32_t           f_definition = 0;
+        std::shared_ptr<value_list_t const>
+                                f_values = std::shared_ptr<value_list_t const>();
+    };
+
+    typedef std::array<record_t, CHUNK_SIZE>    chunk_t;
+    typedef std::shared_ptr<chunk_t const>      chunk_pointer_t;
+    typedef std::vector<chunk_pointer_t>        chunk_vector_t;
+
+                            snapshot(
+                                  std::uint64_t version
+                                , std::size_t size
+                                , chunk_vector_t const & chunks
+                                , value::buffer_t const & options);
+
+    static record_t         make_record(settings_table::entry const & e);
+
+    std::uint64_t           get_version() const;
+    std::size_t             size() const;
+    record_t const *        get_record(index_t id) const;
+    std::string const &     get_options() const;
+    get_result_t            get_default_value(
+                                  index_t id
+                                , value::buffer_t & result) const;
+    get_result_t            get_buffer(
+                                  index_t id
+                                , value::buffer_t & result
+                                , priority_t priority = HIGHEST_PRIORITY) const;
+    get_result_t            get_all_values(
+                                  index_t id
+                                , std::string & result) const;
+
+private:
+    std::uint64_t           f_version = 0;
+    std::size_t             f_size = 0;
+    chunk_vector_t          f_chunks = chunk_vector_t();
+    value::buffer_t         f_options = value::buffer_t();
+};
+
+
+
+} // namespace fluid_settings
+// vim: ts=4 sw=4 et
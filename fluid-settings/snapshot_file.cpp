@@ -0,0 +1,654 @@
+// Copyright (c) 2011-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/** \file
+ * \brief Implementation of the binary settings file.
+ *
+ * The file is one or more segments:
+ *
+ * \code
+ *     header:
+ *         uint32_t     magic ("FLSS")
+ *         uint32_t     version
+ *         uint32_t     number of records
+ *         uint32_t     flags (SEGMENT_FLAG_DELTA, SEGMENT_FLAG_LAST)
+ *         uint64_t     size of the body
+ *     body:
+ *         records:
+ *             uint32_t     size of the record
+ *             uint32_t     fingerprint of the definition of the setting
+ *             record       the values of one setting (see record.cpp)
+ *     trailer:
+ *         uint32_t     CRC32C of the header and body
+ * \endcode
+ *
+ * Each save writes one or more segments of about BLOCK_SIZE bytes, each
+ * with its own checksum. The last segment of a save is marked with
+ * SEGMENT_FLAG_LAST. A save which is not complete is ignored as a whole.
+ *
+ * The first save includes all the settings. The following saves, marked
+ * with SEGMENT_FLAG_DELTA, only include the settings which changed since
+ * the previous save. A setting without values in a delta was reset.
+ *
+ * The fingerprint identifies the definition the values were validated
+ * against (see settings::load_definitions()). 0 means unknown.
+ *
+ * The records of a save are sorted by name. All the numbers are saved
+ * in little endian.
+ */
+
+// self
+//
+#include    "snapshot_file.h"
+
+#include    "crc32c.h"
+
+
+// snaplogger
+//
+#include    <snaplogger/message.h>
+
+
+// snapdev
+//
+#include    <snapdev/raii_generic_deleter.h>
+
+
+// C
+//
+#include    <errno.h>
+#include    <fcntl.h>
+#include    <libgen.h>
+#include    <string.h>
+#include    <sys/mman.h>
+#include    <sys/stat.h>
+#include    <unistd.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace fluid_settings
+{
+
+
+
+/** \brief Write a buffer to a file descriptor.
+ *
+ * The write() is repeated until all the \p data was written or an
+ * error other than EINTR occurs.
+ *
+ * \param[in] fd  The file descriptor to write to.
+ * \param[in] data  The data to write.
+ *
+ * \return true if all the data was written, false otherwise (see errno).
+ */
+bool write_all(int fd, std::string const & data)
+{
+    std::size_t written(0);
+    while(written < data.length())
+    {
+        ssize_t const r(::write(fd, data.data() + written, data.length() - written));
+        if(r < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        written += r;
+    }
+    return true;
+}
+
+
+
+/** \class snapshot_file
+ * \brief Save and load the settings in binary.
+ *
+ * To save the settings, call add() once per setting, in order, and
+ * then save(). The file is first written to a temporary file which gets
+ * synchronized to disk and then renamed. This way the file is always
+ * either the old or the new version, never a mix.
+ *
+ * To save only the settings which changed, call add() for those and then
+ * append(). The new segment gets appended to the existing file. If the
+ * computer crashes while appending, the partial segment is ignored on
+ * the next load().
+ *
+ * To load the settings, call load() which memory maps the file and
+ * verifies the checksums. Then call next() until it returns false to
+ * read each record, in the order they were saved.
+ */
+
+
+
+snapshot_file::snapshot_file(std::string const & filename)
+    : f_filename(filename)
+{
+}
+
+
+snapshot_file::~snapshot_file()
+{
+    unmap();
+}
+
+
+std::string const & snapshot_file::get_filename() const
+{
+    return f_filename;
+}
+
+
+/** \brief Do not log the errors of save() and append().
+ *
+ * A forked child must not log since another thread of the parent may
+ * have held the logger lock at the time of the fork(). The caller can
+ * instead report the error returned by get_errno().
+ *
+ * \param[in] quiet  Whether the errors get logged.
+ */
+void snapshot_file::set_quiet(bool quiet)
+{
+    f_quiet = quiet;
+}
+
+
+/** \brief Get the errno of the last save() or append() which failed.
+ *
+ * \return The errno of the failure, 0 if none.
+ */
+int snapshot_file::get_errno() const
+{
+    return f_errno;
+}
+
+
+/** \brief Add the values of one setting.
+ *
+ * The settings must be added sorted by name.
+ *
+ * \param[in] name  The name of the setting.
+ * \param[in] values  The values of the setting.
+ * \param[in] definition  The fingerprint of the definition of the setting.
+ */
+void snapshot_file::add(
+      std::string const & name
+    , priority_set const & values
+    , std::uint32_t definition)
+{
+    std::string::size_type const pos(f_body.length());
+    encode_uint(f_body, 0, 4);
+    encode_uint(f_body, definition, 4);
+    encode_record(f_body, name, values);
+    end_record(pos);
+}
+
+
+/** \brief Add the values of one setting from a snapshot.
+ *
+ * The settings must be added sorted by name.
+ *
+ * \param[in] name  The name of the setting.
+ * \param[in] values  The values of the setting; may be nullptr.
+ * \param[in] definition  The fingerprint of the definition of the setting.
+ */
+void snapshot_file::add(
+      std::string const & name
+    , snapshot::value_list_t const * values
+    , std::uint32_t definition)
+{
+    std::string::size_type const pos(f_body.length());
+    encode_uint(f_body, 0, 4);
+    encode_uint(f_body, definition, 4);
+    encode_record(f_body, name, values);
+    end_record(pos);
+}
+
+
+/** \brief Save the size of the record which starts at \p pos.
+ *
+ * \param[in] pos  The position of the size of the record in the body.
+ */
+void snapshot_file::end_record(std::string::size_type pos)
+{
+    std::string size;
+    encode_uint(size, f_body.length() - pos - 4, 4);
+    f_body.replace(pos, 4, size);
+
+    ++f_count;
+
+    // start a new block once this one is large enough
+    //
+    std::size_t const start(f_blocks.empty() ? 0 : f_blocks.back().f_end);
+    if(f_body.length() - start >= BLOCK_SIZE)
+    {
+        block_t b;
+        b.f_end = f_body.length();
+        b.f_count = f_count;
+        f_blocks.push_back(b);
+    }
+}
+
+
+/** \brief Create the segments with the records added so far.
+ *
+ * The records are cut in blocks of about BLOCK_SIZE bytes, each saved
+ * in its own segment. The last segment gets the SEGMENT_FLAG_LAST flag.
+ * Without any records, one empty segment is created.
+ *
+ * \param[in] flags  The flags of the segments.
+ *
+ * \return The header, body and trailer of each segment.
+ */
+std::string snapshot_file::make_segments(std::uint32_t flags) const
+{
+    std::vector<block_t> blocks(f_blocks);
+    if(blocks.empty()
+    || blocks.back().f_end != f_body.length())
+    {
+        block_t b;
+        b.f_end = f_body.length();
+        b.f_count = f_count;
+        blocks.push_back(b);
+    }
+
+    std::string segments;
+    segments.reserve(blocks.size() * (HEADER_SIZE + TRAILER_SIZE) + f_body.length());
+    block_t previous;
+    for(std::size_t idx(0); idx < blocks.size(); ++idx)
+    {
+        std::size_t const start(segments.length());
+        std::size_t const size(blocks[idx].f_end - previous.f_end);
+        encode_uint(segments, MAGIC, 4);
+        encode_uint(segments, VERSION, 4);
+        encode_uint(segments, blocks[idx].f_count - previous.f_count, 4);
+        encode_uint(segments, flags | (idx + 1 == blocks.size() ? SEGMENT_FLAG_LAST : 0), 4);
+        encode_uint(segments, size, 8);
+        segments.append(f_body, previous.f_end, size);
+        encode_uint(segments, crc32c(segments.data() + start, segments.length() - start), 4);
+        previous = blocks[idx];
+    }
+    return segments;
+}
+
+
+/** \brief Write the file.
+ *
+ * The file gets written to a temporary file, synchronized to disk and
+ * then renamed over the existing file.
+ *
+ * \return true if the file was saved.
+ */
+bool snapshot_file::save()
+{
+    std::string const segments(make_segments(0));
+
+    std::string const tmp(f_filename + ".tmp");
+    snapdev::raii_fd_t fd(::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0640));
+    if(fd == nullptr)
+    {
+        int const e(errno);
+        f_errno = e;
+        if(!f_quiet)
+        {
+            SNAP_LOG_ERROR
+                << "could not create \""
+                << tmp
+                << "\" (errno: "
+                << e
+                << ", "
+                << strerror(e)
+                << ")."
+                << SNAP_LOG_SEND;
+        }
+        return false;
+    }
+
+    if(!write_all(fd.get(), segments)
+    || fsync(fd.get()) != 0)
+    {
+        int const e(errno);
+        f_errno = e;
+        if(!f_quiet)
+        {
+            SNAP_LOG_ERROR
+                << "could not write \""
+                << tmp
+                << "\" (errno: "
+                << e
+                << ", "
+                << strerror(e)
+                << ")."
+                << SNAP_LOG_SEND;
+        }
+        fd.reset();
+        unlink(tmp.c_str());
+        return false;
+    }
+
+    // keep the previous version in case this one gets corrupted
+    //
+    std::string const bak(f_filename + ".bak");
+    unlink(bak.c_str());
+    if(link(f_filename.c_str(), bak.c_str()) != 0
+    && errno != ENOENT
+    && !f_quiet)
+    {
+        SNAP_LOG_WARNING
+            << "could not create backup \""
+            << bak
+            << "\"."
+            << SNAP_LOG_SEND;
+    }
+
+    if(rename(tmp.c_str(), f_filename.c_str()) != 0)
+    {
+        int const e(errno);
+        f_errno = e;
+        if(!f_quiet)
+        {
+            SNAP_LOG_ERROR
+                << "could not save \""
+                << f_filename
+                << "\" (errno: "
+                << e
+                << ", "
+                << strerror(e)
+                << ")."
+                << SNAP_LOG_SEND;
+        }
+        fd.reset();
+        unlink(tmp.c_str());
+        return false;
+    }
+    fd.reset();
+
+    // make sure the rename() itself is on disk
+    //
+    std::string dir(f_filename);
+    snapdev::raii_fd_t dfd(::open(dirname(&dir[0]), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+    if(dfd != nullptr)
+    {
+        fsync(dfd.get());
+    }
+
+    f_file_size = segments.length();
+    f_base_size = segments.length();
+
+    return true;
+}
+
+
+/** \brief Append a delta segment to the file.
+ *
+ * The file is first truncated to \p valid_size, which removes a partial
+ * segment left by a crash. Then the segment gets appended and the file
+ * synchronized to disk.
+ *
+ * \param[in] valid_size  The size of the file as known by the caller.
+ *
+ * \return true if the segment was appended.
+ */
+bool snapshot_file::append(std::size_t valid_size)
+{
+    std::string const segments(make_segments(SEGMENT_FLAG_DELTA));
+
+    snapdev::raii_fd_t fd(::open(f_filename.c_str(), O_WRONLY | O_CLOEXEC));
+    if(fd == nullptr
+    || ftruncate(fd.get(), valid_size) != 0
+    || lseek(fd.get(), valid_size, SEEK_SET) != static_cast<off_t>(valid_size)
+    || !write_all(fd.get(), segments)
+    || fdatasync(fd.get()) != 0)
+    {
+        int const e(errno);
+        f_errno = e;
+        if(!f_quiet)
+        {
+            SNAP_LOG_ERROR
+                << "could not append to \""
+                << f_filename
+                << "\" (errno: "
+                << e
+                << ", "
+                << strerror(e)
+                << ")."
+                << SNAP_LOG_SEND;
+        }
+        return false;
+    }
+
+    f_file_size = valid_size + segments.length();
+
+    return true;
+}
+
+
+/** \brief Map the file in memory and verify it.
+ *
+ * \return false if the file does not exist or is not valid.
+ */
+bool snapshot_file::load()
+{
+    unmap();
+
+    snapdev::raii_fd_t fd(::open(f_filename.c_str(), O_RDONLY | O_CLOEXEC));
+    if(fd == nullptr)
+    {
+        return false;
+    }
+    struct stat st = {};
+    if(fstat(fd.get(), &st) != 0
+    || static_cast<std::size_t>(st.st_size) < HEADER_SIZE + TRAILER_SIZE)
+    {
+        SNAP_LOG_ERROR
+            << "settings file \""
+            << f_filename
+            << "\" is too small."
+            << SNAP_LOG_SEND;
+        return false;
+    }
+
+    void * map(mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd.get(), 0));
+    if(map == MAP_FAILED)
+    {
+        return false;
+    }
+    f_map = static_cast<char const *>(map);
+    f_map_size = st.st_size;
+
+    // verify each segment; a bad segment after the first save is the
+    // result of a crash while appending, we ignore that save and what
+    // follows
+    //
+    f_count = 0;
+    std::size_t pos(0);
+    std::size_t valid_size(0);
+    std::size_t valid_segments(0);
+    std::uint32_t count(0);
+    while(f_map_size - pos >= HEADER_SIZE + TRAILER_SIZE)
+    {
+        char const * h(f_map + pos);
+        std::uint64_t const body_size(decode_uint(h + 16, 8));
+        std::uint32_t const flags(decode_uint(h + 12, 4));
+        bool const delta((flags & SEGMENT_FLAG_DELTA) != 0);
+        if(decode_uint(h, 4) != MAGIC
+        || decode_uint(h + 4, 4) != VERSION
+        || delta != (valid_segments != 0)
+        || body_size > f_map_size - pos - HEADER_SIZE - TRAILER_SIZE)
+        {
+            break;
+        }
+        std::size_t const end(pos + HEADER_SIZE + body_size);
+        if(crc32c(h, HEADER_SIZE + body_size) != decode_uint(f_map + end, 4))
+        {
+            break;
+        }
+
+        segment_t seg;
+        seg.f_pos = pos + HEADER_SIZE;
+        seg.f_end = end;
+        f_segments.push_back(seg);
+        count += decode_uint(h + 8, 4);
+        pos = end + TRAILER_SIZE;
+
+        if((flags & SEGMENT_FLAG_LAST) != 0)
+        {
+            if(valid_segments == 0)
+            {
+                f_base_size = pos;
+            }
+            valid_segments = f_segments.size();
+            valid_size = pos;
+            f_count += count;
+            count = 0;
+        }
+    }
+    f_segments.resize(valid_segments);
+
+    if(f_segments.empty())
+    {
+        SNAP_LOG_ERROR
+            << "file \""
+            << f_filename
+            << "\" is not a valid binary settings file (invalid checksum, or its version is not supported)."
+            << SNAP_LOG_SEND;
+        unmap();
+        return false;
+    }
+    if(valid_size != f_map_size)
+    {
+        SNAP_LOG_WARNING
+            << "settings file \""
+            << f_filename
+            << "\" ends with an incomplete or corrupted segment; "
+            << f_map_size - valid_size
+            << " bytes ignored."
+            << SNAP_LOG_SEND;
+    }
+
+    f_file_size = valid_size;
+    f_segment = 0;
+    f_pos = f_segments[0].f_pos;
+
+    return true;
+}
+
+
+/** \brief The number of records.
+ *
+ * \return The number of records added or loaded.
+ */
+std::size_t snapshot_file::size() const
+{
+    return f_count;
+}
+
+
+/** \brief The size of the valid part of the file.
+ *
+ * After a load(), save() or append(), this is the size of the file
+ * without any partial segment. It is the \p valid_size to pass to the
+ * next append().
+ *
+ * \return The size of the file in bytes.
+ */
+std::size_t snapshot_file::get_file_size() const
+{
+    return f_file_size;
+}
+
+
+/** \brief The size of the first segment.
+ *
+ * The first segment includes all the settings. When the delta segments
+ * become larger than the first segment, it is time to save() the whole
+ * file again.
+ *
+ * \return The size of the first segment in bytes.
+ */
+std::size_t snapshot_file::get_base_size() const
+{
+    return f_base_size;
+}
+
+
+/** \brief Read the next record.
+ *
+ * \param[out] record  The next record.
+ *
+ * \return false once all the records were read.
+ */
+bool snapshot_file::next(record_t & record)
+{
+    while(f_segment < f_segments.size()
+       && f_segments[f_segment].f_end - f_pos < 4)
+    {
+        ++f_segment;
+        if(f_segment < f_segments.size())
+        {
+            f_pos = f_segments[f_segment].f_pos;
+        }
+    }
+    if(f_segment >= f_segments.size())
+    {
+        return false;
+    }
+
+    std::size_t const end(f_segments[f_segment].f_end);
+    std::size_t const size(decode_uint(f_map + f_pos, 4));
+    f_pos += 4;
+    if(end - f_pos < size
+    || size < 4
+    || !decode_record(f_map + f_pos + 4, size - 4, record))
+    {
+        SNAP_LOG_ERROR
+            << "settings file \""
+            << f_filename
+            << "\" includes an invalid record."
+            << SNAP_LOG_SEND;
+        f_segment = f_segments.size();
+        return false;
+    }
+    record.f_definition = decode_uint(f_map + f_pos, 4);
+    f_pos += size;
+
+    return true;
+}
+
+
+void snapshot_file::unmap()
+{
+    if(f_map != nullptr)
+    {
+        munmap(const_cast<char *>(f_map), f_map_size);
+        f_map = nullptr;
+        f_map_size = 0;
+    }
+    f_segments.clear();
+}
+
+
+
+} // namespace fluid_settings
+// vim: ts=4 sw=4 et
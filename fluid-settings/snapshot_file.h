@@ -0,0 +1,135 @@
+// Copyright (c) 2011-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+/** \file
+ * \brief Declaration of the binary settings file.
+ *
+ * The settings are saved in a binary file which can be memory mapped
+ * and loaded without having to parse text. The settings.conf file is
+ * still available as an export.
+ */
+
+// self
+//
+#include    "record.h"
+
+
+// C++
+//
+#include    <string>
+#include    <vector>
+
+
+
+namespace fluid_settings
+{
+
+
+
+bool                    write_all(int fd, std::string const & data);
+
+
+// the decoded content of a binary settings file
+//
+struct snapshot_content_t
+{
+    std::string             f_filename = std::string();
+    bool                    f_loaded = false;
+    bool                    f_backup = false;       // loaded from the ".bak" file
+    record_vector_t         f_records = record_vector_t();
+    std::size_t             f_file_size = 0;
+    std::size_t             f_base_size = 0;
+};
+
+
+class snapshot_file
+{
+public:
+    static constexpr std::uint32_t const    MAGIC = 0x53534C46;     // "FLSS"
+    static constexpr std::uint32_t const    VERSION = 3;
+    static constexpr std::size_t const      HEADER_SIZE = 24;       // magic, version, count, flags, body size
+    static constexpr std::size_t const      TRAILER_SIZE = 4;       // crc32c
+
+    static constexpr std::size_t const      BLOCK_SIZE = 64 * 1024;
+
+    static constexpr std::uint32_t const    SEGMENT_FLAG_DELTA = 0x0001;
+    static constexpr std::uint32_t const    SEGMENT_FLAG_LAST = 0x0002;
+
+                            snapshot_file(std::string const & filename);
+                            snapshot_file(snapshot_file const &) = delete;
+                            ~snapshot_file();
+    snapshot_file &         operator = (snapshot_file const &) = delete;
+
+    std::string const &     get_filename() const;
+    void                    set_quiet(bool quiet);
+    int                     get_errno() const;
+
+    void                    add(
+                                  std::string const & name
+                                , priority_set const & values
+                                , std::uint32_t definition = 0);
+    void                    add(
+                                  std::string const & name
+                                , snapshot::value_list_t const * values
+                                , std::uint32_t definition = 0);
+    bool                    save();
+    bool                    append(std::size_t valid_size);
+
+    bool                    load();
+    std::size_t             size() const;
+    std::size_t             get_file_size() const;
+    std::size_t             get_base_size() const;
+    bool                    next(record_t & record);
+
+private:
+    struct segment_t
+    {
+        std::size_t             f_pos = 0;
+        std::size_t             f_end = 0;
+    };
+
+    struct block_t
+    {
+        std::size_t             f_end = 0;
+        std::uint32_t           f_count = 0;
+    };
+
+    void                    end_record(std::string::size_type pos);
+    std::string             make_segments(std::uint32_t flags) const;
+    void                    unmap();
+
+    std::string             f_filename = std::string();
+    bool                    f_quiet = false;
+    int                     f_errno = 0;
+    std::string             f_body = std::string();
+    std::uint32_t           f_count = 0;
+    std::vector<block_t>    f_blocks = std::vector<block_t>();
+    std::size_t             f_file_size = 0;
+    std::size_t             f_base_size = 0;
+    char const *            f_map = nullptr;
+    std::size_t             f_map_size = 0;
+    std::vector<segment_t>  f_segments = std::vector<segment_t>();
+    std::size_t             f_segment = 0;
+    std::size_t             f_pos = 0;
+};
+
+
+
+} // namespace fluid_settings
+// vim: ts=4 sw=4 et
@@ -54,12 +54,32 @@ constexpr time_t const      g_oldest_fluid_setting_date = snapdev::unix_timestam
 
 timestamp_t const           g_oldest_fluid_setting(g_oldest_fluid_setting_date, 0);
 
+std::string const           g_empty_value = std::string();
+
 
 
 void value::set_value(
       std::string const & v
     , priority_t priority
     , timestamp_t const & timestamp)
+{
+    set_value(std::make_shared<std::string const>(v), priority, timestamp);
+}
+
+
+/** \brief Set the value from an existing buffer.
+ *
+ * This function is used when the buffer was allocated by the caller,
+ * for example from the memory pool of the settings_table.
+ *
+ * \param[in] v  The buffer with the new value.
+ * \param[in] priority  The priority of the value.
+ * \param[in] timestamp  The time when the value was set.
+ */
+void value::set_value(
+      buffer_t const & v
+    , priority_t priority
+    , timestamp_t const & timestamp)
 {
     if(priority < MINIMUM_PRIORITY
     || priority > MAXIMUM_PRIORITY)
@@ -89,7 +109,45 @@ void value::set_value(
 }
 
 
+/** \brief Set the value without checking it.
+ *
+ * This function is used to load values which were checked by set_value()
+ * before they were saved in a file protected by checksums.
+ *
+ * \param[in] v  The buffer with the new value.
+ * \param[in] priority  The priority of the value.
+ * \param[in] timestamp  The time when the value was set.
+ */
+void value::set_trusted_value(
+      buffer_t const & v
+    , priority_t priority
+    , timestamp_t const & timestamp)
+{
+    f_value = v;
+    f_priority = priority;
+    f_timestamp = timestamp;
+}
+
+
 std::string const & value::get_value() const
+{
+    if(f_value == nullptr)
+    {
+        return g_empty_value;
+    }
+    return *f_value;
+}
+
+
+/** \brief Get the shared buffer holding this value.
+ *
+ * The buffer is immutable. Setting a new value allocates a new buffer so
+ * a caller holding a reference to this one can keep using it for as long
+ * as it wants, even after the setting changed or got reset.
+ *
+ * \return The buffer with the value or a nullptr if the value was never set.
+ */
+value::buffer_t const & value::get_buffer() const
 {
     return f_value;
 }
@@ -113,6 +171,27 @@ bool value::operator < (value const & rhs) const
 }
 
 
+/** \brief Check whether set_value() would accept these parameters.
+ *
+ * Values received from other fluid-settings or read from files must be
+ * checked with this function before calling set_value() since an
+ * exception would abort the whole batch.
+ *
+ * \param[in] priority  The priority of the value.
+ * \param[in] timestamp  The time when the value was set.
+ *
+ * \return true if the priority and the timestamp are valid.
+ */
+bool value::is_valid(
+      priority_t priority
+    , timestamp_t const & timestamp)
+{
+    return priority >= MINIMUM_PRIORITY
+        && priority <= MAXIMUM_PRIORITY
+        && timestamp >= g_oldest_fluid_setting;
+}
+
+
 
 } // namespace fluid_settings
 // vim: ts=4 sw=4 et
@@ -34,7 +34,7 @@
  * The timestamp is specific to a value at a given priority. We need it
  * to make sure that we keep the last value being set.
  */
-#pragma
+#pragma once
 
 // snapdev
 //
@@ -44,7 +44,10 @@
 // C++
 //
 #include    <map>
+#include    <memory>
 #include    <set>
+#include    <string>
+#include    <vector>
 
 
 
@@ -78,24 +81,47 @@ constexpr priority_t const      MAXIMUM_PRIORITY = 99;
 
 // one value class holds a value, its priority and timestamp
 //
+// the value itself is kept in an immutable shared buffer so it can be
+// handed out (replies, notifications, effective value) without a copy
+//
 class value
 {
 public:
-    typedef std::set<value>                     set_t;
-    typedef std::map<std::string, value::set_t> map_t;
+    typedef std::vector<value>                  vector_t;
+    typedef std::shared_ptr<std::string const>  buffer_t;
+
+    // kept for backward compatibility, the settings use priority_set
+    //
+    using set_t [[deprecated("use fluid_settings::priority_set")]]
+                                                = std::set<value>;
+    using map_t [[deprecated("use fluid_settings::settings_table")]]
+                                                = std::map<std::string, std::set<value>>;
 
     void                    set_value(
                                   std::string const & v
                                 , priority_t priority
                                 , timestamp_t const & timestamp);
+    void                    set_value(
+                                  buffer_t const & v
+                                , priority_t priority
+                                , timestamp_t const & timestamp);
+    void                    set_trusted_value(
+                                  buffer_t const & v
+                                , priority_t priority
+                                , timestamp_t const & timestamp);
     std::string const &     get_value() const;
+    buffer_t const &        get_buffer() const;
     priority_t              get_priority() const;
     timestamp_t const &     get_timestamp() const;
 
     bool                    operator < (value const & rhs) const;
 
+    static bool             is_valid(
+                                  priority_t priority
+                                , timestamp_t const & timestamp);
+
 private:
-    std::string             f_value = std::string();
+    buffer_t                f_value = buffer_t();
     int                     f_priority = ADMINISTRATOR_PRIORITY;
     timestamp_t             f_timestamp = timestamp_t();
 };
@@ -0,0 +1,443 @@
+// Copyright (c) 2022-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/** \file
+ * \brief Implementation of the encoding of the serialized values.
+ *
+ * The escaping searches for the next special character 16 or 32 bytes
+ * at a time with SSE2 or AVX2 and copies the characters in between in
+ * one go. The unescaping and the escaping of commas only search for one
+ * character which memchr() already does that way.
+ *
+ * The result is exactly the same as the previous implementation which
+ * called snapdev::string_replace_many() with the following patterns:
+ *
+ * \code
+ *     escape:   "|" -> "\\P", "\\" -> "\\S", "\n" -> "\\n", "\r" -> "\\r"
+ *     unescape: "\\P" -> "|", "\\S" -> "\\", "\\n" -> "\n", "\\r" -> "\r"
+ *     commas:   "," -> "\\,"
+ * \endcode
+ *
+ * A backslash followed by any other character is kept as is by the
+ * unescape.
+ */
+
+// self
+//
+#include    "value_codec.h"
+
+#include    "settings.h"
+
+
+// C++
+//
+#include    <charconv>
+
+
+// C
+//
+#include    <string.h>
+
+#if defined(__x86_64__)
+#include    <immintrin.h>
+#endif
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace fluid_settings
+{
+
+
+
+namespace
+{
+
+
+
+typedef char const * (*scan_t)(char const * s, char const * end);
+
+
+bool is_special(char c)
+{
+    return c == settings::FIELD_SEPARATOR
+        || c == '\\'
+        || c == '\n'
+        || c == '\r';
+}
+
+
+char const * scan_portable(char const * s, char const * end)
+{
+    for(; s < end; ++s)
+    {
+        if(is_special(*s))
+        {
+            return s;
+        }
+    }
+    return end;
+}
+
+
+#if defined(__x86_64__)
+char const * scan_sse2(char const * s, char const * end)
+{
+    __m128i const separator(_mm_set1_epi8(settings::FIELD_SEPARATOR));
+    __m128i const backslash(_mm_set1_epi8('\\'));
+    __m128i const newline(_mm_set1_epi8('\n'));
+    __m128i const carriage_return(_mm_set1_epi8('\r'));
+    for(; end - s >= 16; s += 16)
+    {
+        __m128i const v(_mm_loadu_si128(reinterpret_cast<__m128i const *>(s)));
+        __m128i const m(_mm_or_si128(
+                  _mm_or_si128(_mm_cmpeq_epi8(v, separator), _mm_cmpeq_epi8(v, backslash))
+                , _mm_or_si128(_mm_cmpeq_epi8(v, newline), _mm_cmpeq_epi8(v, carriage_return))));
+        int const bits(_mm_movemask_epi8(m));
+        if(bits != 0)
+        {
+            return s + __builtin_ctz(bits);
+        }
+    }
+    return scan_portable(s, end);
+}
+
+
+__attribute__((target("avx2")))
+char const * scan_avx2(char const * s, char const * end)
+{
+    __m256i const separator(_mm256_set1_epi8(settings::FIELD_SEPARATOR));
+    __m256i const backslash(_mm256_set1_epi8('\\'));
+    __m256i const newline(_mm256_set1_epi8('\n'));
+    __m256i const carriage_return(_mm256_set1_epi8('\r'));
+    for(; end - s >= 32; s += 32)
+    {
+        __m256i const v(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(s)));
+        __m256i const m(_mm256_or_si256(
+                  _mm256_or_si256(_mm256_cmpeq_epi8(v, separator), _mm256_cmpeq_epi8(v, backslash))
+                , _mm256_or_si256(_mm256_cmpeq_epi8(v, newline), _mm256_cmpeq_epi8(v, carriage_return))));
+        unsigned int const bits(_mm256_movemask_epi8(m));
+        if(bits != 0)
+        {
+            return s + __builtin_ctz(bits);
+        }
+    }
+    return scan_sse2(s, end);
+}
+
+
+scan_t select_scan()
+{
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+    {
+        return scan_avx2;
+    }
+    return scan_sse2;
+}
+#else
+scan_t select_scan()
+{
+    return scan_portable;
+}
+#endif
+
+
+scan_t get_scan()
+{
+    static scan_t const scan(select_scan());
+    return scan;
+}
+
+
+
+} // no name namespace
+
+
+
+/** \brief Escape a value so it can be serialized.
+ *
+ * The escaped \p value gets appended to \p out. The characters in
+ * between the special characters are copied in blocks.
+ *
+ * \param[in,out] out  The buffer receiving the escaped value.
+ * \param[in] value  The value to escape.
+ */
+void escape_value(
+      std::string & out
+    , std::string_view value)
+{
+    // most values have no or very few special characters
+    //
+    out.reserve(out.size() + value.size() + 16);
+
+    scan_t const scan(get_scan());
+    char const * s(value.data());
+    char const * const end(s + value.size());
+    for(;;)
+    {
+        char const * const special(scan(s, end));
+        out.append(s, special - s);
+        if(special == end)
+        {
+            return;
+        }
+
+        out += '\\';
+        switch(*special)
+        {
+        case settings::FIELD_SEPARATOR:
+            out += 'P';
+            break;
+
+        case '\\':
+            out += 'S';
+            break;
+
+        case '\n':
+            out += 'n';
+            break;
+
+        default: // '\r'
+            out += 'r';
+            break;
+
+        }
+        s = special + 1;
+    }
+}
+
+
+/** \brief Restore a value escaped by escape_value().
+ *
+ * The unescaped \p value gets appended to \p out.
+ *
+ * \param[in,out] out  The buffer receiving the value.
+ * \param[in] value  The escaped value.
+ */
+void unescape_value(
+      std::string & out
+    , std::string_view value)
+{
+    out.reserve(out.size() + value.size());
+
+    char const * s(value.data());
+    char const * const end(s + value.size());
+    while(s < end)
+    {
+        char const * const backslash(static_cast<char const *>(memchr(s, '\\', end - s)));
+        if(backslash == nullptr)
+        {
+            out.append(s, end - s);
+            return;
+        }
+        out.append(s, backslash - s);
+        s = backslash + 1;
+
+        char c('\\');
+        if(s < end)
+        {
+            switch(*s)
+            {
+            case 'P':
+                c = settings::FIELD_SEPARATOR;
+                ++s;
+                break;
+
+            case 'S':
+                ++s;
+                break;
+
+            case 'n':
+                c = '\n';
+                ++s;
+                break;
+
+            case 'r':
+                c = '\r';
+                ++s;
+                break;
+
+            }
+        }
+        out += c;
+    }
+}
+
+
+/** \brief Escape the commas of a value.
+ *
+ * This is used to return a list of values separated by commas. The
+ * escaped \p value gets appended to \p out.
+ *
+ * \param[in,out] out  The buffer receiving the escaped value.
+ * \param[in] value  The value to escape.
+ */
+void escape_commas(
+      std::string & out
+    , std::string_view value)
+{
+    out.reserve(out.size() + value.size() + 8);
+
+    char const * s(value.data());
+    char const * const end(s + value.size());
+    while(s < end)
+    {
+        char const * const comma(static_cast<char const *>(memchr(s, ',', end - s)));
+        if(comma == nullptr)
+        {
+            out.append(s, end - s);
+            return;
+        }
+        out.append(s, comma - s);
+        out += "\\,";
+        s = comma + 1;
+    }
+}
+
+
+/** \brief Get the name of the implementation used by escape_value().
+ *
+ * \return "avx2", "sse2", or "portable".
+ */
+char const * escape_implementation()
+{
+#if defined(__x86_64__)
+    scan_t const scan(get_scan());
+    if(scan == scan_avx2)
+    {
+        return "avx2";
+    }
+    if(scan == scan_sse2)
+    {
+        return "sse2";
+    }
+#endif
+    return "portable";
+}
+
+
+
+/** \class serialized_parser
+ * \brief Parse the output of settings::serialize_value().
+ *
+ * The parser returns views of the input buffer so the lines and fields
+ * are not copied. Only the unescaped value needs a buffer.
+ */
+
+
+
+/** \brief Initialize the parser.
+ *
+ * The \p input buffer must remain valid while the parser is used.
+ *
+ * \param[in] input  The serialized values.
+ */
+serialized_parser::serialized_parser(std::string_view input)
+    : f_input(input)
+{
+}
+
+
+/** \brief Get the next line.
+ *
+ * Empty lines are skipped.
+ *
+ * \param[out] line  The next line, without the newline character.
+ *
+ * \return false once all the lines were returned.
+ */
+bool serialized_parser::next_line(std::string_view & line)
+{
+    while(!f_input.empty())
+    {
+        std::string_view::size_type const pos(f_input.find(settings::VALUE_SEPARATOR));
+        if(pos == std::string_view::npos)
+        {
+            line = f_input;
+            f_input = std::string_view();
+        }
+        else
+        {
+            line = f_input.substr(0, pos);
+            f_input.remove_prefix(pos + 1);
+        }
+        if(!line.empty())
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/** \brief Parse one line.
+ *
+ * A line has exactly three fields: the priority, the timestamp in
+ * nanoseconds, and the escaped value.
+ *
+ * \param[in] line  The line to parse.
+ * \param[out] entry  The fields of the line; the value is still escaped.
+ *
+ * \return false if the line is not valid.
+ */
+bool serialized_parser::parse_line(
+      std::string_view line
+    , entry_t & entry)
+{
+    std::string_view::size_type const p1(line.find(settings::FIELD_SEPARATOR));
+    if(p1 == std::string_view::npos)
+    {
+        return false;
+    }
+    std::string_view::size_type const p2(line.find(settings::FIELD_SEPARATOR, p1 + 1));
+    if(p2 == std::string_view::npos
+    || line.find(settings::FIELD_SEPARATOR, p2 + 1) != std::string_view::npos)
+    {
+        return false;
+    }
+
+    char const * const start(line.data());
+    std::from_chars_result r(std::from_chars(start, start + p1, entry.f_priority));
+    if(r.ec != std::errc()
+    || r.ptr != start + p1
+    || p1 == 0)
+    {
+        return false;
+    }
+    r = std::from_chars(start + p1 + 1, start + p2, entry.f_timestamp);
+    if(r.ec != std::errc()
+    || r.ptr != start + p2
+    || p2 == p1 + 1)
+    {
+        return false;
+    }
+
+    entry.f_value = line.substr(p2 + 1);
+    return true;
+}
+
+
+
+} // namespace fluid_settings
+// vim: ts=4 sw=4 et
@@ -0,0 +1,81 @@
+// Copyright (c) 2022-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+/** \file
+ * \brief Declaration of the encoding of the serialized values.
+ *
+ * The values sent between fluid-settings are serialized one per line
+ * with their priority and timestamp separated by `|`. The characters
+ * which have a special meaning in that format get escaped with a
+ * backslash. The values returned by a GET with `all=true` are separated
+ * by commas which get escaped the same way.
+ */
+
+// C++
+//
+#include    <cstdint>
+#include    <string>
+#include    <string_view>
+
+
+
+namespace fluid_settings
+{
+
+
+
+void                    escape_value(
+                              std::string & out
+                            , std::string_view value);
+void                    unescape_value(
+                              std::string & out
+                            , std::string_view value);
+void                    escape_commas(
+                              std::string & out
+                            , std::string_view value);
+char const *            escape_implementation();
+
+
+// parse the lines of a serialized value without copying them
+//
+class serialized_parser
+{
+public:
+    struct entry_t
+    {
+        std::int64_t            f_priority = 0;
+        std::int64_t            f_timestamp = 0;
+        std::string_view        f_value = std::string_view();
+    };
+
+                            serialized_parser(std::string_view input);
+
+    bool                    next_line(std::string_view & line);
+    static bool             parse_line(
+                                  std::string_view line
+                                , entry_t & entry);
+
+private:
+    std::string_view        f_input = std::string_view();
+};
+
+
+
+} // namespace fluid_settings
+// vim: ts=4 sw=4 et
@@ -0,0 +1,89 @@
+// Copyright (c) 2011-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// self
+//
+#include    "catch_main.h"
+
+
+// fluid-settings
+//
+#include    <fluid-settings/crc32c.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+CATCH_TEST_CASE("crc32c", "[crc32c]")
+{
+    CATCH_START_SECTION("crc32c: known values")
+    {
+        CATCH_REQUIRE(fluid_settings::crc32c("", 0) == 0);
+        CATCH_REQUIRE(fluid_settings::crc32c("123456789", 9) == 0xE3069283);
+
+        std::string const zeroes(32, '\0');
+        CATCH_REQUIRE(fluid_settings::crc32c(zeroes.data(), zeroes.length()) == 0x8A9136AA);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("crc32c: computed in several parts")
+    {
+        std::string data;
+        for(int i(0); i < 1000; ++i)
+        {
+            data += static_cast<char>(rand());
+        }
+        std::uint32_t const crc(fluid_settings::crc32c(data.data(), data.length()));
+        for(std::size_t split(0); split <= data.length(); split += 37)
+        {
+            std::uint32_t part(fluid_settings::crc32c(data.data(), split));
+            part = fluid_settings::crc32c(data.data() + split, data.length() - split, part);
+            CATCH_REQUIRE(part == crc);
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("crc32c: hardware and portable versions match")
+    {
+        std::string data;
+        for(int i(0); i < 1024 + 16; ++i)
+        {
+            data += static_cast<char>(rand());
+        }
+
+        // all the sizes and alignments
+        //
+        for(std::size_t offset(0); offset < 16; ++offset)
+        {
+            for(std::size_t size(0); size <= 1024; size += offset + 1)
+            {
+                CATCH_REQUIRE(fluid_settings::crc32c(data.data() + offset, size)
+                                == fluid_settings::crc32c_portable(data.data() + offset, size));
+            }
+        }
+
+        CATCH_REQUIRE(fluid_settings::crc32c_portable("123456789", 9) == 0xE3069283);
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,202 @@
+// Copyright (c) 2022-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// self
+//
+#include    "catch_main.h"
+
+
+// fluid-settings
+//
+#include    <fluid-settings/hash_tree.h>
+
+
+// C++
+//
+#include    <algorithm>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+// set_value() refuses timestamps from before fluid-settings existed
+//
+fluid_settings::timestamp_t timestamp(std::int64_t offset)
+{
+    return fluid_settings::timestamp_t(1'700'000'000, 0) + fluid_settings::timestamp_t(offset);
+}
+
+
+}
+// no name namespace
+
+
+
+CATCH_TEST_CASE("hash_tree", "[hash_tree]")
+{
+    CATCH_START_SECTION("hash_tree: digests")
+    {
+        fluid_settings::priority_set values;
+        CATCH_REQUIRE(fluid_settings::hash_tree::compute_digest("test::digest", values) == 0);
+
+        fluid_settings::value v;
+        v.set_value("value", 50, timestamp(1'000));
+        values.insert(v);
+        fluid_settings::hash_tree::digest_t const d1(fluid_settings::hash_tree::compute_digest("test::digest", values));
+        CATCH_REQUIRE(d1 != 0);
+        CATCH_REQUIRE(fluid_settings::hash_tree::compute_digest("test::digest", values) == d1);
+
+        // any change to the name, priority, timestamp, or value changes the digest
+        //
+        CATCH_REQUIRE(fluid_settings::hash_tree::compute_digest("test::other", values) != d1);
+
+        fluid_settings::priority_set changed;
+        v.set_value("value", 51, timestamp(1'000));
+        changed.insert(v);
+        CATCH_REQUIRE(fluid_settings::hash_tree::compute_digest("test::digest", changed) != d1);
+
+        changed.clear();
+        v.set_value("value", 50, timestamp(1'001));
+        changed.insert(v);
+        CATCH_REQUIRE(fluid_settings::hash_tree::compute_digest("test::digest", changed) != d1);
+
+        changed.clear();
+        v.set_value("valuf", 50, timestamp(1'000));
+        changed.insert(v);
+        CATCH_REQUIRE(fluid_settings::hash_tree::compute_digest("test::digest", changed) != d1);
+
+        for(int i(0); i < 100; ++i)
+        {
+            CATCH_REQUIRE(fluid_settings::hash_tree::bucket_of("test::name-" + std::to_string(i)) < fluid_settings::hash_tree::BUCKET_COUNT);
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("hash_tree: incremental updates")
+    {
+        std::vector<std::string> names;
+        std::vector<fluid_settings::priority_set> values(500);
+        for(std::size_t idx(0); idx < values.size(); ++idx)
+        {
+            names.push_back("test::name-" + std::to_string(idx));
+            fluid_settings::value v;
+            v.set_value("value " + std::to_string(idx), idx % 100, timestamp(idx * 1'000));
+            values[idx].insert(v);
+        }
+
+        // the same settings updated in a different order give the same tree
+        //
+        fluid_settings::hash_tree a;
+        fluid_settings::hash_tree b;
+        fluid_settings::hash_tree::digest_t const empty_root(a.get_root());
+        for(std::size_t idx(0); idx < values.size(); ++idx)
+        {
+            a.update(idx, names[idx], values[idx]);
+            std::size_t const rev(values.size() - 1 - idx);
+            b.update(rev, names[rev], values[rev]);
+        }
+        CATCH_REQUIRE(a.get_root() != empty_root);
+        CATCH_REQUIRE(a.get_root() == b.get_root());
+        CATCH_REQUIRE(a.size() == values.size());
+        CATCH_REQUIRE(a.get_buckets() == b.get_buckets());
+        CATCH_REQUIRE(a.get_digest(7) == fluid_settings::hash_tree::compute_digest(names[7], values[7]));
+        CATCH_REQUIRE(a.get_digest(10'000) == 0);
+
+        // one change only affects one bucket
+        //
+        fluid_settings::value v;
+        v.set_value("new value", 99, timestamp(5'000'000));
+        values[42].insert(v);
+        a.update(42, names[42], values[42]);
+        CATCH_REQUIRE(a.get_root() != b.get_root());
+        std::size_t differences(0);
+        for(std::size_t bucket(0); bucket < fluid_settings::hash_tree::BUCKET_COUNT; ++bucket)
+        {
+            if(a.get_bucket(bucket) != b.get_bucket(bucket))
+            {
+                ++differences;
+                CATCH_REQUIRE(bucket == fluid_settings::hash_tree::bucket_of(names[42]));
+
+                std::vector<fluid_settings::hash_tree::index_t> members;
+                a.get_bucket_members(bucket, members);
+                CATCH_REQUIRE(std::find(members.begin(), members.end(), 42) != members.end());
+                for(auto const id : members)
+                {
+                    CATCH_REQUIRE(fluid_settings::hash_tree::bucket_of(names[id]) == bucket);
+                }
+            }
+        }
+        CATCH_REQUIRE(differences == 1);
+
+        // reverting the change reverts the digests
+        //
+        values[42].erase(99);
+        a.update(42, names[42], values[42]);
+        CATCH_REQUIRE(a.get_root() == b.get_root());
+
+        // a setting without values is the same as no setting
+        //
+        for(std::size_t idx(0); idx < values.size(); ++idx)
+        {
+            a.update(idx, names[idx], fluid_settings::priority_set());
+        }
+        CATCH_REQUIRE(a.get_root() == empty_root);
+        CATCH_REQUIRE(a.size() == 0);
+        std::vector<fluid_settings::hash_tree::index_t> members;
+        a.get_bucket_members(fluid_settings::hash_tree::bucket_of(names[0]), members);
+        CATCH_REQUIRE(members.empty());
+
+        b.clear();
+        CATCH_REQUIRE(b.get_root() == empty_root);
+        CATCH_REQUIRE(b.size() == 0);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("hash_tree: encode and decode digests")
+    {
+        fluid_settings::hash_tree::digest_vector_t const digests({ 0, 1, 0x0123456789abcdefULL, UINT64_MAX });
+        std::string const str(fluid_settings::hash_tree::encode_digests(digests));
+        CATCH_REQUIRE(str == "0000000000000000"
+                             "0000000000000001"
+                             "0123456789abcdef"
+                             "ffffffffffffffff");
+
+        fluid_settings::hash_tree::digest_vector_t decoded;
+        CATCH_REQUIRE(fluid_settings::hash_tree::decode_digests(str, decoded));
+        CATCH_REQUIRE(decoded == digests);
+
+        decoded.clear();
+        CATCH_REQUIRE(fluid_settings::hash_tree::decode_digests(std::string(), decoded));
+        CATCH_REQUIRE(decoded.empty());
+
+        CATCH_REQUIRE_FALSE(fluid_settings::hash_tree::decode_digests(str.substr(1), decoded));
+        CATCH_REQUIRE_FALSE(fluid_settings::hash_tree::decode_digests("000000000000000g", decoded));
+        CATCH_REQUIRE_FALSE(fluid_settings::hash_tree::decode_digests("-000000000000001", decoded));
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,96 @@
+// Copyright (c) 2022-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// self
+//
+#include    "catch_main.h"
+
+
+// fluid-settings
+//
+#include    <fluid-settings/histogram.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+CATCH_TEST_CASE("histogram", "[histogram]")
+{
+    CATCH_START_SECTION("histogram: buckets")
+    {
+        CATCH_REQUIRE(fluid_settings::histogram::bucket_index(0) == 0);
+        CATCH_REQUIRE(fluid_settings::histogram::bucket_index(1) == 1);
+        CATCH_REQUIRE(fluid_settings::histogram::bucket_index(2) == 2);
+        CATCH_REQUIRE(fluid_settings::histogram::bucket_index(3) == 2);
+        CATCH_REQUIRE(fluid_settings::histogram::bucket_index(4) == 3);
+        CATCH_REQUIRE(fluid_settings::histogram::bucket_index(UINT64_MAX) == 64);
+
+        for(std::size_t idx(0); idx < fluid_settings::histogram::BUCKET_COUNT; ++idx)
+        {
+            std::uint64_t const limit(fluid_settings::histogram::bucket_limit(idx));
+            CATCH_REQUIRE(fluid_settings::histogram::bucket_index(limit) == idx);
+            if(idx + 1 < fluid_settings::histogram::BUCKET_COUNT)
+            {
+                CATCH_REQUIRE(fluid_settings::histogram::bucket_index(limit + 1) == idx + 1);
+            }
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("histogram: samples and percentiles")
+    {
+        fluid_settings::histogram h;
+        CATCH_REQUIRE(h.get_count() == 0);
+        CATCH_REQUIRE(h.percentile(50.0) == 0);
+        CATCH_REQUIRE(h.to_string().empty());
+
+        for(std::uint64_t sample(1); sample <= 100; ++sample)
+        {
+            h.add(sample);
+        }
+        CATCH_REQUIRE(h.get_count() == 100);
+        CATCH_REQUIRE(h.get_sum() == 5050);
+        CATCH_REQUIRE(h.get_max() == 100);
+        CATCH_REQUIRE(h.get_bucket(1) == 1);
+        CATCH_REQUIRE(h.get_bucket(7) == 37);       // 64 to 100
+        CATCH_REQUIRE(h.get_bucket(fluid_settings::histogram::BUCKET_COUNT) == 0);
+
+        CATCH_REQUIRE(h.percentile(0.0) == 1);
+        CATCH_REQUIRE(h.percentile(1.0) == 1);
+        CATCH_REQUIRE(h.percentile(50.0) == 63);
+        CATCH_REQUIRE(h.percentile(99.0) == 100);   // capped to the maximum
+        CATCH_REQUIRE(h.percentile(100.0) == 100);
+
+        CATCH_REQUIRE(h.to_string() == "1:1,3:2,7:4,15:8,31:16,63:32,127:37");
+
+        h.add(0);
+        CATCH_REQUIRE(h.to_string() == "0:1,1:1,3:2,7:4,15:8,31:16,63:32,127:37");
+
+        h.clear();
+        CATCH_REQUIRE(h.get_count() == 0);
+        CATCH_REQUIRE(h.get_max() == 0);
+        CATCH_REQUIRE(h.to_string().empty());
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
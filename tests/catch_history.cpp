@@ -0,0 +1,177 @@
+// Copyright (c) 2022-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// self
+//
+#include    "catch_main.h"
+
+
+// fluid-settings
+//
+#include    <fluid-settings/history.h>
+
+
+// C++
+//
+#include    <limits>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+fluid_settings::timestamp_t const g_latest(std::numeric_limits<std::int64_t>::max());
+
+
+}
+// no name namespace
+
+
+
+CATCH_TEST_CASE("history", "[history]")
+{
+    CATCH_START_SECTION("history: disabled by default")
+    {
+        fluid_settings::history h;
+
+        CATCH_REQUIRE(h.get_depth() == 0);
+        CATCH_REQUIRE(h.record(3, 50, fluid_settings::timestamp_t(1000), nullptr, SNAP_CATCH2_NAMESPACE::buffer("a")) == 0);
+        CATCH_REQUIRE(h.get_revision() == 0);
+
+        fluid_settings::history::event_vector_t events;
+        CATCH_REQUIRE(h.get_events(3, 0, g_latest, events));
+        CATCH_REQUIRE(events.empty());
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("history: events by revision and time")
+    {
+        fluid_settings::history h;
+        h.set_depth(10);
+
+        CATCH_REQUIRE(h.record(7, 50, fluid_settings::timestamp_t(1'000'000), nullptr, SNAP_CATCH2_NAMESPACE::buffer("one")) == 1);
+        CATCH_REQUIRE(h.record(2, 10, fluid_settings::timestamp_t(1'500'000), nullptr, SNAP_CATCH2_NAMESPACE::buffer("other")) == 2);
+        CATCH_REQUIRE(h.record(7, 50, fluid_settings::timestamp_t(2'000'000), SNAP_CATCH2_NAMESPACE::buffer("one"), SNAP_CATCH2_NAMESPACE::buffer("two")) == 3);
+        CATCH_REQUIRE(h.record(7, 90, fluid_settings::timestamp_t(1'999'000), nullptr, SNAP_CATCH2_NAMESPACE::buffer("high")) == 4);
+        CATCH_REQUIRE(h.record(7, 50, fluid_settings::timestamp_t(3'000'000), SNAP_CATCH2_NAMESPACE::buffer("two"), nullptr) == 5);
+        CATCH_REQUIRE(h.get_revision() == 5);
+
+        fluid_settings::history::event_vector_t events;
+        CATCH_REQUIRE(h.get_events(7, 0, g_latest, events));
+        CATCH_REQUIRE(events.size() == 4);
+        CATCH_REQUIRE(events[0].f_revision == 1);
+        CATCH_REQUIRE(events[0].f_timestamp == fluid_settings::timestamp_t(1'000'000));
+        CATCH_REQUIRE(events[0].f_before == nullptr);
+        CATCH_REQUIRE(*events[0].f_after == "one");
+        CATCH_REQUIRE(events[1].f_revision == 3);
+        CATCH_REQUIRE(*events[1].f_before == "one");
+        CATCH_REQUIRE(*events[1].f_after == "two");
+        CATCH_REQUIRE(events[2].f_revision == 4);
+        CATCH_REQUIRE(events[2].f_priority == 90);
+        CATCH_REQUIRE(events[2].f_timestamp == fluid_settings::timestamp_t(1'999'000));
+        CATCH_REQUIRE(events[3].f_revision == 5);
+        CATCH_REQUIRE(events[3].f_after == nullptr);
+
+        CATCH_REQUIRE(h.get_events(7, 3, g_latest, events));
+        CATCH_REQUIRE(events.size() == 2);
+        CATCH_REQUIRE(events[0].f_revision == 4);
+
+        CATCH_REQUIRE(h.get_events(7, fluid_settings::history::LATEST_REVISION, fluid_settings::timestamp_t(1'999'500), events));
+        CATCH_REQUIRE(events.size() == 2);
+        CATCH_REQUIRE(events[0].f_revision == 3);
+        CATCH_REQUIRE(events[1].f_revision == 5);
+
+        CATCH_REQUIRE(h.get_events(2, 1, g_latest, events));
+        CATCH_REQUIRE(events.size() == 1);
+        CATCH_REQUIRE(*events[0].f_after == "other");
+
+        // the setting without history has no events
+        //
+        CATCH_REQUIRE(h.get_events(100, 0, g_latest, events));
+        CATCH_REQUIRE(events.empty());
+
+        std::vector<fluid_settings::history::index_t> ids;
+        h.changed_since(0, ids);
+        CATCH_REQUIRE(ids == std::vector<fluid_settings::history::index_t>({ 2, 7 }));
+        h.changed_since(2, ids);
+        CATCH_REQUIRE(ids == std::vector<fluid_settings::history::index_t>({ 7 }));
+        h.changed_since(5, ids);
+        CATCH_REQUIRE(ids.empty());
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("history: bounded depth and shared values")
+    {
+        fluid_settings::history h;
+        h.set_depth(3);
+
+        fluid_settings::value::buffer_t previous;
+        for(int i(0); i < 10; ++i)
+        {
+            fluid_settings::value::buffer_t const value(SNAP_CATCH2_NAMESPACE::buffer(i % 2 == 0 ? "even" : "odd"));
+            h.record(1, 50, fluid_settings::timestamp_t(1'000 * (i + 1)), previous, value);
+            previous = value;
+        }
+
+        fluid_settings::history::stats_t const stats(h.get_stats());
+        CATCH_REQUIRE(stats.f_revision == 10);
+        CATCH_REQUIRE(stats.f_events == 3);
+        CATCH_REQUIRE(stats.f_dropped == 7);
+        CATCH_REQUIRE(stats.f_strings == 2);
+        CATCH_REQUIRE(stats.f_string_bytes == 7);
+
+        // revisions 1 to 7 were dropped
+        //
+        fluid_settings::history::event_vector_t events;
+        CATCH_REQUIRE_FALSE(h.get_events(1, 5, g_latest, events));
+        CATCH_REQUIRE_FALSE(h.get_events(1, fluid_settings::history::LATEST_REVISION, fluid_settings::timestamp_t(6'000), events));
+        CATCH_REQUIRE(h.get_events(1, 7, g_latest, events));
+        CATCH_REQUIRE(events.size() == 3);
+        CATCH_REQUIRE(events[0].f_revision == 8);
+        CATCH_REQUIRE(events[0].f_timestamp == fluid_settings::timestamp_t(8'000));
+        CATCH_REQUIRE(*events[0].f_before == "even");
+        CATCH_REQUIRE(*events[0].f_after == "odd");
+        CATCH_REQUIRE(events[2].f_revision == 10);
+
+        // equal values share one buffer
+        //
+        CATCH_REQUIRE(events[0].f_after == events[1].f_before);
+        CATCH_REQUIRE(events[0].f_before == events[2].f_before);
+
+        h.set_depth(1);
+        CATCH_REQUIRE(h.get_stats().f_events == 1);
+        CATCH_REQUIRE_FALSE(h.get_events(1, 8, g_latest, events));
+        CATCH_REQUIRE(h.get_events(1, 9, g_latest, events));
+        CATCH_REQUIRE(events.size() == 1);
+
+        h.clear();
+        CATCH_REQUIRE(h.get_stats().f_events == 0);
+        CATCH_REQUIRE(h.get_stats().f_strings == 0);
+        CATCH_REQUIRE(h.record(1, 50, fluid_settings::timestamp_t(20'000), nullptr, SNAP_CATCH2_NAMESPACE::buffer("new")) == 11);
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,329 @@
+// Copyright (c) 2011-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// self
+//
+#include    "catch_main.h"
+
+
+// fluid-settings
+//
+#include    <fluid-settings/journal.h>
+
+
+// C++
+//
+#include    <fstream>
+
+
+// C
+//
+#include    <unistd.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+std::string journal_filename(std::string const & name)
+{
+    std::string const filename(SNAP_CATCH2_NAMESPACE::g_tmp_dir() + "/" + name + ".journal");
+    unlink(filename.c_str());
+    return filename;
+}
+
+
+}
+// no name namespace
+
+
+
+CATCH_TEST_CASE("journal", "[journal]")
+{
+    CATCH_START_SECTION("journal: default filename")
+    {
+        CATCH_REQUIRE(fluid_settings::journal::get_default_filename("/var/lib/fluid-settings/settings/settings.conf")
+                            == "/var/lib/fluid-settings/settings/settings.journal");
+        CATCH_REQUIRE(fluid_settings::journal::get_default_filename("/tmp/settings")
+                            == "/tmp/settings.journal");
+        CATCH_REQUIRE(fluid_settings::journal::get_default_filename("/tmp/settings.conf.old")
+                            == "/tmp/settings.conf.old.journal");
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("journal: append, commit, read back")
+    {
+        std::string const filename(journal_filename("commit"));
+        fluid_settings::timestamp_t const now(fluid_settings::timestamp_t::gettime());
+
+        {
+            fluid_settings::journal j(filename);
+            fluid_settings::journal::record_vector_t records;
+            CATCH_REQUIRE(j.read(records));
+            CATCH_REQUIRE(records.empty());
+            CATCH_REQUIRE(j.open());
+            CATCH_REQUIRE_FALSE(j.has_pending());
+
+            fluid_settings::priority_set values;
+            fluid_settings::value v;
+            v.set_value("first|value\nwith \\ special characters", 50, now);
+            values.insert(v);
+            v.set_value("", 10, now);
+            values.insert(v);
+            j.append("test::one", values);
+            CATCH_REQUIRE(j.has_pending());
+
+            values.clear();
+            j.append("test::two", values);
+
+            // group commit: two records, one commit
+            //
+            CATCH_REQUIRE(j.commit());
+            CATCH_REQUIRE_FALSE(j.has_pending());
+            CATCH_REQUIRE(j.get_commits() == 1);
+            CATCH_REQUIRE(j.get_records() == 2);
+        }
+
+        fluid_settings::journal j(filename);
+        fluid_settings::journal::record_vector_t records;
+        CATCH_REQUIRE(j.read(records));
+        CATCH_REQUIRE(records.size() == 2);
+        CATCH_REQUIRE(records[0].f_name == "test::one");
+        CATCH_REQUIRE(records[0].f_values.size() == 2);
+        CATCH_REQUIRE(records[0].f_values[0].f_priority == 10);
+        CATCH_REQUIRE(records[0].f_values[0].f_value.empty());
+        CATCH_REQUIRE(records[0].f_values[0].f_timestamp == now);
+        CATCH_REQUIRE(records[0].f_values[1].f_priority == 50);
+        CATCH_REQUIRE(records[0].f_values[1].f_value == "first|value\nwith \\ special characters");
+        CATCH_REQUIRE(records[1].f_name == "test::two");
+        CATCH_REQUIRE(records[1].f_values.empty());
+
+        // after a reset, the journal is empty
+        //
+        CATCH_REQUIRE(j.open());
+        CATCH_REQUIRE(j.reset());
+        CATCH_REQUIRE(j.read(records));
+        CATCH_REQUIRE(records.empty());
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("journal: reset keeps the records after the mark")
+    {
+        std::string const filename(journal_filename("mark"));
+        fluid_settings::timestamp_t const now(fluid_settings::timestamp_t::gettime());
+
+        {
+            fluid_settings::journal j(filename);
+            CATCH_REQUIRE(j.open());
+            CATCH_REQUIRE(j.get_size() == fluid_settings::journal::HEADER_SIZE);
+
+            fluid_settings::priority_set values;
+            fluid_settings::value v;
+            v.set_value("saved", 50, now);
+            values.insert(v);
+            j.append("test::saved", values);
+            CATCH_REQUIRE(j.commit());
+
+            // a save starts here, then more changes get committed
+            //
+            std::size_t const mark(j.get_size());
+            CATCH_REQUIRE(mark > fluid_settings::journal::HEADER_SIZE);
+
+            values.clear();
+            v.set_value("not saved", 50, now);
+            values.insert(v);
+            j.append("test::not-saved", values);
+            CATCH_REQUIRE(j.commit());
+
+            CATCH_REQUIRE(j.reset(mark));
+
+            // the journal is still usable after the rewrite
+            //
+            values.clear();
+            j.append("test::after", values);
+            CATCH_REQUIRE(j.commit());
+        }
+
+        fluid_settings::journal j(filename);
+        fluid_settings::journal::record_vector_t records;
+        CATCH_REQUIRE(j.read(records));
+        CATCH_REQUIRE(records.size() == 2);
+        CATCH_REQUIRE(records[0].f_name == "test::not-saved");
+        CATCH_REQUIRE(records[0].f_values.size() == 1);
+        CATCH_REQUIRE(records[0].f_values[0].f_value == "not saved");
+        CATCH_REQUIRE(records[1].f_name == "test::after");
+        CATCH_REQUIRE(records[1].f_values.empty());
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("journal: two resets with a mark in a row")
+    {
+        std::string const filename(journal_filename("marks"));
+        fluid_settings::timestamp_t const now(fluid_settings::timestamp_t::gettime());
+
+        {
+            fluid_settings::journal j(filename);
+            CATCH_REQUIRE(j.open());
+
+            fluid_settings::priority_set values;
+            fluid_settings::value v;
+            for(int i(0); i < 3; ++i)
+            {
+                values.clear();
+                v.set_value("value " + std::to_string(i), 50, now);
+                values.insert(v);
+                j.append("test::value-" + std::to_string(i), values);
+                CATCH_REQUIRE(j.commit());
+            }
+
+            // the second save starts after the first one rewrote the
+            // journal, so the new journal must also be readable
+            //
+            std::size_t mark(j.get_size());
+            values.clear();
+            v.set_value("value 3", 50, now);
+            values.insert(v);
+            j.append("test::value-3", values);
+            CATCH_REQUIRE(j.commit());
+            CATCH_REQUIRE(j.reset(mark));
+
+            mark = j.get_size();
+            values.clear();
+            v.set_value("value 4", 50, now);
+            values.insert(v);
+            j.append("test::value-4", values);
+            CATCH_REQUIRE(j.commit());
+            CATCH_REQUIRE(j.reset(mark));
+        }
+
+        fluid_settings::journal j(filename);
+        fluid_settings::journal::record_vector_t records;
+        CATCH_REQUIRE(j.read(records));
+        CATCH_REQUIRE(records.size() == 1);
+        CATCH_REQUIRE(records[0].f_name == "test::value-4");
+        CATCH_REQUIRE(records[0].f_values.size() == 1);
+        CATCH_REQUIRE(records[0].f_values[0].f_value == "value 4");
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("journal: torn record gets dropped")
+    {
+        std::string const filename(journal_filename("torn"));
+        fluid_settings::timestamp_t const now(fluid_settings::timestamp_t::gettime());
+
+        fluid_settings::priority_set values;
+        fluid_settings::value v;
+        v.set_value("kept", 50, now);
+        values.insert(v);
+        {
+            fluid_settings::journal j(filename);
+            CATCH_REQUIRE(j.open());
+            j.append("test::kept", values);
+            CATCH_REQUIRE(j.commit());
+        }
+
+        // simulate a crash in the middle of writing a record
+        //
+        {
+            std::ofstream out(filename, std::ios::binary | std::ios::app);
+            out << std::string("\x40\x00\x00\x00\x12\x34", 6);
+        }
+
+        fluid_settings::journal j(filename);
+        fluid_settings::journal::record_vector_t records;
+        CATCH_REQUIRE(j.read(records));
+        CATCH_REQUIRE(records.size() == 1);
+        CATCH_REQUIRE(records[0].f_name == "test::kept");
+
+        // open() truncates the bad record so new records can be read back
+        //
+        CATCH_REQUIRE(j.open());
+        j.append("test::after", values);
+        CATCH_REQUIRE(j.commit());
+        CATCH_REQUIRE(j.read(records));
+        CATCH_REQUIRE(records.size() == 2);
+        CATCH_REQUIRE(records[1].f_name == "test::after");
+        CATCH_REQUIRE(records[1].f_values[0].f_value == "kept");
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("journal: bad checksum")
+    {
+        std::string const filename(journal_filename("checksum"));
+        fluid_settings::timestamp_t const now(fluid_settings::timestamp_t::gettime());
+
+        fluid_settings::priority_set values;
+        fluid_settings::value v;
+        v.set_value("value", 50, now);
+        values.insert(v);
+        {
+            fluid_settings::journal j(filename);
+            CATCH_REQUIRE(j.open());
+            j.append("test::good", values);
+            j.append("test::bad", values);
+            CATCH_REQUIRE(j.commit());
+        }
+
+        // flip the last byte of the last value
+        //
+        {
+            std::fstream io(filename, std::ios::binary | std::ios::in | std::ios::out);
+            io.seekg(-1, std::ios::end);
+            char c(0);
+            io.get(c);
+            io.seekp(-1, std::ios::end);
+            io.put(static_cast<char>(c ^ 0x20));
+        }
+
+        fluid_settings::journal j(filename);
+        fluid_settings::journal::record_vector_t records;
+        CATCH_REQUIRE(j.read(records));
+        CATCH_REQUIRE(records.size() == 1);
+        CATCH_REQUIRE(records[0].f_name == "test::good");
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("journal: not a journal")
+    {
+        std::string const filename(journal_filename("invalid"));
+        {
+            std::ofstream out(filename);
+            out << "# this is a settings file\nname=value\n";
+        }
+
+        fluid_settings::journal j(filename);
+        fluid_settings::journal::record_vector_t records;
+        CATCH_REQUIRE_FALSE(j.read(records));
+        CATCH_REQUIRE_FALSE(j.open());
+
+        std::ifstream in(filename);
+        std::string line;
+        std::getline(in, line);
+        CATCH_REQUIRE(line == "# this is a settings file");
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
@@ -17,6 +17,11 @@
 // along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #pragma once
 
+// fluid-settings
+//
+#include    <fluid-settings/value.h>
+
+
 // catch2
 //
 #include    <catch2/snapcatch2.hpp>
@@ -38,6 +43,12 @@ namespace SNAP_CATCH2_NAMESPACE
 extern char ** g_argv;
 
 
+inline fluid_settings::value::buffer_t buffer(std::string const & v)
+{
+    return std::make_shared<std::string const>(v);
+}
+
+
 
 }
 // namespace SNAP_CATCH2_NAMESPACE
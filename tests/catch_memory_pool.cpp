@@ -0,0 +1,152 @@
+// Copyright (c) 2011-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// self
+//
+#include    "catch_main.h"
+
+
+// fluid-settings
+//
+#include    <fluid-settings/memory_pool.h>
+#include    <fluid-settings/priority_set.h>
+
+
+// C++
+//
+#include    <cstring>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+CATCH_TEST_CASE("memory_pool", "[memory]")
+{
+    CATCH_START_SECTION("memory_pool: allocate, release, compact")
+    {
+        fluid_settings::memory_pool pool;
+
+        CATCH_REQUIRE(pool.get_stats().f_slabs == 0);
+
+        // fill a little over one slab of 32 byte blocks
+        //
+        std::size_t const count(fluid_settings::memory_pool::SLAB_SIZE / 32 + 10);
+        std::vector<void *> blocks;
+        for(std::size_t i(0); i < count; ++i)
+        {
+            void * p(pool.allocate(20));
+            CATCH_REQUIRE(p != nullptr);
+            CATCH_REQUIRE(reinterpret_cast<std::uintptr_t>(p) % 16 == 0);
+            memset(p, static_cast<int>(i), 20);
+            blocks.push_back(p);
+        }
+        CATCH_REQUIRE(pool.get_stats().f_slabs == 2);
+        CATCH_REQUIRE(pool.get_stats().f_in_use == count * 32);
+        CATCH_REQUIRE(pool.get_stats().f_allocations == count);
+
+        // large blocks do not use slabs
+        //
+        void * large(pool.allocate(5000));
+        CATCH_REQUIRE(pool.get_stats().f_large == 5000);
+        CATCH_REQUIRE(pool.get_stats().f_slabs == 2);
+        pool.deallocate(large, 5000);
+        CATCH_REQUIRE(pool.get_stats().f_large == 0);
+
+        // nothing is free, compacting has no effect
+        //
+        CATCH_REQUIRE(pool.compact() == 0);
+        CATCH_REQUIRE(pool.get_stats().f_slabs == 2);
+
+        // release the last 10 blocks, one slab becomes empty
+        //
+        for(std::size_t i(0); i < 10; ++i)
+        {
+            pool.deallocate(blocks.back(), 20);
+            blocks.pop_back();
+        }
+        CATCH_REQUIRE(pool.compact() == fluid_settings::memory_pool::SLAB_SIZE);
+        CATCH_REQUIRE(pool.get_stats().f_slabs == 1);
+        CATCH_REQUIRE(pool.get_stats().f_released == fluid_settings::memory_pool::SLAB_SIZE);
+
+        // the remaining blocks were not touched
+        //
+        for(std::size_t i(0); i < blocks.size(); ++i)
+        {
+            CATCH_REQUIRE(static_cast<unsigned char const *>(blocks[i])[19] == static_cast<unsigned char>(i));
+        }
+
+        // release every other block, nothing can be released
+        //
+        void * const lowest(blocks[0]);
+        for(std::size_t i(0); i < blocks.size(); i += 2)
+        {
+            pool.deallocate(blocks[i], 20);
+            blocks[i] = nullptr;
+        }
+        CATCH_REQUIRE(pool.compact() == 0);
+
+        // after a compaction, the free blocks are reused lowest first
+        //
+        void * p(pool.allocate(32));
+        CATCH_REQUIRE(p == lowest);
+        pool.deallocate(p, 32);
+
+        for(std::size_t i(1); i < blocks.size(); i += 2)
+        {
+            pool.deallocate(blocks[i], 20);
+        }
+        CATCH_REQUIRE(pool.get_stats().f_in_use == 0);
+        CATCH_REQUIRE(pool.compact() == fluid_settings::memory_pool::SLAB_SIZE);
+        CATCH_REQUIRE(pool.get_stats().f_slabs == 0);
+        CATCH_REQUIRE(pool.get_stats().f_deallocations == pool.get_stats().f_allocations);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("memory_pool: priority_set and buffers use the pool")
+    {
+        fluid_settings::memory_pool::pointer_t pool(std::make_shared<fluid_settings::memory_pool>());
+        fluid_settings::timestamp_t const now(fluid_settings::timestamp_t::gettime());
+
+        {
+            fluid_settings::priority_set set(fluid_settings::priority_set::allocator_t{pool});
+            for(fluid_settings::priority_t p(0); p < 10; ++p)
+            {
+                fluid_settings::value v;
+                v.set_value(
+                          std::allocate_shared<std::string>(
+                                  fluid_settings::pool_allocator<std::string>(pool)
+                                , "value " + std::to_string(p))
+                        , p
+                        , now);
+                set.insert(v);
+            }
+            CATCH_REQUIRE(pool->get_stats().f_in_use > 0);
+            CATCH_REQUIRE(set.find(5)->get_value() == "value 5");
+        }
+
+        CATCH_REQUIRE(pool->get_stats().f_in_use == 0);
+        CATCH_REQUIRE(pool->get_stats().f_allocations == pool->get_stats().f_deallocations);
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,106 @@
+// Copyright (c) 2011-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// self
+//
+#include    "catch_main.h"
+
+
+// fluid-settings
+//
+#include    <fluid-settings/priority_set.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+CATCH_TEST_CASE("priority_set", "[priority]")
+{
+    CATCH_START_SECTION("priority_set: empty set")
+    {
+        fluid_settings::priority_set set;
+
+        CATCH_REQUIRE(set.empty());
+        CATCH_REQUIRE(set.size() == 0);
+        CATCH_REQUIRE(set.highest() == nullptr);
+        CATCH_REQUIRE(set.get_highest_priority() == fluid_settings::HIGHEST_PRIORITY);
+        for(fluid_settings::priority_t p(-5); p < 130; ++p)
+        {
+            CATCH_REQUIRE_FALSE(set.has(p));
+            CATCH_REQUIRE(set.find(p) == nullptr);
+            CATCH_REQUIRE_FALSE(set.erase(p));
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("priority_set: insert, find, replace, erase")
+    {
+        fluid_settings::priority_set set;
+        fluid_settings::timestamp_t const now(fluid_settings::timestamp_t::gettime());
+
+        // insert in an order which crosses the 64 bit boundary both ways
+        //
+        for(fluid_settings::priority_t const p : { 50, 0, 99, 63, 64, 1 })
+        {
+            fluid_settings::value v;
+            v.set_value("at " + std::to_string(p), p, now);
+            CATCH_REQUIRE(set.insert(v));
+        }
+        CATCH_REQUIRE(set.size() == 6);
+        CATCH_REQUIRE(set.get_highest_priority() == 99);
+        CATCH_REQUIRE(set.highest()->get_value() == "at 99");
+
+        std::vector<fluid_settings::priority_t> order;
+        for(auto const & v : set)
+        {
+            order.push_back(v.get_priority());
+            CATCH_REQUIRE(v.get_value() == "at " + std::to_string(v.get_priority()));
+        }
+        CATCH_REQUIRE(order == std::vector<fluid_settings::priority_t>({ 0, 1, 50, 63, 64, 99 }));
+
+        CATCH_REQUIRE(set.find(64)->get_value() == "at 64");
+        CATCH_REQUIRE(set.find(63)->get_value() == "at 63");
+        CATCH_REQUIRE(set.find(65) == nullptr);
+
+        fluid_settings::value replacement;
+        replacement.set_value("new 50", 50, now);
+        CATCH_REQUIRE_FALSE(set.insert(replacement));
+        CATCH_REQUIRE(set.size() == 6);
+        CATCH_REQUIRE(set.find(50)->get_value() == "new 50");
+
+        CATCH_REQUIRE(set.erase(99));
+        CATCH_REQUIRE_FALSE(set.erase(99));
+        CATCH_REQUIRE(set.get_highest_priority() == 64);
+        CATCH_REQUIRE(set.highest()->get_value() == "at 64");
+
+        CATCH_REQUIRE(set.erase(64));
+        CATCH_REQUIRE(set.get_highest_priority() == 63);
+        CATCH_REQUIRE(set.find(1)->get_value() == "at 1");
+
+        set.clear();
+        CATCH_REQUIRE(set.empty());
+        CATCH_REQUIRE(set.get_highest_priority() == fluid_settings::HIGHEST_PRIORITY);
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
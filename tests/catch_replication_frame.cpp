@@ -0,0 +1,254 @@
+// Copyright (c) 2022-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// self
+//
+#include    "catch_main.h"
+
+
+// fluid-settings
+//
+#include    <fluid-settings/replication_frame.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+CATCH_TEST_CASE("replication_frame", "[replication]")
+{
+    CATCH_START_SECTION("replication_frame: encode and decode")
+    {
+        fluid_settings::priority_set values;
+        fluid_settings::value v;
+        v.set_value("low", 0, fluid_settings::timestamp_t(1'700'000'000'123'456'789LL));
+        values.insert(v);
+        v.set_value(std::string("binary\0|\n\\value", 15), 50, fluid_settings::timestamp_t(1'700'000'000'000'000'005LL));
+        values.insert(v);
+        v.set_value(std::string(300, 'x'), 99, fluid_settings::timestamp_t(0x7FFF'FFFF'FFFF'FFFFLL));
+        values.insert(v);
+
+        std::string frame;
+        fluid_settings::encode_frame(frame, values);
+
+        // 1 + 8 + 1 + 3, 1 + 8 + 1 + 15, 1 + 8 + 2 + 300
+        //
+        CATCH_REQUIRE(frame.length() == 13 + 25 + 311);
+
+        fluid_settings::mutation_vector_t decoded;
+        CATCH_REQUIRE(fluid_settings::decode_frame(frame, decoded));
+        CATCH_REQUIRE(decoded.size() == 3);
+        CATCH_REQUIRE(decoded[0].f_priority == 0);
+        CATCH_REQUIRE(decoded[0].f_timestamp == fluid_settings::timestamp_t(1'700'000'000'123'456'789LL));
+        CATCH_REQUIRE(decoded[0].f_value == "low");
+        CATCH_REQUIRE(decoded[1].f_priority == 50);
+        CATCH_REQUIRE(decoded[1].f_timestamp == fluid_settings::timestamp_t(1'700'000'000'000'000'005LL));
+        CATCH_REQUIRE(decoded[1].f_value == std::string("binary\0|\n\\value", 15));
+        CATCH_REQUIRE(decoded[2].f_priority == 99);
+        CATCH_REQUIRE(decoded[2].f_timestamp == fluid_settings::timestamp_t(0x7FFF'FFFF'FFFF'FFFFLL));
+        CATCH_REQUIRE(decoded[2].f_value == std::string(300, 'x'));
+
+        // the values of a snapshot give the same frame
+        //
+        fluid_settings::snapshot::value_list_t list;
+        for(auto const & value : values)
+        {
+            fluid_settings::snapshot::priority_value_t pv;
+            pv.f_priority = value.get_priority();
+            pv.f_value = value.get_buffer();
+            pv.f_timestamp = value.get_timestamp();
+            list.push_back(pv);
+        }
+        std::string snapshot_frame;
+        fluid_settings::encode_frame(snapshot_frame, list);
+        CATCH_REQUIRE(snapshot_frame == frame);
+
+        // an empty set gives an empty frame
+        //
+        std::string empty;
+        fluid_settings::encode_frame(empty, fluid_settings::priority_set());
+        CATCH_REQUIRE(empty.empty());
+        decoded.clear();
+        CATCH_REQUIRE(fluid_settings::decode_frame(empty, decoded));
+        CATCH_REQUIRE(decoded.empty());
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("replication_frame: invalid frames")
+    {
+        fluid_settings::priority_set values;
+        fluid_settings::value v;
+        v.set_value("some value", 50, fluid_settings::timestamp_t(1'700'000'000'000'001'000LL));
+        values.insert(v);
+
+        std::string frame;
+        fluid_settings::encode_frame(frame, values);
+
+        // any truncation is detected
+        //
+        for(std::size_t size(1); size < frame.length(); ++size)
+        {
+            fluid_settings::mutation_vector_t decoded;
+            CATCH_REQUIRE_FALSE(fluid_settings::decode_frame(std::string_view(frame.data(), size), decoded));
+        }
+
+        // priority out of range
+        //
+        std::string bad(frame);
+        bad[0] = 100;
+        fluid_settings::mutation_vector_t decoded;
+        CATCH_REQUIRE_FALSE(fluid_settings::decode_frame(bad, decoded));
+
+        // timestamp of 0 or too large for an std::int64_t
+        //
+        bad = frame;
+        for(std::size_t idx(1); idx <= 8; ++idx)
+        {
+            bad[idx] = 0;
+        }
+        CATCH_REQUIRE_FALSE(fluid_settings::decode_frame(bad, decoded));
+        bad[8] = '\x80';
+        CATCH_REQUIRE_FALSE(fluid_settings::decode_frame(bad, decoded));
+        CATCH_REQUIRE(decoded.empty());
+
+        // varint which never ends
+        //
+        CATCH_REQUIRE_FALSE(fluid_settings::decode_frame(std::string(20, '\xFF'), decoded));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("replication_frame: batch")
+    {
+        fluid_settings::priority_set values;
+        fluid_settings::value v;
+        v.set_value("first", 50, fluid_settings::timestamp_t(1'700'000'000'000'001'000LL));
+        values.insert(v);
+        std::string frame1;
+        fluid_settings::encode_frame(frame1, values);
+
+        v.set_value("second", 20, fluid_settings::timestamp_t(1'700'000'000'000'002'000LL));
+        values.insert(v);
+        std::string frame2;
+        fluid_settings::encode_frame(frame2, values);
+
+        std::string batch;
+        fluid_settings::encode_batch_entry(batch, 3, "test::first", frame1);
+        fluid_settings::encode_batch_entry(batch, 300, std::string_view(), frame2);
+        fluid_settings::encode_batch_entry(batch, 7, "test::empty", std::string_view());
+
+        fluid_settings::batch_entry_vector_t entries;
+        CATCH_REQUIRE(fluid_settings::decode_batch(batch, entries));
+        CATCH_REQUIRE(entries.size() == 3);
+        CATCH_REQUIRE(entries[0].f_id == 3);
+        CATCH_REQUIRE(entries[0].f_name == "test::first");
+        CATCH_REQUIRE(entries[0].f_frame == frame1);
+        CATCH_REQUIRE(entries[1].f_id == 300);
+        CATCH_REQUIRE(entries[1].f_name.empty());
+        CATCH_REQUIRE(entries[1].f_frame == frame2);
+        CATCH_REQUIRE(entries[2].f_id == 7);
+        CATCH_REQUIRE(entries[2].f_name == "test::empty");
+        CATCH_REQUIRE(entries[2].f_frame.empty());
+
+        fluid_settings::mutation_vector_t decoded;
+        CATCH_REQUIRE(fluid_settings::decode_frame(entries[1].f_frame, decoded));
+        CATCH_REQUIRE(decoded.size() == 2);
+
+        // any truncation is detected, except at the end of an entry
+        //
+        std::size_t const first_end(1 + 1 + 11 + 1 + frame1.length());
+        for(std::size_t size(1); size < batch.length(); ++size)
+        {
+            entries.clear();
+            bool const valid(fluid_settings::decode_batch(std::string_view(batch.data(), size), entries));
+            CATCH_REQUIRE(valid == (size == first_end || size == first_end + 2 + 1 + 1 + frame2.length()));
+        }
+
+        // the batch goes through a text parameter
+        //
+        std::string text;
+        fluid_settings::encode_base64(text, batch);
+        CATCH_REQUIRE(text.find_first_not_of("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/=") == std::string::npos);
+        std::string received;
+        CATCH_REQUIRE(fluid_settings::decode_base64(text, received));
+        CATCH_REQUIRE(received == batch);
+        entries.clear();
+        CATCH_REQUIRE(fluid_settings::decode_batch(received, entries));
+        CATCH_REQUIRE(entries.size() == 3);
+        CATCH_REQUIRE(entries[1].f_frame == frame2);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("replication_frame: base64")
+    {
+        // RFC 4648 test vectors
+        //
+        char const * const vectors[][2] = {
+            { "",       ""         },
+            { "f",      "Zg=="     },
+            { "fo",     "Zm8="     },
+            { "foo",    "Zm9v"     },
+            { "foob",   "Zm9vYg==" },
+            { "fooba",  "Zm9vYmE=" },
+            { "foobar", "Zm9vYmFy" },
+        };
+        for(auto const & v : vectors)
+        {
+            std::string text;
+            fluid_settings::encode_base64(text, v[0]);
+            CATCH_REQUIRE(text == v[1]);
+
+            std::string batch;
+            CATCH_REQUIRE(fluid_settings::decode_base64(text, batch));
+            CATCH_REQUIRE(batch == v[0]);
+        }
+
+        // all the byte values, at each length modulo 3
+        //
+        std::string all;
+        for(int c(0); c < 256; ++c)
+        {
+            all += static_cast<char>(c);
+        }
+        for(std::size_t size(all.length() - 3); size <= all.length(); ++size)
+        {
+            std::string text;
+            fluid_settings::encode_base64(text, std::string_view(all.data(), size));
+            CATCH_REQUIRE(text.length() == (size + 2) / 3 * 4);
+
+            std::string batch;
+            CATCH_REQUIRE(fluid_settings::decode_base64(text, batch));
+            CATCH_REQUIRE(batch == all.substr(0, size));
+        }
+
+        // invalid input
+        //
+        std::string batch;
+        CATCH_REQUIRE_FALSE(fluid_settings::decode_base64("Zm9", batch));
+        CATCH_REQUIRE_FALSE(fluid_settings::decode_base64("Zm9v\n", batch));
+        CATCH_REQUIRE_FALSE(fluid_settings::decode_base64("Zm=v", batch));
+        CATCH_REQUIRE_FALSE(fluid_settings::decode_base64("Zg==Zm9v", batch));
+        CATCH_REQUIRE_FALSE(fluid_settings::decode_base64("Z===", batch));
+        CATCH_REQUIRE_FALSE(fluid_settings::decode_base64("Zm9-", batch));
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
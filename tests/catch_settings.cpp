@@ -0,0 +1,385 @@
+// Copyright (c) 2022-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+// self
+//
+#include    "catch_main.h"
+
+
+// fluid-settings
+//
+#include    <fluid-settings/settings.h>
+
+
+// C++
+//
+#include    <fstream>
+#include    <vector>
+
+
+// C
+//
+#include    <sys/stat.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+
+/** \brief Create a directory with definition files.
+ *
+ * \param[in] name  The name of the directory under the temporary directory.
+ * \param[in] files  The name and content of each file to create.
+ *
+ * \return The path to the directory.
+ */
+std::string create_definitions(
+      std::string const & name
+    , std::vector<std::pair<std::string, std::string>> const & files)
+{
+    std::string const path(SNAP_CATCH2_NAMESPACE::g_tmp_dir() + "/" + name);
+    mkdir(path.c_str(), 0700);
+    for(auto const & f : files)
+    {
+        std::ofstream out(path + "/" + f.first);
+        out << f.second;
+    }
+    return path;
+}
+
+
+
+}
+// no name namespace
+
+
+
+CATCH_TEST_CASE("settings_definitions", "[settings]")
+{
+    CATCH_START_SECTION("settings_definitions: the first definition wins")
+    {
+        std::string const path(create_definitions(
+                  "duplicates"
+                , {
+                      { "a.ini", "[test::duplicate]\n"
+                                 "default=first\n"
+                                 "help=defined in two files\n"
+                                 "\n"
+                                 "[test::only_a]\n"
+                                 "help=defined in a.ini\n" },
+                      { "b.ini", "[test::duplicate]\n"
+                                 "default=second\n"
+                                 "help=defined in two files\n"
+                                 "\n"
+                                 "[test::only_b]\n"
+                                 "help=defined in b.ini\n" },
+                  }));
+
+        fluid_settings::settings s;
+        CATCH_REQUIRE(s.load_definitions(path, 1));
+
+        // the duplicate does not prevent the other options from loading
+        //
+        CATCH_REQUIRE(s.resolve("test::only_a") != fluid_settings::INVALID_SETTING_ID);
+        CATCH_REQUIRE(s.resolve("test::only_b") != fluid_settings::INVALID_SETTING_ID);
+
+        std::string value;
+        CATCH_REQUIRE(s.get_default_value("test::duplicate", value) == fluid_settings::get_result_t::GET_RESULT_DEFAULT);
+        CATCH_REQUIRE(value == "first");
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("settings_definitions: parallel load gives the same result")
+    {
+        std::vector<std::pair<std::string, std::string>> files;
+        for(int idx(0); idx < 20; ++idx)
+        {
+            std::string const n(std::to_string(idx));
+            files.emplace_back(
+                      "file" + std::string(idx < 10 ? "0" : "") + n + ".ini"
+                    , "[test::shared]\n"
+                      "default=" + n + "\n"
+                      "help=defined in all the files\n"
+                      "\n"
+                      "[test::file" + n + "]\n"
+                      "default=" + n + "\n"
+                      "help=defined in one file\n");
+        }
+        std::string const path(create_definitions("parallel", files));
+
+        fluid_settings::settings sequential;
+        CATCH_REQUIRE(sequential.load_definitions(path, 1));
+
+        fluid_settings::settings parallel;
+        CATCH_REQUIRE(parallel.load_definitions(path, 4));
+
+        CATCH_REQUIRE(parallel.list_of_options() == sequential.list_of_options());
+
+        std::string value;
+        CATCH_REQUIRE(parallel.get_default_value("test::shared", value) == fluid_settings::get_result_t::GET_RESULT_DEFAULT);
+        CATCH_REQUIRE(value == "0");
+        for(int idx(0); idx < 20; ++idx)
+        {
+            std::string const n(std::to_string(idx));
+            CATCH_REQUIRE(parallel.get_default_value("test::file" + n, value) == fluid_settings::get_result_t::GET_RESULT_DEFAULT);
+            CATCH_REQUIRE(value == n);
+        }
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("settings_fingerprint", "[settings]")
+{
+    CATCH_START_SECTION("settings_fingerprint: only a changed definition is verified again")
+    {
+        std::string const definition(
+            "[test::fingerprint]\n"
+            "default=5\n"
+            "help=a setting used to test fingerprints\n"
+            "validator=integer\n");
+
+        std::string const original(create_definitions(
+                  "fingerprint-original"
+                , { { "fingerprint.ini", definition } }));
+        std::string const commented(create_definitions(
+                  "fingerprint-commented"
+                , { { "fingerprint.ini", "# only comments were added\n"
+                                         "\n"
+                                       + definition } }));
+        std::string const changed(create_definitions(
+                  "fingerprint-changed"
+                , { { "fingerprint.ini", "[test::fingerprint]\n"
+                                         "default=7\n"
+                                         "help=a setting used to test fingerprints\n"
+                                         "validator=integer\n" } }));
+        std::string const snapshot(SNAP_CATCH2_NAMESPACE::g_tmp_dir() + "/fingerprint.snapshot");
+
+        {
+            fluid_settings::settings s;
+            CATCH_REQUIRE(s.load_definitions(original, 1));
+            CATCH_REQUIRE(s.set_value(
+                      "test::fingerprint"
+                    , "10"
+                    , 50
+                    , fluid_settings::timestamp_t::gettime()) == fluid_settings::set_result_t::SET_RESULT_NEW);
+            CATCH_REQUIRE(s.save_snapshot(snapshot));
+        }
+
+        // same definition: the values are trusted as is
+        //
+        {
+            fluid_settings::settings s;
+            CATCH_REQUIRE(s.load_definitions(original, 1));
+            CATCH_REQUIRE(s.load_snapshot(snapshot));
+            CATCH_REQUIRE_FALSE(s.has_deferred());
+        }
+
+        // the comments are not part of the fingerprint
+        //
+        {
+            fluid_settings::settings s;
+            CATCH_REQUIRE(s.load_definitions(commented, 1));
+            CATCH_REQUIRE(s.load_snapshot(snapshot));
+            CATCH_REQUIRE_FALSE(s.has_deferred());
+        }
+
+        // a different definition requires a verification
+        //
+        {
+            fluid_settings::settings s;
+            CATCH_REQUIRE(s.load_definitions(changed, 1));
+            CATCH_REQUIRE(s.load_snapshot(snapshot));
+            CATCH_REQUIRE(s.has_deferred());
+
+            fluid_settings::change_set_t changes;
+            CATCH_REQUIRE_FALSE(s.verify_deferred(100, changes));
+            CATCH_REQUIRE_FALSE(s.has_deferred());
+
+            std::string value;
+            CATCH_REQUIRE(s.get_value("test::fingerprint", value) == fluid_settings::get_result_t::GET_RESULT_SUCCESS);
+            CATCH_REQUIRE(value == "10");
+        }
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("settings_history", "[settings]")
+{
+    CATCH_START_SECTION("settings_history: values at a revision or a time")
+    {
+        std::string const path(create_definitions(
+                  "history-values"
+                , {
+                      { "history.ini", "[test::history]\n"
+                                       "default=none\n"
+                                       "help=a setting used to test the history\n" },
+                  }));
+
+        fluid_settings::settings s;
+        CATCH_REQUIRE(s.load_definitions(path, 1));
+        s.set_history_depth(100);
+
+        fluid_settings::timestamp_t const t1(1'700'000'000'000'000'000LL);
+        fluid_settings::timestamp_t const t2(1'700'000'100'000'000'000LL);
+        fluid_settings::timestamp_t const t3(1'700'000'200'000'000'000LL);
+
+        fluid_settings::history::revision_t const r0(s.get_revision());
+        CATCH_REQUIRE(s.set_value("test::history", "one", 50, t1) == fluid_settings::set_result_t::SET_RESULT_NEW);
+        fluid_settings::history::revision_t const r1(s.get_revision());
+        CATCH_REQUIRE(s.set_value("test::history", "two", 50, t2) == fluid_settings::set_result_t::SET_RESULT_CHANGED);
+        CATCH_REQUIRE(s.set_value("test::history", "high", 60, t3) == fluid_settings::set_result_t::SET_RESULT_NEW_PRIORITY);
+
+        fluid_settings::setting_id_t const id(s.resolve("test::history"));
+        std::string value;
+        CATCH_REQUIRE(s.get_value_at(id, value, r0) == fluid_settings::get_result_t::GET_RESULT_DEFAULT);
+        CATCH_REQUIRE(value == "none");
+        CATCH_REQUIRE(s.get_value_at(id, value, r1) == fluid_settings::get_result_t::GET_RESULT_SUCCESS);
+        CATCH_REQUIRE(value == "one");
+        CATCH_REQUIRE(s.get_value_at(id, value, s.get_revision()) == fluid_settings::get_result_t::GET_RESULT_SUCCESS);
+        CATCH_REQUIRE(value == "high");
+
+        // the history uses the timestamps of the values, not the time
+        // at which they were set
+        //
+        CATCH_REQUIRE(s.get_value_at(
+                  id
+                , value
+                , fluid_settings::history::LATEST_REVISION
+                , fluid_settings::timestamp_t(1'700'000'050'000'000'000LL)) == fluid_settings::get_result_t::GET_RESULT_SUCCESS);
+        CATCH_REQUIRE(value == "one");
+        CATCH_REQUIRE(s.get_value_at(
+                  id
+                , value
+                , fluid_settings::history::LATEST_REVISION
+                , fluid_settings::timestamp_t(1'700'000'150'000'000'000LL)) == fluid_settings::get_result_t::GET_RESULT_SUCCESS);
+        CATCH_REQUIRE(value == "two");
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("settings_history: rollback of one namespace")
+    {
+        std::string const path(create_definitions(
+                  "history-rollback"
+                , {
+                      { "history.ini", "[test::rollback]\n"
+                                       "help=a setting used to test the rollback\n"
+                                       "\n"
+                                       "[other::rollback]\n"
+                                       "help=a setting which must not be rolled back\n" },
+                  }));
+
+        fluid_settings::settings s;
+        CATCH_REQUIRE(s.load_definitions(path, 1));
+        s.set_history_depth(100);
+
+        fluid_settings::timestamp_t const t1(1'700'000'000'000'000'000LL);
+        fluid_settings::timestamp_t const t2(1'700'000'100'000'000'000LL);
+
+        CATCH_REQUIRE(s.set_value("test::rollback", "one", 50, t1) == fluid_settings::set_result_t::SET_RESULT_NEW);
+        fluid_settings::history::revision_t const r1(s.get_revision());
+        CATCH_REQUIRE(s.set_value("test::rollback", "two", 50, t2) == fluid_settings::set_result_t::SET_RESULT_CHANGED);
+        CATCH_REQUIRE(s.set_value("test::rollback", "high", 60, t2) == fluid_settings::set_result_t::SET_RESULT_NEW_PRIORITY);
+        CATCH_REQUIRE(s.set_value("other::rollback", "kept", 50, t2) == fluid_settings::set_result_t::SET_RESULT_NEW);
+
+        fluid_settings::change_set_t changes;
+        CATCH_REQUIRE(s.rollback("test", r1, changes));
+        CATCH_REQUIRE(changes.size() == 1);
+        CATCH_REQUIRE(changes[0] == s.resolve("test::rollback"));
+
+        std::string value;
+        CATCH_REQUIRE(s.get_value("test::rollback", value) == fluid_settings::get_result_t::GET_RESULT_SUCCESS);
+        CATCH_REQUIRE(value == "one");
+        CATCH_REQUIRE(s.get_values(changes[0])->size() == 1);
+        CATCH_REQUIRE(s.get_value("other::rollback", value) == fluid_settings::get_result_t::GET_RESULT_SUCCESS);
+        CATCH_REQUIRE(value == "kept");
+
+        // the rollback itself is part of the history
+        //
+        CATCH_REQUIRE(s.get_revision() > r1 + 3);
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("settings_batch", "[settings]")
+{
+    CATCH_START_SECTION("settings_batch: invalid values in a batch")
+    {
+        std::string const path(create_definitions(
+                  "batch"
+                , {
+                      { "batch.ini", "[test::batch]\n"
+                                     "help=a setting used to test batches\n" },
+                  }));
+
+        fluid_settings::settings s;
+        CATCH_REQUIRE(s.load_definitions(path, 1));
+
+        // the invalid mutations must not stop the batch
+        //
+        fluid_settings::timestamp_t const now(fluid_settings::timestamp_t::gettime());
+        fluid_settings::mutation_vector_t batch(4);
+        batch[0].f_name = "test::batch";
+        batch[0].f_priority = 50;
+        batch[0].f_timestamp = now;
+        batch[0].f_value = "first";
+        batch[1].f_name = "test::batch";
+        batch[1].f_priority = 100;
+        batch[1].f_timestamp = now;
+        batch[1].f_value = "bad priority";
+        batch[2].f_name = "test::batch";
+        batch[2].f_priority = 70;
+        batch[2].f_timestamp = fluid_settings::timestamp_t(1, 0);
+        batch[2].f_value = "bad timestamp";
+        batch[3].f_name = "test::batch";
+        batch[3].f_priority = 60;
+        batch[3].f_timestamp = now;
+        batch[3].f_value = "last";
+
+        fluid_settings::change_set_t changes;
+        fluid_settings::set_result_vector_t const results(s.apply_batch(batch, changes));
+        CATCH_REQUIRE(results.size() == 4);
+        CATCH_REQUIRE(results[0] == fluid_settings::set_result_t::SET_RESULT_NEW);
+        CATCH_REQUIRE(results[1] == fluid_settings::set_result_t::SET_RESULT_ERROR);
+        CATCH_REQUIRE(results[2] == fluid_settings::set_result_t::SET_RESULT_ERROR);
+        CATCH_REQUIRE(results[3] == fluid_settings::set_result_t::SET_RESULT_NEW_PRIORITY);
+        CATCH_REQUIRE(changes.size() == 1);
+
+        // the effective value was refreshed
+        //
+        std::string value;
+        CATCH_REQUIRE(s.get_value("test::batch", value) == fluid_settings::get_result_t::GET_RESULT_SUCCESS);
+        CATCH_REQUIRE(value == "last");
+        CATCH_REQUIRE(s.get_values(changes[0])->size() == 2);
+    }
+    CATCH_END_SECTION()
+}
+
+
+
+// vim: ts=4 sw=4 et
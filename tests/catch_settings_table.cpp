@@ -0,0 +1,140 @@
+// Copyright (c) 2011-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// self
+//
+#include    "catch_main.h"
+
+
+// fluid-settings
+//
+#include    <fluid-settings/settings_table.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+CATCH_TEST_CASE("settings_table", "[table]")
+{
+    CATCH_START_SECTION("settings_table: intern and find names")
+    {
+        fluid_settings::settings_table table;
+
+        CATCH_REQUIRE(table.size() == 0);
+        CATCH_REQUIRE(table.find("test::missing") == fluid_settings::settings_table::NO_INDEX);
+
+        // enough names to force the table to grow a few times
+        //
+        std::vector<fluid_settings::settings_table::index_t> indexes;
+        for(int i(0); i < 1000; ++i)
+        {
+            std::string const name("test::name-" + std::to_string(i));
+            fluid_settings::settings_table::index_t const idx(table.intern(name));
+            CATCH_REQUIRE(idx == static_cast<fluid_settings::settings_table::index_t>(i));
+            indexes.push_back(idx);
+        }
+        CATCH_REQUIRE(table.size() == 1000);
+
+        for(int i(0); i < 1000; ++i)
+        {
+            std::string const name("test::name-" + std::to_string(i));
+            CATCH_REQUIRE(table.find(name) == indexes[i]);
+            CATCH_REQUIRE(table.intern(name) == indexes[i]);
+            CATCH_REQUIRE(table.get_entry(indexes[i]).get_name() == name);
+        }
+        CATCH_REQUIRE(table.size() == 1000);
+        CATCH_REQUIRE(table.find("test::missing") == fluid_settings::settings_table::NO_INDEX);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("settings_table: sorted iteration")
+    {
+        fluid_settings::settings_table table;
+
+        table.intern("zebra::c");
+        table.intern("alpha::b");
+        table.intern("middle::a");
+
+        std::vector<std::string> names;
+        for(auto const idx : table.sorted_indexes())
+        {
+            names.push_back(table.get_entry(idx).get_name());
+        }
+        CATCH_REQUIRE(names == std::vector<std::string>({ "alpha::b", "middle::a", "zebra::c" }));
+
+        table.intern("beta::d");
+        CATCH_REQUIRE(table.sorted_indexes().size() == 4);
+        CATCH_REQUIRE(table.get_entry(table.sorted_indexes()[1]).get_name() == "beta::d");
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("settings_table: effective value")
+    {
+        fluid_settings::settings_table table;
+        fluid_settings::settings_table::entry & e(table.get_entry(table.intern("test::effective")));
+        fluid_settings::timestamp_t const now(fluid_settings::timestamp_t::gettime());
+
+        CATCH_REQUIRE_FALSE(e.get_effective().f_is_set);
+        CATCH_REQUIRE(e.get_effective().f_version == 0);
+
+        // without a definition, nothing is valid
+        //
+        CATCH_REQUIRE_FALSE(e.validate("low"));
+
+        fluid_settings::value low;
+        low.set_value("low", 10, now);
+        e.get_values().insert(low);
+        e.refresh_effective();
+        CATCH_REQUIRE(e.get_effective().f_is_set);
+        CATCH_REQUIRE_FALSE(e.get_effective().f_is_default);
+        CATCH_REQUIRE(e.get_effective().f_priority == 10);
+        CATCH_REQUIRE(*e.get_effective().f_value == "low");
+        CATCH_REQUIRE(e.get_effective().f_version == 1);
+
+        fluid_settings::value high;
+        high.set_value("high", 90, now);
+        e.get_values().insert(high);
+        e.refresh_effective();
+        CATCH_REQUIRE(e.get_effective().f_priority == 90);
+        CATCH_REQUIRE(*e.get_effective().f_value == "high");
+        CATCH_REQUIRE(e.get_effective().f_version == 2);
+
+        // the effective value shares the buffer of the value
+        //
+        CATCH_REQUIRE(e.get_effective().f_value == e.get_values().find(90)->get_buffer());
+
+        e.get_values().erase(90);
+        e.refresh_effective();
+        CATCH_REQUIRE(*e.get_effective().f_value == "low");
+
+        // no option attached, so no default
+        //
+        e.get_values().clear();
+        e.refresh_effective();
+        CATCH_REQUIRE_FALSE(e.get_effective().f_is_set);
+        CATCH_REQUIRE(e.get_effective().f_value == nullptr);
+        CATCH_REQUIRE(e.get_effective().f_version == 4);
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,110 @@
+// Copyright (c) 2011-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// self
+//
+#include    "catch_main.h"
+
+
+// fluid-settings
+//
+#include    <fluid-settings/snapshot.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+CATCH_TEST_CASE("snapshot", "[snapshot]")
+{
+    CATCH_START_SECTION("snapshot: read records")
+    {
+        std::shared_ptr<fluid_settings::snapshot::chunk_t> chunk(std::make_shared<fluid_settings::snapshot::chunk_t>());
+
+        // record 0: not defined
+        //
+
+        // record 1: defined, not set, no default
+        //
+        (*chunk)[1].f_defined = true;
+
+        // record 2: defined with a default only
+        //
+        (*chunk)[2].f_defined = true;
+        (*chunk)[2].f_default = SNAP_CATCH2_NAMESPACE::buffer("def");
+        (*chunk)[2].f_effective.f_is_set = true;
+        (*chunk)[2].f_effective.f_is_default = true;
+        (*chunk)[2].f_effective.f_value = (*chunk)[2].f_default;
+
+        // record 3: defined with two values and a default
+        //
+        auto values(std::make_shared<fluid_settings::snapshot::value_list_t>());
+        values->push_back({ 10, SNAP_CATCH2_NAMESPACE::buffer("low, with comma") });
+        values->push_back({ 50, SNAP_CATCH2_NAMESPACE::buffer("admin") });
+        (*chunk)[3].f_defined = true;
+        (*chunk)[3].f_default = SNAP_CATCH2_NAMESPACE::buffer("def3");
+        (*chunk)[3].f_effective.f_is_set = true;
+        (*chunk)[3].f_effective.f_priority = 50;
+        (*chunk)[3].f_effective.f_value = values->back().f_value;
+        (*chunk)[3].f_values = values;
+
+        fluid_settings::snapshot s(
+                  7
+                , 4
+                , fluid_settings::snapshot::chunk_vector_t{ chunk }
+                , SNAP_CATCH2_NAMESPACE::buffer("a,b"));
+
+        CATCH_REQUIRE(s.get_version() == 7);
+        CATCH_REQUIRE(s.size() == 4);
+        CATCH_REQUIRE(s.get_options() == "a,b");
+        CATCH_REQUIRE(s.get_record(4) == nullptr);
+
+        fluid_settings::value::buffer_t b;
+        std::string all;
+
+        CATCH_REQUIRE(s.get_buffer(0, b) == fluid_settings::get_result_t::GET_RESULT_UNKNOWN);
+        CATCH_REQUIRE(s.get_buffer(4, b) == fluid_settings::get_result_t::GET_RESULT_UNKNOWN);
+        CATCH_REQUIRE(s.get_default_value(0, b) == fluid_settings::get_result_t::GET_RESULT_UNKNOWN);
+
+        CATCH_REQUIRE(s.get_buffer(1, b) == fluid_settings::get_result_t::GET_RESULT_NOT_SET);
+        CATCH_REQUIRE(s.get_all_values(1, all) == fluid_settings::get_result_t::GET_RESULT_NOT_SET);
+        CATCH_REQUIRE(s.get_default_value(1, b) == fluid_settings::get_result_t::GET_RESULT_NOT_SET);
+
+        CATCH_REQUIRE(s.get_buffer(2, b) == fluid_settings::get_result_t::GET_RESULT_DEFAULT);
+        CATCH_REQUIRE(*b == "def");
+        CATCH_REQUIRE(s.get_buffer(2, b, 50) == fluid_settings::get_result_t::GET_RESULT_DEFAULT);
+        CATCH_REQUIRE(s.get_all_values(2, all) == fluid_settings::get_result_t::GET_RESULT_DEFAULT);
+        CATCH_REQUIRE(all == "def");
+
+        CATCH_REQUIRE(s.get_buffer(3, b) == fluid_settings::get_result_t::GET_RESULT_SUCCESS);
+        CATCH_REQUIRE(b == values->back().f_value);
+        CATCH_REQUIRE(s.get_buffer(3, b, 10) == fluid_settings::get_result_t::GET_RESULT_SUCCESS);
+        CATCH_REQUIRE(*b == "low, with comma");
+        CATCH_REQUIRE(s.get_buffer(3, b, 20) == fluid_settings::get_result_t::GET_RESULT_PRIORITY_NOT_FOUND);
+        CATCH_REQUIRE(s.get_all_values(3, all) == fluid_settings::get_result_t::GET_RESULT_SUCCESS);
+        CATCH_REQUIRE(all == "low\\, with comma,admin");
+        CATCH_REQUIRE(s.get_default_value(3, b) == fluid_settings::get_result_t::GET_RESULT_DEFAULT);
+        CATCH_REQUIRE(*b == "def3");
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
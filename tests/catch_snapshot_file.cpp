@@ -0,0 +1,340 @@
+// Copyright (c) 2011-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// self
+//
+#include    "catch_main.h"
+
+
+// fluid-settings
+//
+#include    <fluid-settings/snapshot_file.h>
+
+
+// C++
+//
+#include    <fstream>
+
+
+// C
+//
+#include    <errno.h>
+#include    <unistd.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+std::string snapshot_filename(std::string const & name)
+{
+    std::string const filename(SNAP_CATCH2_NAMESPACE::g_tmp_dir() + "/" + name + ".snapshot");
+    unlink(filename.c_str());
+    return filename;
+}
+
+
+void save_test_file(std::string const & filename, int count)
+{
+    fluid_settings::timestamp_t const now(fluid_settings::timestamp_t::gettime());
+    fluid_settings::snapshot_file file(filename);
+    for(int i(0); i < count; ++i)
+    {
+        fluid_settings::priority_set values;
+        fluid_settings::value v;
+        v.set_value("value-" + std::to_string(i), 50, now);
+        values.insert(v);
+        if(i % 3 == 0)
+        {
+            v.set_value("low\n|\\", 10, now);
+            values.insert(v);
+        }
+        file.add("test::name-" + std::to_string(1000 + i), values);
+    }
+    CATCH_REQUIRE(file.size() == static_cast<std::size_t>(count));
+    CATCH_REQUIRE(file.save());
+}
+
+
+}
+// no name namespace
+
+
+
+CATCH_TEST_CASE("snapshot_file", "[snapshot]")
+{
+    CATCH_START_SECTION("snapshot_file: save and load")
+    {
+        std::string const filename(snapshot_filename("save"));
+        save_test_file(filename, 100);
+
+        // the temporary file was renamed
+        //
+        CATCH_REQUIRE(access((filename + ".tmp").c_str(), F_OK) != 0);
+
+        fluid_settings::snapshot_file file(filename);
+        CATCH_REQUIRE(file.load());
+        CATCH_REQUIRE(file.size() == 100);
+
+        fluid_settings::record_t r;
+        for(int i(0); i < 100; ++i)
+        {
+            CATCH_REQUIRE(file.next(r));
+            CATCH_REQUIRE(r.f_name == "test::name-" + std::to_string(1000 + i));
+            if(i % 3 == 0)
+            {
+                CATCH_REQUIRE(r.f_values.size() == 2);
+                CATCH_REQUIRE(r.f_values[0].f_priority == 10);
+                CATCH_REQUIRE(r.f_values[0].f_value == "low\n|\\");
+                CATCH_REQUIRE(r.f_values[1].f_priority == 50);
+                CATCH_REQUIRE(r.f_values[1].f_value == "value-" + std::to_string(i));
+            }
+            else
+            {
+                CATCH_REQUIRE(r.f_values.size() == 1);
+                CATCH_REQUIRE(r.f_values[0].f_value == "value-" + std::to_string(i));
+            }
+        }
+        CATCH_REQUIRE_FALSE(file.next(r));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("snapshot_file: blocks and backup")
+    {
+        std::string const filename(snapshot_filename("blocks"));
+        unlink((filename + ".bak").c_str());
+        save_test_file(filename, 5000);
+        CATCH_REQUIRE(access((filename + ".bak").c_str(), F_OK) != 0);
+
+        std::size_t file_size(0);
+        {
+            fluid_settings::snapshot_file file(filename);
+            CATCH_REQUIRE(file.load());
+            CATCH_REQUIRE(file.size() == 5000);
+            file_size = file.get_file_size();
+            CATCH_REQUIRE(file_size > fluid_settings::snapshot_file::BLOCK_SIZE * 2);
+            CATCH_REQUIRE(file.get_base_size() == file_size);
+
+            fluid_settings::record_t r;
+            for(int i(0); i < 5000; ++i)
+            {
+                CATCH_REQUIRE(file.next(r));
+                CATCH_REQUIRE(r.f_name == "test::name-" + std::to_string(1000 + i));
+            }
+            CATCH_REQUIRE_FALSE(file.next(r));
+        }
+
+        // the second save keeps the first as a backup
+        //
+        save_test_file(filename, 5000);
+        CATCH_REQUIRE(access((filename + ".bak").c_str(), F_OK) == 0);
+
+        // a bad block in the middle of the first save is an error
+        //
+        {
+            std::fstream out(filename, std::ios::in | std::ios::out | std::ios::binary);
+            out.seekp(file_size / 2);
+            out.put('?');
+        }
+        fluid_settings::snapshot_file file(filename);
+        CATCH_REQUIRE_FALSE(file.load());
+
+        fluid_settings::snapshot_file backup(filename + ".bak");
+        CATCH_REQUIRE(backup.load());
+        CATCH_REQUIRE(backup.size() == 5000);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("snapshot_file: definition fingerprints")
+    {
+        std::string const filename(snapshot_filename("definitions"));
+        fluid_settings::timestamp_t const now(fluid_settings::timestamp_t::gettime());
+        {
+            fluid_settings::snapshot_file file(filename);
+            for(int i(0); i < 10; ++i)
+            {
+                fluid_settings::priority_set values;
+                fluid_settings::value v;
+                v.set_value("value-" + std::to_string(i), 50, now);
+                values.insert(v);
+                file.add("test::name-" + std::to_string(1000 + i), values, i * 0x1234);
+            }
+            CATCH_REQUIRE(file.save());
+        }
+
+        fluid_settings::snapshot_file file(filename);
+        CATCH_REQUIRE(file.load());
+        fluid_settings::record_t r;
+        for(int i(0); i < 10; ++i)
+        {
+            CATCH_REQUIRE(file.next(r));
+            CATCH_REQUIRE(r.f_name == "test::name-" + std::to_string(1000 + i));
+            CATCH_REQUIRE(r.f_definition == static_cast<std::uint32_t>(i * 0x1234));
+            CATCH_REQUIRE(r.f_values.size() == 1);
+            CATCH_REQUIRE(r.f_values[0].f_value == "value-" + std::to_string(i));
+        }
+        CATCH_REQUIRE_FALSE(file.next(r));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("snapshot_file: empty file")
+    {
+        std::string const filename(snapshot_filename("empty"));
+        save_test_file(filename, 0);
+
+        fluid_settings::snapshot_file file(filename);
+        CATCH_REQUIRE(file.load());
+        CATCH_REQUIRE(file.size() == 0);
+        fluid_settings::record_t r;
+        CATCH_REQUIRE_FALSE(file.next(r));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("snapshot_file: delta segments")
+    {
+        std::string const filename(snapshot_filename("delta"));
+        save_test_file(filename, 10);
+
+        std::size_t size(0);
+        std::size_t base_size(0);
+        {
+            fluid_settings::snapshot_file file(filename);
+            CATCH_REQUIRE(file.load());
+            size = file.get_file_size();
+            base_size = file.get_base_size();
+            CATCH_REQUIRE(size == base_size);
+        }
+
+        fluid_settings::timestamp_t const now(fluid_settings::timestamp_t::gettime());
+        for(int d(0); d < 3; ++d)
+        {
+            fluid_settings::snapshot_file file(filename);
+            fluid_settings::priority_set values;
+            fluid_settings::value v;
+            v.set_value("delta-" + std::to_string(d), 50, now);
+            values.insert(v);
+            file.add("test::name-1003", values);
+            values.clear();
+            file.add("test::name-1005", values);
+            CATCH_REQUIRE(file.append(size));
+            CATCH_REQUIRE(file.get_file_size() > size);
+            size = file.get_file_size();
+        }
+
+        // a partial segment at the end gets ignored
+        //
+        {
+            std::ofstream out(filename, std::ios::binary | std::ios::app);
+            out << std::string("FLSS\x01\x00\x00", 7);
+        }
+
+        fluid_settings::snapshot_file file(filename);
+        CATCH_REQUIRE(file.load());
+        CATCH_REQUIRE(file.size() == 10 + 3 * 2);
+        CATCH_REQUIRE(file.get_file_size() == size);
+        CATCH_REQUIRE(file.get_base_size() == base_size);
+
+        fluid_settings::record_t r;
+        for(int i(0); i < 10; ++i)
+        {
+            CATCH_REQUIRE(file.next(r));
+            CATCH_REQUIRE(r.f_name == "test::name-" + std::to_string(1000 + i));
+        }
+        for(int d(0); d < 3; ++d)
+        {
+            CATCH_REQUIRE(file.next(r));
+            CATCH_REQUIRE(r.f_name == "test::name-1003");
+            CATCH_REQUIRE(r.f_values.size() == 1);
+            CATCH_REQUIRE(r.f_values[0].f_value == "delta-" + std::to_string(d));
+            CATCH_REQUIRE(file.next(r));
+            CATCH_REQUIRE(r.f_name == "test::name-1005");
+            CATCH_REQUIRE(r.f_values.empty());
+        }
+        CATCH_REQUIRE_FALSE(file.next(r));
+
+        // the next append() overwrites the partial segment
+        //
+        fluid_settings::snapshot_file again(filename);
+        fluid_settings::priority_set values;
+        again.add("test::name-1009", values);
+        CATCH_REQUIRE(again.append(size));
+        CATCH_REQUIRE(again.load());
+        CATCH_REQUIRE(again.size() == 10 + 3 * 2 + 1);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("snapshot_file: corrupted file")
+    {
+        std::string const filename(snapshot_filename("corrupted"));
+        save_test_file(filename, 10);
+
+        {
+            std::fstream io(filename, std::ios::binary | std::ios::in | std::ios::out);
+            io.seekg(100);
+            char c(0);
+            io.get(c);
+            io.seekp(100);
+            io.put(static_cast<char>(c ^ 0x01));
+        }
+
+        fluid_settings::snapshot_file file(filename);
+        CATCH_REQUIRE_FALSE(file.load());
+        fluid_settings::record_t r;
+        CATCH_REQUIRE_FALSE(file.next(r));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("snapshot_file: missing, truncated or text file")
+    {
+        std::string const filename(snapshot_filename("invalid"));
+        fluid_settings::snapshot_file file(filename);
+        CATCH_REQUIRE_FALSE(file.load());
+
+        save_test_file(filename, 10);
+        CATCH_REQUIRE(truncate(filename.c_str(), 50) == 0);
+        CATCH_REQUIRE_FALSE(file.load());
+
+        {
+            std::ofstream out(filename);
+            out << "# text settings\ntest::name::50=123|value\n";
+        }
+        CATCH_REQUIRE_FALSE(file.load());
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("snapshot_file: quiet errors")
+    {
+        fluid_settings::snapshot_file file(SNAP_CATCH2_NAMESPACE::g_tmp_dir() + "/no-such-directory/quiet.settings");
+        file.set_quiet(true);
+        CATCH_REQUIRE(file.get_errno() == 0);
+        CATCH_REQUIRE_FALSE(file.save());
+        CATCH_REQUIRE(file.get_errno() == ENOENT);
+        CATCH_REQUIRE_FALSE(file.append(0));
+        CATCH_REQUIRE(file.get_errno() == ENOENT);
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
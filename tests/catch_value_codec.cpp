@@ -0,0 +1,223 @@
+// Copyright (c) 2022-2024  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/fluid-settings
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// self
+//
+#include    "catch_main.h"
+
+
+// fluid-settings
+//
+#include    <fluid-settings/value_codec.h>
+
+
+// snapdev
+//
+#include    <snapdev/string_replace_many.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+// the previous implementation, which defines the wire format
+//
+std::string reference_escape(std::string const & value)
+{
+    return snapdev::string_replace_many(
+                value,
+                {
+                    { "|", "\\P" },
+                    { "\\", "\\S" },
+                    { "\n", "\\n" },
+                    { "\r", "\\r" },
+                });
+}
+
+
+std::string reference_unescape(std::string const & value)
+{
+    return snapdev::string_replace_many(
+                value,
+                {
+                    { "\\P", "|" },
+                    { "\\S", "\\" },
+                    { "\\n", "\n" },
+                    { "\\r", "\r" },
+                });
+}
+
+
+// random strings with many special characters, of all the lengths
+// around the size of the SIMD registers
+//
+std::string random_value()
+{
+    char const interesting[] = "|\\\n\rPSnr,a";
+    std::string value;
+    int const length(rand() % 100);
+    for(int i(0); i < length; ++i)
+    {
+        switch(rand() % 4)
+        {
+        case 0:
+            value += interesting[rand() % (sizeof(interesting) - 1)];
+            break;
+
+        case 1:
+            value += static_cast<char>(rand());
+            break;
+
+        default:
+            value += static_cast<char>('a' + rand() % 26);
+            break;
+
+        }
+    }
+    return value;
+}
+
+
+}
+// no name namespace
+
+
+
+CATCH_TEST_CASE("value_codec", "[codec]")
+{
+    CATCH_START_SECTION("value_codec: escape known values")
+    {
+        std::string out;
+        fluid_settings::escape_value(out, "plain");
+        CATCH_REQUIRE(out == "plain");
+
+        out = "prefix:";
+        fluid_settings::escape_value(out, "a|b\\c\nd\re\\P");
+        CATCH_REQUIRE(out == "prefix:a\\Pb\\Sc\\nd\\re\\SP");
+
+        std::string value;
+        fluid_settings::unescape_value(value, "a\\Pb\\Sc\\nd\\re\\SP");
+        CATCH_REQUIRE(value == "a|b\\c\nd\re\\P");
+
+        // unknown and trailing escapes are kept as is
+        //
+        value.clear();
+        fluid_settings::unescape_value(value, "\\x\\\\P\\");
+        CATCH_REQUIRE(value == "\\x\\|\\");
+
+        out.clear();
+        fluid_settings::escape_commas(out, "a,b,,c\\,");
+        CATCH_REQUIRE(out == "a\\,b\\,\\,c\\\\,");
+
+        std::string const implementation(fluid_settings::escape_implementation());
+        CATCH_REQUIRE((implementation == "avx2" || implementation == "sse2" || implementation == "portable"));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("value_codec: fuzz against the previous implementation")
+    {
+        for(int i(0); i < 20'000; ++i)
+        {
+            std::string const value(random_value());
+
+            std::string escaped;
+            fluid_settings::escape_value(escaped, value);
+            CATCH_REQUIRE(escaped == reference_escape(value));
+
+            std::string unescaped;
+            fluid_settings::unescape_value(unescaped, escaped);
+            CATCH_REQUIRE(unescaped == value);
+
+            // random input, not generated by the escape
+            //
+            unescaped.clear();
+            fluid_settings::unescape_value(unescaped, value);
+            CATCH_REQUIRE(unescaped == reference_unescape(value));
+
+            std::string commas;
+            fluid_settings::escape_commas(commas, value);
+            CATCH_REQUIRE(commas == snapdev::string_replace_many(value, { { ",", "\\," } }));
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("value_codec: parse serialized values")
+    {
+        for(int i(0); i < 1'000; ++i)
+        {
+            std::vector<std::string> values;
+            std::string serialized;
+            int const count(rand() % 5);
+            for(int j(0); j < count; ++j)
+            {
+                values.push_back(random_value());
+                serialized += std::to_string(j * 10 + 1);
+                serialized += '|';
+                serialized += std::to_string(1'700'000'000'000'000'000LL + i);
+                serialized += '|';
+                serialized += reference_escape(values.back());
+                serialized += '\n';
+            }
+
+            fluid_settings::serialized_parser parser(serialized);
+            std::string_view line;
+            for(int j(0); j < count; ++j)
+            {
+                CATCH_REQUIRE(parser.next_line(line));
+                fluid_settings::serialized_parser::entry_t entry;
+                CATCH_REQUIRE(fluid_settings::serialized_parser::parse_line(line, entry));
+                CATCH_REQUIRE(entry.f_priority == j * 10 + 1);
+                CATCH_REQUIRE(entry.f_timestamp == 1'700'000'000'000'000'000LL + i);
+                std::string value;
+                fluid_settings::unescape_value(value, entry.f_value);
+                CATCH_REQUIRE(value == values[j]);
+            }
+            CATCH_REQUIRE_FALSE(parser.next_line(line));
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("value_codec: invalid lines")
+    {
+        fluid_settings::serialized_parser parser("\n\n50|123|empty lines are skipped\n\n");
+        std::string_view line;
+        CATCH_REQUIRE(parser.next_line(line));
+        CATCH_REQUIRE(line == "50|123|empty lines are skipped");
+        CATCH_REQUIRE_FALSE(parser.next_line(line));
+
+        fluid_settings::serialized_parser::entry_t entry;
+        CATCH_REQUIRE(fluid_settings::serialized_parser::parse_line("50|123|", entry));
+        CATCH_REQUIRE(entry.f_value.empty());
+        CATCH_REQUIRE_FALSE(fluid_settings::serialized_parser::parse_line("50|123", entry));
+        CATCH_REQUIRE_FALSE(fluid_settings::serialized_parser::parse_line("50|123|a|b", entry));
+        CATCH_REQUIRE_FALSE(fluid_settings::serialized_parser::parse_line("|123|value", entry));
+        CATCH_REQUIRE_FALSE(fluid_settings::serialized_parser::parse_line("50||value", entry));
+        CATCH_REQUIRE_FALSE(fluid_settings::serialized_parser::parse_line("5x|123|value", entry));
+        CATCH_REQUIRE_FALSE(fluid_settings::serialized_parser::parse_line("50|12.3|value", entry));
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et